@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+public class BiasedLockBenchmark {
+    private final Object lock = new Object();
+    private long counter;
+
+    // The same thread locks the object over and over, with biased locking every iteration after
+    // the first one is a plain load and store of the lock word.
+    public void timeUncontendedReacquire(int count) {
+        for (int i = 0; i < count; ++i) {
+            synchronized (lock) {
+                counter++;
+            }
+        }
+    }
+
+    // Nested locking of the same object only updates the count.
+    public void timeRecursiveReacquire(int count) {
+        for (int i = 0; i < count; ++i) {
+            synchronized (lock) {
+                synchronized (lock) {
+                    counter++;
+                }
+            }
+        }
+    }
+
+    // Every iteration locks a fresh object on this thread and then on another thread, which has
+    // to revoke the reservation. Measures the cost of a revocation against a plain thin lock. Note
+    // that the runtime turns biased locking off once revocations get too frequent.
+    public void timeRevocation(int count) throws InterruptedException {
+        final Object[] objects = new Object[count];
+        for (int i = 0; i < count; ++i) {
+            objects[i] = new Object();
+            synchronized (objects[i]) {
+                counter++;
+            }
+        }
+        Thread thread = new Thread() {
+            public void run() {
+                for (Object object : objects) {
+                    synchronized (object) {
+                        counter++;
+                    }
+                }
+            }
+        };
+        thread.start();
+        thread.join();
+    }
+}
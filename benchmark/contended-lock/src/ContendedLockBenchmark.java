@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+public class ContendedLockBenchmark {
+    private static final int THREADS = 4;
+
+    private final Object lock = new Object();
+    private long counter;
+
+    // The lock is held for a few instructions, a running owner releases it almost immediately.
+    public void timeShortHold(int count) throws InterruptedException {
+        runContended(count, 1);
+    }
+
+    // The lock is held long enough for spinning waiters to give up and block.
+    public void timeLongHold(int count) throws InterruptedException {
+        runContended(count, 1000);
+    }
+
+    // The owner sleeps while holding the lock, spinning on it is pointless.
+    public void timeSleepingOwner(int count) throws InterruptedException {
+        Thread[] threads = new Thread[THREADS];
+        for (int t = 0; t < THREADS; ++t) {
+            final int iterations = count / THREADS;
+            threads[t] = new Thread() {
+                public void run() {
+                    for (int i = 0; i < iterations; ++i) {
+                        synchronized (lock) {
+                            if ((i & 63) == 0) {
+                                try {
+                                    Thread.sleep(0, 100000);
+                                } catch (InterruptedException e) {
+                                    throw new Error(e);
+                                }
+                            }
+                            counter++;
+                        }
+                    }
+                }
+            };
+        }
+        startAndJoin(threads);
+    }
+
+    private void runContended(int count, final int work) throws InterruptedException {
+        Thread[] threads = new Thread[THREADS];
+        for (int t = 0; t < THREADS; ++t) {
+            final int iterations = count / THREADS;
+            threads[t] = new Thread() {
+                public void run() {
+                    for (int i = 0; i < iterations; ++i) {
+                        synchronized (lock) {
+                            $noinline$work(work);
+                        }
+                    }
+                }
+            };
+        }
+        startAndJoin(threads);
+    }
+
+    private void $noinline$work(int work) {
+        for (int i = 0; i < work; ++i) {
+            counter = counter * 31 + i;
+        }
+    }
+
+    private static void startAndJoin(Thread[] threads) throws InterruptedException {
+        for (Thread thread : threads) {
+            thread.start();
+        }
+        for (Thread thread : threads) {
+            thread.join();
+        }
+    }
+}
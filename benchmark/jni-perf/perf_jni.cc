@@ -16,6 +16,7 @@
 
 #include <assert.h>
 
+#include "base/mutex.h"
 #include "jni.h"
 #include "scoped_thread_state_change-inl.h"
 #include "thread.h"
@@ -34,6 +35,39 @@ extern "C" JNIEXPORT void JNICALL Java_JniPerfBenchmark_perfSOAUncheckedCall(JNI
   ScopedObjectAccessUnchecked soa(Thread::Current());
 }
 
+extern "C" JNIEXPORT void JNICALL Java_JniPerfBenchmark_perfSharedMutatorLockCall(JNIEnv*,
+                                                                                   jobject) {
+  // Shared acquisition without becoming runnable, as done by GC worker threads.
+  ReaderMutexLock mu(Thread::Current(), *Locks::mutator_lock_);
+}
+
+// A tiny helper called with each of the JNI flavors.
+extern "C" JNIEXPORT jint JNICALL Java_JniPerfBenchmark_perfAdd(JNIEnv*, jclass, jint a, jint b) {
+  return a + b;
+}
+
+extern "C" JNIEXPORT jint JNICALL Java_JniPerfBenchmark_perfFastAdd(JNIEnv*,
+                                                                    jclass,
+                                                                    jint a,
+                                                                    jint b) {
+  return a + b;
+}
+
+static jint perfCriticalAdd(jint a, jint b) {
+  return a + b;
+}
+
+// @CriticalNative methods don't record the calling frame, so the dlsym lookup cannot find them.
+extern "C" JNIEXPORT void JNICALL Java_JniPerfBenchmark_perfRegisterCriticalNatives(JNIEnv* env,
+                                                                                     jclass klass) {
+  JNINativeMethod methods[] = {
+    { "perfCriticalAdd", "(II)I", reinterpret_cast<void*>(perfCriticalAdd) },
+  };
+  jint result = env->RegisterNatives(klass, methods, arraysize(methods));
+  assert(result == JNI_OK);
+  UNUSED(result);
+}
+
 }  // namespace
 
 }  // namespace art
@@ -14,12 +14,23 @@
  * limitations under the License.
  */
 
+import dalvik.annotation.optimization.CriticalNative;
+import dalvik.annotation.optimization.FastNative;
+
 public class JniPerfBenchmark {
   private static final String MSG = "ABCDE";
 
   native void perfJniEmptyCall();
   native void perfSOACall();
   native void perfSOAUncheckedCall();
+  native void perfSharedMutatorLockCall();
+
+  static native int perfAdd(int a, int b);
+  @FastNative
+  static native int perfFastAdd(int a, int b);
+  @CriticalNative
+  static native int perfCriticalAdd(int a, int b);
+  static native void perfRegisterCriticalNatives();
 
   public void timeFastJNI(int N) {
     // TODO: This might be an intrinsic.
@@ -46,7 +57,91 @@ public class JniPerfBenchmark {
     }
   }
 
+  public int timeAddCall(int N) {
+    int sum = 0;
+    for (int i = 0; i < N; i++) {
+      sum = perfAdd(sum, i);
+    }
+    return sum;
+  }
+
+  public int timeFastAddCall(int N) {
+    int sum = 0;
+    for (int i = 0; i < N; i++) {
+      sum = perfFastAdd(sum, i);
+    }
+    return sum;
+  }
+
+  public int timeCriticalAddCall(int N) {
+    int sum = 0;
+    for (int i = 0; i < N; i++) {
+      sum = perfCriticalAdd(sum, i);
+    }
+    return sum;
+  }
+
+  public void timeSharedMutatorLockCall(int N) {
+    for (long i = 0; i < N; i++) {
+      perfSharedMutatorLockCall();
+    }
+  }
+
+  // The same total number of calls spread over several threads. The time per call should stay
+  // flat as threads are added unless the transitions share state.
+  public void timeSOACallOn2Threads(int N) throws InterruptedException {
+    runSOACallOnThreads(N, 2);
+  }
+
+  public void timeSOACallOn4Threads(int N) throws InterruptedException {
+    runSOACallOnThreads(N, 4);
+  }
+
+  public void timeSOACallOn8Threads(int N) throws InterruptedException {
+    runSOACallOnThreads(N, 8);
+  }
+
+  public void timeSharedMutatorLockCallOn8Threads(int N) throws InterruptedException {
+    Thread[] threads = new Thread[8];
+    for (int t = 0; t < threads.length; t++) {
+      final int iterations = N / threads.length;
+      threads[t] = new Thread() {
+        public void run() {
+          for (int i = 0; i < iterations; i++) {
+            perfSharedMutatorLockCall();
+          }
+        }
+      };
+    }
+    startAndJoin(threads);
+  }
+
+  private void runSOACallOnThreads(int N, int numThreads) throws InterruptedException {
+    Thread[] threads = new Thread[numThreads];
+    for (int t = 0; t < numThreads; t++) {
+      final int iterations = N / numThreads;
+      threads[t] = new Thread() {
+        public void run() {
+          for (int i = 0; i < iterations; i++) {
+            perfSOACall();
+          }
+        }
+      };
+    }
+    startAndJoin(threads);
+  }
+
+  private static void startAndJoin(Thread[] threads) throws InterruptedException {
+    for (Thread thread : threads) {
+      thread.start();
+    }
+    for (Thread thread : threads) {
+      thread.join();
+    }
+  }
+
   {
     System.loadLibrary("artbenchmark");
+    perfRegisterCriticalNatives();
   }
 }
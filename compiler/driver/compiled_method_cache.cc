@@ -0,0 +1,785 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "compiled_method_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#include "base/array_ref.h"
+#include "base/logging.h"
+#include "base/stringprintf.h"
+#include "base/unix_file/fd_file.h"
+#include "dex/verification_results.h"
+#include "dex/verified_method.h"
+#include "dex_file-inl.h"
+#include "dex_instruction-inl.h"
+#include "driver/compiler_driver.h"
+
+namespace art {
+
+static constexpr char kCacheMagic[] = { 'c', 'm', 'c', '\n' };
+
+// Smallest encodings of the counted records, used to reject counts that cannot fit in the file
+// before allocating or looping over them.
+static constexpr size_t kMinClassSize =
+    2u * sizeof(uint32_t) /* location, descriptor */ + sizeof(uint64_t) + sizeof(uint32_t);
+static constexpr size_t kMinMethodSize =
+    6u * sizeof(uint32_t) + 4u * sizeof(uint32_t) /* blobs */ + sizeof(uint32_t);
+static constexpr size_t kPatchSize = 4u * sizeof(uint32_t);
+
+// 64-bit FNV-1a.
+class FingerprintHasher {
+ public:
+  FingerprintHasher() : hash_(UINT64_C(0xcbf29ce484222325)) {}
+
+  void Update(const void* data, size_t size) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    for (size_t i = 0; i != size; ++i) {
+      hash_ = (hash_ ^ bytes[i]) * UINT64_C(0x100000001b3);
+    }
+  }
+
+  void Update(uint32_t value) {
+    Update(&value, sizeof(value));
+  }
+
+  void Update(uint64_t value) {
+    Update(&value, sizeof(value));
+  }
+
+  void Update(const char* str) {
+    // Include the terminating null so that consecutive strings cannot be confused.
+    Update(str, strlen(str) + 1u);
+  }
+
+  // Never returns 0 which is reserved for classes that cannot be cached.
+  uint64_t Get() const {
+    return (hash_ != 0u) ? hash_ : 1u;
+  }
+
+ private:
+  uint64_t hash_;
+};
+
+// Computes the class fingerprints. Classes are numbered across all the dex files; the class
+// defined first (in the order of the dex files) wins for duplicate descriptors, as in the runtime.
+class CompiledMethodCache::Fingerprinter {
+ public:
+  explicit Fingerprinter(const std::vector<const DexFile*>& dex_files)
+      : dex_files_(dex_files), first_class_(dex_files.size() + 1u, 0u) {
+    for (size_t i = 0; i != dex_files_.size(); ++i) {
+      const DexFile* dex_file = dex_files_[i];
+      first_class_[i + 1u] = first_class_[i] + dex_file->NumClassDefs();
+      for (uint32_t class_def_idx = 0; class_def_idx != dex_file->NumClassDefs(); ++class_def_idx) {
+        const DexFile::ClassDef& class_def = dex_file->GetClassDef(class_def_idx);
+        // Keeps the first definition.
+        classes_.emplace(dex_file->GetClassDescriptor(class_def), first_class_[i] + class_def_idx);
+      }
+    }
+    size_t num_classes = first_class_.back();
+    hashes_.resize(num_classes, 0u);
+    cacheable_.resize(num_classes, true);
+    edges_.resize(num_classes);
+  }
+
+  std::vector<std::vector<uint64_t>> Compute() {
+    for (size_t i = 0; i != dex_files_.size(); ++i) {
+      const DexFile& dex_file = *dex_files_[i];
+      for (uint32_t class_def_idx = 0; class_def_idx != dex_file.NumClassDefs(); ++class_def_idx) {
+        HashClass(dex_file, class_def_idx, first_class_[i] + class_def_idx);
+      }
+    }
+    std::vector<uint64_t> combined = CombineTransitively();
+    std::vector<std::vector<uint64_t>> result(dex_files_.size());
+    for (size_t i = 0; i != dex_files_.size(); ++i) {
+      result[i].reserve(dex_files_[i]->NumClassDefs());
+      for (uint32_t node = first_class_[i]; node != first_class_[i + 1u]; ++node) {
+        result[i].push_back(cacheable_[node] ? combined[node] : 0u);
+      }
+    }
+    return result;
+  }
+
+ private:
+  void AddEdge(uint32_t node, const char* descriptor) {
+    while (*descriptor == '[') {
+      ++descriptor;
+    }
+    if (*descriptor != 'L') {
+      return;  // Primitive type.
+    }
+    auto it = classes_.find(descriptor);
+    if (it != classes_.end() && it->second != node) {
+      edges_[node].push_back(it->second);
+    }
+  }
+
+  void HashType(FingerprintHasher* hasher, uint32_t node, const DexFile& dex_file,
+                dex::TypeIndex type_idx) {
+    const char* descriptor = dex_file.StringByTypeIdx(type_idx);
+    hasher->Update(descriptor);
+    AddEdge(node, descriptor);
+  }
+
+  // Hashes the declaration and the code of the class itself and collects the classes it refers to.
+  void HashClass(const DexFile& dex_file, uint32_t class_def_idx, uint32_t node) {
+    const DexFile::ClassDef& class_def = dex_file.GetClassDef(class_def_idx);
+    FingerprintHasher hasher;
+    hasher.Update(dex_file.GetClassDescriptor(class_def));
+    hasher.Update(class_def.access_flags_);
+    if (class_def.superclass_idx_.IsValid()) {
+      HashType(&hasher, node, dex_file, class_def.superclass_idx_);
+    }
+    const DexFile::TypeList* interfaces = dex_file.GetInterfacesList(class_def);
+    if (interfaces != nullptr) {
+      for (size_t i = 0; i != interfaces->Size(); ++i) {
+        HashType(&hasher, node, dex_file, interfaces->GetTypeItem(i).type_idx_);
+      }
+    }
+    // Static values may be folded into the code of other classes.
+    if (class_def.static_values_off_ != 0u) {
+      for (EncodedStaticFieldValueIterator it(dex_file, class_def); it.HasNext(); it.Next()) {
+        hasher.Update(static_cast<uint32_t>(it.GetValueType()));
+        if (it.GetValueType() == EncodedStaticFieldValueIterator::kString) {
+          hasher.Update(dex_file.StringDataByIdx(dex::StringIndex(it.GetJavaValue().i)));
+        } else if (it.GetValueType() == EncodedStaticFieldValueIterator::kType) {
+          HashType(&hasher, node, dex_file, dex::TypeIndex(it.GetJavaValue().i));
+        } else {
+          hasher.Update(static_cast<uint64_t>(it.GetJavaValue().j));
+        }
+      }
+    }
+    const uint8_t* class_data = dex_file.GetClassData(class_def);
+    if (class_data != nullptr) {
+      ClassDataItemIterator it(dex_file, class_data);
+      while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+        const DexFile::FieldId& field_id = dex_file.GetFieldId(it.GetMemberIndex());
+        hasher.Update(dex_file.GetFieldName(field_id));
+        hasher.Update(dex_file.GetFieldTypeDescriptor(field_id));
+        hasher.Update(it.GetFieldAccessFlags());
+        it.Next();
+      }
+      while (it.HasNextDirectMethod() || it.HasNextVirtualMethod()) {
+        uint32_t method_idx = it.GetMemberIndex();
+        const DexFile::MethodId& method_id = dex_file.GetMethodId(method_idx);
+        hasher.Update(method_idx);
+        hasher.Update(dex_file.GetMethodName(method_id));
+        hasher.Update(dex_file.GetMethodSignature(method_id).ToString().c_str());
+        hasher.Update(it.GetMethodAccessFlags());
+        const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+        if (code_item != nullptr) {
+          HashCode(&hasher, node, dex_file, *code_item);
+        }
+        it.Next();
+      }
+    }
+    hashes_[node] = hasher.Get();
+  }
+
+  void HashCode(FingerprintHasher* hasher,
+                uint32_t node,
+                const DexFile& dex_file,
+                const DexFile::CodeItem& code_item) {
+    hasher->Update(static_cast<uint32_t>(code_item.registers_size_));
+    hasher->Update(static_cast<uint32_t>(code_item.ins_size_));
+    hasher->Update(static_cast<uint32_t>(code_item.outs_size_));
+    hasher->Update(static_cast<uint32_t>(code_item.tries_size_));
+    hasher->Update(code_item.insns_size_in_code_units_);
+    // The indexes in the instructions are embedded in the compiled code, so hash them as they
+    // are, together with what they refer to.
+    hasher->Update(code_item.insns_, code_item.insns_size_in_code_units_ * sizeof(uint16_t));
+    for (uint32_t dex_pc = 0; dex_pc < code_item.insns_size_in_code_units_;) {
+      const Instruction* inst = Instruction::At(code_item.insns_ + dex_pc);
+      Instruction::Code opcode = inst->Opcode();
+      if (opcode == Instruction::RETURN_VOID_NO_BARRIER) {
+        cacheable_[node] = false;
+      }
+      Instruction::IndexType index_type = Instruction::IndexTypeOf(opcode);
+      uint32_t index = 0u;
+      if (index_type != Instruction::kIndexNone && index_type != Instruction::kIndexUnknown) {
+        index = (Instruction::FormatOf(opcode) == Instruction::k22c) ? inst->VRegC_22c()
+                                                                      : inst->VRegB();
+      }
+      switch (index_type) {
+        case Instruction::kIndexTypeRef:
+          HashType(hasher, node, dex_file, dex::TypeIndex(index));
+          break;
+        case Instruction::kIndexStringRef:
+          hasher->Update(dex_file.StringDataByIdx(dex::StringIndex(index)));
+          break;
+        case Instruction::kIndexFieldRef: {
+          const DexFile::FieldId& field_id = dex_file.GetFieldId(index);
+          HashType(hasher, node, dex_file, field_id.class_idx_);
+          hasher->Update(dex_file.GetFieldName(field_id));
+          hasher->Update(dex_file.GetFieldTypeDescriptor(field_id));
+          break;
+        }
+        case Instruction::kIndexMethodRef: {
+          const DexFile::MethodId& method_id = dex_file.GetMethodId(index);
+          HashType(hasher, node, dex_file, method_id.class_idx_);
+          hasher->Update(dex_file.GetMethodName(method_id));
+          hasher->Update(dex_file.GetMethodSignature(method_id).ToString().c_str());
+          break;
+        }
+        case Instruction::kIndexFieldOffset:
+        case Instruction::kIndexVtableOffset:
+        case Instruction::kIndexMethodAndProtoRef:
+        case Instruction::kIndexCallSiteRef:
+          // Quickened instructions depend on the runtime layout, and the code for
+          // invoke-polymorphic and invoke-custom is not worth the complexity here.
+          cacheable_[node] = false;
+          break;
+        default:
+          break;
+      }
+      dex_pc += inst->SizeInCodeUnits();
+    }
+    for (uint32_t i = 0; i != code_item.tries_size_; ++i) {
+      const DexFile::TryItem* try_item = DexFile::GetTryItems(code_item, i);
+      hasher->Update(try_item->start_addr_);
+      hasher->Update(static_cast<uint32_t>(try_item->insn_count_));
+      for (CatchHandlerIterator handlers(code_item, *try_item); handlers.HasNext();
+           handlers.Next()) {
+        if (handlers.GetHandlerTypeIndex().IsValid()) {
+          HashType(hasher, node, dex_file, handlers.GetHandlerTypeIndex());
+        }
+        hasher->Update(handlers.GetHandlerAddress());
+      }
+    }
+  }
+
+  // Folds the hashes of all the classes reachable from each class into its fingerprint.
+  // Cycles are handled by hashing each strongly connected component as a whole (Tarjan's
+  // algorithm, iterative to keep the native stack small for big apps). Components are
+  // completed in reverse topological order, so their successors are already hashed.
+  std::vector<uint64_t> CombineTransitively() {
+    static constexpr uint32_t kUnvisited = static_cast<uint32_t>(-1);
+    size_t num_classes = hashes_.size();
+    std::vector<uint32_t> index(num_classes, kUnvisited);
+    std::vector<uint32_t> low_link(num_classes, 0u);
+    std::vector<uint32_t> component(num_classes, kUnvisited);
+    std::vector<uint64_t> component_hashes;
+    std::vector<uint64_t> combined(num_classes, 0u);
+    std::vector<uint32_t> stack;
+    std::vector<std::pair<uint32_t, size_t>> work;  // Node and next edge to visit.
+    uint32_t next_index = 0u;
+    for (uint32_t root = 0; root != num_classes; ++root) {
+      if (index[root] != kUnvisited) {
+        continue;
+      }
+      index[root] = low_link[root] = next_index++;
+      stack.push_back(root);
+      work.emplace_back(root, 0u);
+      while (!work.empty()) {
+        uint32_t node = work.back().first;
+        size_t& edge = work.back().second;
+        if (edge != edges_[node].size()) {
+          uint32_t target = edges_[node][edge];
+          ++edge;
+          if (index[target] == kUnvisited) {
+            index[target] = low_link[target] = next_index++;
+            stack.push_back(target);
+            work.emplace_back(target, 0u);
+          } else if (component[target] == kUnvisited) {
+            // Still on the stack.
+            low_link[node] = std::min(low_link[node], index[target]);
+          }
+          continue;
+        }
+        work.pop_back();
+        if (!work.empty()) {
+          uint32_t parent = work.back().first;
+          low_link[parent] = std::min(low_link[parent], low_link[node]);
+        }
+        if (low_link[node] != index[node]) {
+          continue;
+        }
+        // `node` is the root of a component; pop it from the stack and hash it.
+        uint32_t component_idx = component_hashes.size();
+        std::vector<uint64_t> member_hashes;
+        auto component_begin = std::find(stack.begin(), stack.end(), node);
+        for (auto it = component_begin; it != stack.end(); ++it) {
+          component[*it] = component_idx;
+          member_hashes.push_back(hashes_[*it]);
+        }
+        std::vector<uint64_t> successor_hashes;
+        for (auto it = component_begin; it != stack.end(); ++it) {
+          for (uint32_t target : edges_[*it]) {
+            if (component[target] != component_idx) {
+              successor_hashes.push_back(component_hashes[component[target]]);
+            }
+          }
+        }
+        std::sort(member_hashes.begin(), member_hashes.end());
+        std::sort(successor_hashes.begin(), successor_hashes.end());
+        successor_hashes.erase(std::unique(successor_hashes.begin(), successor_hashes.end()),
+                               successor_hashes.end());
+        FingerprintHasher hasher;
+        hasher.Update(member_hashes.data(), member_hashes.size() * sizeof(uint64_t));
+        hasher.Update(successor_hashes.data(), successor_hashes.size() * sizeof(uint64_t));
+        component_hashes.push_back(hasher.Get());
+        for (auto it = component_begin; it != stack.end(); ++it) {
+          // Mix in the class' own hash so that the members of a component differ.
+          FingerprintHasher member_hasher;
+          member_hasher.Update(component_hashes.back());
+          member_hasher.Update(hashes_[*it]);
+          combined[*it] = member_hasher.Get();
+        }
+        stack.erase(component_begin, stack.end());
+      }
+    }
+    return combined;
+  }
+
+  const std::vector<const DexFile*>& dex_files_;
+  std::vector<uint32_t> first_class_;
+  std::unordered_map<std::string, uint32_t> classes_;
+  std::vector<uint64_t> hashes_;
+  std::vector<bool> cacheable_;
+  std::vector<std::vector<uint32_t>> edges_;
+};
+
+namespace {
+
+class CacheWriter {
+ public:
+  void Write(const void* data, size_t size) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    buffer_.insert(buffer_.end(), bytes, bytes + size);
+  }
+
+  void WriteU32(uint32_t value) {
+    Write(&value, sizeof(value));
+  }
+
+  void WriteU64(uint64_t value) {
+    Write(&value, sizeof(value));
+  }
+
+  void WriteBlob(ArrayRef<const uint8_t> data) {
+    WriteU32(data.size());
+    Write(data.data(), data.size());
+  }
+
+  void WriteString(const std::string& str) {
+    WriteBlob(ArrayRef<const uint8_t>(reinterpret_cast<const uint8_t*>(str.data()), str.size()));
+  }
+
+  const std::vector<uint8_t>& GetBuffer() const {
+    return buffer_;
+  }
+
+ private:
+  std::vector<uint8_t> buffer_;
+};
+
+class CacheReader {
+ public:
+  explicit CacheReader(const std::vector<uint8_t>& buffer)
+      : pos_(buffer.data()), end_(buffer.data() + buffer.size()) {}
+
+  bool Read(void* data, size_t size) {
+    if (static_cast<size_t>(end_ - pos_) < size) {
+      return false;
+    }
+    memcpy(data, pos_, size);
+    pos_ += size;
+    return true;
+  }
+
+  bool ReadU32(uint32_t* value) {
+    return Read(value, sizeof(*value));
+  }
+
+  bool ReadU64(uint64_t* value) {
+    return Read(value, sizeof(*value));
+  }
+
+  bool ReadBlob(std::vector<uint8_t>* data) {
+    uint32_t size;
+    if (!ReadU32(&size) || static_cast<size_t>(end_ - pos_) < size) {
+      return false;
+    }
+    data->assign(pos_, pos_ + size);
+    pos_ += size;
+    return true;
+  }
+
+  bool ReadString(std::string* str) {
+    std::vector<uint8_t> data;
+    if (!ReadBlob(&data)) {
+      return false;
+    }
+    str->assign(data.begin(), data.end());
+    return true;
+  }
+
+  bool IsAtEnd() const {
+    return pos_ == end_;
+  }
+
+  // Returns whether `count` records of at least `record_size` bytes each fit in the remaining data.
+  bool CanHold(uint32_t count, size_t record_size) const {
+    return count <= static_cast<size_t>(end_ - pos_) / record_size;
+  }
+
+ private:
+  const uint8_t* pos_;
+  const uint8_t* const end_;
+};
+
+}  // namespace
+
+static uint64_t ComputeConfigChecksum(const std::string& config) {
+  FingerprintHasher hasher;
+  hasher.Update(config.c_str());
+  return hasher.Get();
+}
+
+CompiledMethodCache::CompiledMethodCache(const std::vector<const DexFile*>& dex_files,
+                                         const std::string& config)
+    : dex_files_(dex_files),
+      config_checksum_(ComputeConfigChecksum(config)),
+      fingerprints_(Fingerprinter(dex_files).Compute()),
+      reused_method_count_(0u) {}
+
+int CompiledMethodCache::FindDexFile(const std::string& location) const {
+  for (size_t i = 0; i != dex_files_.size(); ++i) {
+    if (dex_files_[i]->GetLocation() == location) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+bool CompiledMethodCache::EncodePatch(const DexFile& dex_file,
+                                      const LinkerPatch& patch,
+                                      CachedPatch* out) {
+  out->type = patch.GetType();
+  out->literal_offset = patch.LiteralOffset();
+  out->value1 = 0u;
+  out->value2 = 0u;
+  const DexFile* target_dex_file = nullptr;
+  switch (patch.GetType()) {
+    case LinkerPatch::Type::kMethod:
+    case LinkerPatch::Type::kCall:
+    case LinkerPatch::Type::kCallRelative:
+      target_dex_file = patch.TargetMethod().dex_file;
+      out->value1 = patch.TargetMethod().dex_method_index;
+      break;
+    case LinkerPatch::Type::kType:
+    case LinkerPatch::Type::kTypeRelative:
+    case LinkerPatch::Type::kTypeBssEntry:
+      target_dex_file = patch.TargetTypeDexFile();
+      out->value1 = patch.TargetTypeIndex().index_;
+      out->value2 = (patch.GetType() != LinkerPatch::Type::kType) ? patch.PcInsnOffset() : 0u;
+      break;
+    case LinkerPatch::Type::kString:
+    case LinkerPatch::Type::kStringRelative:
+    case LinkerPatch::Type::kStringBssEntry:
+      target_dex_file = patch.TargetStringDexFile();
+      out->value1 = patch.TargetStringIndex().index_;
+      out->value2 = (patch.GetType() != LinkerPatch::Type::kString) ? patch.PcInsnOffset() : 0u;
+      break;
+    case LinkerPatch::Type::kBakerReadBarrierBranch:
+      out->value1 = patch.GetBakerCustomValue1();
+      out->value2 = patch.GetBakerCustomValue2();
+      return true;
+    case LinkerPatch::Type::kDexCacheArray:
+      // Element offsets depend on the dex cache arrays layout of the whole oat file.
+      return false;
+  }
+  // Patches into other dex files would need the target dex file recorded as well; such code
+  // is rare (cross-dex inlining) and is simply recompiled.
+  return target_dex_file == &dex_file;
+}
+
+LinkerPatch CompiledMethodCache::DecodePatch(const DexFile& dex_file, const CachedPatch& patch) {
+  switch (patch.type) {
+    case LinkerPatch::Type::kMethod:
+      return LinkerPatch::MethodPatch(patch.literal_offset, &dex_file, patch.value1);
+    case LinkerPatch::Type::kCall:
+      return LinkerPatch::CodePatch(patch.literal_offset, &dex_file, patch.value1);
+    case LinkerPatch::Type::kCallRelative:
+      return LinkerPatch::RelativeCodePatch(patch.literal_offset, &dex_file, patch.value1);
+    case LinkerPatch::Type::kType:
+      return LinkerPatch::TypePatch(patch.literal_offset, &dex_file, patch.value1);
+    case LinkerPatch::Type::kTypeRelative:
+      return LinkerPatch::RelativeTypePatch(
+          patch.literal_offset, &dex_file, patch.value2, patch.value1);
+    case LinkerPatch::Type::kTypeBssEntry:
+      return LinkerPatch::TypeBssEntryPatch(
+          patch.literal_offset, &dex_file, patch.value2, patch.value1);
+    case LinkerPatch::Type::kString:
+      return LinkerPatch::StringPatch(patch.literal_offset, &dex_file, patch.value1);
+    case LinkerPatch::Type::kStringRelative:
+      return LinkerPatch::RelativeStringPatch(
+          patch.literal_offset, &dex_file, patch.value2, patch.value1);
+    case LinkerPatch::Type::kStringBssEntry:
+      return LinkerPatch::StringBssEntryPatch(
+          patch.literal_offset, &dex_file, patch.value2, patch.value1);
+    case LinkerPatch::Type::kBakerReadBarrierBranch:
+      return LinkerPatch::BakerReadBarrierBranchPatch(
+          patch.literal_offset, patch.value1, patch.value2);
+    case LinkerPatch::Type::kDexCacheArray:
+      break;
+  }
+  LOG(FATAL) << "Unexpected cached patch type " << patch.type;
+  UNREACHABLE();
+}
+
+bool CompiledMethodCache::Load(File* file, std::string* error_msg) {
+  int64_t length = file->GetLength();
+  if (length < 0) {
+    *error_msg = StringPrintf("Failed to get the length of %s", file->GetPath().c_str());
+    return false;
+  }
+  std::vector<uint8_t> buffer(static_cast<size_t>(length));
+  if (!file->PreadFully(buffer.data(), buffer.size(), /* offset */ 0)) {
+    *error_msg = StringPrintf("Failed to read %s", file->GetPath().c_str());
+    return false;
+  }
+
+  CacheReader reader(buffer);
+  char magic[sizeof(kCacheMagic)];
+  uint32_t version;
+  uint64_t config_checksum;
+  uint32_t num_classes;
+  if (!reader.Read(magic, sizeof(magic)) ||
+      memcmp(magic, kCacheMagic, sizeof(magic)) != 0 ||
+      !reader.ReadU32(&version) ||
+      version != kCacheVersion) {
+    *error_msg = StringPrintf("%s is not a compiled method cache", file->GetPath().c_str());
+    return false;
+  }
+  if (!reader.ReadU64(&config_checksum) ||
+      !reader.ReadU32(&num_classes) ||
+      !reader.CanHold(num_classes, kMinClassSize)) {
+    *error_msg = StringPrintf("Truncated compiled method cache %s", file->GetPath().c_str());
+    return false;
+  }
+  if (config_checksum != config_checksum_) {
+    // Not an error, the previous compilation just used a different configuration.
+    return true;
+  }
+
+  std::map<MethodReference, CachedMethod, MethodReferenceComparator> methods;
+  for (uint32_t i = 0; i != num_classes; ++i) {
+    std::string location;
+    std::string descriptor;
+    uint64_t fingerprint;
+    uint32_t num_methods;
+    if (!reader.ReadString(&location) ||
+        !reader.ReadString(&descriptor) ||
+        !reader.ReadU64(&fingerprint) ||
+        !reader.ReadU32(&num_methods) ||
+        !reader.CanHold(num_methods, kMinMethodSize)) {
+      *error_msg = StringPrintf("Truncated compiled method cache %s", file->GetPath().c_str());
+      return false;
+    }
+    // Only keep the methods of classes that did not change.
+    const DexFile* dex_file = nullptr;
+    int dex_file_index = FindDexFile(location);
+    if (dex_file_index >= 0) {
+      const DexFile* candidate = dex_files_[dex_file_index];
+      const DexFile::TypeId* type_id = candidate->FindTypeId(descriptor.c_str());
+      const DexFile::ClassDef* class_def =
+          (type_id != nullptr) ? candidate->FindClassDef(candidate->GetIndexForTypeId(*type_id))
+                               : nullptr;
+      if (class_def != nullptr &&
+          fingerprints_[dex_file_index][candidate->GetIndexForClassDef(*class_def)] ==
+              fingerprint &&
+          fingerprint != 0u) {
+        dex_file = candidate;
+      }
+    }
+    for (uint32_t j = 0; j != num_methods; ++j) {
+      uint32_t method_idx;
+      uint32_t instruction_set;
+      uint32_t num_patches;
+      CachedMethod method;
+      if (!reader.ReadU32(&method_idx) ||
+          !reader.ReadU32(&method.verification_failures) ||
+          !reader.ReadU32(&instruction_set) ||
+          !reader.ReadU32(&method.frame_size_in_bytes) ||
+          !reader.ReadU32(&method.core_spill_mask) ||
+          !reader.ReadU32(&method.fp_spill_mask) ||
+          !reader.ReadBlob(&method.code) ||
+          !reader.ReadBlob(&method.method_info) ||
+          !reader.ReadBlob(&method.vmap_table) ||
+          !reader.ReadBlob(&method.cfi_info) ||
+          !reader.ReadU32(&num_patches) ||
+          !reader.CanHold(num_patches, kPatchSize)) {
+        *error_msg = StringPrintf("Truncated compiled method cache %s", file->GetPath().c_str());
+        return false;
+      }
+      method.instruction_set = static_cast<InstructionSet>(instruction_set);
+      method.patches.resize(num_patches);
+      for (CachedPatch& patch : method.patches) {
+        uint32_t type;
+        if (!reader.ReadU32(&type) ||
+            !reader.ReadU32(&patch.literal_offset) ||
+            !reader.ReadU32(&patch.value1) ||
+            !reader.ReadU32(&patch.value2)) {
+          *error_msg = StringPrintf("Truncated compiled method cache %s", file->GetPath().c_str());
+          return false;
+        }
+        if (type > static_cast<uint32_t>(LinkerPatch::Type::kBakerReadBarrierBranch) ||
+            static_cast<LinkerPatch::Type>(type) == LinkerPatch::Type::kDexCacheArray) {
+          *error_msg = StringPrintf("Bad patch type in %s", file->GetPath().c_str());
+          return false;
+        }
+        patch.type = static_cast<LinkerPatch::Type>(type);
+      }
+      if (dex_file != nullptr && method_idx < dex_file->NumMethodIds()) {
+        methods.emplace(MethodReference(dex_file, method_idx), std::move(method));
+      }
+    }
+  }
+  if (!reader.IsAtEnd()) {
+    *error_msg = StringPrintf("Trailing data in compiled method cache %s",
+                              file->GetPath().c_str());
+    return false;
+  }
+  methods_.swap(methods);
+  return true;
+}
+
+bool CompiledMethodCache::Save(File* file, CompilerDriver* driver, std::string* error_msg) const {
+  CacheWriter writer;
+  writer.Write(kCacheMagic, sizeof(kCacheMagic));
+  writer.WriteU32(kCacheVersion);
+  writer.WriteU64(config_checksum_);
+  uint32_t num_classes = 0u;
+  for (const std::vector<uint64_t>& fingerprints : fingerprints_) {
+    num_classes += std::count_if(fingerprints.begin(),
+                                 fingerprints.end(),
+                                 [](uint64_t fingerprint) { return fingerprint != 0u; });
+  }
+  writer.WriteU32(num_classes);
+
+  std::vector<CachedPatch> patches;
+  for (size_t i = 0; i != dex_files_.size(); ++i) {
+    const DexFile& dex_file = *dex_files_[i];
+    for (uint32_t class_def_idx = 0; class_def_idx != dex_file.NumClassDefs(); ++class_def_idx) {
+      uint64_t fingerprint = fingerprints_[i][class_def_idx];
+      if (fingerprint == 0u) {
+        continue;
+      }
+      const DexFile::ClassDef& class_def = dex_file.GetClassDef(class_def_idx);
+      // Collect the methods first, the count goes before them.
+      CacheWriter methods_writer;
+      uint32_t num_methods = 0u;
+      const uint8_t* class_data = dex_file.GetClassData(class_def);
+      if (class_data != nullptr) {
+        ClassDataItemIterator it(dex_file, class_data);
+        while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+          it.Next();
+        }
+        for (; it.HasNextDirectMethod() || it.HasNextVirtualMethod(); it.Next()) {
+          MethodReference method_ref(&dex_file, it.GetMemberIndex());
+          CompiledMethod* compiled_method = driver->GetCompiledMethod(method_ref);
+          if (compiled_method == nullptr ||
+              compiled_method->GetInstructionSet() != driver->GetInstructionSet() ||
+              (it.GetMethodAccessFlags() & (kAccNative | kAccAbstract)) != 0u) {
+            continue;
+          }
+          patches.clear();
+          bool encodable = true;
+          for (const LinkerPatch& patch : compiled_method->GetPatches()) {
+            patches.emplace_back();
+            if (!EncodePatch(dex_file, patch, &patches.back())) {
+              encodable = false;
+              break;
+            }
+          }
+          if (!encodable) {
+            continue;
+          }
+          const VerifiedMethod* verified_method =
+              driver->GetVerificationResults()->GetVerifiedMethod(method_ref);
+          DCHECK(verified_method != nullptr);
+          methods_writer.WriteU32(method_ref.dex_method_index);
+          methods_writer.WriteU32(verified_method->GetEncounteredVerificationFailures());
+          methods_writer.WriteU32(static_cast<uint32_t>(compiled_method->GetInstructionSet()));
+          methods_writer.WriteU32(compiled_method->GetFrameSizeInBytes());
+          methods_writer.WriteU32(compiled_method->GetCoreSpillMask());
+          methods_writer.WriteU32(compiled_method->GetFpSpillMask());
+          methods_writer.WriteBlob(compiled_method->GetQuickCode());
+          methods_writer.WriteBlob(compiled_method->GetMethodInfo());
+          methods_writer.WriteBlob(compiled_method->GetVmapTable());
+          methods_writer.WriteBlob(compiled_method->GetCFIInfo());
+          methods_writer.WriteU32(patches.size());
+          for (const CachedPatch& patch : patches) {
+            methods_writer.WriteU32(static_cast<uint32_t>(patch.type));
+            methods_writer.WriteU32(patch.literal_offset);
+            methods_writer.WriteU32(patch.value1);
+            methods_writer.WriteU32(patch.value2);
+          }
+          ++num_methods;
+        }
+      }
+      writer.WriteString(dex_file.GetLocation());
+      writer.WriteString(dex_file.GetClassDescriptor(class_def));
+      writer.WriteU64(fingerprint);
+      writer.WriteU32(num_methods);
+      writer.Write(methods_writer.GetBuffer().data(), methods_writer.GetBuffer().size());
+    }
+  }
+
+  const std::vector<uint8_t>& buffer = writer.GetBuffer();
+  if (file->SetLength(0) != 0 ||
+      !file->PwriteFully(buffer.data(), buffer.size(), /* offset */ 0) ||
+      file->FlushClose() != 0) {
+    *error_msg = StringPrintf("Failed to write compiled method cache %s", file->GetPath().c_str());
+    return false;
+  }
+  return true;
+}
+
+CompiledMethod* CompiledMethodCache::Lookup(CompilerDriver* driver,
+                                            const MethodReference& method_ref,
+                                            uint32_t verification_failures) const {
+  auto it = methods_.find(method_ref);
+  if (it == methods_.end()) {
+    return nullptr;
+  }
+  const CachedMethod& method = it->second;
+  if (method.verification_failures != verification_failures ||
+      method.instruction_set != driver->GetInstructionSet()) {
+    return nullptr;
+  }
+  std::vector<LinkerPatch> patches;
+  patches.reserve(method.patches.size());
+  for (const CachedPatch& patch : method.patches) {
+    patches.push_back(DecodePatch(*method_ref.dex_file, patch));
+  }
+  reused_method_count_.FetchAndAddRelaxed(1u);
+  return CompiledMethod::SwapAllocCompiledMethod(driver,
+                                                 method.instruction_set,
+                                                 ArrayRef<const uint8_t>(method.code),
+                                                 method.frame_size_in_bytes,
+                                                 method.core_spill_mask,
+                                                 method.fp_spill_mask,
+                                                 ArrayRef<const uint8_t>(method.method_info),
+                                                 ArrayRef<const uint8_t>(method.vmap_table),
+                                                 ArrayRef<const uint8_t>(method.cfi_info),
+                                                 ArrayRef<const LinkerPatch>(patches));
+}
+
+}  // namespace art
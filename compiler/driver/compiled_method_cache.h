@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_DRIVER_COMPILED_METHOD_CACHE_H_
+#define ART_COMPILER_DRIVER_COMPILED_METHOD_CACHE_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "atomic.h"
+#include "base/macros.h"
+#include "compiled_method.h"
+#include "method_reference.h"
+#include "os.h"
+
+namespace art {
+
+class CompilerDriver;
+class DexFile;
+
+// Compiled code of a previous compilation that can be reused for classes that did not change.
+//
+// The oat file does not keep the linker patches of the compiled methods, so the code cannot be
+// taken from the previous oat file. Instead, dex2oat --compiled-method-cache writes the compiled
+// methods together with their patches to a cache file, and reads them back in the next run.
+//
+// Every class gets a fingerprint which covers its declaration, the declarations of its
+// superclasses and interfaces, its code, and the values of all the dex file ids that its code
+// refers to, together with their indexes. Compiled code embeds these indexes, so equal
+// fingerprints mean that the code is still valid for the new dex file. The fingerprints of the
+// classes referenced from the code are folded in transitively, so changing a class also
+// invalidates all the code that may have inlined it or that depends on its layout.
+// Anything outside the compiled dex files (boot image, class path, compiler options, profile) is
+// described by a configuration string whose checksum must match for the cache to be used at all.
+class CompiledMethodCache {
+ public:
+  // Computes the fingerprints of all the classes in `dex_files`.
+  CompiledMethodCache(const std::vector<const DexFile*>& dex_files, const std::string& config);
+
+  // Loads the entries of a previous compilation. Entries of classes with a different fingerprint
+  // are dropped. Returns false if the cache could not be read; no entries are used then.
+  bool Load(File* file, std::string* error_msg);
+
+  // Writes the compiled methods of the unchanged and recompiled classes for the next run.
+  bool Save(File* file, CompilerDriver* driver, std::string* error_msg) const;
+
+  // Returns a new copy of the cached code for the method, or null if there is no valid entry.
+  // Thread-safe.
+  CompiledMethod* Lookup(CompilerDriver* driver,
+                         const MethodReference& method_ref,
+                         uint32_t verification_failures) const;
+
+  size_t GetLoadedMethodCount() const {
+    return methods_.size();
+  }
+
+  size_t GetReusedMethodCount() const {
+    return reused_method_count_.LoadRelaxed();
+  }
+
+ private:
+  struct CachedPatch {
+    LinkerPatch::Type type;
+    uint32_t literal_offset;
+    uint32_t value1;
+    uint32_t value2;
+  };
+
+  struct CachedMethod {
+    uint32_t verification_failures;
+    InstructionSet instruction_set;
+    uint32_t frame_size_in_bytes;
+    uint32_t core_spill_mask;
+    uint32_t fp_spill_mask;
+    std::vector<uint8_t> code;
+    std::vector<uint8_t> method_info;
+    std::vector<uint8_t> vmap_table;
+    std::vector<uint8_t> cfi_info;
+    std::vector<CachedPatch> patches;
+  };
+
+  class Fingerprinter;
+
+  static constexpr uint32_t kCacheVersion = 1u;
+
+  // Returns the index of the dex file with the given location, or -1.
+  int FindDexFile(const std::string& location) const;
+
+  static bool EncodePatch(const DexFile& dex_file, const LinkerPatch& patch, CachedPatch* out);
+  static LinkerPatch DecodePatch(const DexFile& dex_file, const CachedPatch& patch);
+
+  const std::vector<const DexFile*>& dex_files_;
+  const uint64_t config_checksum_;
+
+  // Fingerprints indexed by dex file and class def index. Zero marks classes that cannot be
+  // cached, e.g. because they use quickened or invoke-polymorphic instructions.
+  std::vector<std::vector<uint64_t>> fingerprints_;
+
+  std::map<MethodReference, CachedMethod, MethodReferenceComparator> methods_;
+
+  mutable Atomic<size_t> reused_method_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompiledMethodCache);
+};
+
+}  // namespace art
+
+#endif  // ART_COMPILER_DRIVER_COMPILED_METHOD_CACHE_H_
@@ -16,6 +16,7 @@
 
 #include "compiler_driver.h"
 
+#include <algorithm>
 #include <unordered_set>
 #include <vector>
 #include <unistd.h>
@@ -48,6 +49,7 @@
 #include "dex/dex_to_dex_decompiler.h"
 #include "dex/verification_results.h"
 #include "dex/verified_method.h"
+#include "driver/compiled_method_cache.h"
 #include "driver/compiler_options.h"
 #include "intrinsics_enum.h"
 #include "jni_internal.h"
@@ -302,12 +304,14 @@ CompilerDriver::CompilerDriver(
       compiler_context_(nullptr),
       support_boot_image_fixup_(true),
       dex_files_for_oat_file_(nullptr),
+      compiled_method_cache_(nullptr),
       compiled_method_storage_(swap_fd),
       profile_compilation_info_(profile_compilation_info),
       max_arena_alloc_(0),
       dex_to_dex_references_lock_("dex-to-dex references lock"),
       dex_to_dex_references_(),
-      current_dex_to_dex_methods_(nullptr) {
+      current_dex_to_dex_methods_(nullptr),
+      over_budget_methods_lock_("over budget methods lock") {
   DCHECK(compiler_options_ != nullptr);
 
   compiler_->Init();
@@ -672,7 +676,11 @@ static void CompileMethod(Thread* self,
         driver->IsMethodToCompile(method_ref) &&
         driver->ShouldCompileBasedOnProfile(method_ref);
 
-    if (compile) {
+    if (compile && driver->GetCompiledMethodCache() != nullptr) {
+      compiled_method = driver->GetCompiledMethodCache()->Lookup(
+          driver, method_ref, verified_method->GetEncounteredVerificationFailures());
+    }
+    if (compile && compiled_method == nullptr) {
       // NOTE: if compiler declines to compile this method, it will return null.
       compiled_method = driver->GetCompiler()->Compile(code_item,
                                                        access_flags,
@@ -1435,13 +1443,18 @@ bool CompilerDriver::CanAssumeClassIsLoaded(mirror::Class* klass) {
 
 void CompilerDriver::MarkForDexToDexCompilation(Thread* self, const MethodReference& method_ref) {
   MutexLock lock(self, dex_to_dex_references_lock_);
-  // Since we're compiling one dex file at a time, we need to look for the
-  // current dex file entry only at the end of dex_to_dex_references_.
-  if (dex_to_dex_references_.empty() ||
-      &dex_to_dex_references_.back().GetDexFile() != method_ref.dex_file) {
+  // The class defs of all dex files are compiled from a single queue, so keep one set per dex
+  // file. There are few dex files, a linear search is fine.
+  auto it = std::find_if(dex_to_dex_references_.begin(),
+                         dex_to_dex_references_.end(),
+                         [&](const DexFileMethodSet& method_set) {
+                           return &method_set.GetDexFile() == method_ref.dex_file;
+                         });
+  if (it == dex_to_dex_references_.end()) {
     dex_to_dex_references_.emplace_back(*method_ref.dex_file);
+    it = dex_to_dex_references_.end() - 1;
   }
-  dex_to_dex_references_.back().GetMethodIndexes().SetBit(method_ref.dex_method_index);
+  it->GetMethodIndexes().SetBit(method_ref.dex_method_index);
 }
 
 bool CompilerDriver::CanAccessTypeWithoutChecks(ObjPtr<mirror::Class> referrer_class,
@@ -1583,6 +1596,34 @@ class CompilationVisitor {
   virtual void Visit(size_t index) = 0;
 };
 
+class ClassDefVisitor {
+ public:
+  virtual ~ClassDefVisitor() {}
+  virtual void Visit(const DexFile& dex_file, size_t class_def_index) = 0;
+};
+
+// Estimate the cost of compiling a class from the size of its code items. The estimate is used
+// only to order the work, so a class with no methods still gets a small non-zero cost.
+static size_t EstimateClassDefCost(const DexFile& dex_file, size_t class_def_index) {
+  const uint8_t* class_data = dex_file.GetClassData(dex_file.GetClassDef(class_def_index));
+  if (class_data == nullptr) {
+    return 1u;
+  }
+  ClassDataItemIterator it(dex_file, class_data);
+  while (it.HasNextStaticField()) {
+    it.Next();
+  }
+  while (it.HasNextInstanceField()) {
+    it.Next();
+  }
+  size_t cost = 1u;
+  for (; it.HasNextDirectMethod() || it.HasNextVirtualMethod(); it.Next()) {
+    const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+    cost += 1u + ((code_item != nullptr) ? code_item->insns_size_in_code_units_ : 0u);
+  }
+  return cost;
+}
+
 class ParallelCompilationManager {
  public:
   ParallelCompilationManager(ClassLinker* class_linker,
@@ -1629,9 +1670,12 @@ class ParallelCompilationManager {
     CHECK_GT(work_units, 0U);
 
     index_.StoreRelaxed(begin);
+    std::vector<Task*> tasks;
+    tasks.reserve(work_units);
     for (size_t i = 0; i < work_units; ++i) {
-      thread_pool_->AddTask(self, new ForAllClosure(this, end, visitor));
+      tasks.push_back(new ForAllClosure(this, end, visitor));
     }
+    thread_pool_->AddTasks(self, tasks);
     thread_pool_->StartWorkers(self);
 
     // Ensure we're suspended while we're blocked waiting for the other threads to finish (worker
@@ -1645,11 +1689,66 @@ class ParallelCompilationManager {
     thread_pool_->StopWorkers(self);
   }
 
+  // Visit the class defs of all the given dex files from a single work queue, so that there is
+  // no barrier between dex files and the threads do not idle at the end of small dex files. The
+  // classes are handed out in the order of decreasing estimated cost, so that the big classes
+  // start first and the tail of the phase consists of cheap classes.
+  void ForAllClassDefs(const std::vector<const DexFile*>& dex_files,
+                       ClassDefVisitor* visitor,
+                       size_t work_units,
+                       TimingLogger* timings)
+      REQUIRES(!*Locks::mutator_lock_) {
+    std::vector<ClassDefWorkItem> work_items;
+    {
+      TimingLogger::ScopedTiming t("Estimate class costs", timings);
+      size_t num_class_defs = 0u;
+      for (const DexFile* dex_file : dex_files) {
+        num_class_defs += dex_file->NumClassDefs();
+      }
+      work_items.reserve(num_class_defs);
+      for (const DexFile* dex_file : dex_files) {
+        for (size_t i = 0, num = dex_file->NumClassDefs(); i != num; ++i) {
+          work_items.push_back({dex_file, i, EstimateClassDefCost(*dex_file, i)});
+        }
+      }
+      // Use a stable sort to keep the definition order for classes with the same cost.
+      std::stable_sort(work_items.begin(),
+                       work_items.end(),
+                       [](const ClassDefWorkItem& lhs, const ClassDefWorkItem& rhs) {
+                         return lhs.cost > rhs.cost;
+                       });
+    }
+    ClassDefWorkItemVisitor work_item_visitor(work_items, visitor);
+    ForAll(0, work_items.size(), &work_item_visitor, work_units);
+  }
+
   size_t NextIndex() {
     return index_.FetchAndAddSequentiallyConsistent(1);
   }
 
  private:
+  struct ClassDefWorkItem {
+    const DexFile* dex_file;
+    size_t class_def_index;
+    size_t cost;
+  };
+
+  class ClassDefWorkItemVisitor : public CompilationVisitor {
+   public:
+    ClassDefWorkItemVisitor(const std::vector<ClassDefWorkItem>& work_items,
+                            ClassDefVisitor* visitor)
+        : work_items_(work_items), visitor_(visitor) {}
+
+    virtual void Visit(size_t index) OVERRIDE {
+      const ClassDefWorkItem& work_item = work_items_[index];
+      visitor_->Visit(*work_item.dex_file, work_item.class_def_index);
+    }
+
+   private:
+    const std::vector<ClassDefWorkItem>& work_items_;
+    ClassDefVisitor* const visitor_;
+  };
+
   class ForAllClosure : public Task {
    public:
     ForAllClosure(ParallelCompilationManager* manager, size_t end, CompilationVisitor* visitor)
@@ -2091,15 +2190,11 @@ void CompilerDriver::Verify(jobject jclass_loader,
   // Note: verification should not be pulling in classes anymore when compiling the boot image,
   //       as all should have been resolved before. As such, doing this in parallel should still
   //       be deterministic.
-  for (const DexFile* dex_file : dex_files) {
-    CHECK(dex_file != nullptr);
-    VerifyDexFile(jclass_loader,
-                  *dex_file,
-                  dex_files,
-                  parallel_thread_pool_.get(),
-                  parallel_thread_count_,
-                  timings);
-  }
+  VerifyDexFiles(jclass_loader,
+                 dex_files,
+                 parallel_thread_pool_.get(),
+                 parallel_thread_count_,
+                 timings);
 
   if (!GetCompilerOptions().IsBootImage()) {
     // Merge all VerifierDeps into the main one.
@@ -2114,15 +2209,15 @@ void CompilerDriver::Verify(jobject jclass_loader,
   }
 }
 
-class VerifyClassVisitor : public CompilationVisitor {
+class VerifyClassVisitor : public ClassDefVisitor {
  public:
   VerifyClassVisitor(const ParallelCompilationManager* manager, verifier::HardFailLogMode log_level)
      : manager_(manager), log_level_(log_level) {}
 
-  virtual void Visit(size_t class_def_index) REQUIRES(!Locks::mutator_lock_) OVERRIDE {
+  virtual void Visit(const DexFile& dex_file, size_t class_def_index)
+      REQUIRES(!Locks::mutator_lock_) OVERRIDE {
     ATRACE_CALL();
     ScopedObjectAccess soa(Thread::Current());
-    const DexFile& dex_file = *manager_->GetDexFile();
     const DexFile::ClassDef& class_def = dex_file.GetClassDef(class_def_index);
     const char* descriptor = dex_file.GetClassDescriptor(class_def);
     ClassLinker* class_linker = manager_->GetClassLinker();
@@ -2183,7 +2278,7 @@ class VerifyClassVisitor : public CompilationVisitor {
           << klass->PrettyDescriptor() << ": state=" << klass->GetStatus();
 
       // Class has a meaningful status for the compiler now, record it.
-      ClassReference ref(manager_->GetDexFile(), class_def_index);
+      ClassReference ref(&dex_file, class_def_index);
       manager_->GetCompiler()->RecordClassStatus(ref, klass->GetStatus());
 
       // It is *very* problematic if there are verification errors in the boot classpath. For example,
@@ -2219,21 +2314,20 @@ class VerifyClassVisitor : public CompilationVisitor {
   const verifier::HardFailLogMode log_level_;
 };
 
-void CompilerDriver::VerifyDexFile(jobject class_loader,
-                                   const DexFile& dex_file,
-                                   const std::vector<const DexFile*>& dex_files,
-                                   ThreadPool* thread_pool,
-                                   size_t thread_count,
-                                   TimingLogger* timings) {
-  TimingLogger::ScopedTiming t("Verify Dex File", timings);
+void CompilerDriver::VerifyDexFiles(jobject class_loader,
+                                    const std::vector<const DexFile*>& dex_files,
+                                    ThreadPool* thread_pool,
+                                    size_t thread_count,
+                                    TimingLogger* timings) {
+  TimingLogger::ScopedTiming t("Verify Dex Files", timings);
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
-  ParallelCompilationManager context(class_linker, class_loader, this, &dex_file, dex_files,
+  ParallelCompilationManager context(class_linker, class_loader, this, nullptr, dex_files,
                                      thread_pool);
   verifier::HardFailLogMode log_level = GetCompilerOptions().AbortOnHardVerifierFailure()
                               ? verifier::HardFailLogMode::kLogInternalFatal
                               : verifier::HardFailLogMode::kLogWarning;
   VerifyClassVisitor visitor(&context, log_level);
-  context.ForAll(0, dex_file.NumClassDefs(), &visitor, thread_count);
+  context.ForAllClassDefs(dex_files, &visitor, thread_count, timings);
 }
 
 class SetVerifiedClassVisitor : public CompilationVisitor {
@@ -2567,19 +2661,16 @@ void CompilerDriver::Compile(jobject class_loader,
   }
 
   DCHECK(current_dex_to_dex_methods_ == nullptr);
-  for (const DexFile* dex_file : dex_files) {
-    CHECK(dex_file != nullptr);
-    CompileDexFile(class_loader,
-                   *dex_file,
-                   dex_files,
-                   parallel_thread_pool_.get(),
-                   parallel_thread_count_,
-                   timings);
-    const ArenaPool* const arena_pool = Runtime::Current()->GetArenaPool();
-    const size_t arena_alloc = arena_pool->GetBytesAllocated();
-    max_arena_alloc_ = std::max(arena_alloc, max_arena_alloc_);
-    Runtime::Current()->ReclaimArenaPoolMemory();
-  }
+  CompileDexFiles(class_loader,
+                  dex_files,
+                  dex_files,
+                  parallel_thread_pool_.get(),
+                  parallel_thread_count_,
+                  timings);
+  const ArenaPool* const arena_pool = Runtime::Current()->GetArenaPool();
+  const size_t arena_alloc = arena_pool->GetBytesAllocated();
+  max_arena_alloc_ = std::max(arena_alloc, max_arena_alloc_);
+  Runtime::Current()->ReclaimArenaPoolMemory();
 
   ArrayRef<DexFileMethodSet> dex_to_dex_references;
   {
@@ -2590,25 +2681,25 @@ void CompilerDriver::Compile(jobject class_loader,
   }
   for (const auto& method_set : dex_to_dex_references) {
     current_dex_to_dex_methods_ = &method_set.GetMethodIndexes();
-    CompileDexFile(class_loader,
-                   method_set.GetDexFile(),
-                   dex_files,
-                   parallel_thread_pool_.get(),
-                   parallel_thread_count_,
-                   timings);
+    CompileDexFiles(class_loader,
+                    { &method_set.GetDexFile() },
+                    dex_files,
+                    parallel_thread_pool_.get(),
+                    parallel_thread_count_,
+                    timings);
   }
   current_dex_to_dex_methods_ = nullptr;
 
   VLOG(compiler) << "Compile: " << GetMemoryUsageString(false);
 }
 
-class CompileClassVisitor : public CompilationVisitor {
+class CompileClassVisitor : public ClassDefVisitor {
  public:
   explicit CompileClassVisitor(const ParallelCompilationManager* manager) : manager_(manager) {}
 
-  virtual void Visit(size_t class_def_index) REQUIRES(!Locks::mutator_lock_) OVERRIDE {
+  virtual void Visit(const DexFile& dex_file, size_t class_def_index)
+      REQUIRES(!Locks::mutator_lock_) OVERRIDE {
     ATRACE_CALL();
-    const DexFile& dex_file = *manager_->GetDexFile();
     const DexFile::ClassDef& class_def = dex_file.GetClassDef(class_def_index);
     ClassLinker* class_linker = manager_->GetClassLinker();
     jobject jclass_loader = manager_->GetClassLoader();
@@ -2719,17 +2810,17 @@ class CompileClassVisitor : public CompilationVisitor {
   const ParallelCompilationManager* const manager_;
 };
 
-void CompilerDriver::CompileDexFile(jobject class_loader,
-                                    const DexFile& dex_file,
-                                    const std::vector<const DexFile*>& dex_files,
-                                    ThreadPool* thread_pool,
-                                    size_t thread_count,
-                                    TimingLogger* timings) {
-  TimingLogger::ScopedTiming t("Compile Dex File", timings);
+void CompilerDriver::CompileDexFiles(jobject class_loader,
+                                     const std::vector<const DexFile*>& dex_files_to_compile,
+                                     const std::vector<const DexFile*>& dex_files,
+                                     ThreadPool* thread_pool,
+                                     size_t thread_count,
+                                     TimingLogger* timings) {
+  TimingLogger::ScopedTiming t("Compile Dex Files", timings);
   ParallelCompilationManager context(Runtime::Current()->GetClassLinker(), class_loader, this,
-                                     &dex_file, dex_files, thread_pool);
+                                     nullptr, dex_files, thread_pool);
   CompileClassVisitor visitor(&context);
-  context.ForAll(0, dex_file.NumClassDefs(), &visitor, thread_count);
+  context.ForAllClassDefs(dex_files_to_compile, &visitor, thread_count, timings);
 }
 
 void CompilerDriver::AddCompiledMethod(const MethodReference& method_ref,
@@ -2746,6 +2837,39 @@ void CompilerDriver::AddCompiledMethod(const MethodReference& method_ref,
       << method_ref.dex_file->PrettyMethod(method_ref.dex_method_index);
 }
 
+void CompilerDriver::RecordOverBudgetMethod(const MethodReference& method_ref,
+                                            uint64_t duration_ns,
+                                            size_t arena_bytes) {
+  VLOG(compiler) << "Compilation of " << method_ref.dex_file->PrettyMethod(
+      method_ref.dex_method_index) << " exceeded its budget after "
+      << PrettyDuration(duration_ns) << " and " << PrettySize(arena_bytes);
+  MutexLock mu(Thread::Current(), over_budget_methods_lock_);
+  over_budget_methods_.push_back(OverBudgetMethod { method_ref, duration_ns, arena_bytes });
+}
+
+void CompilerDriver::DumpOverBudgetMethods(std::ostream& os) const {
+  std::vector<OverBudgetMethod> methods;
+  {
+    MutexLock mu(Thread::Current(), over_budget_methods_lock_);
+    methods = over_budget_methods_;
+  }
+  if (methods.empty()) {
+    return;
+  }
+  std::sort(methods.begin(),
+            methods.end(),
+            [](const OverBudgetMethod& lhs, const OverBudgetMethod& rhs) {
+              return lhs.duration_ns > rhs.duration_ns;
+            });
+  os << "Methods compiled with the reduced pipeline after exceeding their budget: "
+     << methods.size() << "\n";
+  for (const OverBudgetMethod& method : methods) {
+    os << "  " << method.method_ref.dex_file->PrettyMethod(method.method_ref.dex_method_index)
+       << ": " << PrettyDuration(method.duration_ns) << ", " << PrettySize(method.arena_bytes)
+       << "\n";
+  }
+}
+
 CompiledClass* CompilerDriver::GetCompiledClass(ClassReference ref) const {
   MutexLock mu(Thread::Current(), compiled_classes_lock_);
   ClassTable::const_iterator it = compiled_classes_.find(ref);
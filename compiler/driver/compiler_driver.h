@@ -58,6 +58,7 @@ class VerifierDepsTest;
 class BitVector;
 class CompiledClass;
 class CompiledMethod;
+class CompiledMethodCache;
 class CompilerOptions;
 class DexCompilationUnit;
 struct InlineIGetIPutData;
@@ -116,6 +117,15 @@ class CompilerDriver {
         : ArrayRef<const DexFile* const>();
   }
 
+  // Set the cache of a previous compilation to take the code of unchanged methods from.
+  void SetCompiledMethodCache(const CompiledMethodCache* cache) {
+    compiled_method_cache_ = cache;
+  }
+
+  const CompiledMethodCache* GetCompiledMethodCache() const {
+    return compiled_method_cache_;
+  }
+
   void CompileAll(jobject class_loader,
                   const std::vector<const DexFile*>& dex_files,
                   TimingLogger* timings)
@@ -286,6 +296,16 @@ class CompilerDriver {
     return timings_logger_;
   }
 
+  // Records a method that exceeded its compilation budget and was compiled again with the
+  // reduced pipeline.
+  void RecordOverBudgetMethod(const MethodReference& method_ref,
+                              uint64_t duration_ns,
+                              size_t arena_bytes)
+      REQUIRES(!over_budget_methods_lock_);
+
+  // Dumps the methods that exceeded their compilation budget, slowest first.
+  void DumpOverBudgetMethods(std::ostream& os) const REQUIRES(!over_budget_methods_lock_);
+
   void SetDedupeEnabled(bool dedupe_enabled) {
     compiled_method_storage_.SetDedupeEnabled(dedupe_enabled);
   }
@@ -406,12 +426,12 @@ class CompilerDriver {
               const std::vector<const DexFile*>& dex_files,
               TimingLogger* timings);
 
-  void VerifyDexFile(jobject class_loader,
-                     const DexFile& dex_file,
-                     const std::vector<const DexFile*>& dex_files,
-                     ThreadPool* thread_pool,
-                     size_t thread_count,
-                     TimingLogger* timings)
+  // Verify the classes of all `dex_files` from a single work queue.
+  void VerifyDexFiles(jobject class_loader,
+                      const std::vector<const DexFile*>& dex_files,
+                      ThreadPool* thread_pool,
+                      size_t thread_count,
+                      TimingLogger* timings)
       REQUIRES(!Locks::mutator_lock_);
 
   void SetVerified(jobject class_loader,
@@ -440,12 +460,13 @@ class CompilerDriver {
   void Compile(jobject class_loader,
                const std::vector<const DexFile*>& dex_files,
                TimingLogger* timings) REQUIRES(!dex_to_dex_references_lock_);
-  void CompileDexFile(jobject class_loader,
-                      const DexFile& dex_file,
-                      const std::vector<const DexFile*>& dex_files,
-                      ThreadPool* thread_pool,
-                      size_t thread_count,
-                      TimingLogger* timings)
+  // Compile the classes of `dex_files_to_compile` from a single work queue.
+  void CompileDexFiles(jobject class_loader,
+                       const std::vector<const DexFile*>& dex_files_to_compile,
+                       const std::vector<const DexFile*>& dex_files,
+                       ThreadPool* thread_pool,
+                       size_t thread_count,
+                       TimingLogger* timings)
       REQUIRES(!Locks::mutator_lock_);
 
   bool MayInlineInternal(const DexFile* inlined_from, const DexFile* inlined_into) const;
@@ -527,6 +548,9 @@ class CompilerDriver {
   // List of dex files that will be stored in the oat file.
   const std::vector<const DexFile*>* dex_files_for_oat_file_;
 
+  // Compiled code of a previous compilation, may be null.
+  const CompiledMethodCache* compiled_method_cache_;
+
   CompiledMethodStorage compiled_method_storage_;
 
   // Info for profile guided compilation.
@@ -543,6 +567,14 @@ class CompilerDriver {
   // indexes for dex-to-dex compilation in the current dex file.
   const BitVector* current_dex_to_dex_methods_;
 
+  struct OverBudgetMethod {
+    MethodReference method_ref;
+    uint64_t duration_ns;
+    size_t arena_bytes;
+  };
+  mutable Mutex over_budget_methods_lock_;
+  std::vector<OverBudgetMethod> over_budget_methods_ GUARDED_BY(over_budget_methods_lock_);
+
   friend class CompileClassVisitor;
   friend class DexToDexDecompilerTest;
   friend class verifier::VerifierDepsTest;
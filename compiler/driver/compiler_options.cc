@@ -47,7 +47,9 @@ CompilerOptions::CompilerOptions()
       dump_cfg_append_(false),
       force_determinism_(false),
       register_allocation_strategy_(RegisterAllocator::kRegisterAllocatorDefault),
-      passes_to_run_(nullptr) {
+      passes_to_run_(nullptr),
+      method_compile_time_budget_ms_(kDefaultMethodCompileTimeBudgetMs),
+      method_compile_memory_budget_(kDefaultMethodCompileMemoryBudget) {
 }
 
 CompilerOptions::~CompilerOptions() {
@@ -104,7 +106,9 @@ CompilerOptions::CompilerOptions(CompilerFilter::Filter compiler_filter,
       dump_cfg_append_(dump_cfg_append),
       force_determinism_(force_determinism),
       register_allocation_strategy_(regalloc_strategy),
-      passes_to_run_(passes_to_run) {
+      passes_to_run_(passes_to_run),
+      method_compile_time_budget_ms_(kDefaultMethodCompileTimeBudgetMs),
+      method_compile_memory_budget_(kDefaultMethodCompileMemoryBudget) {
 }
 
 void CompilerOptions::ParseHugeMethodMax(const StringPiece& option, UsageFn Usage) {
@@ -131,6 +135,17 @@ void CompilerOptions::ParseInlineMaxCodeUnits(const StringPiece& option, UsageFn
   ParseUintOption(option, "--inline-max-code-units", &inline_max_code_units_, Usage);
 }
 
+void CompilerOptions::ParseMethodCompileTimeBudget(const StringPiece& option, UsageFn Usage) {
+  ParseUintOption(option,
+                  "--method-compile-time-budget-ms",
+                  &method_compile_time_budget_ms_,
+                  Usage);
+}
+
+void CompilerOptions::ParseMethodCompileMemoryBudget(const StringPiece& option, UsageFn Usage) {
+  ParseUintOption(option, "--method-compile-memory-budget", &method_compile_memory_budget_, Usage);
+}
+
 void CompilerOptions::ParseDumpInitFailures(const StringPiece& option,
                                             UsageFn Usage ATTRIBUTE_UNUSED) {
   DCHECK(option.starts_with("--dump-init-failures="));
@@ -204,6 +219,10 @@ bool CompilerOptions::ParseCompilerOption(const StringPiece& option, UsageFn Usa
     dump_cfg_append_ = true;
   } else if (option.starts_with("--register-allocation-strategy=")) {
     ParseRegisterAllocationStrategy(option, Usage);
+  } else if (option.starts_with("--method-compile-time-budget-ms=")) {
+    ParseMethodCompileTimeBudget(option, Usage);
+  } else if (option.starts_with("--method-compile-memory-budget=")) {
+    ParseMethodCompileMemoryBudget(option, Usage);
   } else {
     // Option not recognized.
     return false;
@@ -48,6 +48,9 @@ class CompilerOptions FINAL {
   static const bool kDefaultGenerateMiniDebugInfo = false;
   static const size_t kDefaultInlineMaxCodeUnits = 32;
   static constexpr size_t kUnsetInlineMaxCodeUnits = -1;
+  // Budgets for compiling a single method; zero disables the budget.
+  static const size_t kDefaultMethodCompileTimeBudgetMs = 0;
+  static const size_t kDefaultMethodCompileMemoryBudget = 256 * MB;
 
   CompilerOptions();
   ~CompilerOptions();
@@ -257,6 +260,17 @@ class CompilerOptions FINAL {
     return passes_to_run_;
   }
 
+  // A method that takes longer than this to compile is compiled again with a reduced pipeline.
+  size_t GetMethodCompileTimeBudgetMs() const {
+    return method_compile_time_budget_ms_;
+  }
+
+  // A method that needs more arena memory than this to compile is compiled again with a
+  // reduced pipeline.
+  size_t GetMethodCompileMemoryBudget() const {
+    return method_compile_memory_budget_;
+  }
+
  private:
   void ParseDumpInitFailures(const StringPiece& option, UsageFn Usage);
   void ParseDumpCfgPasses(const StringPiece& option, UsageFn Usage);
@@ -267,6 +281,8 @@ class CompilerOptions FINAL {
   void ParseLargeMethodMax(const StringPiece& option, UsageFn Usage);
   void ParseHugeMethodMax(const StringPiece& option, UsageFn Usage);
   void ParseRegisterAllocationStrategy(const StringPiece& option, UsageFn Usage);
+  void ParseMethodCompileTimeBudget(const StringPiece& option, UsageFn Usage);
+  void ParseMethodCompileMemoryBudget(const StringPiece& option, UsageFn Usage);
 
   CompilerFilter::Filter compiler_filter_;
   size_t huge_method_threshold_;
@@ -321,6 +337,9 @@ class CompilerOptions FINAL {
   // compiler-dependant behavior.
   const std::vector<std::string>* passes_to_run_;
 
+  size_t method_compile_time_budget_ms_;
+  size_t method_compile_memory_budget_;
+
   friend class Dex2Oat;
   friend class DexToDexDecompilerTest;
   friend class CommonCompilerTest;
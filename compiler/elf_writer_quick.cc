@@ -32,8 +32,8 @@
 #include "elf_utils.h"
 #include "globals.h"
 #include "leb128.h"
-#include "linker/buffered_output_stream.h"
 #include "linker/file_output_stream.h"
+#include "linker/pipelined_output_stream.h"
 #include "thread-inl.h"
 #include "thread_pool.h"
 #include "utils.h"
@@ -121,7 +121,7 @@ class ElfWriterQuick FINAL : public ElfWriter {
   size_t rodata_size_;
   size_t text_size_;
   size_t bss_size_;
-  std::unique_ptr<BufferedOutputStream> output_stream_;
+  std::unique_ptr<PipelinedOutputStream> output_stream_;
   std::unique_ptr<ElfBuilder<ElfTypes>> builder_;
   std::unique_ptr<DebugInfoTask> debug_info_task_;
   std::unique_ptr<ThreadPool> debug_info_thread_pool_;
@@ -160,7 +160,7 @@ ElfWriterQuick<ElfTypes>::ElfWriterQuick(InstructionSet instruction_set,
       rodata_size_(0u),
       text_size_(0u),
       bss_size_(0u),
-      output_stream_(MakeUnique<BufferedOutputStream>(MakeUnique<FileOutputStream>(elf_file))),
+      output_stream_(MakeUnique<PipelinedOutputStream>(MakeUnique<FileOutputStream>(elf_file))),
       builder_(new ElfBuilder<ElfTypes>(instruction_set, features, output_stream_.get())) {}
 
 template <typename ElfTypes>
@@ -16,7 +16,9 @@
 
 #include "image.h"
 
+#include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -56,6 +58,11 @@ struct CompilationHelper {
   std::vector<ScratchFile> oat_files;
   std::vector<ScratchFile> vdex_files;
   std::string image_dir;
+  // The --dirty-image-objects entries to pass to the image writer. When set, image_bins is
+  // filled with the bins of the image objects, keyed by their "class <descriptor>" or
+  // "instance <descriptor>" entry.
+  std::unique_ptr<std::unordered_set<std::string>> dirty_image_objects;
+  std::map<std::string, std::set<size_t>> image_bins;
 
   void Compile(CompilerDriver* driver,
                ImageHeader::StorageMode storage_mode);
@@ -91,6 +98,8 @@ class ImageTest : public CommonCompilerTest {
     return new std::unordered_set<std::string>(image_classes_);
   }
 
+  static constexpr size_t kBinKnownDirty = ImageWriter::kBinKnownDirty;
+
   ArtMethod* FindCopiedMethod(ArtMethod* origin, mirror::Class* klass)
       REQUIRES_SHARED(Locks::mutator_lock_) {
     PointerSize pointer_size = class_linker_->GetImagePointerSize();
@@ -103,10 +112,54 @@ class ImageTest : public CommonCompilerTest {
     return nullptr;
   }
 
+ public:
+  // Record the bins that the writer put the image objects in, see CompilationHelper::image_bins.
+  static void CollectImageBins(ImageWriter* writer,
+                               std::map<std::string, std::set<size_t>>* image_bins)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
  private:
+  struct CollectImageBinsArgs {
+    ImageWriter* writer;
+    std::map<std::string, std::set<size_t>>* image_bins;
+  };
+
+  static void CollectImageBinsCallback(mirror::Object* obj, void* arg)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
   std::unordered_set<std::string> image_classes_;
 };
 
+constexpr size_t ImageTest::kBinKnownDirty;
+
+void ImageTest::CollectImageBins(ImageWriter* writer,
+                                 std::map<std::string, std::set<size_t>>* image_bins) {
+  CollectImageBinsArgs args = { writer, image_bins };
+  Runtime::Current()->GetHeap()->VisitObjects(CollectImageBinsCallback, &args);
+}
+
+void ImageTest::CollectImageBinsCallback(mirror::Object* obj, void* arg) {
+  CollectImageBinsArgs* args = reinterpret_cast<CollectImageBinsArgs*>(arg);
+  ImageWriter* writer = args->writer;
+  if (!writer->IsImageOffsetAssigned(obj)) {
+    return;  // Not in the image.
+  }
+  // Objects are laid out bin after bin, find the one containing the object's offset.
+  const ImageWriter::ImageInfo& image_info = writer->GetImageInfo(writer->GetOatIndex(obj));
+  size_t offset = writer->GetImageOffset(obj);
+  size_t bin = 0u;
+  while (bin != ImageWriter::kBinMirrorCount &&
+         offset >= image_info.bin_slot_offsets_[bin] + image_info.bin_slot_sizes_[bin]) {
+    ++bin;
+  }
+  ASSERT_NE(static_cast<size_t>(ImageWriter::kBinMirrorCount), bin);
+  std::string temp;
+  std::string entry = obj->IsClass()
+      ? std::string("class ") + obj->AsClass()->GetDescriptor(&temp)
+      : std::string("instance ") + obj->GetClass<kVerifyNone>()->GetDescriptor(&temp);
+  (*args->image_bins)[entry].insert(bin);
+}
+
 CompilationHelper::~CompilationHelper() {
   for (ScratchFile& image_file : image_files) {
     image_file.Unlink();
@@ -210,7 +263,8 @@ void CompilationHelper::Compile(CompilerDriver* driver,
                                                       /*compile_app_image*/false,
                                                       storage_mode,
                                                       oat_filename_vector,
-                                                      dex_file_to_oat_index_map));
+                                                      dex_file_to_oat_index_map,
+                                                      dirty_image_objects.get()));
   {
     {
       jobject class_loader = nullptr;
@@ -284,6 +338,10 @@ void CompilationHelper::Compile(CompilerDriver* driver,
       }
       bool image_space_ok = writer->PrepareImageAddressSpace();
       ASSERT_TRUE(image_space_ok);
+      if (dirty_image_objects != nullptr) {
+        ScopedObjectAccess soa(Thread::Current());
+        ImageTest::CollectImageBins(writer.get(), &image_bins);
+      }
 
       if (kIsVdexEnabled) {
         for (size_t i = 0, size = vdex_files.size(); i != size; ++i) {
@@ -529,6 +587,60 @@ TEST_F(ImageTest, TestImageLayout) {
   EXPECT_LT(image_sizes.back(), image_sizes_extra.back());
 }
 
+TEST_F(ImageTest, TestDirtyImageObjects) {
+  static const char* const kDirtyClass = "class Ljava/lang/Object;";
+  static const char* const kDirtyInstances = "instance Ljava/lang/String;";
+  // Compile without any dirty image objects to get the usual bins of the objects.
+  std::map<std::string, std::set<size_t>> usual_bins;
+  {
+    CompilationHelper helper;
+    helper.dirty_image_objects.reset(new std::unordered_set<std::string>());
+    Compile(ImageHeader::kStorageModeUncompressed, helper);
+    usual_bins = helper.image_bins;
+  }
+  TearDown();
+  runtime_.reset();
+  SetUp();
+  // Compile with a dirty image objects file in the format dumped by imgdiag, with comment lines
+  // and the sample addresses of the objects in trailing comments.
+  ScratchFile dirty_image_objects_file;
+  const std::string contents = std::string("# Dirty objects of the boot image\n") +
+      "#\n" +
+      kDirtyClass + " # 0x70001000\n" +
+      "\n" +
+      kDirtyInstances + "\t# 0x70002000 0x70002018\n" +
+      "# class Ljava/lang/String;\n";
+  ASSERT_TRUE(dirty_image_objects_file.GetFile()->WriteFully(contents.data(), contents.size()));
+  std::map<std::string, std::set<size_t>> image_bins;
+  {
+    CompilationHelper helper;
+    helper.dirty_image_objects =
+        ImageWriter::ReadDirtyImageObjects(dirty_image_objects_file.GetFilename().c_str());
+    ASSERT_TRUE(helper.dirty_image_objects != nullptr);
+    EXPECT_EQ(std::unordered_set<std::string>({ kDirtyClass, kDirtyInstances }),
+              *helper.dirty_image_objects);
+    Compile(ImageHeader::kStorageModeUncompressed, helper);
+    image_bins = helper.image_bins;
+  }
+  // The listed class and all the listed instances are in the known dirty bin.
+  const std::set<size_t> known_dirty_bin = { kBinKnownDirty };
+  EXPECT_EQ(known_dirty_bin, image_bins[kDirtyClass]);
+  EXPECT_EQ(known_dirty_bin, image_bins[kDirtyInstances]);
+  // Everything else, including the class listed in a comment line, stays in its usual bins.
+  EXPECT_EQ(0u, usual_bins[kDirtyClass].count(kBinKnownDirty));
+  EXPECT_EQ(0u, usual_bins[kDirtyInstances].count(kBinKnownDirty));
+  ASSERT_NE(0u, image_bins.count("class Ljava/lang/String;"));
+  for (const auto& entry : usual_bins) {
+    if (entry.first == kDirtyClass || entry.first == kDirtyInstances) {
+      continue;
+    }
+    auto it = image_bins.find(entry.first);
+    if (it != image_bins.end()) {
+      EXPECT_EQ(entry.second, it->second) << entry.first;
+    }
+  }
+}
+
 TEST_F(ImageTest, ImageHeaderIsValid) {
     uint32_t image_begin = ART_BASE_ADDRESS;
     uint32_t image_size_ = 16 * KB;
@@ -20,6 +20,8 @@
 #include <lz4.h>
 #include <lz4hc.h>
 
+#include <algorithm>
+#include <fstream>
 #include <memory>
 #include <numeric>
 #include <unordered_set>
@@ -68,6 +70,7 @@
 #include "runtime.h"
 #include "scoped_thread_state_change-inl.h"
 #include "handle_scope-inl.h"
+#include "thread_pool.h"
 #include "utils/dex_cache_arrays_layout-inl.h"
 
 using ::art::mirror::Class;
@@ -154,8 +157,9 @@ bool ImageWriter::PrepareImageAddressSpace() {
   }
 
   {
+    std::unique_ptr<ThreadPool> thread_pool = CreateThreadPool();
     ScopedObjectAccess soa(Thread::Current());
-    CalculateNewObjectOffsets();
+    CalculateNewObjectOffsets(thread_pool.get());
   }
 
   // This needs to happen after CalculateNewObjectOffsets since it relies on intern_table_bytes_ and
@@ -188,10 +192,11 @@ bool ImageWriter::Write(int image_fd,
   }
 
   {
+    std::unique_ptr<ThreadPool> thread_pool = CreateThreadPool();
     // TODO: heap validation can't handle these fix up passes.
     ScopedObjectAccess soa(Thread::Current());
     Runtime::Current()->GetHeap()->DisableObjectValidation();
-    CopyAndFixupObjects();
+    CopyAndFixupObjects(thread_pool.get());
   }
 
   for (size_t i = 0; i < image_filenames.size(); ++i) {
@@ -404,6 +409,13 @@ void ImageWriter::SetImageBinSlot(mirror::Object* object, BinSlot bin_slot) {
       LOG(FATAL) << "Thin locked object " << object << " found during object copy";
       break;
     }
+    case LockWord::kBiased: {
+      // A bias without a count is only a reservation, the object is not locked.
+      if (lw.BiasedLockCount() != 0u) {
+        LOG(FATAL) << "Biased locked object " << object << " found during object copy";
+      }
+      break;
+    }
     case LockWord::kUnlocked:
       // No hash, don't need to save it.
       break;
@@ -502,6 +514,26 @@ void ImageWriter::AddMethodPointerArray(mirror::PointerArray* arr) {
   pointer_arrays_.emplace(arr, kBinArtMethodClean);
 }
 
+bool ImageWriter::IsKnownDirtyObject(mirror::Object* object) {
+  if (dirty_image_objects_ == nullptr || dirty_image_objects_->empty()) {
+    return false;
+  }
+  std::string temp;
+  if (object->IsClass()) {
+    // Every class object is binned once, no need to cache the result.
+    std::string entry = std::string("class ") + object->AsClass()->GetDescriptor(&temp);
+    return dirty_image_objects_->find(entry) != dirty_image_objects_->end();
+  }
+  mirror::Class* klass = object->GetClass<kVerifyNone>();
+  auto it = dirty_instance_classes_.find(klass);
+  if (it == dirty_instance_classes_.end()) {
+    std::string entry = std::string("instance ") + klass->GetDescriptor(&temp);
+    bool is_dirty = dirty_image_objects_->find(entry) != dirty_image_objects_->end();
+    it = dirty_instance_classes_.emplace(klass, is_dirty).first;
+  }
+  return it->second;
+}
+
 void ImageWriter::AssignImageBinSlot(mirror::Object* object, size_t oat_index) {
   DCHECK(object != nullptr);
   size_t object_size = object->SizeOf();
@@ -603,6 +635,11 @@ void ImageWriter::AssignImageBinSlot(mirror::Object* object, size_t oat_index) {
       bin = kBinMiscDirty;
     }
     // else bin = kBinRegular
+
+    // Objects that were seen dirty in a running system override the static guesses above.
+    if (IsKnownDirtyObject(object)) {
+      bin = kBinKnownDirty;
+    }
   }
 
   // Assign the oat index too.
@@ -1449,12 +1486,80 @@ void ImageWriter::DeflateMonitorCallback(mirror::Object* obj, void* arg ATTRIBUT
   Monitor::Deflate(Thread::Current(), obj);
 }
 
-void ImageWriter::UnbinObjectsIntoOffsetCallback(mirror::Object* obj, void* arg) {
+void ImageWriter::CollectImageObjectsCallback(mirror::Object* obj, void* arg) {
   ImageWriter* writer = reinterpret_cast<ImageWriter*>(arg);
   DCHECK(writer != nullptr);
   if (!writer->IsInBootImage(obj)) {
-    writer->UnbinObjectsIntoOffset(obj);
+    writer->image_objects_.push_back(obj);
+  }
+}
+
+// Number of chunks per thread that the image objects are split into, so that threads which finish
+// their chunks early pick up the remaining work.
+static constexpr size_t kImageObjectChunksPerThread = 4u;
+
+template <typename Visitor>
+class ImageObjectsTask FINAL : public Task {
+ public:
+  ImageObjectsTask(mirror::Object* const* begin,
+                   mirror::Object* const* end,
+                   const Visitor* visitor)
+      : begin_(begin), end_(end), visitor_(visitor) {}
+
+  void Run(Thread* self) OVERRIDE {
+    ScopedObjectAccess soa(self);
+    for (mirror::Object* const* it = begin_; it != end_; ++it) {
+      (*visitor_)(*it);
+    }
+  }
+
+  void Finalize() OVERRIDE {
+    delete this;
+  }
+
+ private:
+  mirror::Object* const* const begin_;
+  mirror::Object* const* const end_;
+  const Visitor* const visitor_;
+
+  DISALLOW_COPY_AND_ASSIGN(ImageObjectsTask);
+};
+
+std::unique_ptr<ThreadPool> ImageWriter::CreateThreadPool() const {
+  const size_t thread_count = compiler_driver_.GetThreadCount();
+  if (thread_count <= 1u) {
+    return nullptr;
+  }
+  // The calling thread helps with the work, so it only needs thread_count - 1 workers.
+  return std::unique_ptr<ThreadPool>(
+      new ThreadPool("Image writer thread pool", thread_count - 1u));
+}
+
+template <typename Visitor>
+void ImageWriter::VisitImageObjectsInParallel(ThreadPool* thread_pool, const Visitor& visitor) {
+  const size_t num_objects = image_objects_.size();
+  if (thread_pool == nullptr ||
+      num_objects < (thread_pool->GetThreadCount() + 1u) * kImageObjectChunksPerThread) {
+    for (mirror::Object* obj : image_objects_) {
+      visitor(obj);
+    }
+    return;
   }
+  // Every object is visited exactly once and the visitor only touches that object, so the result
+  // does not depend on which thread visits which chunk.
+  Thread* const self = Thread::Current();
+  const size_t num_chunks = (thread_pool->GetThreadCount() + 1u) * kImageObjectChunksPerThread;
+  const size_t chunk_size = RoundUp(num_objects, num_chunks) / num_chunks;
+  mirror::Object* const* const objects = image_objects_.data();
+  for (size_t begin = 0u; begin < num_objects; begin += chunk_size) {
+    size_t end = std::min(begin + chunk_size, num_objects);
+    thread_pool->AddTask(self,
+                         new ImageObjectsTask<Visitor>(objects + begin, objects + end, &visitor));
+  }
+  thread_pool->StartWorkers(self);
+  // The calling thread holds the mutator lock and helps with the work.
+  thread_pool->Wait(self, /* do_work */ true, /* may_hold_locks */ true);
+  thread_pool->StopWorkers(self);
 }
 
 void ImageWriter::UnbinObjectsIntoOffset(mirror::Object* obj) {
@@ -1551,7 +1656,7 @@ void ImageWriter::ProcessWorkStack(WorkStack* work_stack) {
   }
 }
 
-void ImageWriter::CalculateNewObjectOffsets() {
+void ImageWriter::CalculateNewObjectOffsets(ThreadPool* thread_pool) {
   Thread* const self = Thread::Current();
   VariableSizedHandleScope handles(self);
   std::vector<Handle<ObjectArray<Object>>> image_roots;
@@ -1716,8 +1821,14 @@ void ImageWriter::CalculateNewObjectOffsets() {
     image_offset += image_info.image_size_;
   }
 
-  // Transform each object's bin slot into an offset which will be used to do the final copy.
-  heap->VisitObjects(UnbinObjectsIntoOffsetCallback, this);
+  // Transform each object's bin slot into an offset which will be used to do the final copy. The
+  // bin slots were assigned serially above, so the offsets do not depend on the thread count.
+  DCHECK(image_objects_.empty());
+  heap->VisitObjects(CollectImageObjectsCallback, this);
+  auto unbin_visitor = [this](mirror::Object* obj) REQUIRES_SHARED(Locks::mutator_lock_) {
+    UnbinObjectsIntoOffset(obj);
+  };
+  VisitImageObjectsInParallel(thread_pool, unbin_visitor);
 
   size_t i = 0;
   for (ImageInfo& image_info : image_infos_) {
@@ -2023,9 +2134,16 @@ void ImageWriter::CopyAndFixupNativeData(size_t oat_index) {
   }
 }
 
-void ImageWriter::CopyAndFixupObjects() {
-  gc::Heap* heap = Runtime::Current()->GetHeap();
-  heap->VisitObjects(CopyAndFixupObjectsCallback, this);
+void ImageWriter::CopyAndFixupObjects(ThreadPool* thread_pool) {
+  // Each object is copied to the slot assigned in CalculateNewObjectOffsets, so the objects may be
+  // copied and fixed up in any order.
+  auto copy_visitor = [this](mirror::Object* obj) REQUIRES_SHARED(Locks::mutator_lock_) {
+    CopyAndFixupObject(obj);
+  };
+  VisitImageObjectsInParallel(thread_pool, copy_visitor);
+  image_objects_.clear();
+  image_objects_.shrink_to_fit();
+  pointer_arrays_.clear();
   // Fix up the object previously had hash codes.
   for (const auto& hash_pair : saved_hashcode_map_) {
     Object* obj = hash_pair.first;
@@ -2035,12 +2153,6 @@ void ImageWriter::CopyAndFixupObjects() {
   saved_hashcode_map_.clear();
 }
 
-void ImageWriter::CopyAndFixupObjectsCallback(Object* obj, void* arg) {
-  DCHECK(obj != nullptr);
-  DCHECK(arg != nullptr);
-  reinterpret_cast<ImageWriter*>(arg)->CopyAndFixupObject(obj);
-}
-
 void ImageWriter::FixupPointerArray(mirror::Object* dst,
                                     mirror::PointerArray* arr,
                                     mirror::Class* klass,
@@ -2086,7 +2198,8 @@ void ImageWriter::CopyAndFixupObject(Object* obj) {
   DCHECK_LT(offset, image_info.image_end_);
   const auto* src = reinterpret_cast<const uint8_t*>(obj);
 
-  image_info.image_bitmap_->Set(dst);  // Mark the obj as live.
+  // Mark the obj as live. Other threads may be marking neighbouring objects in the same word.
+  image_info.image_bitmap_->AtomicTestAndSet(dst);
 
   const size_t n = obj->SizeOf();
   DCHECK_LE(offset + n, image_info.image_->Size());
@@ -2105,7 +2218,10 @@ void ImageWriter::CopyAndFixupObject(Object* obj) {
   FixupObject(obj, dst);
 }
 
-// Rewrite all the references in the copied object to point to their image address equivalent
+// Rewrite all the references in the copied object to point to their image address equivalent.
+// The visitors run on the image writer pool without the heap bitmap lock. They only read fields of
+// objects gathered into image_objects_ and write the image copy, and the mutator lock held by every
+// worker keeps the GC from changing the heap meanwhile.
 class ImageWriter::FixupVisitor {
  public:
   FixupVisitor(ImageWriter* image_writer, Object* copy) : image_writer_(image_writer), copy_(copy) {
@@ -2119,7 +2235,7 @@ class ImageWriter::FixupVisitor {
 
 
   void operator()(ObjPtr<Object> obj, MemberOffset offset, bool is_static ATTRIBUTE_UNUSED) const
-      REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(Locks::heap_bitmap_lock_) {
+      REQUIRES_SHARED(Locks::mutator_lock_) {
     ObjPtr<Object> ref = obj->GetFieldObject<Object, kVerifyNone>(offset);
     // Copy the reference and record the fixup if necessary.
     image_writer_->CopyReference(
@@ -2130,7 +2246,7 @@ class ImageWriter::FixupVisitor {
   // java.lang.ref.Reference visitor.
   void operator()(ObjPtr<mirror::Class> klass ATTRIBUTE_UNUSED,
                   ObjPtr<mirror::Reference> ref) const
-      REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(Locks::heap_bitmap_lock_) {
+      REQUIRES_SHARED(Locks::mutator_lock_) {
     operator()(ref, mirror::Reference::ReferentOffset(), /* is_static */ false);
   }
 
@@ -2145,14 +2261,14 @@ class ImageWriter::FixupClassVisitor FINAL : public FixupVisitor {
   }
 
   void operator()(ObjPtr<Object> obj, MemberOffset offset, bool is_static ATTRIBUTE_UNUSED) const
-      REQUIRES(Locks::mutator_lock_, Locks::heap_bitmap_lock_) {
+      REQUIRES_SHARED(Locks::mutator_lock_) {
     DCHECK(obj->IsClass());
     FixupVisitor::operator()(obj, offset, /*is_static*/false);
   }
 
   void operator()(ObjPtr<mirror::Class> klass ATTRIBUTE_UNUSED,
                   ObjPtr<mirror::Reference> ref ATTRIBUTE_UNUSED) const
-      REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(Locks::heap_bitmap_lock_) {
+      REQUIRES_SHARED(Locks::mutator_lock_) {
     LOG(FATAL) << "Reference not expected here.";
   }
 };
@@ -2240,9 +2356,9 @@ void ImageWriter::FixupObject(Object* orig, Object* copy) {
     // Is this a native pointer array?
     auto it = pointer_arrays_.find(down_cast<mirror::PointerArray*>(orig));
     if (it != pointer_arrays_.end()) {
-      // Should only need to fixup every pointer array exactly once.
+      // Every pointer array is fixed up exactly once since every object is visited once. Do not
+      // erase the entry as other threads may be looking up pointer_arrays_ concurrently.
       FixupPointerArray(copy, down_cast<mirror::PointerArray*>(orig), klass, it->second);
-      pointer_arrays_.erase(it);
       return;
     }
   }
@@ -2651,7 +2767,8 @@ ImageWriter::ImageWriter(
     bool compile_app_image,
     ImageHeader::StorageMode image_storage_mode,
     const std::vector<const char*>& oat_filenames,
-    const std::unordered_map<const DexFile*, size_t>& dex_file_oat_index_map)
+    const std::unordered_map<const DexFile*, size_t>& dex_file_oat_index_map,
+    const std::unordered_set<std::string>* dirty_image_objects)
     : compiler_driver_(compiler_driver),
       global_image_begin_(reinterpret_cast<uint8_t*>(image_begin)),
       image_objects_offset_begin_(0),
@@ -2663,13 +2780,33 @@ ImageWriter::ImageWriter(
       clean_methods_(0u),
       image_storage_mode_(image_storage_mode),
       oat_filenames_(oat_filenames),
-      dex_file_oat_index_map_(dex_file_oat_index_map) {
+      dex_file_oat_index_map_(dex_file_oat_index_map),
+      dirty_image_objects_(dirty_image_objects) {
   CHECK_NE(image_begin, 0U);
   std::fill_n(image_methods_, arraysize(image_methods_), nullptr);
   CHECK_EQ(compile_app_image, !Runtime::Current()->GetHeap()->GetBootImageSpaces().empty())
       << "Compiling a boot image should occur iff there are no boot image spaces loaded";
 }
 
+std::unique_ptr<std::unordered_set<std::string>> ImageWriter::ReadDirtyImageObjects(
+    const char* filename) {
+  std::ifstream input(filename, std::ifstream::in);
+  if (!input.is_open()) {
+    return nullptr;
+  }
+  std::unique_ptr<std::unordered_set<std::string>> entries(new std::unordered_set<std::string>());
+  std::string line;
+  while (std::getline(input, line)) {
+    // Drop comments, both whole lines and the trailing sample addresses of an entry.
+    std::string entry = line.substr(0, line.find('#'));
+    entry.erase(entry.find_last_not_of(" \t") + 1u);
+    if (!entry.empty()) {
+      entries->insert(entry);
+    }
+  }
+  return entries;
+}
+
 ImageWriter::ImageInfo::ImageInfo()
     : intern_table_(new InternTable),
       class_table_(new ClassTable) {}
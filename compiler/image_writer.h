@@ -26,6 +26,8 @@
 #include <stack>
 #include <string>
 #include <ostream>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "art_method.h"
 #include "base/bit_utils.h"
@@ -59,6 +61,7 @@ class ClassLoader;
 class ClassLoaderVisitor;
 class ClassTable;
 class ImtConflictTable;
+class ThreadPool;
 
 static constexpr int kInvalidFd = -1;
 
@@ -71,7 +74,14 @@ class ImageWriter FINAL {
               bool compile_app_image,
               ImageHeader::StorageMode image_storage_mode,
               const std::vector<const char*>& oat_filenames,
-              const std::unordered_map<const DexFile*, size_t>& dex_file_oat_index_map);
+              const std::unordered_map<const DexFile*, size_t>& dex_file_oat_index_map,
+              const std::unordered_set<std::string>* dirty_image_objects);
+
+  // Read the entries of a --dirty-image-objects file, "class <descriptor>" or
+  // "instance <descriptor>", one per line. Everything from a '#' to the end of the line is a
+  // comment. Returns null if the file cannot be opened.
+  static std::unique_ptr<std::unordered_set<std::string>> ReadDirtyImageObjects(
+      const char* filename);
 
   bool PrepareImageAddressSpace();
 
@@ -168,6 +178,7 @@ class ImageWriter FINAL {
   // Classify different kinds of bins that objects end up getting packed into during image writing.
   // Ordered from dirtiest to cleanest (until ArtMethods).
   enum Bin {
+    kBinKnownDirty,               // Objects listed by --dirty-image-objects
     kBinMiscDirty,                // Dex caches, object locks, etc...
     kBinClassVerified,            // Class verified, but initializers haven't been run
     // Unknown mix of clean/dirty:
@@ -410,7 +421,7 @@ class ImageWriter FINAL {
       REQUIRES_SHARED(Locks::mutator_lock_);
 
   // Lays out where the image objects will be at runtime.
-  void CalculateNewObjectOffsets()
+  void CalculateNewObjectOffsets(ThreadPool* thread_pool)
       REQUIRES_SHARED(Locks::mutator_lock_);
   void ProcessWorkStack(WorkStack* work_stack)
       REQUIRES_SHARED(Locks::mutator_lock_);
@@ -427,14 +438,27 @@ class ImageWriter FINAL {
       REQUIRES_SHARED(Locks::mutator_lock_);
   static void DeflateMonitorCallback(mirror::Object* obj, void* arg)
       REQUIRES_SHARED(Locks::mutator_lock_);
-  static void UnbinObjectsIntoOffsetCallback(mirror::Object* obj, void* arg)
+  // Returns true if the dirty image objects list says that the object is likely to be dirtied
+  // at runtime.
+  bool IsKnownDirtyObject(mirror::Object* object) REQUIRES_SHARED(Locks::mutator_lock_);
+
+  static void CollectImageObjectsCallback(mirror::Object* obj, void* arg)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  // Creates the pool used by VisitImageObjectsInParallel, or null for a single compiler thread.
+  // Starting and joining the workers may wait for a suspend point, so the caller must not hold the
+  // mutator lock.
+  std::unique_ptr<ThreadPool> CreateThreadPool() const REQUIRES(!Locks::mutator_lock_);
+
+  // Calls the visitor for each object in image_objects_ using the given pool. The visitor must only
+  // write to the object it is given and to that object's image copy.
+  template <typename Visitor>
+  void VisitImageObjectsInParallel(ThreadPool* thread_pool, const Visitor& visitor)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
   // Creates the contiguous image in memory and adjusts pointers.
   void CopyAndFixupNativeData(size_t oat_index) REQUIRES_SHARED(Locks::mutator_lock_);
-  void CopyAndFixupObjects() REQUIRES_SHARED(Locks::mutator_lock_);
-  static void CopyAndFixupObjectsCallback(mirror::Object* obj, void* arg)
-      REQUIRES_SHARED(Locks::mutator_lock_);
+  void CopyAndFixupObjects(ThreadPool* thread_pool) REQUIRES_SHARED(Locks::mutator_lock_);
   void CopyAndFixupObject(mirror::Object* obj) REQUIRES_SHARED(Locks::mutator_lock_);
   void CopyAndFixupMethod(ArtMethod* orig, ArtMethod* copy, const ImageInfo& image_info)
       REQUIRES_SHARED(Locks::mutator_lock_);
@@ -569,6 +593,17 @@ class ImageWriter FINAL {
   // Oat index map for objects.
   std::unordered_map<mirror::Object*, uint32_t> oat_index_map_;
 
+  // Entries of the --dirty-image-objects list, "class <descriptor>" for class objects and
+  // "instance <descriptor>" for instances of a class. May be null.
+  const std::unordered_set<std::string>* dirty_image_objects_;
+
+  // Whether the instances of a class are listed in dirty_image_objects_, by class.
+  std::unordered_map<mirror::Class*, bool> dirty_instance_classes_;
+
+  // Objects that are written to the images, i.e. all heap objects outside of the boot image.
+  // Collected once all bin slots are assigned and cleared after the objects are copied.
+  std::vector<mirror::Object*> image_objects_;
+
   // Boolean flags.
   const bool compile_pic_;
   const bool compile_app_image_;
@@ -631,6 +666,8 @@ class ImageWriter FINAL {
   class RegisterBootClassPathClassesVisitor;
   class VisitReferencesVisitor;
 
+  friend class ImageTest;
+
   DISALLOW_COPY_AND_ASSIGN(ImageWriter);
 };
 
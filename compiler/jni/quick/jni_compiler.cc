@@ -639,7 +639,10 @@ static CompiledMethod* ArtJniCompileMethodInternal(CompilerDriver* driver,
   __ DecreaseFrameSize(current_out_arg_size);
 
   // 15. Process pending exceptions from JNI call or monitor exit.
-  __ ExceptionPoll(main_jni_conv->InterproceduralScratchRegister(), 0 /* stack_adjust */);
+  //     @CriticalNative methods get no JNIEnv* and thus cannot throw.
+  if (LIKELY(!is_critical_native)) {
+    __ ExceptionPoll(main_jni_conv->InterproceduralScratchRegister(), 0 /* stack_adjust */);
+  }
 
   // 16. Remove activation - need to restore callee save registers since the GC may have changed
   //     them.
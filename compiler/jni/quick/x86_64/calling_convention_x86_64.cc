@@ -51,10 +51,22 @@ static constexpr ManagedRegister kCalleeSaveRegisters[] = {
     X86_64ManagedRegister::FromXmmRegister(XMM15),
 };
 
-static constexpr uint32_t CalculateCoreCalleeSpillMask() {
+// @CriticalNative methods cannot suspend, so nothing looks at or updates the managed callee saves
+// while they run. The native code preserves the core ones itself, only the XMMs that the native
+// ABI treats as caller-save need spilling.
+static constexpr ManagedRegister kCriticalCalleeSaveRegisters[] = {
+    X86_64ManagedRegister::FromXmmRegister(XMM12),
+    X86_64ManagedRegister::FromXmmRegister(XMM13),
+    X86_64ManagedRegister::FromXmmRegister(XMM14),
+    X86_64ManagedRegister::FromXmmRegister(XMM15),
+};
+
+template <size_t size>
+static constexpr uint32_t CalculateCoreCalleeSpillMask(
+    const ManagedRegister (&callee_saves)[size]) {
   // The spilled PC gets a special marker.
   uint32_t result = 1 << kNumberOfCpuRegisters;
-  for (auto&& r : kCalleeSaveRegisters) {
+  for (auto&& r : callee_saves) {
     if (r.AsX86_64().IsCpuRegister()) {
       result |= (1 << r.AsX86_64().AsCpuRegister().AsRegister());
     }
@@ -62,9 +74,10 @@ static constexpr uint32_t CalculateCoreCalleeSpillMask() {
   return result;
 }
 
-static constexpr uint32_t CalculateFpCalleeSpillMask() {
+template <size_t size>
+static constexpr uint32_t CalculateFpCalleeSpillMask(const ManagedRegister (&callee_saves)[size]) {
   uint32_t result = 0;
-  for (auto&& r : kCalleeSaveRegisters) {
+  for (auto&& r : callee_saves) {
     if (r.AsX86_64().IsXmmRegister()) {
       result |= (1 << r.AsX86_64().AsXmmRegister().AsFloatRegister());
     }
@@ -72,8 +85,12 @@ static constexpr uint32_t CalculateFpCalleeSpillMask() {
   return result;
 }
 
-static constexpr uint32_t kCoreCalleeSpillMask = CalculateCoreCalleeSpillMask();
-static constexpr uint32_t kFpCalleeSpillMask = CalculateFpCalleeSpillMask();
+static constexpr uint32_t kCoreCalleeSpillMask = CalculateCoreCalleeSpillMask(kCalleeSaveRegisters);
+static constexpr uint32_t kFpCalleeSpillMask = CalculateFpCalleeSpillMask(kCalleeSaveRegisters);
+static constexpr uint32_t kCriticalCoreCalleeSpillMask =
+    CalculateCoreCalleeSpillMask(kCriticalCalleeSaveRegisters);
+static constexpr uint32_t kCriticalFpCalleeSpillMask =
+    CalculateFpCalleeSpillMask(kCriticalCalleeSaveRegisters);
 
 // Calling convention
 
@@ -185,11 +202,11 @@ X86_64JniCallingConvention::X86_64JniCallingConvention(bool is_static,
 }
 
 uint32_t X86_64JniCallingConvention::CoreSpillMask() const {
-  return kCoreCalleeSpillMask;
+  return is_critical_native_ ? kCriticalCoreCalleeSpillMask : kCoreCalleeSpillMask;
 }
 
 uint32_t X86_64JniCallingConvention::FpSpillMask() const {
-  return kFpCalleeSpillMask;
+  return is_critical_native_ ? kCriticalFpCalleeSpillMask : kFpCalleeSpillMask;
 }
 
 size_t X86_64JniCallingConvention::FrameSize() {
@@ -224,6 +241,9 @@ size_t X86_64JniCallingConvention::OutArgSize() {
 }
 
 ArrayRef<const ManagedRegister> X86_64JniCallingConvention::CalleeSaveRegisters() const {
+  if (is_critical_native_) {
+    return ArrayRef<const ManagedRegister>(kCriticalCalleeSaveRegisters);
+  }
   return ArrayRef<const ManagedRegister>(kCalleeSaveRegisters);
 }
 
@@ -22,6 +22,7 @@
 #include "base/stl_util.h"
 #include "buffered_output_stream.h"
 #include "common_runtime_test.h"
+#include "pipelined_output_stream.h"
 
 namespace art {
 
@@ -91,6 +92,46 @@ TEST_F(OutputStreamTest, Buffered) {
   CheckTestOutput(actual);
 }
 
+TEST_F(OutputStreamTest, Pipelined) {
+  ScratchFile tmp;
+  {
+    PipelinedOutputStream pipelined_output_stream(MakeUnique<FileOutputStream>(tmp.GetFile()));
+    SetOutputStream(pipelined_output_stream);
+    GenerateTestOutput();
+  }
+  std::unique_ptr<File> in(OS::OpenFileForReading(tmp.GetFilename().c_str()));
+  EXPECT_TRUE(in.get() != nullptr);
+  std::vector<uint8_t> actual(in->GetLength());
+  bool readSuccess = in->ReadFully(&actual[0], actual.size());
+  EXPECT_TRUE(readSuccess);
+  CheckTestOutput(actual);
+}
+
+TEST_F(OutputStreamTest, PipelinedLarge) {
+  // Write enough data to go through several buffers of the writer thread.
+  std::vector<uint8_t> expected(3 * MB + 123);
+  for (size_t i = 0; i != expected.size(); ++i) {
+    expected[i] = static_cast<uint8_t>(i * 7u);
+  }
+  ScratchFile tmp;
+  {
+    PipelinedOutputStream pipelined_output_stream(MakeUnique<FileOutputStream>(tmp.GetFile()));
+    size_t offset = 0u;
+    for (size_t size = 1u; offset != expected.size(); size = (size * 3u) % 100000u + 1u) {
+      size = std::min(size, expected.size() - offset);
+      EXPECT_TRUE(pipelined_output_stream.WriteFully(&expected[offset], size));
+      offset += size;
+      EXPECT_EQ(static_cast<off_t>(offset), pipelined_output_stream.Seek(0, kSeekCurrent));
+    }
+    EXPECT_TRUE(pipelined_output_stream.Flush());
+  }
+  std::unique_ptr<File> in(OS::OpenFileForReading(tmp.GetFilename().c_str()));
+  ASSERT_TRUE(in.get() != nullptr);
+  std::vector<uint8_t> actual(in->GetLength());
+  ASSERT_TRUE(in->ReadFully(&actual[0], actual.size()));
+  EXPECT_TRUE(expected == actual);
+}
+
 TEST_F(OutputStreamTest, Vector) {
   std::vector<uint8_t> output;
   VectorOutputStream output_stream("test vector output", &output);
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pipelined_output_stream.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "thread-inl.h"
+
+namespace art {
+
+PipelinedOutputStream::PipelinedOutputStream(std::unique_ptr<OutputStream> out)
+    : OutputStream(out->GetLocation()),  // Before out is moved to out_.
+      out_(std::move(out)),
+      current_(),
+      offset_(-1),
+      lock_("pipelined output stream lock"),
+      cond_("pipelined output stream condition", lock_),
+      pending_buffers_(),
+      free_buffers_(),
+      writing_(false),
+      failed_(false),
+      shutdown_(false) {
+  current_.reserve(kBufferSize);
+  CHECK_PTHREAD_CALL(pthread_create,
+                     (&writer_thread_, nullptr, &WriterThreadStart, this),
+                     "pipelined output stream writer");
+}
+
+PipelinedOutputStream::~PipelinedOutputStream() {
+  Drain();
+  Thread* self = Thread::Current();
+  {
+    MutexLock mu(self, lock_);
+    shutdown_ = true;
+    cond_.Broadcast(self);
+  }
+  CHECK_PTHREAD_CALL(pthread_join, (writer_thread_, nullptr), "pipelined output stream writer");
+}
+
+void* PipelinedOutputStream::WriterThreadStart(void* arg) {
+  reinterpret_cast<PipelinedOutputStream*>(arg)->WriterLoop();
+  return nullptr;
+}
+
+void PipelinedOutputStream::WriterLoop() {
+  // The writer thread is not attached to the runtime.
+  Thread* self = nullptr;
+  lock_.Lock(self);
+  while (true) {
+    while (pending_buffers_.empty() && !shutdown_) {
+      cond_.Wait(self);
+    }
+    if (pending_buffers_.empty()) {
+      DCHECK(shutdown_);
+      break;
+    }
+    std::vector<uint8_t> buffer = std::move(pending_buffers_.front());
+    pending_buffers_.pop_front();
+    if (!failed_) {  // Drop the data after a failure.
+      writing_ = true;
+      lock_.Unlock(self);
+      bool success = out_->WriteFully(buffer.data(), buffer.size());
+      lock_.Lock(self);
+      writing_ = false;
+      failed_ = !success;
+    }
+    buffer.clear();
+    free_buffers_.push_back(std::move(buffer));
+    cond_.Broadcast(self);
+  }
+  lock_.Unlock(self);
+}
+
+bool PipelinedOutputStream::SubmitBuffer() {
+  Thread* self = Thread::Current();
+  // Waiting with the mutator lock held would block suspension and GC until the disk catches up.
+  // The oat writer writes the code under the mutator lock, so let the queue grow past the limit
+  // then. It is drained by the next Seek() or Flush() once the lock has been released.
+  const bool may_wait = !Locks::mutator_lock_->IsSharedHeld(self);
+  MutexLock mu(self, lock_);
+  while (may_wait && pending_buffers_.size() >= kMaxPendingBuffers && !failed_) {
+    cond_.Wait(self);
+  }
+  if (failed_) {
+    current_.clear();
+    return false;
+  }
+  pending_buffers_.push_back(std::move(current_));
+  if (!free_buffers_.empty()) {
+    current_ = std::move(free_buffers_.back());
+    free_buffers_.pop_back();
+  } else {
+    current_ = std::vector<uint8_t>();
+    current_.reserve(kBufferSize);
+  }
+  DCHECK(current_.empty());
+  cond_.Broadcast(self);
+  return true;
+}
+
+bool PipelinedOutputStream::Drain() {
+  if (!current_.empty() && !SubmitBuffer()) {
+    return false;
+  }
+  Thread* self = Thread::Current();
+  Locks::mutator_lock_->AssertNotHeld(self);
+  MutexLock mu(self, lock_);
+  while (!pending_buffers_.empty() || writing_) {
+    cond_.Wait(self);
+  }
+  return !failed_;
+}
+
+bool PipelinedOutputStream::WriteFully(const void* buffer, size_t byte_count) {
+  const uint8_t* src = reinterpret_cast<const uint8_t*>(buffer);
+  size_t remaining = byte_count;
+  while (remaining != 0u) {
+    size_t chunk = std::min(remaining, kBufferSize - current_.size());
+    current_.insert(current_.end(), src, src + chunk);
+    src += chunk;
+    remaining -= chunk;
+    if (current_.size() == kBufferSize && !SubmitBuffer()) {
+      return false;
+    }
+  }
+  if (offset_ != static_cast<off_t>(-1)) {
+    offset_ += byte_count;
+  }
+  return true;
+}
+
+off_t PipelinedOutputStream::Seek(off_t offset, Whence whence) {
+  // Querying the current offset is frequent (for example in debug checks of the oat writer),
+  // answer it without waiting for the writer thread when possible.
+  if (whence == kSeekCurrent && offset == 0 && offset_ != static_cast<off_t>(-1)) {
+    return offset_;
+  }
+  if (!Drain()) {
+    return -1;
+  }
+  offset_ = out_->Seek(offset, whence);
+  return offset_;
+}
+
+bool PipelinedOutputStream::Flush() {
+  return Drain() && out_->Flush();
+}
+
+}  // namespace art
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_LINKER_PIPELINED_OUTPUT_STREAM_H_
+#define ART_COMPILER_LINKER_PIPELINED_OUTPUT_STREAM_H_
+
+#include <pthread.h>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "output_stream.h"
+
+#include "base/mutex.h"
+#include "globals.h"
+
+namespace art {
+
+// An output stream that collects the data in large buffers and writes them to the underlying
+// stream on a background thread. This lets the caller prepare the next data, for example patch
+// the code of the next method, while the previous data is being written to the file.
+// Seek() and Flush() wait for all pending data to be written and must not be called with the
+// mutator lock held. Writes made with the mutator lock held never wait for the writer thread.
+class PipelinedOutputStream FINAL : public OutputStream {
+ public:
+  explicit PipelinedOutputStream(std::unique_ptr<OutputStream> out);
+
+  ~PipelinedOutputStream() OVERRIDE;
+
+  bool WriteFully(const void* buffer, size_t byte_count) OVERRIDE REQUIRES(!lock_);
+
+  off_t Seek(off_t offset, Whence whence) OVERRIDE REQUIRES(!lock_);
+
+  bool Flush() OVERRIDE REQUIRES(!lock_);
+
+ private:
+  static constexpr size_t kBufferSize = 256 * KB;
+  // Maximum number of buffers waiting for the writer thread.
+  static constexpr size_t kMaxPendingBuffers = 4u;
+
+  static void* WriterThreadStart(void* arg);
+  void WriterLoop() REQUIRES(!lock_);
+
+  // Hand the current buffer over to the writer thread. Waits for space in the queue unless the
+  // caller holds the mutator lock.
+  bool SubmitBuffer() REQUIRES(!lock_);
+  // Wait until all the data has been written to the underlying stream.
+  bool Drain() REQUIRES(!lock_);
+
+  std::unique_ptr<OutputStream> const out_;
+
+  // The buffer being filled by the caller. Not accessed by the writer thread.
+  std::vector<uint8_t> current_;
+  // The current offset, if known without asking the underlying stream, or -1.
+  off_t offset_;
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  ConditionVariable cond_ GUARDED_BY(lock_);
+  std::deque<std::vector<uint8_t>> pending_buffers_ GUARDED_BY(lock_);
+  std::vector<std::vector<uint8_t>> free_buffers_ GUARDED_BY(lock_);
+  bool writing_ GUARDED_BY(lock_);
+  bool failed_ GUARDED_BY(lock_);
+  bool shutdown_ GUARDED_BY(lock_);
+
+  pthread_t writer_thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(PipelinedOutputStream);
+};
+
+}  // namespace art
+
+#endif  // ART_COMPILER_LINKER_PIPELINED_OUTPUT_STREAM_H_
@@ -40,6 +40,7 @@
 #include "gc/space/space.h"
 #include "handle_scope-inl.h"
 #include "image_writer.h"
+#include "jit/profile_compilation_info.h"
 #include "linker/buffered_output_stream.h"
 #include "linker/file_output_stream.h"
 #include "linker/multi_oat_relative_patcher.h"
@@ -653,7 +654,16 @@ class OatWriter::OatDexMethodVisitor : public DexMethodVisitor {
   OatDexMethodVisitor(OatWriter* writer, size_t offset)
     : DexMethodVisitor(writer, offset),
       oat_class_index_(0u),
-      method_offsets_index_(0u) {
+      method_offsets_index_(0u),
+      code_layout_tier_(CodeLayoutTier::kCold),
+      last_code_layout_pass_(true) {
+  }
+
+  // Called by VisitDexMethodsInCodeLayoutOrder() before each pass over the dex files.
+  void StartCodeLayoutPass(CodeLayoutTier tier, bool last_pass) {
+    oat_class_index_ = 0u;
+    code_layout_tier_ = tier;
+    last_code_layout_pass_ = last_pass;
   }
 
   bool StartClass(const DexFile* dex_file, size_t class_def_index) {
@@ -669,8 +679,21 @@ class OatWriter::OatDexMethodVisitor : public DexMethodVisitor {
   }
 
  protected:
+  // Whether the method is laid out in the current code layout pass. Methods skipped
+  // in this pass must still advance method_offsets_index_ if they have compiled code.
+  bool IsInCodeLayoutPass(const ClassDataItemIterator& it) const {
+    return writer_->GetCodeLayoutTier(dex_file_, class_def_index_, it.GetMemberIndex()) ==
+        code_layout_tier_;
+  }
+
+  bool IsEndOfCode() const {
+    return last_code_layout_pass_ && oat_class_index_ == writer_->oat_classes_.size();
+  }
+
   size_t oat_class_index_;
   size_t method_offsets_index_;
+  CodeLayoutTier code_layout_tier_;
+  bool last_code_layout_pass_;
 };
 
 class OatWriter::InitOatClassesMethodVisitor : public DexMethodVisitor {
@@ -743,14 +766,21 @@ class OatWriter::InitCodeMethodVisitor : public OatDexMethodVisitor {
   InitCodeMethodVisitor(OatWriter* writer, size_t offset, size_t quickening_info_offset)
     : OatDexMethodVisitor(writer, offset),
       debuggable_(writer->GetCompilerDriver()->GetCompilerOptions().GetDebuggable()),
+      quickening_info_offset_(quickening_info_offset),
       current_quickening_info_offset_(quickening_info_offset) {
     writer_->absolute_patch_locations_.reserve(
         writer_->compiler_driver_->GetNonRelativeLinkerPatchCount());
   }
 
+  void StartCodeLayoutPass(CodeLayoutTier tier, bool last_pass) {
+    OatDexMethodVisitor::StartCodeLayoutPass(tier, last_pass);
+    // The quickening info is in the definition order, recalculate its offsets in each pass.
+    current_quickening_info_offset_ = quickening_info_offset_;
+  }
+
   bool EndClass() {
     OatDexMethodVisitor::EndClass();
-    if (oat_class_index_ == writer_->oat_classes_.size()) {
+    if (IsEndOfCode()) {
       offset_ = writer_->relative_patcher_->ReserveSpaceEnd(offset_);
     }
     return true;
@@ -764,6 +794,14 @@ class OatWriter::InitCodeMethodVisitor : public OatDexMethodVisitor {
     if (it.GetMethodCodeItem() != nullptr) {
       current_quickening_info_offset_ += sizeof(uint32_t);
     }
+    if (compiled_method != nullptr && !IsInCodeLayoutPass(it)) {
+      if (kIsVdexEnabled && compiled_method->GetQuickCode().empty()) {
+        ArrayRef<const uint8_t> vmap_table = compiled_method->GetVmapTable();
+        current_quickening_info_offset_ += vmap_table.size() * sizeof(vmap_table.front());
+      }
+      ++method_offsets_index_;
+      return true;
+    }
     if (compiled_method != nullptr) {
       // Derived from CompiledMethod.
       uint32_t quick_code_offset = 0;
@@ -945,6 +983,7 @@ class OatWriter::InitCodeMethodVisitor : public OatDexMethodVisitor {
   const bool debuggable_;
 
   // Offset in the vdex file for the quickening info.
+  const uint32_t quickening_info_offset_;
   uint32_t current_quickening_info_offset_;
 };
 
@@ -1213,7 +1252,7 @@ class OatWriter::WriteCodeMethodVisitor : public OatDexMethodVisitor {
 
   bool EndClass() REQUIRES_SHARED(Locks::mutator_lock_) {
     bool result = OatDexMethodVisitor::EndClass();
-    if (oat_class_index_ == writer_->oat_classes_.size()) {
+    if (IsEndOfCode()) {
       DCHECK(result);  // OatDexMethodVisitor::EndClass() never fails.
       offset_ = writer_->relative_patcher_->WriteThunks(out_, offset_);
       if (UNLIKELY(offset_ == 0u)) {
@@ -1229,6 +1268,11 @@ class OatWriter::WriteCodeMethodVisitor : public OatDexMethodVisitor {
     OatClass* oat_class = &writer_->oat_classes_[oat_class_index_];
     const CompiledMethod* compiled_method = oat_class->GetCompiledMethod(class_def_method_index);
 
+    if (compiled_method != nullptr && !IsInCodeLayoutPass(it)) {
+      ++method_offsets_index_;
+      return true;
+    }
+
     // No thread suspension since dex_cache_ that may get invalidated if that occurs.
     ScopedAssertNoThreadSuspension tsc(__FUNCTION__);
     if (compiled_method != nullptr) {  // ie. not an abstract method
@@ -1667,6 +1711,37 @@ class OatWriter::WriteMethodInfoVisitor : public OatDexMethodVisitor {
   }
 };
 
+OatWriter::CodeLayoutTier OatWriter::GetCodeLayoutTier(const DexFile* dex_file,
+                                                       size_t class_def_index,
+                                                       uint32_t method_idx) const {
+  const ProfileCompilationInfo* profile = compiler_driver_->GetProfileCompilationInfo();
+  if (profile == nullptr || !profile->ContainsMethod(MethodReference(dex_file, method_idx))) {
+    return CodeLayoutTier::kCold;
+  }
+  const DexFile::ClassDef& class_def = dex_file->GetClassDef(class_def_index);
+  return profile->ContainsClass(*dex_file, class_def.class_idx_)
+      ? CodeLayoutTier::kStartup
+      : CodeLayoutTier::kHot;
+}
+
+template <typename Visitor>
+bool OatWriter::VisitDexMethodsInCodeLayoutOrder(Visitor* visitor) {
+  // Without a profile, everything is cold and a single pass is enough.
+  CodeLayoutTier first_tier = (compiler_driver_->GetProfileCompilationInfo() != nullptr)
+      ? CodeLayoutTier::kStartup
+      : CodeLayoutTier::kCold;
+  for (size_t i = static_cast<size_t>(first_tier);
+       i <= static_cast<size_t>(CodeLayoutTier::kCold);
+       ++i) {
+    CodeLayoutTier tier = static_cast<CodeLayoutTier>(i);
+    visitor->StartCodeLayoutPass(tier, /* last_pass */ tier == CodeLayoutTier::kCold);
+    if (UNLIKELY(!VisitDexMethods(visitor))) {
+      return false;
+    }
+  }
+  return true;
+}
+
 // Visit all methods from all classes in all dex files with the specified visitor.
 bool OatWriter::VisitDexMethods(DexMethodVisitor* visitor) {
   for (const DexFile* dex_file : *dex_files_) {
@@ -1817,7 +1892,7 @@ size_t OatWriter::InitOatCodeDexFiles(size_t offset) {
     return offset;
   }
   InitCodeMethodVisitor code_visitor(this, offset, vdex_quickening_info_offset_);
-  bool success = VisitDexMethods(&code_visitor);
+  bool success = VisitDexMethodsInCodeLayoutOrder(&code_visitor);
   DCHECK(success);
   offset = code_visitor.GetOffset();
 
@@ -2285,7 +2360,7 @@ size_t OatWriter::WriteCodeDexFiles(OutputStream* out,
   #define VISIT(VisitorType)                                              \
     do {                                                                  \
       VisitorType visitor(this, out, file_offset, relative_offset);       \
-      if (UNLIKELY(!VisitDexMethods(&visitor))) {                         \
+      if (UNLIKELY(!VisitDexMethodsInCodeLayoutOrder(&visitor))) {        \
         return 0;                                                         \
       }                                                                   \
       relative_offset = visitor.GetOffset();                              \
@@ -2462,8 +2537,11 @@ bool OatWriter::LayoutAndWriteDexFile(OutputStream* out, OatDexFile* oat_dex_fil
   std::unique_ptr<const DexFile> dex_file;
   if (oat_dex_file->source_.IsZipEntry()) {
     ZipEntry* zip_entry = oat_dex_file->source_.GetZipEntry();
-    std::unique_ptr<MemMap> mem_map(
-        zip_entry->ExtractToMemMap(location.c_str(), "classes.dex", &error_msg));
+    std::unique_ptr<MemMap> mem_map(zip_entry->MapDirectlyOrExtract(location.c_str(),
+                                                                    "classes.dex",
+                                                                    alignof(DexFile::Header),
+                                                                    /* mapped_directly */ nullptr,
+                                                                    &error_msg));
     if (mem_map == nullptr) {
       LOG(ERROR) << "Failed to extract dex file to mem map for layout: " << error_msg;
       return false;
@@ -265,6 +265,26 @@ class OatWriter {
   // with a given DexMethodVisitor.
   bool VisitDexMethods(DexMethodVisitor* visitor);
 
+  // Compiled code is laid out in the .text section in tiers so that the code needed
+  // during startup and for hot methods is packed together at the start of the code
+  // instead of being scattered across the whole section. Without a profile, all
+  // methods are in the kCold tier and the code is in the definition order.
+  enum class CodeLayoutTier : uint8_t {
+    kStartup,  // Profiled methods of classes in the profile.
+    kHot,      // Other profiled methods.
+    kCold,     // Methods not in the profile.
+  };
+
+  CodeLayoutTier GetCodeLayoutTier(const DexFile* dex_file,
+                                   size_t class_def_index,
+                                   uint32_t method_idx) const;
+
+  // Visit all the methods with a code visitor, once for each CodeLayoutTier in the
+  // order of the tiers. Each pass visits methods in their definition order and the
+  // visitor processes only the methods in the current tier.
+  template <typename Visitor>
+  bool VisitDexMethodsInCodeLayoutOrder(Visitor* visitor);
+
   // If `update_input_vdex` is true, then this method won't actually write the dex files,
   // and the compiler will just re-use the existing vdex file.
   bool WriteDexFiles(OutputStream* out, File* file, bool update_input_vdex);
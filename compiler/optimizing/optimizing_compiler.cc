@@ -51,6 +51,7 @@
 #include "base/dumpable.h"
 #include "base/macros.h"
 #include "base/mutex.h"
+#include "base/time_utils.h"
 #include "base/timing_logger.h"
 #include "bounds_check_elimination.h"
 #include "builder.h"
@@ -132,6 +133,47 @@ class CodeVectorAllocator FINAL : public CodeAllocator {
   DISALLOW_COPY_AND_ASSIGN(CodeVectorAllocator);
 };
 
+/**
+ * Limits on the time and arena memory spent compiling a method. The budget is checked
+ * between passes; once exceeded, the remaining passes are skipped and the compilation
+ * is abandoned so that it can be retried with a reduced pipeline.
+ */
+class CompilationBudget : public ValueObject {
+ public:
+  CompilationBudget(const ArenaAllocator* arena, uint64_t time_budget_ns, size_t memory_budget)
+      : arena_(arena),
+        start_ns_(NanoTime()),
+        time_budget_ns_(time_budget_ns),
+        memory_budget_(memory_budget),
+        exceeded_(false) {}
+
+  bool IsExceeded() {
+    if (!exceeded_) {
+      exceeded_ = (time_budget_ns_ != 0u && GetElapsedNs() > time_budget_ns_) ||
+                  (memory_budget_ != 0u && arena_->BytesUsed() > memory_budget_);
+    }
+    return exceeded_;
+  }
+
+  // Whether a previous IsExceeded() check failed, without checking again.
+  bool WasExceeded() const {
+    return exceeded_;
+  }
+
+  uint64_t GetElapsedNs() const {
+    return NanoTime() - start_ns_;
+  }
+
+ private:
+  const ArenaAllocator* const arena_;
+  const uint64_t start_ns_;
+  const uint64_t time_budget_ns_;
+  const size_t memory_budget_;
+  bool exceeded_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompilationBudget);
+};
+
 /**
  * Filter to apply to the visualizer. Methods whose name contain that filter will
  * be dumped.
@@ -146,7 +188,8 @@ class PassObserver : public ValueObject {
                CodeGenerator* codegen,
                std::ostream* visualizer_output,
                CompilerDriver* compiler_driver,
-               Mutex& dump_mutex)
+               Mutex& dump_mutex,
+               CompilationBudget* budget)
       : graph_(graph),
         cached_method_name_(),
         timing_logger_enabled_(compiler_driver->GetDumpPasses()),
@@ -157,7 +200,8 @@ class PassObserver : public ValueObject {
         visualizer_enabled_(!compiler_driver->GetCompilerOptions().GetDumpCfgFileName().empty()),
         visualizer_(&visualizer_oss_, graph, *codegen),
         visualizer_dump_mutex_(dump_mutex),
-        graph_in_bad_state_(false) {
+        graph_in_bad_state_(false),
+        budget_(budget) {
     if (timing_logger_enabled_ || visualizer_enabled_) {
       if (!IsVerboseMethod(compiler_driver, GetMethodName())) {
         timing_logger_enabled_ = visualizer_enabled_ = false;
@@ -186,6 +230,8 @@ class PassObserver : public ValueObject {
 
   void SetGraphInBadState() { graph_in_bad_state_ = true; }
 
+  bool IsOverBudget() { return budget_ != nullptr && budget_->IsExceeded(); }
+
   const char* GetMethodName() {
     // PrettyMethod() is expensive, so we delay calling it until we actually have to.
     if (cached_method_name_.empty()) {
@@ -273,6 +319,9 @@ class PassObserver : public ValueObject {
   // expected to validate.
   bool graph_in_bad_state_;
 
+  // Budget of the compilation, may be null.
+  CompilationBudget* const budget_;
+
   friend PassScope;
 
   DISALLOW_COPY_AND_ASSIGN(PassObserver);
@@ -348,6 +397,7 @@ class OptimizingCompiler FINAL : public Compiler {
                         CompilerDriver* driver,
                         const DexCompilationUnit& dex_compilation_unit,
                         PassObserver* pass_observer,
+                        bool reduced_pipeline,
                         VariableSizedHandleScope* handles) const;
 
   void RunOptimizations(HOptimization* optimizations[],
@@ -369,6 +419,8 @@ class OptimizingCompiler FINAL : public Compiler {
   // 2) Transforms the graph to SSA. Returns null if it failed.
   // 3) Runs optimizations on the graph, including register allocator.
   // 4) Generates code with the `code_allocator` provided.
+  // A `reduced_pipeline` skips inlining and uses the linear scan register allocator.
+  // Returns null if the `budget` (which may be null) is exceeded.
   CodeGenerator* TryCompile(ArenaAllocator* arena,
                             CodeVectorAllocator* code_allocator,
                             const DexFile::CodeItem* code_item,
@@ -381,6 +433,8 @@ class OptimizingCompiler FINAL : public Compiler {
                             Handle<mirror::DexCache> dex_cache,
                             ArtMethod* method,
                             bool osr,
+                            bool reduced_pipeline,
+                            CompilationBudget* budget,
                             VariableSizedHandleScope* handles) const;
 
   void MaybeRunInliner(HGraph* graph,
@@ -586,6 +640,9 @@ void OptimizingCompiler::RunOptimizations(HOptimization* optimizations[],
                                           size_t length,
                                           PassObserver* pass_observer) const {
   for (size_t i = 0; i < length; ++i) {
+    if (pass_observer->IsOverBudget()) {
+      return;
+    }
     PassScope scope(optimizations[i]->GetPassName(), pass_observer);
     optimizations[i]->Run();
   }
@@ -736,6 +793,7 @@ void OptimizingCompiler::RunOptimizations(HGraph* graph,
                                           CompilerDriver* driver,
                                           const DexCompilationUnit& dex_compilation_unit,
                                           PassObserver* pass_observer,
+                                          bool reduced_pipeline,
                                           VariableSizedHandleScope* handles) const {
   OptimizingCompilerStats* stats = compilation_stats_.get();
   ArenaAllocator* arena = graph->GetArena();
@@ -796,7 +854,9 @@ void OptimizingCompiler::RunOptimizations(HGraph* graph,
   };
   RunOptimizations(optimizations1, arraysize(optimizations1), pass_observer);
 
-  MaybeRunInliner(graph, codegen, driver, dex_compilation_unit, pass_observer, handles);
+  if (!reduced_pipeline) {
+    MaybeRunInliner(graph, codegen, driver, dex_compilation_unit, pass_observer, handles);
+  }
 
   HOptimization* optimizations2[] = {
     // SelectGenerator depends on the InstructionSimplifier removing
@@ -888,8 +948,13 @@ CodeGenerator* OptimizingCompiler::TryCompile(ArenaAllocator* arena,
                                               Handle<mirror::DexCache> dex_cache,
                                               ArtMethod* method,
                                               bool osr,
+                                              bool reduced_pipeline,
+                                              CompilationBudget* budget,
                                               VariableSizedHandleScope* handles) const {
-  MaybeRecordStat(MethodCompilationStat::kAttemptCompilation);
+  // A reduced pipeline only retries a method that already counted as attempted.
+  if (!reduced_pipeline) {
+    MaybeRecordStat(MethodCompilationStat::kAttemptCompilation);
+  }
   CompilerDriver* compiler_driver = GetCompilerDriver();
   InstructionSet instruction_set = compiler_driver->GetInstructionSet();
 
@@ -971,7 +1036,8 @@ CodeGenerator* OptimizingCompiler::TryCompile(ArenaAllocator* arena,
                              codegen.get(),
                              visualizer_output_.get(),
                              compiler_driver,
-                             dump_mutex_);
+                             dump_mutex_,
+                             budget);
 
   {
     VLOG(compiler) << "Building " << pass_observer.GetMethodName();
@@ -1015,10 +1081,17 @@ CodeGenerator* OptimizingCompiler::TryCompile(ArenaAllocator* arena,
                    compiler_driver,
                    dex_compilation_unit,
                    &pass_observer,
+                   reduced_pipeline,
                    handles);
+  if (pass_observer.IsOverBudget()) {
+    // Skipped passes may have left the graph in a state the code generator does not handle.
+    pass_observer.SetGraphInBadState();
+    return nullptr;
+  }
 
-  RegisterAllocator::Strategy regalloc_strategy =
-    compiler_options.GetRegisterAllocationStrategy();
+  RegisterAllocator::Strategy regalloc_strategy = reduced_pipeline
+      ? RegisterAllocator::Strategy::kRegisterAllocatorLinearScan
+      : compiler_options.GetRegisterAllocationStrategy();
   AllocateRegisters(graph, codegen.get(), &pass_observer, regalloc_strategy);
 
   codegen->Compile(code_allocator);
@@ -1043,39 +1116,64 @@ CompiledMethod* OptimizingCompiler::Compile(const DexFile::CodeItem* code_item,
   if (compiler_driver->IsMethodVerifiedWithoutFailures(method_idx, class_def_idx, dex_file)
       || verifier::CanCompilerHandleVerificationFailure(
             verified_method->GetEncounteredVerificationFailures())) {
-    ArenaAllocator arena(Runtime::Current()->GetArenaPool());
-    CodeVectorAllocator code_allocator(&arena);
-    std::unique_ptr<CodeGenerator> codegen;
-    {
-      ScopedObjectAccess soa(Thread::Current());
-      VariableSizedHandleScope handles(soa.Self());
-      // Go to native so that we don't block GC during compilation.
-      ScopedThreadSuspension sts(soa.Self(), kNative);
-      codegen.reset(
-          TryCompile(&arena,
-                     &code_allocator,
-                     code_item,
-                     access_flags,
-                     invoke_type,
-                     class_def_idx,
-                     method_idx,
-                     jclass_loader,
-                     dex_file,
-                     dex_cache,
-                     nullptr,
-                     /* osr */ false,
-                     &handles));
-    }
-    if (codegen.get() != nullptr) {
-      MaybeRecordStat(MethodCompilationStat::kCompiled);
-      method = Emit(&arena, &code_allocator, codegen.get(), compiler_driver, code_item);
-
-      if (kArenaAllocatorCountAllocations) {
-        if (arena.BytesAllocated() > kArenaAllocatorMemoryReportThreshold) {
-          MemStats mem_stats(arena.GetMemStats());
-          LOG(INFO) << dex_file.PrettyMethod(method_idx) << " " << Dumpable<MemStats>(mem_stats);
+    const CompilerOptions& compiler_options = compiler_driver->GetCompilerOptions();
+    // The time budget depends on the machine load, so it cannot be used for deterministic
+    // compilation.
+    uint64_t time_budget_ns = compiler_options.IsForceDeterminism()
+        ? 0u
+        : MsToNs(compiler_options.GetMethodCompileTimeBudgetMs());
+    size_t memory_budget = compiler_options.GetMethodCompileMemoryBudget();
+    // If the full pipeline exceeds the budget, retry with the reduced pipeline. The retry is not
+    // limited since there is nothing cheaper left to fall back to.
+    for (bool reduced_pipeline : { false, true }) {
+      ArenaAllocator arena(Runtime::Current()->GetArenaPool());
+      CodeVectorAllocator code_allocator(&arena);
+      CompilationBudget budget(&arena,
+                               reduced_pipeline ? 0u : time_budget_ns,
+                               reduced_pipeline ? 0u : memory_budget);
+      std::unique_ptr<CodeGenerator> codegen;
+      {
+        ScopedObjectAccess soa(Thread::Current());
+        VariableSizedHandleScope handles(soa.Self());
+        // Go to native so that we don't block GC during compilation.
+        ScopedThreadSuspension sts(soa.Self(), kNative);
+        codegen.reset(
+            TryCompile(&arena,
+                       &code_allocator,
+                       code_item,
+                       access_flags,
+                       invoke_type,
+                       class_def_idx,
+                       method_idx,
+                       jclass_loader,
+                       dex_file,
+                       dex_cache,
+                       nullptr,
+                       /* osr */ false,
+                       reduced_pipeline,
+                       &budget,
+                       &handles));
+      }
+      if (codegen.get() != nullptr) {
+        MaybeRecordStat(reduced_pipeline ? MethodCompilationStat::kCompiledReducedPipeline
+                                         : MethodCompilationStat::kCompiled);
+        method = Emit(&arena, &code_allocator, codegen.get(), compiler_driver, code_item);
+
+        if (kArenaAllocatorCountAllocations) {
+          if (arena.BytesAllocated() > kArenaAllocatorMemoryReportThreshold) {
+            MemStats mem_stats(arena.GetMemStats());
+            LOG(INFO) << dex_file.PrettyMethod(method_idx) << " " << Dumpable<MemStats>(mem_stats);
+          }
         }
+        break;
+      }
+      if (!budget.WasExceeded()) {
+        break;  // The method cannot be compiled; the reduced pipeline would not help.
       }
+      DCHECK(!reduced_pipeline);
+      compiler_driver->RecordOverBudgetMethod(MethodReference(&dex_file, method_idx),
+                                              budget.GetElapsedNs(),
+                                              arena.BytesUsed());
     }
   } else {
     if (compiler_driver->GetCompilerOptions().VerifyAtRuntime()) {
@@ -1171,6 +1269,8 @@ bool OptimizingCompiler::JitCompile(Thread* self,
                    dex_cache,
                    method,
                    osr,
+                   /* reduced_pipeline */ false,
+                   /* budget */ nullptr,
                    &handles));
     if (codegen.get() == nullptr) {
       return false;
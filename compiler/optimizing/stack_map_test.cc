@@ -580,6 +580,50 @@ TEST(StackMapTest, TestNonLiveDexRegisters) {
   ASSERT_FALSE(stack_map.HasInlineInfo(encoding.stack_map.encoding));
 }
 
+TEST(StackMapTest, TestGetDexRegisterLocations) {
+  ArenaPool pool;
+  ArenaAllocator arena(&pool);
+  StackMapStream stream(&arena, kRuntimeISA);
+
+  ArenaBitVector sp_mask(&arena, 0, false);
+  uint32_t number_of_dex_registers = 5;
+  stream.BeginStackMapEntry(0, 64, 0x3, &sp_mask, number_of_dex_registers, 0);
+  stream.AddDexRegisterEntry(Kind::kInStack, 0);         // Short location.
+  stream.AddDexRegisterEntry(Kind::kNone, 0);            // No location.
+  stream.AddDexRegisterEntry(Kind::kConstant, -2);       // Large location.
+  stream.AddDexRegisterEntry(Kind::kInRegister, 2);      // Short location.
+  stream.AddDexRegisterEntry(Kind::kInStack, 1024);      // Large location.
+  stream.EndStackMapEntry();
+
+  size_t size = stream.PrepareForFillIn();
+  void* memory = arena.Alloc(size, kArenaAllocMisc);
+  MemoryRegion region(memory, size);
+  stream.FillInCodeInfo(region);
+
+  CodeInfo code_info(region);
+  CodeInfoEncoding encoding = code_info.ExtractEncoding();
+  StackMap stack_map = code_info.GetStackMapAt(0, encoding);
+  DexRegisterMap dex_register_map =
+      code_info.GetDexRegisterMapOf(stack_map, encoding, number_of_dex_registers);
+
+  std::vector<DexRegisterLocation> locations(number_of_dex_registers);
+  dex_register_map.GetDexRegisterLocations(
+      number_of_dex_registers, code_info, encoding, locations.data());
+  for (uint16_t i = 0; i < number_of_dex_registers; ++i) {
+    ASSERT_TRUE(locations[i] == dex_register_map.GetDexRegisterLocation(
+        i, number_of_dex_registers, code_info, encoding));
+  }
+  ASSERT_EQ(Kind::kInStack, locations[0].GetKind());
+  ASSERT_EQ(0, locations[0].GetValue());
+  ASSERT_EQ(Kind::kNone, locations[1].GetKind());
+  ASSERT_EQ(Kind::kConstant, locations[2].GetKind());
+  ASSERT_EQ(-2, locations[2].GetValue());
+  ASSERT_EQ(Kind::kInRegister, locations[3].GetKind());
+  ASSERT_EQ(2, locations[3].GetValue());
+  ASSERT_EQ(Kind::kInStack, locations[4].GetKind());
+  ASSERT_EQ(1024, locations[4].GetValue());
+}
+
 // Generate a stack map whose dex register offset is
 // StackMap::kNoDexRegisterMapSmallEncoding, and ensure we do
 // not treat it as kNoDexRegisterMap.
@@ -21,12 +21,15 @@
 
 #include <algorithm>
 #include <inttypes.h>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "android-base/stringprintf.h"
 
+#include "atomic.h"
+#include "base/bit_utils.h"
 #include "base/mutex.h"
-#include "base/hash_set.h"
 #include "base/stl_util.h"
 #include "base/time_utils.h"
 
@@ -57,43 +60,63 @@ class DedupeSet<InKey, StoreKey, Alloc, HashType, HashFunc, kShard>::Shard {
       : alloc_(alloc),
         lock_name_(lock_name),
         lock_(lock_name_.c_str()),
-        keys_() {
+        tables_(),
+        table_(nullptr),
+        size_(0u) {
+    tables_.emplace_back(new Table(kInitialCapacity));
+    table_.StoreRelaxed(tables_.back().get());
   }
 
   ~Shard() {
-    for (const HashedKey<StoreKey>& key : keys_) {
-      DCHECK(key.Key() != nullptr);
-      alloc_.Destroy(key.Key());
+    // All keys are in the current table, the older tables are kept only for concurrent readers.
+    const Table* table = table_.LoadRelaxed();
+    for (size_t i = 0; i != table->Capacity(); ++i) {
+      const StoreKey* key = table->GetKey(i);
+      if (key != nullptr) {
+        alloc_.Destroy(key);
+      }
     }
   }
 
   const StoreKey* Add(Thread* self, size_t hash, const InKey& in_key) REQUIRES(!lock_) {
+    // Most additions are duplicates, so look for the key without taking the lock first.
+    const StoreKey* store_key = Find(table_.LoadAcquire(), hash, in_key);
+    if (store_key != nullptr) {
+      return store_key;
+    }
     MutexLock lock(self, lock_);
-    HashedKey<InKey> hashed_in_key(hash, &in_key);
-    auto it = keys_.Find(hashed_in_key);
-    if (it != keys_.end()) {
-      DCHECK(it->Key() != nullptr);
-      return it->Key();
+    // The key may have been added, or the table replaced, before we took the lock.
+    Table* table = table_.LoadRelaxed();
+    store_key = Find(table, hash, in_key);
+    if (store_key != nullptr) {
+      return store_key;
+    }
+    if ((size_ + 1u) * kMaxLoadDenominator > table->Capacity() * kMaxLoadNumerator) {
+      table = Grow(table);
     }
-    const StoreKey* store_key = alloc_.Copy(in_key);
-    keys_.Insert(HashedKey<StoreKey> { hash, store_key });
+    store_key = alloc_.Copy(in_key);
+    table->Insert(hash, store_key);
+    ++size_;
     return store_key;
   }
 
   void UpdateStats(Thread* self, Stats* global_stats) REQUIRES(!lock_) {
-    // HashSet<> doesn't keep entries ordered by hash, so we actually allocate memory
+    // The table doesn't keep entries ordered by hash, so we actually allocate memory
     // for bookkeeping while collecting the stats.
     std::unordered_map<HashType, size_t> stats;
     {
       MutexLock lock(self, lock_);
-      // Note: The total_probe_distance will be updated with the current state.
-      // It may have been higher before a re-hash.
-      global_stats->total_probe_distance += keys_.TotalProbeDistance();
-      global_stats->total_size += keys_.Size();
-      for (const HashedKey<StoreKey>& key : keys_) {
-        auto it = stats.find(key.Hash());
+      const Table* table = table_.LoadRelaxed();
+      global_stats->total_size += size_;
+      for (size_t i = 0; i != table->Capacity(); ++i) {
+        if (table->GetKey(i) == nullptr) {
+          continue;
+        }
+        size_t key_hash = table->GetHash(i);
+        global_stats->total_probe_distance += (i - table->IndexOf(key_hash)) & table->Mask();
+        auto it = stats.find(key_hash);
         if (it == stats.end()) {
-          stats.insert({key.Hash(), 1u});
+          stats.insert({key_hash, 1u});
         } else {
           ++it->second;
         }
@@ -109,74 +132,96 @@ class DedupeSet<InKey, StoreKey, Alloc, HashType, HashFunc, kShard>::Shard {
   }
 
  private:
-  template <typename T>
-  class HashedKey {
-   public:
-    HashedKey() : hash_(0u), key_(nullptr) { }
-    HashedKey(size_t hash, const T* key) : hash_(hash), key_(key) { }
+  static constexpr size_t kInitialCapacity = 64u;
+  static constexpr size_t kMaxLoadNumerator = 7u;
+  static constexpr size_t kMaxLoadDenominator = 10u;
 
-    size_t Hash() const {
-      return hash_;
+  // An open addressing hash table with linear probing that supports lookups concurrent with
+  // a single writer. Entries are never removed and a slot is written only once: the hash is
+  // stored before the key is published with release semantics, so a reader that sees
+  // a non-null key also sees its hash.
+  class Table {
+   public:
+    explicit Table(size_t capacity)
+        : mask_(capacity - 1u),
+          hashes_(new size_t[capacity]),
+          keys_(new Atomic<const StoreKey*>[capacity]) {
+      DCHECK(IsPowerOfTwo(capacity));
     }
 
-    const T* Key() const {
-      return key_;
+    size_t Capacity() const {
+      return mask_ + 1u;
     }
 
-    bool IsEmpty() const {
-      return Key() == nullptr;
+    size_t Mask() const {
+      return mask_;
     }
 
-    void MakeEmpty() {
-      key_ = nullptr;
+    size_t IndexOf(size_t hash) const {
+      return hash & mask_;
     }
 
-   private:
-    size_t hash_;
-    const T* key_;
-  };
-
-  class ShardEmptyFn {
-   public:
-    bool IsEmpty(const HashedKey<StoreKey>& key) const {
-      return key.IsEmpty();
+    const StoreKey* GetKey(size_t index) const {
+      return keys_[index].LoadAcquire();
     }
 
-    void MakeEmpty(HashedKey<StoreKey>& key) {
-      key.MakeEmpty();
+    size_t GetHash(size_t index) const {
+      return hashes_[index];
     }
-  };
 
-  struct ShardHashFn {
-    template <typename T>
-    size_t operator()(const HashedKey<T>& key) const {
-      return key.Hash();
+    // Must be called with the shard lock held, or before the table is published.
+    void Insert(size_t hash, const StoreKey* key) {
+      size_t index = IndexOf(hash);
+      while (keys_[index].LoadRelaxed() != nullptr) {
+        index = (index + 1u) & mask_;
+      }
+      hashes_[index] = hash;
+      keys_[index].StoreRelease(key);
     }
+
+   private:
+    const size_t mask_;
+    std::unique_ptr<size_t[]> hashes_;
+    std::unique_ptr<Atomic<const StoreKey*>[]> keys_;
+
+    DISALLOW_COPY_AND_ASSIGN(Table);
   };
 
-  struct ShardPred {
-    typename std::enable_if<!std::is_same<StoreKey, InKey>::value, bool>::type
-    operator()(const HashedKey<StoreKey>& lhs, const HashedKey<StoreKey>& rhs) const {
-      DCHECK(lhs.Key() != nullptr);
-      DCHECK(rhs.Key() != nullptr);
-      // Rehashing: stored keys are already deduplicated, so we can simply compare key pointers.
-      return lhs.Key() == rhs.Key();
+  static const StoreKey* Find(const Table* table, size_t hash, const InKey& in_key) {
+    for (size_t index = table->IndexOf(hash); ; index = (index + 1u) & table->Mask()) {
+      const StoreKey* key = table->GetKey(index);
+      if (key == nullptr) {
+        return nullptr;
+      }
+      if (table->GetHash(index) == hash &&
+          key->size() == in_key.size() &&
+          std::equal(in_key.begin(), in_key.end(), key->begin())) {
+        return key;
+      }
     }
+  }
 
-    template <typename LeftT, typename RightT>
-    bool operator()(const HashedKey<LeftT>& lhs, const HashedKey<RightT>& rhs) const {
-      DCHECK(lhs.Key() != nullptr);
-      DCHECK(rhs.Key() != nullptr);
-      return lhs.Hash() == rhs.Hash() &&
-          lhs.Key()->size() == rhs.Key()->size() &&
-          std::equal(lhs.Key()->begin(), lhs.Key()->end(), rhs.Key()->begin());
+  Table* Grow(const Table* table) REQUIRES(lock_) {
+    std::unique_ptr<Table> new_table(new Table(table->Capacity() * 2u));
+    for (size_t i = 0; i != table->Capacity(); ++i) {
+      const StoreKey* key = table->GetKey(i);
+      if (key != nullptr) {
+        new_table->Insert(table->GetHash(i), key);
+      }
     }
-  };
+    // Readers may still be probing the old table, keep it until the shard is destroyed.
+    // A reader that misses a key in an old table retries under the lock.
+    tables_.push_back(std::move(new_table));
+    table_.StoreRelease(tables_.back().get());
+    return tables_.back().get();
+  }
 
   Alloc alloc_;
   const std::string lock_name_;
   Mutex lock_;
-  HashSet<HashedKey<StoreKey>, ShardEmptyFn, ShardHashFn, ShardPred> keys_ GUARDED_BY(lock_);
+  std::vector<std::unique_ptr<Table>> tables_ GUARDED_BY(lock_);
+  Atomic<Table*> table_;
+  size_t size_ GUARDED_BY(lock_);
 };
 
 template <typename InKey,
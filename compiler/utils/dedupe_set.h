@@ -28,8 +28,8 @@ namespace art {
 class Thread;
 
 // A set of Keys that support a HashFunc returning HashType. Used to find duplicates of Key in the
-// Add method. The data-structure is thread-safe through the use of internal locks, it also
-// supports the lock being sharded.
+// Add method. The data-structure is thread-safe: lookups of keys that are already present do not
+// take any lock and only the insertion of a new key takes the lock of its shard.
 template <typename InKey,
           typename StoreKey,
           typename Alloc,
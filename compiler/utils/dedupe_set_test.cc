@@ -18,9 +18,11 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <pthread.h>
 #include <vector>
 
 #include "base/array_ref.h"
+#include "base/time_utils.h"
 #include "dedupe_set-inl.h"
 #include "gtest/gtest.h"
 #include "thread-inl.h"
@@ -88,4 +90,84 @@ TEST(DedupeSetTest, Test) {
   }
 }
 
+using TestDedupeSet = DedupeSet<ArrayRef<const uint8_t>,
+                                std::vector<uint8_t>,
+                                DedupeSetTestAlloc,
+                                size_t,
+                                DedupeSetTestHashFunc,
+                                4>;
+
+struct ConcurrentAddArgs {
+  TestDedupeSet* deduplicator;
+  const std::vector<std::vector<uint8_t>>* inputs;
+  size_t repeat;
+  std::vector<const std::vector<uint8_t>*> results;
+};
+
+static void* ConcurrentAdd(void* arg) {
+  ConcurrentAddArgs* args = reinterpret_cast<ConcurrentAddArgs*>(arg);
+  args->results.reserve(args->inputs->size());
+  for (size_t r = 0; r != args->repeat; ++r) {
+    for (size_t i = 0; i != args->inputs->size(); ++i) {
+      const std::vector<uint8_t>& input = (*args->inputs)[i];
+      const std::vector<uint8_t>* result = args->deduplicator->Add(
+          /* self */ nullptr, ArrayRef<const uint8_t>(input));
+      if (r == 0u) {
+        args->results.push_back(result);
+      } else if (args->results[i] != result) {
+        args->results[i] = nullptr;  // Report the mismatch to the main thread.
+      }
+    }
+  }
+  return nullptr;
+}
+
+// Adds the same keys from an increasing number of threads and checks that all the threads see
+// the same deduplicated keys. Also logs the throughput to show how the set scales.
+TEST(DedupeSetTest, ConcurrentAdd) {
+  static constexpr size_t kNumInputs = 4096u;
+  static constexpr size_t kRepeat = 8u;
+  std::vector<std::vector<uint8_t>> inputs;
+  inputs.reserve(kNumInputs);
+  for (size_t i = 0; i != kNumInputs; ++i) {
+    // Half of the inputs are duplicates of the other half.
+    size_t value = i % (kNumInputs / 2u);
+    inputs.push_back({ static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8), 42u });
+  }
+
+  for (size_t num_threads = 1u; num_threads <= 64u; num_threads *= 2u) {
+    DedupeSetTestAlloc alloc;
+    TestDedupeSet deduplicator("test", alloc);
+    std::vector<ConcurrentAddArgs> args(num_threads);
+    std::vector<pthread_t> threads(num_threads);
+    uint64_t start_ns = NanoTime();
+    for (size_t t = 0; t != num_threads; ++t) {
+      args[t].deduplicator = &deduplicator;
+      args[t].inputs = &inputs;
+      args[t].repeat = kRepeat;
+      ASSERT_EQ(0, pthread_create(&threads[t], nullptr, ConcurrentAdd, &args[t]));
+    }
+    for (pthread_t thread : threads) {
+      ASSERT_EQ(0, pthread_join(thread, nullptr));
+    }
+    uint64_t duration_ns = std::max<uint64_t>(NanoTime() - start_ns, 1u);
+    size_t num_adds = num_threads * kRepeat * kNumInputs;
+    LOG(INFO) << "DedupeSet: " << num_threads << " threads, "
+              << (num_adds * UINT64_C(1000000000) / duration_ns) << " adds/s";
+
+    for (size_t i = 0; i != kNumInputs; ++i) {
+      const std::vector<uint8_t>* expected = args[0].results[i];
+      ASSERT_NE(expected, nullptr);
+      ASSERT_TRUE(std::equal(inputs[i].begin(), inputs[i].end(), expected->begin()));
+      ASSERT_EQ(expected, args[0].results[i % (kNumInputs / 2u)]);
+      if (i < kNumInputs / 2u) {
+        ASSERT_NE(expected, args[0].results[(i + 1u) % (kNumInputs / 2u)]);
+      }
+      for (size_t t = 1; t != num_threads; ++t) {
+        ASSERT_EQ(expected, args[t].results[i]);
+      }
+    }
+  }
+}
+
 }  // namespace art
@@ -24,10 +24,12 @@
 #include "base/macros.h"
 #include "base/mutex.h"
 #include "thread-inl.h"
+#include "utils.h"
 
 namespace art {
 
-// The chunk size by which the swap file is increased and mapped.
+// The minimum size by which the swap file is increased and mapped. It is shared by the arenas,
+// each of which grows the file by its share only.
 static constexpr size_t kMininumMapSize = 16 * MB;
 
 static constexpr bool kCheckFreeMaps = false;
@@ -45,29 +47,25 @@ static void DumpFreeMap(const FreeBySizeSet& free_by_size) {
   }
 }
 
-void SwapSpace::RemoveChunk(FreeBySizeSet::const_iterator free_by_size_pos) {
+void SwapSpace::Arena::RemoveChunk(FreeBySizeSet::const_iterator free_by_size_pos) {
   auto free_by_start_pos = free_by_size_pos->free_by_start_entry;
   free_by_size_.erase(free_by_size_pos);
   free_by_start_.erase(free_by_start_pos);
 }
 
-inline void SwapSpace::InsertChunk(const SpaceChunk& chunk) {
+inline void SwapSpace::Arena::InsertChunk(const SpaceChunk& chunk) {
   DCHECK_NE(chunk.size, 0u);
   auto insert_result = free_by_start_.insert(chunk);
   DCHECK(insert_result.second);
   free_by_size_.emplace(chunk.size, insert_result.first);
 }
 
-SwapSpace::SwapSpace(int fd, size_t initial_size)
-    : fd_(fd),
-      size_(0),
-      lock_("SwapSpace lock", static_cast<LockLevel>(LockLevel::kDefaultMutexLevel - 1)) {
-  // Assume that the file is unlinked.
-
-  InsertChunk(NewFileChunk(initial_size));
+SwapSpace::Arena::Arena(const std::string& lock_name)
+    : lock_name_(lock_name),
+      lock_(lock_name_.c_str(), static_cast<LockLevel>(LockLevel::kDefaultMutexLevel - 1)) {
 }
 
-SwapSpace::~SwapSpace() {
+SwapSpace::Arena::~Arena() {
   // Unmap all mmapped chunks. Nothing should be allocated anymore at
   // this point, so there should be only full size chunks in free_by_start_.
   for (const SpaceChunk& chunk : free_by_start_) {
@@ -76,6 +74,30 @@ SwapSpace::~SwapSpace() {
           << static_cast<const void*>(chunk.ptr) << " size=" << chunk.size;
     }
   }
+}
+
+SwapSpace::SwapSpace(int fd, size_t initial_size)
+    : fd_(fd),
+      size_(0),
+      chunks_lock_("SwapSpace chunks lock",
+                   static_cast<LockLevel>(LockLevel::kDefaultMutexLevel - 1)) {
+  // Assume that the file is unlinked.
+
+  for (size_t i = 0; i != kNumArenas; ++i) {
+    arenas_[i].reset(new Arena("SwapSpace lock " + std::to_string(i)));
+  }
+  // Give each arena its share of the initial size. Each such chunk is a whole mapping.
+  const size_t arena_initial_size = initial_size / kNumArenas;
+  for (size_t i = 0; i != kNumArenas; ++i) {
+    SpaceChunk chunk = NewFileChunk(arena_initial_size, i);
+    arenas_[i]->Free(chunk, chunk);
+  }
+}
+
+SwapSpace::~SwapSpace() {
+  for (std::unique_ptr<Arena>& arena : arenas_) {
+    arena.reset();
+  }
   // All arenas are backed by the same file. Just close the descriptor.
   close(fd_);
 }
@@ -105,62 +127,81 @@ static size_t CollectFree(const FreeByStartSet& free_by_start, const FreeBySizeS
 }
 
 void* SwapSpace::Alloc(size_t size) {
-  MutexLock lock(Thread::Current(), lock_);
   size = RoundUp(size, 8U);
 
+  Thread* self = Thread::Current();
+  pid_t tid = (self != nullptr) ? self->GetTid() : GetTid();
+  size_t arena_index = static_cast<size_t>(tid) % kNumArenas;
+  Arena* arena = arenas_[arena_index].get();
+  void* ptr = arena->TryAlloc(size);
+  if (ptr == nullptr) {
+    // Not a big enough free chunk, need to increase file size.
+    ptr = arena->AddChunkAndAlloc(NewFileChunk(size, arena_index), size);
+  }
+  return ptr;
+}
+
+void* SwapSpace::Arena::TryAlloc(size_t size) {
+  MutexLock lock(Thread::Current(), lock_);
+
   // Check the free list for something that fits.
   // TODO: Smarter implementation. Global biggest chunk, ...
   auto it = free_by_start_.empty()
       ? free_by_size_.end()
       : free_by_size_.lower_bound(FreeBySizeEntry { size, free_by_start_.begin() });
-  if (it != free_by_size_.end()) {
-    auto entry = it->free_by_start_entry;
-    SpaceChunk old_chunk = *entry;
-    if (old_chunk.size == size) {
-      RemoveChunk(it);
+  if (it == free_by_size_.end()) {
+    return nullptr;
+  }
+  auto entry = it->free_by_start_entry;
+  SpaceChunk old_chunk = *entry;
+  if (old_chunk.size == size) {
+    RemoveChunk(it);
+  } else {
+    // Try to avoid deallocating and allocating the std::set<> nodes.
+    // This would be much simpler if we could use replace() from Boost.Bimap.
+
+    // The free_by_start_ map contains disjoint intervals ordered by the `ptr`.
+    // Shrinking the interval does not affect the ordering.
+    it->free_by_start_entry->ptr += size;
+    it->free_by_start_entry->size -= size;
+
+    // The free_by_size_ map is ordered by the `size` and then `free_by_start_entry->ptr`.
+    // Adjusting the `ptr` above does not change that ordering but decreasing `size` can
+    // push the node before the previous node(s).
+    if (it == free_by_size_.begin()) {
+      it->size -= size;
     } else {
-      // Try to avoid deallocating and allocating the std::set<> nodes.
-      // This would be much simpler if we could use replace() from Boost.Bimap.
-
-      // The free_by_start_ map contains disjoint intervals ordered by the `ptr`.
-      // Shrinking the interval does not affect the ordering.
-      it->free_by_start_entry->ptr += size;
-      it->free_by_start_entry->size -= size;
-
-      // The free_by_size_ map is ordered by the `size` and then `free_by_start_entry->ptr`.
-      // Adjusting the `ptr` above does not change that ordering but decreasing `size` can
-      // push the node before the previous node(s).
-      if (it == free_by_size_.begin()) {
+      auto prev = it;
+      --prev;
+      FreeBySizeEntry new_value(old_chunk.size - size, entry);
+      if (free_by_size_.key_comp()(*prev, new_value)) {
         it->size -= size;
       } else {
-        auto prev = it;
-        --prev;
-        FreeBySizeEntry new_value(old_chunk.size - size, entry);
-        if (free_by_size_.key_comp()(*prev, new_value)) {
-          it->size -= size;
-        } else {
-          // Changing in place would break the std::set<> ordering, we need to remove and insert.
-          free_by_size_.erase(it);
-          free_by_size_.insert(new_value);
-        }
+        // Changing in place would break the std::set<> ordering, we need to remove and insert.
+        free_by_size_.erase(it);
+        free_by_size_.insert(new_value);
       }
     }
-    return old_chunk.ptr;
-  } else {
-    // Not a big enough free chunk, need to increase file size.
-    SpaceChunk new_chunk = NewFileChunk(size);
-    if (new_chunk.size != size) {
-      // Insert the remainder.
-      SpaceChunk remainder = { new_chunk.ptr + size, new_chunk.size - size };
-      InsertChunk(remainder);
-    }
-    return new_chunk.ptr;
   }
+  return old_chunk.ptr;
 }
 
-SwapSpace::SpaceChunk SwapSpace::NewFileChunk(size_t min_size) {
+void* SwapSpace::Arena::AddChunkAndAlloc(const SpaceChunk& chunk, size_t size) {
+  DCHECK_GE(chunk.size, size);
+  if (chunk.size != size) {
+    // Insert the remainder.
+    SpaceChunk remainder = { chunk.ptr + size, chunk.size - size };
+    MutexLock lock(Thread::Current(), lock_);
+    InsertChunk(remainder);
+  }
+  return chunk.ptr;
+}
+
+SwapSpace::SpaceChunk SwapSpace::NewFileChunk(size_t min_size, size_t arena_index) {
 #if !defined(__APPLE__)
-  size_t next_part = std::max(RoundUp(min_size, kPageSize), RoundUp(kMininumMapSize, kPageSize));
+  WriterMutexLock mu(Thread::Current(), chunks_lock_);
+  size_t next_part =
+      std::max(RoundUp(min_size, kPageSize), RoundUp(kMininumMapSize / kNumArenas, kPageSize));
   int result = TEMP_FAILURE_RETRY(ftruncate64(fd_, size_ + next_part));
   if (result != 0) {
     PLOG(FATAL) << "Unable to increase swap file.";
@@ -170,38 +211,55 @@ SwapSpace::SpaceChunk SwapSpace::NewFileChunk(size_t min_size) {
   if (ptr == MAP_FAILED) {
     LOG(ERROR) << "Unable to mmap new swap file chunk.";
     LOG(ERROR) << "Current size: " << size_ << " requested: " << next_part << "/" << min_size;
-    LOG(ERROR) << "Free list:";
-    DumpFreeMap(free_by_size_);
-    LOG(ERROR) << "In free list: " << CollectFree(free_by_start_, free_by_size_);
     LOG(FATAL) << "Aborting...";
   }
   size_ += next_part;
   SpaceChunk new_chunk = {ptr, next_part};
+  chunk_arenas_.emplace(new_chunk.Start(), std::make_pair(new_chunk.End(), arena_index));
   return new_chunk;
 #else
-  UNUSED(min_size, kMininumMapSize);
+  UNUSED(min_size, arena_index, kMininumMapSize);
   LOG(FATAL) << "No swap file support on the Mac.";
   UNREACHABLE();
 #endif
 }
 
-// TODO: Full coalescing.
+SwapSpace::Arena* SwapSpace::GetArenaForChunk(const SpaceChunk& chunk, SpaceChunk* mapping) {
+  ReaderMutexLock mu(Thread::Current(), chunks_lock_);
+  auto it = chunk_arenas_.upper_bound(chunk.Start());
+  CHECK(it != chunk_arenas_.begin()) << static_cast<const void*>(chunk.ptr);
+  --it;
+  CHECK_LE(chunk.End(), it->second.first) << static_cast<const void*>(chunk.ptr);
+  mapping->ptr = reinterpret_cast<uint8_t*>(it->first);
+  mapping->size = it->second.first - it->first;
+  return arenas_[it->second.second].get();
+}
+
 void SwapSpace::Free(void* ptr, size_t size) {
-  MutexLock lock(Thread::Current(), lock_);
   size = RoundUp(size, 8U);
+  SpaceChunk chunk = { reinterpret_cast<uint8_t*>(ptr), size };
+  SpaceChunk mapping;
+  GetArenaForChunk(chunk, &mapping)->Free(chunk, mapping);
+}
+
+// TODO: Full coalescing.
+void SwapSpace::Arena::Free(const SpaceChunk& freed_chunk, const SpaceChunk& mapping) {
+  MutexLock lock(Thread::Current(), lock_);
 
   size_t free_before = 0;
   if (kCheckFreeMaps) {
     free_before = CollectFree(free_by_start_, free_by_size_);
   }
 
-  SpaceChunk chunk = { reinterpret_cast<uint8_t*>(ptr), size };
+  SpaceChunk chunk = freed_chunk;
   auto it = free_by_start_.lower_bound(chunk);
   if (it != free_by_start_.begin()) {
     auto prev = it;
     --prev;
     CHECK_LE(prev->End(), chunk.Start());
-    if (prev->End() == chunk.Start()) {
+    // Adjacent file chunks may be mapped next to each other, but an allocation must not span two
+    // mappings, so only merge free chunks of the same mapping.
+    if (prev->End() == chunk.Start() && prev->Start() >= mapping.Start()) {
       // Merge *prev with this chunk.
       chunk.size += prev->size;
       chunk.ptr -= prev->size;
@@ -213,7 +271,7 @@ void SwapSpace::Free(void* ptr, size_t size) {
   }
   if (it != free_by_start_.end()) {
     CHECK_LE(chunk.End(), it->Start());
-    if (chunk.End() == it->Start()) {
+    if (chunk.End() == it->Start() && it->End() <= mapping.End()) {
       // Merge *it with this chunk.
       chunk.size += it->size;
       auto erase_pos = free_by_size_.find(FreeBySizeEntry { it->size, it });
@@ -227,9 +285,10 @@ void SwapSpace::Free(void* ptr, size_t size) {
   if (kCheckFreeMaps) {
     size_t free_after = CollectFree(free_by_start_, free_by_size_);
 
-    if (free_after != free_before + size) {
+    if (free_after != free_before + freed_chunk.size) {
       DumpFreeMap(free_by_size_);
-      CHECK_EQ(free_after, free_before + size) << "Should be " << size << " difference from " << free_before;
+      CHECK_EQ(free_after, free_before + freed_chunk.size)
+          << "Should be " << freed_chunk.size << " difference from " << free_before;
     }
   }
 }
@@ -19,8 +19,12 @@
 
 #include <cstdlib>
 #include <list>
-#include <vector>
+#include <map>
+#include <memory>
 #include <set>
+#include <string>
+#include <utility>
+#include <vector>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -30,13 +34,16 @@
 
 namespace art {
 
-// An arena pool that creates arenas backed by an mmaped file.
+// An arena pool that creates arenas backed by an mmaped file. To avoid contention between
+// compiler threads, the space is split into several arenas with their own free lists and locks.
+// Each thread allocates from the arena selected by its tid and each mmaped chunk of the file
+// belongs to a single arena, so memory can be freed by any thread.
 class SwapSpace {
  public:
   SwapSpace(int fd, size_t initial_size);
   ~SwapSpace();
-  void* Alloc(size_t size) REQUIRES(!lock_);
-  void Free(void* ptr, size_t size) REQUIRES(!lock_);
+  void* Alloc(size_t size) REQUIRES(!chunks_lock_);
+  void Free(void* ptr, size_t size) REQUIRES(!chunks_lock_);
 
   size_t GetSize() {
     return size_;
@@ -88,22 +95,53 @@ class SwapSpace {
   };
   typedef std::set<FreeBySizeEntry, FreeBySizeComparator> FreeBySizeSet;
 
-  SpaceChunk NewFileChunk(size_t min_size) REQUIRES(lock_);
+  // The free lists of one arena.
+  class Arena {
+   public:
+    explicit Arena(const std::string& lock_name);
+    ~Arena();
+
+    // Allocate from the free lists. Returns null if there is no big enough free chunk.
+    void* TryAlloc(size_t size) REQUIRES(!lock_);
+    // Add a new file chunk to the free lists and allocate `size` bytes from its start.
+    void* AddChunkAndAlloc(const SpaceChunk& chunk, size_t size) REQUIRES(!lock_);
+    // Return a chunk to the free lists. It is only merged with free chunks of the same mapping.
+    void Free(const SpaceChunk& chunk, const SpaceChunk& mapping) REQUIRES(!lock_);
+
+   private:
+    void RemoveChunk(FreeBySizeSet::const_iterator free_by_size_pos) REQUIRES(lock_);
+    void InsertChunk(const SpaceChunk& chunk) REQUIRES(lock_);
+
+    // NOTE: Boost.Bimap would be useful for the two following members.
+
+    // Map start of a free chunk to its size.
+    FreeByStartSet free_by_start_ GUARDED_BY(lock_);
+    // Free chunks ordered by size.
+    FreeBySizeSet free_by_size_ GUARDED_BY(lock_);
+
+    const std::string lock_name_;
+    Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+
+    DISALLOW_COPY_AND_ASSIGN(Arena);
+  };
+
+  static constexpr size_t kNumArenas = 8u;
 
-  void RemoveChunk(FreeBySizeSet::const_iterator free_by_size_pos) REQUIRES(lock_);
-  void InsertChunk(const SpaceChunk& chunk) REQUIRES(lock_);
+  SpaceChunk NewFileChunk(size_t min_size, size_t arena_index) REQUIRES(!chunks_lock_);
+  // Returns the arena of the file chunk that contains `chunk`, and the file chunk in `mapping`.
+  Arena* GetArenaForChunk(const SpaceChunk& chunk, /*out*/ SpaceChunk* mapping)
+      REQUIRES(!chunks_lock_);
 
   int fd_;
   size_t size_;
 
-  // NOTE: Boost.Bimap would be useful for the two following members.
+  // The arena index of each mmaped file chunk, keyed by the chunk start.
+  std::map<uintptr_t, std::pair<uintptr_t, size_t>> chunk_arenas_ GUARDED_BY(chunks_lock_);
 
-  // Map start of a free chunk to its size.
-  FreeByStartSet free_by_start_ GUARDED_BY(lock_);
-  // Free chunks ordered by size.
-  FreeBySizeSet free_by_size_ GUARDED_BY(lock_);
+  std::unique_ptr<Arena> arenas_[kNumArenas];
 
-  mutable Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  // Guards the file size and chunk_arenas_. It is never held together with an arena lock.
+  mutable ReaderWriterMutex chunks_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   DISALLOW_COPY_AND_ASSIGN(SwapSpace);
 };
 
@@ -17,9 +17,11 @@
 #include "utils/swap_space.h"
 
 #include <cstdio>
+#include <cstring>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include "gtest/gtest.h"
 
 #include "base/unix_file/fd_file.h"
@@ -78,4 +80,53 @@ TEST_F(SwapSpaceTest, Swap) {
   SwapTest(true);
 }
 
+struct SwapAllocArgs {
+  SwapSpace* pool;
+  std::vector<void*> allocations;
+};
+
+static void* SwapAllocThread(void* arg) {
+  SwapAllocArgs* args = reinterpret_cast<SwapAllocArgs*>(arg);
+  for (size_t i = 0; i != 1000u; ++i) {
+    size_t size = 8u + (i % 64u) * 8u;
+    uint8_t* ptr = reinterpret_cast<uint8_t*>(args->pool->Alloc(size));
+    memset(ptr, static_cast<int>(i & 0xff), size);
+    args->allocations.push_back(ptr);
+  }
+  return nullptr;
+}
+
+// Allocate from several threads, which may use different arenas, and free everything
+// from the main thread.
+TEST_F(SwapSpaceTest, FreeFromOtherThread) {
+  ScratchFile scratch;
+  int fd = scratch.GetFd();
+  unlink(scratch.GetFilename().c_str());
+  {
+    SwapSpace pool(fd, 1 * MB);
+    static constexpr size_t kNumThreads = 4u;
+    SwapAllocArgs args[kNumThreads];
+    pthread_t threads[kNumThreads];
+    for (size_t t = 0; t != kNumThreads; ++t) {
+      args[t].pool = &pool;
+      ASSERT_EQ(0, pthread_create(&threads[t], nullptr, SwapAllocThread, &args[t]));
+    }
+    for (size_t t = 0; t != kNumThreads; ++t) {
+      ASSERT_EQ(0, pthread_join(threads[t], nullptr));
+    }
+    // The small allocations fit in each arena's share of the initial mapping, so no arena had
+    // to grow the file.
+    EXPECT_EQ(16 * MB, pool.GetSize());
+    for (size_t t = 0; t != kNumThreads; ++t) {
+      for (size_t i = 0; i != args[t].allocations.size(); ++i) {
+        size_t size = 8u + (i % 64u) * 8u;
+        uint8_t* ptr = reinterpret_cast<uint8_t*>(args[t].allocations[i]);
+        EXPECT_EQ(static_cast<uint8_t>(i & 0xff), ptr[size - 1u]);
+        pool.Free(ptr, size);
+      }
+    }
+  }
+  scratch.Close();
+}
+
 }  // namespace art
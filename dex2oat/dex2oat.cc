@@ -56,6 +56,7 @@
 #include "dex/verification_results.h"
 #include "dex2oat_return_codes.h"
 #include "dex_file-inl.h"
+#include "driver/compiled_method_cache.h"
 #include "driver/compiler_driver.h"
 #include "driver/compiler_options.h"
 #include "elf_file.h"
@@ -237,6 +238,11 @@ NO_RETURN static void Usage(const char* fmt, ...) {
   UsageError("  --image-classes=<classname-file>: specifies classes to include in an image.");
   UsageError("      Example: --image=frameworks/base/preloaded-classes");
   UsageError("");
+  UsageError("  --dirty-image-objects=<file>: list of image objects that are likely to be");
+  UsageError("      dirtied at runtime, as written by imgdiag --dump-dirty-objects. These");
+  UsageError("      objects are packed together in the image to reduce private dirty memory.");
+  UsageError("      Example: --dirty-image-objects=frameworks/base/config/dirty-image-objects");
+  UsageError("");
   UsageError("  --base=<hex-address>: specifies the base address when creating a boot image.");
   UsageError("      Example: --base=0x50000000");
   UsageError("");
@@ -320,6 +326,19 @@ NO_RETURN static void Usage(const char* fmt, ...) {
              CompilerOptions::kDefaultInlineMaxCodeUnits);
   UsageError("      Default: %d", CompilerOptions::kDefaultInlineMaxCodeUnits);
   UsageError("");
+  UsageError("  --method-compile-time-budget-ms=<ms>: methods that take longer than this to");
+  UsageError("      compile are compiled again without inlining and with the linear scan");
+  UsageError("      register allocator. Ignored with --force-determinism. A zero value disables");
+  UsageError("      the budget.");
+  UsageError("      Example: --method-compile-time-budget-ms=1000");
+  UsageError("      Default: %zu", CompilerOptions::kDefaultMethodCompileTimeBudgetMs);
+  UsageError("");
+  UsageError("  --method-compile-memory-budget=<bytes>: methods that need more arena memory");
+  UsageError("      than this to compile are compiled again like for the time budget.");
+  UsageError("      A zero value disables the budget.");
+  UsageError("      Example: --method-compile-memory-budget=67108864");
+  UsageError("      Default: %zu", CompilerOptions::kDefaultMethodCompileMemoryBudget);
+  UsageError("");
   UsageError("  --dump-timing: display a breakdown of where time was spent");
   UsageError("");
   UsageError("  -g");
@@ -372,6 +391,12 @@ NO_RETURN static void Usage(const char* fmt, ...) {
   UsageError("      bytes to consider the input \"very large\" and punt on the compilation.");
   UsageError("      Example: --very-large-app-threshold=100000000");
   UsageError("");
+  UsageError("  --compiled-method-cache=<file-name>: reuse the compiled code of classes that did");
+  UsageError("      not change since the previous compilation with the same cache file. The cache");
+  UsageError("      is read if it exists and rewritten with the code of this compilation.");
+  UsageError("      Cannot be used when writing an image.");
+  UsageError("      Example: --compiled-method-cache=/data/tmp/app.cmc");
+  UsageError("");
   UsageError("  --app-image-fd=<file-descriptor>: specify output file descriptor for app image.");
   UsageError("      Example: --app-image-fd=10");
   UsageError("");
@@ -530,12 +555,14 @@ class Dex2Oat FINAL {
       image_base_(0U),
       image_classes_zip_filename_(nullptr),
       image_classes_filename_(nullptr),
+      dirty_image_objects_filename_(nullptr),
       image_storage_mode_(ImageHeader::kStorageModeUncompressed),
       compiled_classes_zip_filename_(nullptr),
       compiled_classes_filename_(nullptr),
       compiled_methods_zip_filename_(nullptr),
       compiled_methods_filename_(nullptr),
       passes_to_run_filename_(nullptr),
+      compiled_method_cache_filename_(nullptr),
       multi_image_(false),
       is_host_(false),
       class_loader_(nullptr),
@@ -783,6 +810,15 @@ class Dex2Oat FINAL {
       Usage("--image-classes-zip should be used with --image-classes");
     }
 
+    if (dirty_image_objects_filename_ != nullptr && !IsImage()) {
+      Usage("--dirty-image-objects should only be used when writing an image");
+    }
+
+    if (compiled_method_cache_filename_ != nullptr && IsImage()) {
+      // Class initialization at compile time changes the code, and is not tracked by the cache.
+      Usage("--compiled-method-cache cannot be used when writing an image");
+    }
+
     if (compiled_classes_filename_ != nullptr && !IsBootImage()) {
       Usage("--compiled-classes should only be used with --image");
     }
@@ -1152,6 +1188,8 @@ class Dex2Oat FINAL {
         image_classes_filename_ = option.substr(strlen("--image-classes=")).data();
       } else if (option.starts_with("--image-classes-zip=")) {
         image_classes_zip_filename_ = option.substr(strlen("--image-classes-zip=")).data();
+      } else if (option.starts_with("--dirty-image-objects=")) {
+        dirty_image_objects_filename_ = option.substr(strlen("--dirty-image-objects=")).data();
       } else if (option.starts_with("--image-format=")) {
         ParseImageFormat(option);
       } else if (option.starts_with("--compiled-classes=")) {
@@ -1212,6 +1250,8 @@ class Dex2Oat FINAL {
                         "--swap-dex-count-threshold",
                         &min_dex_files_for_swap_,
                         Usage);
+      } else if (option.starts_with("--compiled-method-cache=")) {
+        compiled_method_cache_filename_ = option.substr(strlen("--compiled-method-cache=")).data();
       } else if (option.starts_with("--very-large-app-threshold=")) {
         ParseUintOption(option,
                         "--very-large-app-threshold",
@@ -1428,7 +1468,10 @@ class Dex2Oat FINAL {
   dex2oat::ReturnCode Setup() {
     TimingLogger::ScopedTiming t("dex2oat Setup", timings_);
 
-    if (!PrepareImageClasses() || !PrepareCompiledClasses() || !PrepareCompiledMethods()) {
+    if (!PrepareImageClasses() ||
+        !PrepareCompiledClasses() ||
+        !PrepareCompiledMethods() ||
+        !PrepareDirtyImageObjects()) {
       return dex2oat::ReturnCode::kOther;
     }
 
@@ -1717,7 +1760,78 @@ class Dex2Oat FINAL {
                                      swap_fd_,
                                      profile_compilation_info_.get()));
     driver_->SetDexFilesForOatFile(dex_files_);
+
+    std::unique_ptr<CompiledMethodCache> compiled_method_cache;
+    if (compiled_method_cache_filename_ != nullptr) {
+      compiled_method_cache = LoadCompiledMethodCache();
+      driver_->SetCompiledMethodCache(compiled_method_cache.get());
+    }
     driver_->CompileAll(class_loader_, dex_files_, input_vdex_file_.get(), timings_);
+    if (compiled_method_cache != nullptr) {
+      driver_->SetCompiledMethodCache(nullptr);
+      SaveCompiledMethodCache(*compiled_method_cache);
+    }
+  }
+
+  // Describes everything outside the compiled dex files that the compiled code depends on.
+  std::string GetCompiledMethodCacheConfig() const {
+    std::ostringstream oss;
+    oss << GetInstructionSetString(instruction_set_) << '\n'
+        << instruction_set_features_->GetFeatureString() << '\n'
+        << OatHeader::kOatVersion << '\n'
+        << image_file_location_oat_checksum_ << '\n'
+        << compiler_options_->GetInlineMaxCodeUnits() << '\n'
+        << compiler_options_->GetCompilePic() << '\n'
+        << compiler_options_->GetDebuggable() << '\n'
+        << compiler_options_->GetNativeDebuggable() << '\n'
+        << compiler_options_->GetGenerateDebugInfo() << '\n'
+        << compiler_options_->GetMethodCompileTimeBudgetMs() << '\n'
+        << compiler_options_->GetMethodCompileMemoryBudget() << '\n'
+        << no_inline_from_string_ << '\n';
+    // The key-value store has the compiler filter, the boot and class path with their checksums.
+    for (const auto& entry : *key_value_store_) {
+      if (entry.first != OatHeader::kDex2OatCmdLineKey &&
+          entry.first != OatHeader::kDex2OatHostKey) {
+        oss << entry.first << '=' << entry.second << '\n';
+      }
+    }
+    if (profile_compilation_info_ != nullptr) {
+      // The inliner uses the inline caches of the profile.
+      oss << profile_compilation_info_->DumpInfo(
+          static_cast<const std::vector<const DexFile*>*>(nullptr));
+    }
+    return oss.str();
+  }
+
+  std::unique_ptr<CompiledMethodCache> LoadCompiledMethodCache() {
+    TimingLogger::ScopedTiming t("dex2oat Load compiled method cache", timings_);
+    std::unique_ptr<CompiledMethodCache> cache(
+        new CompiledMethodCache(dex_files_, GetCompiledMethodCacheConfig()));
+    if (OS::FileExists(compiled_method_cache_filename_)) {
+      std::unique_ptr<File> file(OS::OpenFileForReading(compiled_method_cache_filename_));
+      std::string error_msg;
+      if (file == nullptr) {
+        PLOG(WARNING) << "Failed to open compiled method cache " << compiled_method_cache_filename_;
+      } else if (!cache->Load(file.get(), &error_msg)) {
+        // The cache is only an optimization, compile everything.
+        LOG(WARNING) << error_msg;
+      }
+    }
+    return cache;
+  }
+
+  void SaveCompiledMethodCache(const CompiledMethodCache& cache) {
+    TimingLogger::ScopedTiming t("dex2oat Save compiled method cache", timings_);
+    LOG(INFO) << "Reused " << cache.GetReusedMethodCount() << " of "
+              << cache.GetLoadedMethodCount() << " cached methods";
+    std::unique_ptr<File> file(OS::CreateEmptyFile(compiled_method_cache_filename_));
+    std::string error_msg;
+    if (file == nullptr) {
+      PLOG(WARNING) << "Failed to create compiled method cache " << compiled_method_cache_filename_;
+    } else if (!cache.Save(file.get(), driver_.get(), &error_msg)) {
+      LOG(WARNING) << error_msg;
+      file->Erase(/* unlink */ true);
+    }
   }
 
   // Notes on the interleaving of creating the images and oat files to
@@ -1821,7 +1935,8 @@ class Dex2Oat FINAL {
                                           IsAppImage(),
                                           image_storage_mode_,
                                           oat_filenames_,
-                                          dex_file_oat_index_map_));
+                                          dex_file_oat_index_map_,
+                                          dirty_image_objects_.get()));
 
       // We need to prepare method offsets in the image address space for direct method patching.
       TimingLogger::ScopedTiming t2("dex2oat Prepare image address space", timings_);
@@ -2058,6 +2173,11 @@ class Dex2Oat FINAL {
   void DumpTiming() {
     if (dump_timing_ || (dump_slow_timing_ && timings_->GetTotalNs() > MsToNs(1000))) {
       LOG(INFO) << Dumpable<TimingLogger>(*timings_);
+      std::ostringstream oss;
+      driver_->DumpOverBudgetMethods(oss);
+      if (!oss.str().empty()) {
+        LOG(INFO) << oss.str();
+      }
     }
     if (dump_passes_) {
       LOG(INFO) << Dumpable<CumulativeLogger>(*driver_->GetTimingsLogger());
@@ -2238,6 +2358,18 @@ class Dex2Oat FINAL {
     return true;
   }
 
+  bool PrepareDirtyImageObjects() {
+    if (dirty_image_objects_filename_ != nullptr) {
+      dirty_image_objects_ = ImageWriter::ReadDirtyImageObjects(dirty_image_objects_filename_);
+      if (dirty_image_objects_ == nullptr) {
+        LOG(ERROR) << "Failed to read dirty image objects from '"
+                   << dirty_image_objects_filename_ << "'";
+        return false;
+      }
+    }
+    return true;
+  }
+
   bool PrepareCompiledClasses() {
     // If --compiled-classes was specified, calculate the full list of classes to compile in the
     // image.
@@ -2704,15 +2836,18 @@ class Dex2Oat FINAL {
   uintptr_t image_base_;
   const char* image_classes_zip_filename_;
   const char* image_classes_filename_;
+  const char* dirty_image_objects_filename_;
   ImageHeader::StorageMode image_storage_mode_;
   const char* compiled_classes_zip_filename_;
   const char* compiled_classes_filename_;
   const char* compiled_methods_zip_filename_;
   const char* compiled_methods_filename_;
   const char* passes_to_run_filename_;
+  const char* compiled_method_cache_filename_;
   std::unique_ptr<std::unordered_set<std::string>> image_classes_;
   std::unique_ptr<std::unordered_set<std::string>> compiled_classes_;
   std::unique_ptr<std::unordered_set<std::string>> compiled_methods_;
+  std::unique_ptr<std::unordered_set<std::string>> dirty_image_objects_;
   std::unique_ptr<std::vector<std::string>> passes_to_run_;
   bool multi_image_;
   bool is_host_;
@@ -14,7 +14,10 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <map>
 #include <regex>
+#include <set>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -28,9 +31,11 @@
 
 #include "base/logging.h"
 #include "base/macros.h"
+#include "base/stl_util.h"
 #include "dex_file-inl.h"
 #include "dex2oat_environment_test.h"
 #include "dex2oat_return_codes.h"
+#include "gc/collector_type.h"
 #include "jit/profile_compilation_info.h"
 #include "oat.h"
 #include "oat_file.h"
@@ -705,6 +710,45 @@ class Dex2oatLayoutTest : public Dex2oatTest {
     }
   }
 
+  std::vector<uint8_t> ReadFileContents(const std::string& file_name) {
+    std::unique_ptr<File> file(OS::OpenFileForReading(file_name.c_str()));
+    CHECK(file != nullptr) << file_name;
+    std::vector<uint8_t> contents(file->GetLength());
+    CHECK(file->ReadFully(contents.data(), contents.size())) << file_name;
+    return contents;
+  }
+
+  void RunImageDeterminismTest() {
+    if (!kUseReadBarrier &&
+        gc::kCollectorTypeDefault != gc::kCollectorTypeCMS &&
+        gc::kCollectorTypeDefault != gc::kCollectorTypeMS) {
+      LOG(INFO) << "Test requires deterministic compilation.";
+      return;
+    }
+    std::string dex_location = GetScratchDir() + "/DexNoOat.jar";
+    std::string odex_location = GetOdexDir() + "/DexOdexNoOat.odex";
+    std::string app_image_file = GetOdexDir() + "/DexOdexNoOat.art";
+    Copy(GetDexSrc2(), dex_location);
+
+    // The image objects are copied by all compiler threads, the image must not depend on that.
+    std::vector<uint8_t> single_thread_image;
+    for (const char* threads : { "-j1", "-j4" }) {
+      CompileProfileOdex(dex_location,
+                         odex_location,
+                         app_image_file,
+                         /* use_fd */ false,
+                         /* num_profile_classes */ 1,
+                         { "--force-determinism", threads });
+      std::vector<uint8_t> image = ReadFileContents(app_image_file);
+      EXPECT_GT(image.size(), sizeof(ImageHeader));
+      if (single_thread_image.empty()) {
+        single_thread_image = std::move(image);
+      } else {
+        EXPECT_TRUE(image == single_thread_image) << threads;
+      }
+    }
+  }
+
   void RunTestVDex() {
     std::string dex_location = GetScratchDir() + "/DexNoOat.jar";
     std::string odex_location = GetOdexDir() + "/DexOdexNoOat.odex";
@@ -794,6 +838,135 @@ class Dex2oatLayoutTest : public Dex2oatTest {
     }
   }
 
+  // Returns the [begin, end) code ranges of the compiled methods, keyed by method index.
+  void GetCodeRanges(const std::string& dex_location,
+                     const std::string& odex_location,
+                     std::map<uint32_t, std::pair<uint32_t, uint32_t>>* code_ranges) {
+    std::string error_msg;
+    std::unique_ptr<OatFile> odex_file(OatFile::Open(odex_location.c_str(),
+                                                     odex_location.c_str(),
+                                                     nullptr,
+                                                     nullptr,
+                                                     false,
+                                                     /*low_4gb*/false,
+                                                     dex_location.c_str(),
+                                                     &error_msg));
+    ASSERT_TRUE(odex_file.get() != nullptr) << error_msg;
+    code_ranges->clear();
+    for (const OatDexFile* oat_dex_file : odex_file->GetOatDexFiles()) {
+      std::unique_ptr<const DexFile> dex_file = oat_dex_file->OpenDexFile(&error_msg);
+      ASSERT_TRUE(dex_file != nullptr) << error_msg;
+      for (size_t class_def_index = 0; class_def_index != dex_file->NumClassDefs();
+           ++class_def_index) {
+        const uint8_t* class_data = dex_file->GetClassData(dex_file->GetClassDef(class_def_index));
+        if (class_data == nullptr) {
+          continue;
+        }
+        const OatFile::OatClass oat_class = oat_dex_file->GetOatClass(class_def_index);
+        ClassDataItemIterator it(*dex_file, class_data);
+        while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+          it.Next();
+        }
+        for (uint32_t method_index = 0; it.HasNextDirectMethod() || it.HasNextVirtualMethod();
+             ++method_index, it.Next()) {
+          const OatFile::OatMethod oat_method = oat_class.GetOatMethod(method_index);
+          uint32_t code_size = oat_method.GetQuickCodeSize();
+          if (code_size != 0u) {
+            uint32_t code_offset = oat_method.GetCodeOffset();
+            code_ranges->emplace(it.GetMemberIndex(),
+                                 std::make_pair(code_offset, code_offset + code_size));
+          }
+        }
+      }
+    }
+  }
+
+  // Returns the number of pages touched by the code of the given methods.
+  static size_t CountCodePages(const std::map<uint32_t, std::pair<uint32_t, uint32_t>>& ranges,
+                               const std::set<uint32_t>& methods) {
+    std::set<uint32_t> pages;
+    for (uint32_t method_idx : methods) {
+      auto it = ranges.find(method_idx);
+      CHECK(it != ranges.end());
+      for (uint32_t page = it->second.first / kPageSize;
+           page <= (it->second.second - 1u) / kPageSize;
+           ++page) {
+        pages.insert(page);
+      }
+    }
+    return pages.size();
+  }
+
+  void RunCodeLayoutTest() {
+    std::string dex_location = GetScratchDir() + "/Statics.jar";
+    std::string odex_location = GetOdexDir() + "/Statics.odex";
+    const std::string profile_location = GetScratchDir() + "/primary.prof";
+    Copy(GetTestDexFileName("Statics"), dex_location);
+
+    // Compile without a profile to get the code layout in the definition order.
+    GenerateOdexForTest(dex_location, odex_location, CompilerFilter::kSpeed);
+    std::map<uint32_t, std::pair<uint32_t, uint32_t>> default_ranges;
+    GetCodeRanges(dex_location, odex_location, &default_ranges);
+    ASSERT_GE(default_ranges.size(), 3u);
+
+    // Mark every third compiled method as hot.
+    std::set<uint32_t> hot_methods;
+    size_t i = 0u;
+    for (const auto& entry : default_ranges) {
+      if (i++ % 3u == 2u) {
+        hot_methods.insert(entry.first);
+      }
+    }
+    std::string error_msg;
+    std::vector<std::unique_ptr<const DexFile>> dex_files;
+    const char* location = dex_location.c_str();
+    ASSERT_TRUE(DexFile::Open(location, location, true, &error_msg, &dex_files));
+    ASSERT_EQ(dex_files.size(), 1U);
+    {
+      int profile_test_fd = open(profile_location.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+      ASSERT_GE(profile_test_fd, 0);
+      ProfileCompilationInfo info;
+      std::string profile_key = ProfileCompilationInfo::GetProfileDexFileKey(dex_location);
+      for (uint32_t method_idx : hot_methods) {
+        info.AddMethodIndex(profile_key, dex_files[0]->GetLocationChecksum(), method_idx);
+      }
+      bool result = info.Save(profile_test_fd);
+      close(profile_test_fd);
+      ASSERT_TRUE(result);
+    }
+
+    GenerateOdexForTest(dex_location,
+                        odex_location,
+                        CompilerFilter::kSpeed,
+                        { "--profile-file=" + profile_location });
+    std::map<uint32_t, std::pair<uint32_t, uint32_t>> profile_ranges;
+    GetCodeRanges(dex_location, odex_location, &profile_ranges);
+    ASSERT_EQ(default_ranges.size(), profile_ranges.size());
+
+    // All the hot code must precede all the cold code. Cold methods may share the code
+    // of hot methods when it is deduplicated.
+    uint32_t hot_end = 0u;
+    std::set<uint32_t> hot_code;
+    for (uint32_t method_idx : hot_methods) {
+      hot_end = std::max(hot_end, profile_ranges[method_idx].second);
+      hot_code.insert(profile_ranges[method_idx].first);
+    }
+    uint32_t cold_begin = std::numeric_limits<uint32_t>::max();
+    for (const auto& entry : profile_ranges) {
+      if (!ContainsElement(hot_code, entry.second.first)) {
+        cold_begin = std::min(cold_begin, entry.second.first);
+      }
+    }
+    EXPECT_LE(hot_end, cold_begin);
+
+    // The hot code must not touch more pages than with the definition order.
+    size_t default_pages = CountCodePages(default_ranges, hot_methods);
+    size_t profile_pages = CountCodePages(profile_ranges, hot_methods);
+    LOG(INFO) << "Hot code pages: " << default_pages << " without profile, "
+              << profile_pages << " with profile";
+    EXPECT_LE(profile_pages, default_pages);
+  }
+
   // Check whether the dex2oat run was really successful.
   void CheckValidity() {
     if (kIsTargetBuild) {
@@ -821,10 +994,18 @@ TEST_F(Dex2oatLayoutTest, TestLayoutAppImage) {
   RunTest(/* app-image */ true);
 }
 
+TEST_F(Dex2oatLayoutTest, TestImageDeterminism) {
+  RunImageDeterminismTest();
+}
+
 TEST_F(Dex2oatLayoutTest, TestVdexLayout) {
   RunTestVDex();
 }
 
+TEST_F(Dex2oatLayoutTest, TestCodeLayout) {
+  RunCodeLayoutTest();
+}
+
 class Dex2oatWatchdogTest : public Dex2oatTest {
  protected:
   void RunTest(bool expect_success, const std::vector<std::string>& extra_args = {}) {
@@ -862,6 +1043,142 @@ TEST_F(Dex2oatWatchdogTest, TestWatchdogTrigger) {
   RunTest(false, { "--watchdog-timeout=10" });
 }
 
+class Dex2oatCompiledMethodCacheTest : public Dex2oatTest {
+ protected:
+  std::string GetCacheLocation() const {
+    return GetOdexDir() + "/Dex2OatCacheTest.cmc";
+  }
+
+  void RunTest(size_t* reused_methods, size_t* loaded_methods = nullptr) {
+    RunTest(GetDexSrc1(), reused_methods, loaded_methods);
+  }
+
+  // Compiles `dex_src`, always copied to the same location so that the cache entries match.
+  void RunTest(const std::string& dex_src, size_t* reused_methods, size_t* loaded_methods) {
+    std::string dex_location = GetScratchDir() + "/Dex2OatCacheTest.jar";
+    std::string odex_location = GetOdexDir() + "/Dex2OatCacheTest.odex";
+    Copy(dex_src, dex_location);
+
+    output_ = "";
+    GenerateOdexForTest(dex_location,
+                        odex_location,
+                        CompilerFilter::kSpeed,
+                        { "--compiled-method-cache=" + GetCacheLocation() });
+    ASSERT_TRUE(OS::FileExists(GetCacheLocation().c_str()));
+
+    std::regex reused_regex("Reused ([0-9]+) of ([0-9]+) cached methods");
+    std::smatch reused_match;
+    ASSERT_TRUE(std::regex_search(output_, reused_match, reused_regex)) << output_;
+    *reused_methods = std::stoul(reused_match.str(1));
+    EXPECT_LE(*reused_methods, std::stoul(reused_match.str(2)));
+    if (loaded_methods != nullptr) {
+      *loaded_methods = std::stoul(reused_match.str(2));
+    }
+  }
+
+  static std::string ReadFile(const std::string& location) {
+    std::unique_ptr<File> file(OS::OpenFileForReading(location.c_str()));
+    CHECK(file != nullptr) << location;
+    std::string contents(file->GetLength(), '\0');
+    CHECK(file->ReadFully(&contents[0], contents.size())) << location;
+    return contents;
+  }
+
+  static void WriteFile(const std::string& location, const std::string& contents) {
+    std::unique_ptr<File> file(OS::CreateEmptyFile(location.c_str()));
+    CHECK(file != nullptr) << location;
+    CHECK(file->WriteFully(contents.data(), contents.size())) << location;
+    CHECK_EQ(file->FlushClose(), 0) << location;
+  }
+
+  std::string ReadOdex() {
+    return ReadFile(GetOdexDir() + "/Dex2OatCacheTest.odex");
+  }
+};
+
+TEST_F(Dex2oatCompiledMethodCacheTest, ReuseUnchangedClasses) {
+  size_t reused_methods = 0u;
+  RunTest(&reused_methods);
+  EXPECT_EQ(0u, reused_methods);
+  std::string first_odex = ReadOdex();
+
+  // Nothing changed, all the code comes from the cache and must be linked the same way.
+  RunTest(&reused_methods);
+  EXPECT_NE(0u, reused_methods);
+  EXPECT_TRUE(first_odex == ReadOdex());
+}
+
+TEST_F(Dex2oatCompiledMethodCacheTest, InvalidateChangedClasses) {
+  // CompiledMethodCacheB changes Base.constant(), which Caller and the subclass Derived inline.
+  size_t reused_methods = 0u;
+  size_t loaded_methods = 0u;
+  RunTest(GetTestDexFileName("CompiledMethodCacheA"), &reused_methods, &loaded_methods);
+  std::string cache_a = ReadFile(GetCacheLocation());
+
+  // The expected output, compiled without any cache entries.
+  ASSERT_EQ(0, unlink(GetCacheLocation().c_str()));
+  RunTest(GetTestDexFileName("CompiledMethodCacheB"), &reused_methods, &loaded_methods);
+  EXPECT_EQ(0u, loaded_methods);
+  std::string expected_odex = ReadOdex();
+
+  // Only the <init> and compute() of Unrelated may be taken from the cache of the old version.
+  WriteFile(GetCacheLocation(), cache_a);
+  RunTest(GetTestDexFileName("CompiledMethodCacheB"), &reused_methods, &loaded_methods);
+  EXPECT_EQ(2u, loaded_methods);
+  EXPECT_EQ(2u, reused_methods);
+  EXPECT_TRUE(expected_odex == ReadOdex());
+}
+
+TEST_F(Dex2oatCompiledMethodCacheTest, RejectBadCache) {
+  size_t reused_methods = 0u;
+  size_t loaded_methods = 0u;
+  RunTest(&reused_methods);
+  std::string expected_odex = ReadOdex();
+  std::string cache = ReadFile(GetCacheLocation());
+  ASSERT_GT(cache.size(), 64u);
+
+  // A truncated cache is not used, and the code is compiled again.
+  WriteFile(GetCacheLocation(), cache.substr(0u, cache.size() / 2u));
+  RunTest(&reused_methods, &loaded_methods);
+  EXPECT_NE(output_.find("Truncated compiled method cache"), std::string::npos) << output_;
+  EXPECT_EQ(0u, loaded_methods);
+  EXPECT_TRUE(expected_odex == ReadOdex());
+
+  // So is a cache whose class count and records are garbage. The magic, version and
+  // configuration checksum take the first 16 bytes.
+  std::string corrupted = cache;
+  std::fill(corrupted.begin() + 16u, corrupted.end(), '\xff');
+  WriteFile(GetCacheLocation(), corrupted);
+  RunTest(&reused_methods, &loaded_methods);
+  EXPECT_EQ(0u, loaded_methods);
+  EXPECT_TRUE(expected_odex == ReadOdex());
+}
+
+class Dex2oatCompileBudgetTest : public Dex2oatTest {
+ protected:
+  void RunTest(const std::vector<std::string>& extra_args) {
+    std::string dex_location = GetScratchDir() + "/Dex2OatBudgetTest.jar";
+    std::string odex_location = GetOdexDir() + "/Dex2OatBudgetTest.odex";
+    Copy(GetDexSrc1(), dex_location);
+
+    std::vector<std::string> args = extra_args;
+    args.push_back("--dump-timing");
+    GenerateOdexForTest(dex_location, odex_location, CompilerFilter::kSpeed, args);
+  }
+};
+
+TEST_F(Dex2oatCompileBudgetTest, WithinBudget) {
+  RunTest({});
+  EXPECT_EQ(output_.find("reduced pipeline"), std::string::npos) << output_;
+}
+
+TEST_F(Dex2oatCompileBudgetTest, OverMemoryBudget) {
+  // Every method exceeds a one byte budget and is compiled again with the reduced pipeline.
+  RunTest({ "--method-compile-memory-budget=1" });
+  EXPECT_NE(output_.find("Methods compiled with the reduced pipeline"), std::string::npos)
+      << output_;
+}
+
 class Dex2oatReturnCodeTest : public Dex2oatTest {
  protected:
   int RunTest(const std::vector<std::string>& extra_args = {}) {
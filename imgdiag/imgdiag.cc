@@ -53,11 +53,13 @@ using android::base::StringPrintf;
 class ImgDiagDumper {
  public:
   explicit ImgDiagDumper(std::ostream* os,
+                         std::ostream* dirty_objects_os,
                          const ImageHeader& image_header,
                          const std::string& image_location,
                          pid_t image_diff_pid,
                          pid_t zygote_diff_pid)
       : os_(os),
+        dirty_objects_os_(dirty_objects_os),
         image_header_(image_header),
         image_location_(image_location),
         image_diff_pid_(image_diff_pid),
@@ -488,6 +490,9 @@ class ImgDiagDumper {
     // Walk each object in the remote image space and compare it against ours
     size_t different_objects = 0;
 
+    // Local pointers to the dirty class objects, by class descriptor.
+    std::map<std::string, std::vector<mirror::Object*>> dirty_class_objects;
+
     std::map<off_t /* field offset */, int /* count */> art_method_field_dirty_count;
     std::vector<ArtMethod*> art_method_dirty_objects;
 
@@ -587,6 +592,8 @@ class ImgDiagDumper {
       std::string descriptor = GetClassDescriptor(klass);
       if (different_image_object) {
         if (klass->IsClassClass()) {
+          dirty_class_objects[GetClassDescriptor(obj->AsClass())].push_back(obj);
+
           // this is a "Class"
           mirror::Class* obj_as_class  = reinterpret_cast<mirror::Class*>(remote_obj);
 
@@ -831,9 +838,54 @@ class ImgDiagDumper {
       os << "    " << mirror::Class::PrettyClass(vk_pair.second) << " (" << vk_pair.first << ")\n";
     }
 
+    if (dirty_objects_os_ != nullptr) {
+      std::set<mirror::Object*> dirty_objects(image_dirty_objects);
+      dirty_objects.insert(zygote_dirty_objects.begin(), zygote_dirty_objects.end());
+      DumpDirtyObjects(dirty_objects, dirty_class_objects, class_data);
+    }
+
     return true;
   }
 
+  // Write the dirty objects in the format read by dex2oat --dirty-image-objects. Dirty class
+  // objects are listed by the descriptor of the class they represent. Instances are listed by the
+  // descriptor of their class when most instances of that class were dirtied, since ImageWriter
+  // can only bin instances by their class.
+  void DumpDirtyObjects(const std::set<mirror::Object*>& dirty_objects,
+                        const std::map<std::string, std::vector<mirror::Object*>>& dirty_classes,
+                        std::map<mirror::Class*, ClassData>& class_data)
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    std::ostream& os = *dirty_objects_os_;
+    constexpr size_t kMaxAddressPrint = 5;
+
+    std::map<std::string, std::vector<mirror::Object*>> dirty_instances;
+    for (mirror::Object* obj : dirty_objects) {
+      mirror::Class* klass = obj->GetClass();
+      if (klass->IsClassClass()) {
+        continue;
+      }
+      const ClassData& data = class_data[klass];
+      if (data.dirty_object_count >= data.clean_object_count) {
+        dirty_instances[data.descriptor].push_back(obj);
+      }
+    }
+
+    auto dump_entries = [&os](const char* kind,
+                              const std::map<std::string, std::vector<mirror::Object*>>& entries) {
+      for (const auto& entry : entries) {
+        os << kind << " " << entry.first << "  #";
+        for (size_t i = 0; i < entry.second.size() && i < kMaxAddressPrint; ++i) {
+          os << " " << reinterpret_cast<void*>(entry.second[i]);
+        }
+        os << "\n";
+      }
+    };
+    os << "# Dirty objects of " << image_location_ << "\n";
+    dump_entries("class", dirty_classes);
+    dump_entries("instance", dirty_instances);
+    os << std::flush;
+  }
+
   // Fixup a remote pointer that we read from a foreign boot.art to point to our own memory.
   // Returned pointer will point to inside of remote_contents.
   template <typename T>
@@ -1009,6 +1061,7 @@ class ImgDiagDumper {
   }
 
   std::ostream* os_;
+  std::ostream* dirty_objects_os_;  // Dump the dirty objects profile if not null
   const ImageHeader& image_header_;
   const std::string image_location_;
   pid_t image_diff_pid_;  // Dump image diff against boot.art if pid is non-negative
@@ -1019,6 +1072,7 @@ class ImgDiagDumper {
 
 static int DumpImage(Runtime* runtime,
                      std::ostream* os,
+                     std::ostream* dirty_objects_os,
                      pid_t image_diff_pid,
                      pid_t zygote_diff_pid) {
   ScopedObjectAccess soa(Thread::Current());
@@ -1033,6 +1087,7 @@ static int DumpImage(Runtime* runtime,
     }
 
     ImgDiagDumper img_diag_dumper(os,
+                                  dirty_objects_os,
                                   image_header,
                                   image_space->GetImageLocation(),
                                   image_diff_pid,
@@ -1071,6 +1126,8 @@ struct ImgDiagArgs : public CmdlineArgs {
         *error_msg = "Zygote diff pid out of range";
         return kParseError;
       }
+    } else if (option.starts_with("--dump-dirty-objects=")) {
+      dirty_objects_filename_ = option.substr(strlen("--dump-dirty-objects=")).ToString();
     } else {
       return kParseUnknownArgument;
     }
@@ -1123,6 +1180,9 @@ struct ImgDiagArgs : public CmdlineArgs {
         "  --zygote-diff-pid=<pid>: provide the PID of the zygote whose boot.art you want to diff "
         "against.\n"
         "      Example: --zygote-diff-pid=$(pid zygote)\n"
+        "  --dump-dirty-objects=<file>: write the dirty image objects to <file> in the format\n"
+        "      expected by dex2oat --dirty-image-objects.\n"
+        "      Example: --dump-dirty-objects=/data/local/tmp/dirty-image-objects.txt\n"
         "\n";
 
     return usage;
@@ -1131,14 +1191,27 @@ struct ImgDiagArgs : public CmdlineArgs {
  public:
   pid_t image_diff_pid_ = -1;
   pid_t zygote_diff_pid_ = -1;
+  std::string dirty_objects_filename_;
 };
 
 struct ImgDiagMain : public CmdlineMain<ImgDiagArgs> {
   virtual bool ExecuteWithRuntime(Runtime* runtime) {
     CHECK(args_ != nullptr);
 
+    std::unique_ptr<std::ofstream> dirty_objects_file;
+    if (!args_->dirty_objects_filename_.empty()) {
+      dirty_objects_file.reset(new std::ofstream(args_->dirty_objects_filename_.c_str()));
+      if (!dirty_objects_file->good()) {
+        fprintf(stderr,
+                "Failed to open dirty objects file %s\n",
+                args_->dirty_objects_filename_.c_str());
+        return false;
+      }
+    }
+
     return DumpImage(runtime,
                      args_->os_,
+                     dirty_objects_file.get(),
                      args_->image_diff_pid_,
                      args_->zygote_diff_pid_) == EXIT_SUCCESS;
   }
@@ -184,6 +184,18 @@ class QuasiAtomic {
   DISALLOW_COPY_AND_ASSIGN(QuasiAtomic);
 };
 
+// Tells the CPU that we are busy-waiting, reducing the cost of a spin loop for the hardware
+// thread that we are waiting for.
+static inline void CpuRelax() {
+#if defined(__i386__) || defined(__x86_64__)
+  __builtin_ia32_pause();
+#elif defined(__arm__) || defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#else
+  asm volatile("" ::: "memory");
+#endif
+}
+
 template<typename T>
 class PACKED(sizeof(T)) Atomic : public std::atomic<T> {
  public:
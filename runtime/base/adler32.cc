@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "adler32.h"
+
+#include <algorithm>
+
+#include "zlib.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define ART_ADLER32_SIMD 1
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ART_ADLER32_SIMD 1
+#else
+#define ART_ADLER32_SIMD 0
+#endif
+
+#include "base/logging.h"
+
+namespace art {
+
+#if ART_ADLER32_SIMD
+
+// The largest prime smaller than 2^16.
+static constexpr uint32_t kAdlerBase = 65521u;
+// The number of bytes processed per vector iteration.
+static constexpr size_t kChunkSize = 16u;
+// The largest number of chunks that can be summed up before the 32-bit vector lanes have to be
+// folded into the checksum. This is the NMAX of zlib (5552) rounded down to whole chunks.
+static constexpr size_t kMaxChunksPerBlock = 5552u / kChunkSize;
+// Inputs shorter than this are left to zlib, the vector setup does not pay off for them.
+static constexpr size_t kMinSimdSize = 4u * kChunkSize;
+
+// For a block of `chunks` * 16 bytes, returns the sum of all bytes in `*sum`, the sum of all
+// bytes weighted by their distance from the end of their chunk (16 for the first byte of a
+// chunk, 1 for the last) in `*weighted_sum`, and the sum over all chunks of the byte sums of all
+// the preceding chunks in `*prefix_sum`.
+static inline void SumChunks(const uint8_t* data,
+                             size_t chunks,
+                             uint32_t* sum,
+                             uint32_t* weighted_sum,
+                             uint32_t* prefix_sum) {
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i weights_lo = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+  const __m128i weights_hi = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+  __m128i vs1 = zero;
+  __m128i vs2 = zero;
+  __m128i vps = zero;
+  for (size_t i = 0; i != chunks; ++i) {
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    data += kChunkSize;
+    vps = _mm_add_epi32(vps, vs1);
+    vs1 = _mm_add_epi32(vs1, _mm_sad_epu8(bytes, zero));
+    vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_unpacklo_epi8(bytes, zero), weights_lo));
+    vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_unpackhi_epi8(bytes, zero), weights_hi));
+  }
+  alignas(16) uint32_t lanes[3][4];
+  _mm_store_si128(reinterpret_cast<__m128i*>(lanes[0]), vs1);
+  _mm_store_si128(reinterpret_cast<__m128i*>(lanes[1]), vs2);
+  _mm_store_si128(reinterpret_cast<__m128i*>(lanes[2]), vps);
+#else
+  static const uint16_t kWeights[kChunkSize] =
+      { 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1 };
+  const uint16x4_t weights0 = vld1_u16(kWeights);
+  const uint16x4_t weights1 = vld1_u16(kWeights + 4);
+  const uint16x4_t weights2 = vld1_u16(kWeights + 8);
+  const uint16x4_t weights3 = vld1_u16(kWeights + 12);
+  uint32x4_t vs1 = vdupq_n_u32(0u);
+  uint32x4_t vs2 = vdupq_n_u32(0u);
+  uint32x4_t vps = vdupq_n_u32(0u);
+  for (size_t i = 0; i != chunks; ++i) {
+    const uint8x16_t bytes = vld1q_u8(data);
+    data += kChunkSize;
+    vps = vaddq_u32(vps, vs1);
+    vs1 = vpadalq_u16(vs1, vpaddlq_u8(bytes));
+    const uint16x8_t lo = vmovl_u8(vget_low_u8(bytes));
+    const uint16x8_t hi = vmovl_u8(vget_high_u8(bytes));
+    vs2 = vmlal_u16(vs2, vget_low_u16(lo), weights0);
+    vs2 = vmlal_u16(vs2, vget_high_u16(lo), weights1);
+    vs2 = vmlal_u16(vs2, vget_low_u16(hi), weights2);
+    vs2 = vmlal_u16(vs2, vget_high_u16(hi), weights3);
+  }
+  uint32_t lanes[3][4];
+  vst1q_u32(lanes[0], vs1);
+  vst1q_u32(lanes[1], vs2);
+  vst1q_u32(lanes[2], vps);
+#endif
+  *sum = lanes[0][0] + lanes[0][1] + lanes[0][2] + lanes[0][3];
+  *weighted_sum = lanes[1][0] + lanes[1][1] + lanes[1][2] + lanes[1][3];
+  *prefix_sum = lanes[2][0] + lanes[2][1] + lanes[2][2] + lanes[2][3];
+}
+
+uint32_t Adler32(uint32_t adler, const uint8_t* data, size_t size) {
+  if (size < kMinSimdSize) {
+    return adler32(adler, data, size);
+  }
+  uint64_t a = adler & 0xffffu;
+  uint64_t b = adler >> 16;
+  size_t chunks = size / kChunkSize;
+  while (chunks != 0u) {
+    const size_t block_chunks = std::min(chunks, kMaxChunksPerBlock);
+    uint32_t sum;
+    uint32_t weighted_sum;
+    uint32_t prefix_sum;
+    SumChunks(data, block_chunks, &sum, &weighted_sum, &prefix_sum);
+    // The byte at index i of a block of n bytes adds (n - i) times its value to `b`, on top of
+    // n times the incoming `a`. For the byte j of chunk c, n - i = 16 * (chunks - c - 1) + 16 - j,
+    // which is split into the prefix sums of the whole chunks and the weights within a chunk.
+    const size_t block_size = block_chunks * kChunkSize;
+    b = (b + block_size * a + kChunkSize * static_cast<uint64_t>(prefix_sum) + weighted_sum) %
+        kAdlerBase;
+    a = (a + sum) % kAdlerBase;
+    data += block_size;
+    chunks -= block_chunks;
+  }
+  DCHECK_LT(a, kAdlerBase);
+  DCHECK_LT(b, kAdlerBase);
+  return adler32(static_cast<uint32_t>((b << 16) | a), data, size % kChunkSize);
+}
+
+#else  // ART_ADLER32_SIMD
+
+uint32_t Adler32(uint32_t adler, const uint8_t* data, size_t size) {
+  return adler32(adler, data, size);
+}
+
+#endif  // ART_ADLER32_SIMD
+
+}  // namespace art
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_BASE_ADLER32_H_
+#define ART_RUNTIME_BASE_ADLER32_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace art {
+
+// The initial value of an Adler-32 checksum, i.e. the checksum of no data.
+static constexpr uint32_t kAdler32Init = 1u;
+
+// Updates the Adler-32 checksum `adler` with `size` bytes at `data`. Returns the same value as
+// zlib's adler32(), but uses SSE2 or NEON to process 16 bytes at a time where available.
+uint32_t Adler32(uint32_t adler, const uint8_t* data, size_t size);
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_BASE_ADLER32_H_
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "adler32.h"
+
+#include <vector>
+
+#include "globals.h"
+#include "gtest/gtest.h"
+#include "zlib.h"
+
+namespace art {
+
+static uint32_t ZlibAdler32(uint32_t adler, const uint8_t* data, size_t size) {
+  return adler32(adler, data, size);
+}
+
+TEST(Adler32Test, Empty) {
+  EXPECT_EQ(ZlibAdler32(0u, nullptr, 0u), kAdler32Init);
+  EXPECT_EQ(kAdler32Init, Adler32(kAdler32Init, nullptr, 0u));
+}
+
+TEST(Adler32Test, MatchesZlib) {
+  // Pseudo-random bytes, so that the weighted sums do not cancel out.
+  std::vector<uint8_t> data(3 * 5552 + 64);
+  uint32_t seed = 1u;
+  for (uint8_t& value : data) {
+    seed = seed * 1103515245u + 12345u;
+    value = static_cast<uint8_t>(seed >> 16);
+  }
+  // Cover inputs below the vector threshold, partial chunks and several zlib-sized blocks, at
+  // all alignments of a 16 byte vector.
+  const size_t sizes[] = { 1u, 15u, 16u, 63u, 64u, 65u, 1000u, 5551u, 5552u, 5553u, 3u * 5552u };
+  for (size_t size : sizes) {
+    for (size_t offset = 0; offset != 17u; ++offset) {
+      const uint8_t* start = data.data() + offset;
+      EXPECT_EQ(ZlibAdler32(kAdler32Init, start, size), Adler32(kAdler32Init, start, size))
+          << size << " " << offset;
+      // Continue from an arbitrary intermediate checksum.
+      const uint32_t adler = (12345u << 16) | 54321u;
+      EXPECT_EQ(ZlibAdler32(adler, start, size), Adler32(adler, start, size))
+          << size << " " << offset;
+    }
+  }
+}
+
+TEST(Adler32Test, MaxBytes) {
+  // All bytes 0xff maximize the intermediate sums.
+  std::vector<uint8_t> data(1 * MB, 0xffu);
+  EXPECT_EQ(ZlibAdler32(kAdler32Init, data.data(), data.size()),
+            Adler32(kAdler32Init, data.data(), data.size()));
+}
+
+TEST(Adler32Test, Split) {
+  std::vector<uint8_t> data(10000u);
+  for (size_t i = 0; i != data.size(); ++i) {
+    data[i] = static_cast<uint8_t>(i * 7u);
+  }
+  const uint32_t expected = ZlibAdler32(kAdler32Init, data.data(), data.size());
+  for (size_t split : { 1u, 100u, 5552u, 9999u }) {
+    uint32_t adler = Adler32(kAdler32Init, data.data(), split);
+    adler = Adler32(adler, data.data() + split, data.size() - split);
+    EXPECT_EQ(expected, adler) << split;
+  }
+}
+
+}  // namespace art
@@ -126,19 +126,50 @@ inline void BaseMutex::RegisterAsUnlocked(Thread* self) {
   }
 }
 
+#if ART_USE_FUTEXES
+inline AtomicInteger* ReaderWriterMutex::GetReaderShard(const Thread* self) const {
+  DCHECK(reader_shards_ != nullptr);
+  return &reader_shards_[SafeGetTid(self) % kNumReaderShards].count;
+}
+
+inline void ReaderWriterMutex::ReleaseReaderShard(AtomicInteger* count) {
+  if (count->FetchAndSubSequentiallyConsistent(1) == 1 &&
+      UNLIKELY(state_.LoadSequentiallyConsistent() < 0)) {
+    // A writer may be waiting for the shard to drain.
+    futex(count->Address(), FUTEX_WAKE, -1, nullptr, nullptr, 0);
+  }
+}
+#endif
+
 inline void ReaderWriterMutex::SharedLock(Thread* self) {
   DCHECK(self == nullptr || self == Thread::Current());
 #if ART_USE_FUTEXES
-  bool done = false;
-  do {
-    int32_t cur_state = state_.LoadRelaxed();
-    if (LIKELY(cur_state >= 0)) {
-      // Add as an extra reader.
-      done = state_.CompareExchangeWeakAcquire(cur_state, cur_state + 1);
-    } else {
+  if (reader_shards_ != nullptr) {
+    AtomicInteger* count = GetReaderShard(self);
+    while (true) {
+      // Announce the reader before looking for a writer. A writer sets state_ before looking at
+      // the shards, so one of us sees the other.
+      count->FetchAndAddSequentiallyConsistent(1);
+      int32_t cur_state = state_.LoadSequentiallyConsistent();
+      if (LIKELY(cur_state >= 0)) {
+        break;
+      }
+      // Back off and wait for the writer.
+      ReleaseReaderShard(count);
       HandleSharedLockContention(self, cur_state);
     }
-  } while (!done);
+  } else {
+    bool done = false;
+    do {
+      int32_t cur_state = state_.LoadRelaxed();
+      if (LIKELY(cur_state >= 0)) {
+        // Add as an extra reader.
+        done = state_.CompareExchangeWeakAcquire(cur_state, cur_state + 1);
+      } else {
+        HandleSharedLockContention(self, cur_state);
+      }
+    } while (!done);
+  }
 #else
   CHECK_MUTEX_CALL(pthread_rwlock_rdlock, (&rwlock_));
 #endif
@@ -153,6 +184,10 @@ inline void ReaderWriterMutex::SharedUnlock(Thread* self) {
   AssertSharedHeld(self);
   RegisterAsUnlocked(self);
 #if ART_USE_FUTEXES
+  if (reader_shards_ != nullptr) {
+    ReleaseReaderShard(GetReaderShard(self));
+    return;
+  }
   bool done = false;
   do {
     int32_t cur_state = state_.LoadRelaxed();
@@ -17,6 +17,8 @@
 #include "mutex.h"
 
 #include <errno.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
 
 #include "android-base/stringprintf.h"
@@ -26,6 +28,7 @@
 #include "base/time_utils.h"
 #include "base/systrace.h"
 #include "base/value_object.h"
+#include "lock_contention_profiler.h"
 #include "mutex-inl.h"
 #include "scoped_thread_state_change-inl.h"
 #include "thread-inl.h"
@@ -142,10 +145,11 @@ class Locks::ScopedExpectedMutexesOnWeakRefAccessLock FINAL {
 class ScopedContentionRecorder FINAL : public ValueObject {
  public:
   ScopedContentionRecorder(BaseMutex* mutex, uint64_t blocked_tid, uint64_t owner_tid)
-      : mutex_(kLogLockContentions ? mutex : nullptr),
+      : mutex_(mutex),
         blocked_tid_(kLogLockContentions ? blocked_tid : 0),
         owner_tid_(kLogLockContentions ? owner_tid : 0),
-        start_nano_time_(kLogLockContentions ? NanoTime() : 0) {
+        profile_(LockContentionProfiler::IsEnabled()),
+        start_nano_time_((kLogLockContentions || profile_) ? NanoTime() : 0) {
     if (ATRACE_ENABLED()) {
       std::string msg = StringPrintf("Lock contention on %s (owner tid: %" PRIu64 ")",
                                      mutex->GetName(), owner_tid);
@@ -155,9 +159,14 @@ class ScopedContentionRecorder FINAL : public ValueObject {
 
   ~ScopedContentionRecorder() {
     ATRACE_END();
-    if (kLogLockContentions) {
+    if (kLogLockContentions || profile_) {
       uint64_t end_nano_time = NanoTime();
-      mutex_->RecordContention(blocked_tid_, owner_tid_, end_nano_time - start_nano_time_);
+      if (kLogLockContentions) {
+        mutex_->RecordContention(blocked_tid_, owner_tid_, end_nano_time - start_nano_time_);
+      }
+      if (profile_) {
+        LockContentionProfiler::RecordMutexContention(mutex_, end_nano_time - start_nano_time_);
+      }
     }
   }
 
@@ -165,6 +174,7 @@ class ScopedContentionRecorder FINAL : public ValueObject {
   BaseMutex* const mutex_;
   const uint64_t blocked_tid_;
   const uint64_t owner_tid_;
+  const bool profile_;
   const uint64_t start_nano_time_;
 };
 
@@ -559,13 +569,28 @@ void Mutex::WakeupToRespondToEmptyCheckpoint() {
 #endif
 }
 
-ReaderWriterMutex::ReaderWriterMutex(const char* name, LockLevel level)
+#if ART_USE_FUTEXES
+void* ReaderWriterMutex::ReaderShard::operator new[](size_t size) {
+  void* result;
+  int error = posix_memalign(&result, kReaderShardSize, size);
+  CHECK_EQ(error, 0) << strerror(error);
+  return result;
+}
+
+void ReaderWriterMutex::ReaderShard::operator delete[](void* ptr) {
+  free(ptr);
+}
+#endif
+
+ReaderWriterMutex::ReaderWriterMutex(const char* name, LockLevel level, bool reader_biased)
     : BaseMutex(name, level)
 #if ART_USE_FUTEXES
-    , state_(0), num_pending_readers_(0), num_pending_writers_(0)
+    , state_(0), num_pending_readers_(0), num_pending_writers_(0),
+      reader_shards_(reader_biased ? new ReaderShard[kNumReaderShards] : nullptr)
 #endif
 {  // NOLINT(whitespace/braces)
 #if !ART_USE_FUTEXES
+  UNUSED(reader_biased);
   CHECK_MUTEX_CALL(pthread_rwlock_init, (&rwlock_, nullptr));
 #endif
   exclusive_owner_ = 0;
@@ -577,6 +602,12 @@ ReaderWriterMutex::~ReaderWriterMutex() {
   CHECK_EQ(exclusive_owner_, 0U);
   CHECK_EQ(num_pending_readers_.LoadRelaxed(), 0);
   CHECK_EQ(num_pending_writers_.LoadRelaxed(), 0);
+  if (reader_shards_ != nullptr) {
+    for (size_t i = 0; i < kNumReaderShards; ++i) {
+      CHECK_EQ(reader_shards_[i].count.LoadRelaxed(), 0);
+    }
+    delete[] reader_shards_;
+  }
 #else
   // We can't use CHECK_MUTEX_CALL here because on shutdown a suspended daemon thread
   // may still be using locks.
@@ -598,7 +629,10 @@ void ReaderWriterMutex::ExclusiveLock(Thread* self) {
     int32_t cur_state = state_.LoadRelaxed();
     if (LIKELY(cur_state == 0)) {
       // Change state from 0 to -1 and impose load/store ordering appropriate for lock acquisition.
-      done =  state_.CompareExchangeWeakAcquire(0 /* cur_state*/, -1 /* new state */);
+      // Sequentially consistent since the readers of a reader biased mutex add themselves to
+      // their shard before they load state_, while we store state_ before loading the shards.
+      done =  state_.CompareExchangeWeakSequentiallyConsistent(0 /* cur_state*/,
+                                                               -1 /* new state */);
     } else {
       // Failed to acquire, hang up.
       ScopedContentionRecorder scr(this, SafeGetTid(self), GetExclusiveOwnerTid());
@@ -617,6 +651,10 @@ void ReaderWriterMutex::ExclusiveLock(Thread* self) {
     }
   } while (!done);
   DCHECK_EQ(state_.LoadRelaxed(), -1);
+  if (reader_shards_ != nullptr) {
+    bool drained = WaitForBiasedReaders(self, nullptr);
+    DCHECK(drained);
+  }
 #else
   CHECK_MUTEX_CALL(pthread_rwlock_wrlock, (&rwlock_));
 #endif
@@ -671,7 +709,9 @@ bool ReaderWriterMutex::ExclusiveLockWithTimeout(Thread* self, int64_t ms, int32
     int32_t cur_state = state_.LoadRelaxed();
     if (cur_state == 0) {
       // Change state from 0 to -1 and impose load/store ordering appropriate for lock acquisition.
-      done =  state_.CompareExchangeWeakAcquire(0 /* cur_state */, -1 /* new state */);
+      // Sequentially consistent for the reader shards, see ExclusiveLock.
+      done =  state_.CompareExchangeWeakSequentiallyConsistent(0 /* cur_state */,
+                                                               -1 /* new state */);
     } else {
       // Failed to acquire, hang up.
       timespec now_abs_ts;
@@ -699,6 +739,14 @@ bool ReaderWriterMutex::ExclusiveLockWithTimeout(Thread* self, int64_t ms, int32
       --num_pending_writers_;
     }
   } while (!done);
+  if (reader_shards_ != nullptr && !WaitForBiasedReaders(self, &end_abs_ts)) {
+    // Timed out waiting for the readers, let everybody in again.
+    state_.StoreSequentiallyConsistent(0);
+    if (num_pending_readers_.LoadRelaxed() > 0 || num_pending_writers_.LoadRelaxed() > 0) {
+      futex(state_.Address(), FUTEX_WAKE, -1, nullptr, nullptr, 0);
+    }
+    return false;
+  }
 #else
   timespec ts;
   InitTimeSpec(true, CLOCK_REALTIME, ms, ns, &ts);
@@ -733,11 +781,60 @@ void ReaderWriterMutex::HandleSharedLockContention(Thread* self, int32_t cur_sta
   }
   --num_pending_readers_;
 }
+
+bool ReaderWriterMutex::WaitForBiasedReaders(Thread* self, const timespec* end_abs_ts) {
+  DCHECK_EQ(state_.LoadRelaxed(), -1);
+  for (size_t i = 0; i < kNumReaderShards; ++i) {
+    AtomicInteger* count = &reader_shards_[i].count;
+    int32_t cur_count;
+    while ((cur_count = count->LoadSequentiallyConsistent()) != 0) {
+      timespec rel_ts;
+      if (end_abs_ts != nullptr) {
+        timespec now_abs_ts;
+        InitTimeSpec(true, CLOCK_MONOTONIC, 0, 0, &now_abs_ts);
+        if (ComputeRelativeTimeSpec(&rel_ts, *end_abs_ts, now_abs_ts)) {
+          return false;  // Timed out.
+        }
+      }
+      // The readers are unknown, only record the contention.
+      ScopedContentionRecorder scr(this, SafeGetTid(self), 0);
+      ++num_pending_writers_;
+      if (UNLIKELY(should_respond_to_empty_checkpoint_request_)) {
+        self->CheckEmptyCheckpointFromMutex();
+      }
+      if (futex(count->Address(),
+                FUTEX_WAIT,
+                cur_count,
+                end_abs_ts != nullptr ? &rel_ts : nullptr,
+                nullptr,
+                0) != 0) {
+        // ETIMEDOUT is handled at the top of the loop, EAGAIN and EINTR are spurious.
+        if ((errno != ETIMEDOUT) && (errno != EAGAIN) && (errno != EINTR)) {
+          PLOG(FATAL) << "futex wait failed for " << name_;
+        }
+      }
+      --num_pending_writers_;
+    }
+  }
+  return true;
+}
 #endif
 
 bool ReaderWriterMutex::SharedTryLock(Thread* self) {
   DCHECK(self == nullptr || self == Thread::Current());
 #if ART_USE_FUTEXES
+  if (reader_shards_ != nullptr) {
+    AtomicInteger* count = GetReaderShard(self);
+    count->FetchAndAddSequentiallyConsistent(1);
+    if (state_.LoadSequentiallyConsistent() < 0) {
+      // Held or being acquired exclusively.
+      ReleaseReaderShard(count);
+      return false;
+    }
+    RegisterAsLocked(self);
+    AssertSharedHeld(self);
+    return true;
+  }
   bool done = false;
   do {
     int32_t cur_state = state_.LoadRelaxed();
@@ -782,9 +879,16 @@ void ReaderWriterMutex::Dump(std::ostream& os) const {
 #if ART_USE_FUTEXES
       << " state=" << state_.LoadSequentiallyConsistent()
       << " num_pending_writers=" << num_pending_writers_.LoadSequentiallyConsistent()
-      << " num_pending_readers=" << num_pending_readers_.LoadSequentiallyConsistent()
+      << " num_pending_readers=" << num_pending_readers_.LoadSequentiallyConsistent();
+  if (reader_shards_ != nullptr) {
+    int32_t biased_readers = 0;
+    for (size_t i = 0; i < kNumReaderShards; ++i) {
+      biased_readers += reader_shards_[i].count.LoadSequentiallyConsistent();
+    }
+    os << " biased_readers=" << biased_readers;
+  }
 #endif
-      << " ";
+  os << " ";
   DumpContention(os);
 }
 
@@ -805,6 +909,12 @@ void ReaderWriterMutex::WakeupToRespondToEmptyCheckpoint() {
   if (UNLIKELY(num_pending_readers_.LoadRelaxed() > 0 ||
                num_pending_writers_.LoadRelaxed() > 0)) {
     futex(state_.Address(), FUTEX_WAKE, -1, nullptr, nullptr, 0);
+    if (reader_shards_ != nullptr) {
+      // A writer may be waiting for a shard to drain.
+      for (size_t i = 0; i < kNumReaderShards; ++i) {
+        futex(reader_shards_[i].count.Address(), FUTEX_WAKE, -1, nullptr, nullptr, 0);
+      }
+    }
   }
 #else
   LOG(FATAL) << "Non futex case isn't supported.";
@@ -314,10 +314,18 @@ class LOCKABLE Mutex : public BaseMutex {
 // Exclusive | Block         | Free            | Block            | error
 // Shared(n) | Block         | error           | SharedLock(n+1)* | Shared(n-1) or Free
 // * for large values of n the SharedLock may block.
+//
+// A reader biased ReaderWriterMutex keeps the shared holders out of the state word: each reader
+// counts itself in one of several cache line sized shards picked by its thread id, so readers on
+// different cores don't bounce a common cache line. Exclusive acquisition marks the state word,
+// which turns new readers away, and then waits for every shard to drain, so it gets more
+// expensive. Only supported with futexes, otherwise the mutex behaves as a regular one.
 std::ostream& operator<<(std::ostream& os, const ReaderWriterMutex& mu);
 class SHARED_LOCKABLE ReaderWriterMutex : public BaseMutex {
  public:
-  explicit ReaderWriterMutex(const char* name, LockLevel level = kDefaultMutexLevel);
+  explicit ReaderWriterMutex(const char* name,
+                             LockLevel level = kDefaultMutexLevel,
+                             bool reader_biased = false);
   ~ReaderWriterMutex();
 
   virtual bool IsReaderWriterMutex() const { return true; }
@@ -404,10 +412,33 @@ class SHARED_LOCKABLE ReaderWriterMutex : public BaseMutex {
 
  private:
 #if ART_USE_FUTEXES
+  // Per-thread reader count of a reader biased mutex. Every count lives on its own cache line.
+  static constexpr size_t kReaderShardSize = 64;
+  static constexpr size_t kNumReaderShards = 16;
+  struct alignas(kReaderShardSize) ReaderShard {
+    AtomicInteger count;
+    uint8_t padding[kReaderShardSize - sizeof(AtomicInteger)];
+
+    // The default operator new[] does not honor the alignment of the shards.
+    static void* operator new[](size_t size);
+    static void operator delete[](void* ptr);
+  };
+
   // Out-of-inline path for handling contention for a SharedLock.
   void HandleSharedLockContention(Thread* self, int32_t cur_state);
 
-  // -1 implies held exclusive, +ve shared held by state_ many owners.
+  // Returns the reader count of self's shard.
+  AtomicInteger* GetReaderShard(const Thread* self) const ALWAYS_INLINE;
+
+  // Drops a reader from its shard, waking a writer waiting for the shard to drain.
+  void ReleaseReaderShard(AtomicInteger* count) ALWAYS_INLINE;
+
+  // Waits for all the shards to drain once state_ is -1. Returns false if end_abs_ts, when not
+  // null, passes first.
+  bool WaitForBiasedReaders(Thread* self, const timespec* end_abs_ts);
+
+  // -1 implies held exclusive, +ve shared held by state_ many owners. Stays 0 while only readers
+  // of a reader biased mutex hold it.
   AtomicInteger state_;
   // Exclusive owner. Modification guarded by this mutex.
   volatile uint64_t exclusive_owner_;
@@ -415,6 +446,8 @@ class SHARED_LOCKABLE ReaderWriterMutex : public BaseMutex {
   AtomicInteger num_pending_readers_;
   // Number of contenders waiting to be the writer.
   AtomicInteger num_pending_writers_;
+  // Reader counts of a reader biased mutex, null otherwise.
+  ReaderShard* const reader_shards_;
 #else
   pthread_rwlock_t rwlock_;
   volatile uint64_t exclusive_owner_;  // Guarded by rwlock_.
@@ -435,11 +468,16 @@ class SHARED_LOCKABLE ReaderWriterMutex : public BaseMutex {
 // *) The most important consequence of this behaviour is that all threads must be in one of the
 // suspended states before exclusive ownership of the mutator mutex is sought.
 //
+// The thread state word thus serves as a per-thread reader indicator that the exclusive acquirer
+// scans when suspending all threads; going through JNI touches no shared cache line. The mutex
+// is also reader biased, so explicit shared acquisitions by suspended threads, e.g. GC workers,
+// don't share one either.
+//
 std::ostream& operator<<(std::ostream& os, const MutatorMutex& mu);
 class SHARED_LOCKABLE MutatorMutex : public ReaderWriterMutex {
  public:
   explicit MutatorMutex(const char* name, LockLevel level = kDefaultMutexLevel)
-    : ReaderWriterMutex(name, level) {}
+    : ReaderWriterMutex(name, level, /* reader_biased */ true) {}
   ~MutatorMutex() {}
 
   virtual bool IsMutatorMutex() const { return true; }
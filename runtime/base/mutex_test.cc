@@ -16,6 +16,7 @@
 
 #include "mutex.h"
 
+#include "base/time_utils.h"
 #include "common_runtime_test.h"
 #include "thread-inl.h"
 
@@ -171,4 +172,48 @@ TEST_F(MutexTest, SharedTryLockUnlock) {
   SharedTryLockUnlockTest();
 }
 
+struct ReaderBiasedExclusion {
+  ReaderBiasedExclusion()
+      : mu("test rwmutex", kDefaultMutexLevel, /* reader_biased */ true), writer_done(0) {
+  }
+
+  ReaderWriterMutex mu;
+  AtomicInteger writer_done;
+};
+
+static void* ReaderBiasedWriterCallback(void* arg) NO_THREAD_SAFETY_ANALYSIS {
+  ReaderBiasedExclusion* state = reinterpret_cast<ReaderBiasedExclusion*>(arg);
+  state->mu.ExclusiveLock(Thread::Current());
+  state->writer_done.StoreSequentiallyConsistent(1);
+  state->mu.ExclusiveUnlock(Thread::Current());
+  return nullptr;
+}
+
+// GCC has trouble with our mutex tests, so we have to turn off thread safety analysis.
+static void ReaderBiasedExclusionTest() NO_THREAD_SAFETY_ANALYSIS {
+  ReaderBiasedExclusion state;
+  state.mu.SharedLock(Thread::Current());
+  state.mu.AssertSharedHeld(Thread::Current());
+
+  pthread_t pthread;
+  int pthread_create_result = pthread_create(&pthread, nullptr, ReaderBiasedWriterCallback, &state);
+  ASSERT_EQ(0, pthread_create_result);
+
+  // The writer has to wait for the reader to leave its shard.
+  NanoSleep(MsToNs(50));
+  EXPECT_EQ(0, state.writer_done.LoadSequentiallyConsistent());
+  state.mu.SharedUnlock(Thread::Current());
+  EXPECT_EQ(pthread_join(pthread, nullptr), 0);
+  EXPECT_EQ(1, state.writer_done.LoadSequentiallyConsistent());
+
+  // Readers get in again once the writer is gone.
+  ASSERT_TRUE(state.mu.SharedTryLock(Thread::Current()));
+  state.mu.SharedUnlock(Thread::Current());
+  state.mu.AssertNotHeld(Thread::Current());
+}
+
+TEST_F(MutexTest, ReaderBiasedExclusion) {
+  ReaderBiasedExclusionTest();
+}
+
 }  // namespace art
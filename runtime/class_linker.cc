@@ -65,6 +65,7 @@
 #include "imtable-inl.h"
 #include "intern_table.h"
 #include "interpreter/interpreter.h"
+#include "interpreter/interpreter_cache.h"
 #include "java_vm_ext.h"
 #include "jit/jit.h"
 #include "jit/jit_code_cache.h"
@@ -8546,9 +8547,36 @@ void ClassLinker::SetEntryPointsForObsoleteMethod(ArtMethod* method) const {
 
 void ClassLinker::DumpForSigQuit(std::ostream& os) {
   ScopedObjectAccess soa(Thread::Current());
-  ReaderMutexLock mu(soa.Self(), *Locks::classlinker_classes_lock_);
-  os << "Zygote loaded classes=" << NumZygoteClasses() << " post zygote classes="
-     << NumNonZygoteClasses() << "\n";
+  {
+    ReaderMutexLock mu(soa.Self(), *Locks::classlinker_classes_lock_);
+    os << "Zygote loaded classes=" << NumZygoteClasses() << " post zygote classes="
+       << NumNonZygoteClasses() << "\n";
+  }
+  // Dex files mapped from the APK or vdex file only use clean pages, while dex files that had to
+  // be extracted, e.g. from compressed APK entries, are held in dirty anonymous memory.
+  size_t file_backed_dex_files = 0u;
+  size_t file_backed_dex_bytes = 0u;
+  size_t anonymous_dex_files = 0u;
+  size_t anonymous_dex_bytes = 0u;
+  {
+    ReaderMutexLock mu(soa.Self(), *Locks::dex_lock_);
+    for (const DexCacheData& data : dex_caches_) {
+      if (soa.Self()->IsJWeakCleared(data.weak_root)) {
+        continue;
+      }
+      if (data.dex_file->IsBackedByFile()) {
+        ++file_backed_dex_files;
+        file_backed_dex_bytes += data.dex_file->Size();
+      } else {
+        ++anonymous_dex_files;
+        anonymous_dex_bytes += data.dex_file->Size();
+      }
+    }
+  }
+  os << "File-backed dex files=" << file_backed_dex_files
+     << " (" << PrettySize(file_backed_dex_bytes) << " clean)"
+     << " anonymous dex files=" << anonymous_dex_files
+     << " (" << PrettySize(anonymous_dex_bytes) << " dirty)\n";
 }
 
 class CountClassesVisitor : public ClassLoaderVisitor {
@@ -8822,6 +8850,10 @@ void ClassLinker::CleanupClassLoaders() {
       }
     }
   }
+  if (!to_delete.empty()) {
+    // Interpreter caches may hold dex instruction addresses and methods of the unloaded classes.
+    interpreter::InterpreterCache::InvalidateAll();
+  }
   for (ClassLoaderData& data : to_delete) {
     DeleteClassLoader(self, data);
   }
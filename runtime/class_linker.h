@@ -223,7 +223,8 @@ class ClassLinker {
 
   mirror::Class* FindPrimitiveClass(char type) REQUIRES_SHARED(Locks::mutator_lock_);
 
-  void DumpForSigQuit(std::ostream& os) REQUIRES(!Locks::classlinker_classes_lock_);
+  void DumpForSigQuit(std::ostream& os)
+      REQUIRES(!Locks::classlinker_classes_lock_, !Locks::dex_lock_);
 
   size_t NumLoadedClasses()
       REQUIRES(!Locks::classlinker_classes_lock_)
@@ -24,7 +24,6 @@
 #include <sys/file.h>
 #include <sys/mman.h>  // For the PROT_* and MAP_* constants.
 #include <sys/stat.h>
-#include <zlib.h>
 
 #include <memory>
 #include <sstream>
@@ -32,6 +31,7 @@
 
 #include "android-base/stringprintf.h"
 
+#include "base/adler32.h"
 #include "base/enums.h"
 #include "base/file_magic.h"
 #include "base/logging.h"
@@ -72,7 +72,7 @@ const uint8_t DexFile::kDexMagicVersions[DexFile::kNumDexVersions][DexFile::kDex
 uint32_t DexFile::CalculateChecksum() const {
   const uint32_t non_sum = OFFSETOF_MEMBER(DexFile::Header, signature_);
   const uint8_t* non_sum_ptr = Begin() + non_sum;
-  return adler32(adler32(0L, Z_NULL, 0), non_sum_ptr, Size() - non_sum);
+  return Adler32(kAdler32Init, non_sum_ptr, Size() - non_sum);
 }
 
 struct DexFile::AnnotationValue {
@@ -324,6 +324,7 @@ std::unique_ptr<const DexFile> DexFile::OpenFile(int fd,
                                                  error_msg);
   if (dex_file != nullptr) {
     dex_file->mem_map_.reset(map.release());
+    dex_file->mapped_from_file_ = true;
   }
 
   return dex_file;
@@ -348,31 +349,14 @@ std::unique_ptr<const DexFile> DexFile::OpenOneDexFileFromZip(const ZipArchive&
     return nullptr;
   }
 
-  std::unique_ptr<MemMap> map;
-  if (zip_entry->IsUncompressed()) {
-    if (!zip_entry->IsAlignedTo(alignof(Header))) {
-      // Do not mmap unaligned ZIP entries because
-      // doing so would fail dex verification which requires 4 byte alignment.
-      LOG(WARNING) << "Can't mmap dex file " << location << "!" << entry_name << " directly; "
-                   << "please zipalign to " << alignof(Header) << " bytes. "
-                   << "Falling back to extracting file.";
-    } else {
-      // Map uncompressed files within zip as file-backed to avoid a dirty copy.
-      map.reset(zip_entry->MapDirectlyFromFile(location.c_str(), /*out*/error_msg));
-      if (map == nullptr) {
-        LOG(WARNING) << "Can't mmap dex file " << location << "!" << entry_name << " directly; "
-                     << "is your ZIP file corrupted? Falling back to extraction.";
-        // Try again with Extraction which still has a chance of recovery.
-      }
-    }
-  }
-
-  if (map == nullptr) {
-    // Default path for compressed ZIP entries,
-    // and fallback for stored ZIP entries.
-    map.reset(zip_entry->ExtractToMemMap(location.c_str(), entry_name, error_msg));
-  }
-
+  // Do not mmap unaligned ZIP entries because
+  // doing so would fail dex verification which requires 4 byte alignment.
+  bool mapped_from_file = false;
+  std::unique_ptr<MemMap> map(zip_entry->MapDirectlyOrExtract(location.c_str(),
+                                                              entry_name,
+                                                              alignof(Header),
+                                                              &mapped_from_file,
+                                                              error_msg));
   if (map == nullptr) {
     *error_msg = StringPrintf("Failed to extract '%s' from '%s': %s", entry_name, location.c_str(),
                               error_msg->c_str());
@@ -398,6 +382,7 @@ std::unique_ptr<const DexFile> DexFile::OpenOneDexFileFromZip(const ZipArchive&
     return nullptr;
   }
   dex_file->mem_map_.reset(map.release());
+  dex_file->mapped_from_file_ = mapped_from_file;
   if (!dex_file->DisableWrite()) {
     *error_msg = StringPrintf("Failed to make dex file '%s' read only", location.c_str());
     *error_code = ZipOpenErrorCode::kMakeReadOnlyError;
@@ -529,6 +514,7 @@ DexFile::DexFile(const uint8_t* base,
       size_(size),
       location_(location),
       location_checksum_(location_checksum),
+      mapped_from_file_(false),
       header_(reinterpret_cast<const Header*>(base)),
       string_ids_(reinterpret_cast<const StringId*>(base + header_->string_ids_off_)),
       type_ids_(reinterpret_cast<const TypeId*>(base + header_->type_ids_off_)),
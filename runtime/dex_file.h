@@ -1042,6 +1042,13 @@ class DexFile {
 
   bool DisableWrite() const;
 
+  // Returns true if the data are pages of a file mapping, e.g. of an uncompressed APK entry or of
+  // a vdex file, which stay clean and can be dropped by the kernel. Otherwise the data are a copy
+  // in anonymous memory, e.g. extracted from a compressed APK entry, which is dirty.
+  bool IsBackedByFile() const {
+    return mapped_from_file_ || oat_dex_file_ != nullptr;
+  }
+
   const uint8_t* Begin() const {
     return begin_;
   }
@@ -1188,6 +1195,9 @@ class DexFile {
   // Manages the underlying memory allocation.
   std::unique_ptr<MemMap> mem_map_;
 
+  // Whether mem_map_ maps the dex file from a file rather than holding a copy in anonymous memory.
+  bool mapped_from_file_;
+
   // Points to the header section.
   const Header* const header_;
 
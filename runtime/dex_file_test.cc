@@ -18,6 +18,8 @@
 
 #include <memory>
 
+#include <ziparchive/zip_writer.h>
+
 #include "base/stl_util.h"
 #include "base/unix_file/fd_file.h"
 #include "common_runtime_test.h"
@@ -27,6 +29,7 @@
 #include "scoped_thread_state_change-inl.h"
 #include "thread-inl.h"
 #include "utils.h"
+#include "zip_archive.h"
 
 namespace art {
 
@@ -584,6 +587,44 @@ TEST_F(DexFileTest, ZipOpenThreeDexFiles) {
   EXPECT_EQ(dex_files.size(), 3u);
 }
 
+TEST_F(DexFileTest, ZipOpenStoredEntryMapsFile) {
+  std::string error_msg;
+  std::unique_ptr<ZipArchive> core_zip(
+      ZipArchive::Open(GetLibCoreDexFileNames()[0].c_str(), &error_msg));
+  ASSERT_TRUE(core_zip != nullptr) << error_msg;
+  std::unique_ptr<ZipEntry> core_entry(core_zip->Find(DexFile::kClassesDex, &error_msg));
+  ASSERT_TRUE(core_entry != nullptr) << error_msg;
+  std::unique_ptr<MemMap> dex_data(core_entry->ExtractToMemMap(
+      GetLibCoreDexFileNames()[0].c_str(), DexFile::kClassesDex, &error_msg));
+  ASSERT_TRUE(dex_data != nullptr) << error_msg;
+
+  for (bool compress : { false, true }) {
+    ScratchFile tmp;
+    FILE* file = fopen(tmp.GetFilename().c_str(), "wb");
+    ASSERT_TRUE(file != nullptr);
+    ZipWriter writer(file);
+    ASSERT_EQ(0, compress ? writer.StartEntry(DexFile::kClassesDex, ZipWriter::kCompress)
+                          : writer.StartAlignedEntry(DexFile::kClassesDex, 0, kPageSize));
+    ASSERT_EQ(0, writer.WriteBytes(dex_data->Begin(), dex_data->Size()));
+    ASSERT_EQ(0, writer.FinishEntry());
+    ASSERT_EQ(0, writer.Finish());
+    ASSERT_EQ(0, fclose(file));
+
+    std::vector<std::unique_ptr<const DexFile>> dex_files;
+    ASSERT_TRUE(DexFile::Open(tmp.GetFilename().c_str(),
+                              tmp.GetFilename(),
+                              /* verify_checksum */ true,
+                              &error_msg,
+                              &dex_files)) << error_msg;
+    ASSERT_EQ(1u, dex_files.size());
+    // Only the stored entry is mapped from the zip file, the compressed one is extracted.
+    EXPECT_NE(compress, dex_files[0]->IsBackedByFile());
+    EXPECT_TRUE(dex_files[0]->IsReadOnly());
+    ASSERT_EQ(dex_data->Size(), dex_files[0]->Size());
+    EXPECT_EQ(0, memcmp(dex_data->Begin(), dex_files[0]->Begin(), dex_data->Size()));
+  }
+}
+
 TEST_F(DexFileTest, OpenDexBadMapOffset) {
   ScratchFile tmp;
   std::unique_ptr<const DexFile> raw =
@@ -17,12 +17,17 @@
 #include "dex_file_verifier.h"
 
 #include <inttypes.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <limits>
 #include <memory>
 
 #include "android-base/stringprintf.h"
 
+#include "atomic.h"
 #include "dex_file-inl.h"
 #include "experimental_flags.h"
 #include "leb128.h"
@@ -35,6 +40,9 @@ namespace art {
 using android::base::StringAppendV;
 using android::base::StringPrintf;
 
+constexpr size_t DexFileVerifier::kParallelVerificationMinSize;
+constexpr size_t DexFileVerifier::kMaxVerificationThreads;
+
 static constexpr uint32_t kTypeIdLimit = std::numeric_limits<uint16_t>::max();
 
 static bool IsValidOrNoTypeId(uint16_t low, uint16_t high) {
@@ -223,14 +231,54 @@ const DexFile::ProtoId* DexFileVerifier::CheckLoadProtoId(uint32_t idx, const ch
     error_stmt;                                               \
   }
 
+// Runs `task` for all indexes in [0, count) on up to `max_threads` threads, including the calling
+// one. These are plain pthreads that are joined before returning: the verifier also runs without
+// a runtime, and in the zygote, which must not have any other threads when it forks.
+template <typename Task>
+static void RunInParallel(size_t count, size_t max_threads, const Task& task) {
+  struct Work {
+    const Task* task;
+    size_t count;
+    Atomic<size_t> next_index;
+  };
+  Work work;
+  work.task = &task;
+  work.count = count;
+  auto run = [](void* arg) -> void* {
+    Work* w = reinterpret_cast<Work*>(arg);
+    for (size_t index = w->next_index.FetchAndAddSequentiallyConsistent(1u);
+         index < w->count;
+         index = w->next_index.FetchAndAddSequentiallyConsistent(1u)) {
+      (*w->task)(index);
+    }
+    return nullptr;
+  };
+  std::vector<pthread_t> threads;
+  size_t num_threads = std::min(count, max_threads);
+  for (size_t i = 1u; i < num_threads; ++i) {
+    pthread_t thread;
+    int rc = pthread_create(&thread, nullptr, run, &work);
+    if (rc != 0) {
+      // Not fatal, the threads that are running pick up the remaining work.
+      LOG(WARNING) << "Failed to create dex file verifier thread: " << strerror(rc);
+      break;
+    }
+    threads.push_back(thread);
+  }
+  run(&work);
+  for (pthread_t thread : threads) {
+    CHECK_PTHREAD_CALL(pthread_join, (thread, nullptr), "dex file verifier thread");
+  }
+}
+
 bool DexFileVerifier::Verify(const DexFile* dex_file,
                              const uint8_t* begin,
                              size_t size,
                              const char* location,
                              bool verify_checksum,
                              std::string* error_msg) {
-  std::unique_ptr<DexFileVerifier> verifier(
-      new DexFileVerifier(dex_file, begin, size, location, verify_checksum));
+  std::unique_ptr<DexFileVerifier> verifier(new DexFileVerifier(
+      dex_file, begin, size, location, verify_checksum, GetVerificationThreadCount(size)));
   if (!verifier->Verify()) {
     *error_msg = verifier->FailureReason();
     return false;
@@ -238,6 +286,17 @@ bool DexFileVerifier::Verify(const DexFile* dex_file,
   return true;
 }
 
+size_t DexFileVerifier::GetVerificationThreadCount(size_t size) {
+  if (size < kParallelVerificationMinSize) {
+    return 1u;
+  }
+  long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (num_cpus <= 1) {
+    return 1u;
+  }
+  return std::min(static_cast<size_t>(num_cpus), size_t{kMaxVerificationThreads});
+}
+
 bool DexFileVerifier::CheckShortyDescriptorMatch(char shorty_char, const char* descriptor,
                                                 bool is_return_type) {
   switch (shorty_char) {
@@ -1740,6 +1799,92 @@ bool DexFileVerifier::CheckIntraDataSection(size_t offset,
   return true;
 }
 
+bool DexFileVerifier::CheckIntraSectionItems(size_t offset,
+                                             uint32_t count,
+                                             DexFile::MapItemType type) {
+  switch (type) {
+    case DexFile::kDexTypeStringIdItem:
+    case DexFile::kDexTypeTypeIdItem:
+    case DexFile::kDexTypeProtoIdItem:
+    case DexFile::kDexTypeFieldIdItem:
+    case DexFile::kDexTypeMethodIdItem:
+    case DexFile::kDexTypeClassDefItem:
+      return CheckIntraIdSection(offset, count, type);
+    case DexFile::kDexTypeMethodHandleItem:
+    case DexFile::kDexTypeCallSiteIdItem:
+      CheckIntraSectionIterate(offset, count, type);
+      return true;
+    case DexFile::kDexTypeTypeList:
+    case DexFile::kDexTypeAnnotationSetRefList:
+    case DexFile::kDexTypeAnnotationSetItem:
+    case DexFile::kDexTypeClassDataItem:
+    case DexFile::kDexTypeCodeItem:
+    case DexFile::kDexTypeStringDataItem:
+    case DexFile::kDexTypeDebugInfoItem:
+    case DexFile::kDexTypeAnnotationItem:
+    case DexFile::kDexTypeEncodedArrayItem:
+    case DexFile::kDexTypeAnnotationsDirectoryItem:
+      return CheckIntraDataSection(offset, count, type);
+    case DexFile::kDexTypeHeaderItem:
+    case DexFile::kDexTypeMapList:
+      break;
+  }
+  LOG(FATAL) << "Unexpected map item type " << type;
+  UNREACHABLE();
+}
+
+std::vector<DexFileVerifier::SectionCheck> DexFileVerifier::CheckIntraSectionItemsInParallel() {
+  const DexFile::MapList* map =
+      reinterpret_cast<const DexFile::MapList*>(begin_ + header_->map_off_);
+  const DexFile::MapItem* items = map->list_;
+  const uint32_t count = map->size_;
+
+  // Start with the largest sections, so that a thread that picks up a large section late does not
+  // hold up the others. CheckMap() made sure that the items are sorted by offset.
+  std::vector<uint32_t> order(count);
+  std::vector<size_t> section_sizes(count);
+  for (uint32_t i = 0; i < count; i++) {
+    order[i] = i;
+    section_sizes[i] = ((i + 1u < count) ? items[i + 1u].offset_ : size_) - items[i].offset_;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t lhs, uint32_t rhs) {
+    return section_sizes[lhs] > section_sizes[rhs];
+  });
+
+  std::vector<SectionCheck> checks(count);
+  RunInParallel(count, max_threads_, [&](size_t index) {
+    const uint32_t i = order[index];
+    DexFile::MapItemType type = static_cast<DexFile::MapItemType>(items[i].type_);
+    if (type == DexFile::kDexTypeHeaderItem ||
+        type == DexFile::kDexTypeMapList ||
+        MapTypeToBitMask(type) == 0u) {
+      // Checked by CheckIntraSection() itself.
+      return;
+    }
+    std::unique_ptr<DexFileVerifier> verifier(new DexFileVerifier(this));
+    verifier->ptr_ = begin_ + items[i].offset_;
+    checks[i].success = verifier->CheckIntraSectionItems(items[i].offset_, items[i].size_, type);
+    checks[i].verifier = std::move(verifier);
+  });
+  return checks;
+}
+
+bool DexFileVerifier::MergeIntraSectionCheck(SectionCheck* check) {
+  DexFileVerifier* verifier = check->verifier.get();
+  DCHECK(verifier != nullptr);
+  ptr_ = verifier->ptr_;
+  if (!check->success) {
+    failure_reason_ = verifier->failure_reason_;
+    return false;
+  }
+  for (const std::pair<uint32_t, uint16_t>& entry : verifier->offset_to_type_map_) {
+    DCHECK(offset_to_type_map_.Find(entry.first) == offset_to_type_map_.end());
+    offset_to_type_map_.Insert(entry);
+  }
+  check->verifier.reset();
+  return true;
+}
+
 bool DexFileVerifier::CheckIntraSection() {
   const DexFile::MapList* map = reinterpret_cast<const DexFile::MapList*>(begin_ + header_->map_off_);
   const DexFile::MapItem* item = map->list_;
@@ -1747,6 +1892,15 @@ bool DexFileVerifier::CheckIntraSection() {
   uint32_t count = map->size_;
   ptr_ = begin_;
 
+  // The items of a section can be checked without looking at the other sections. On large files,
+  // do that for all the sections on multiple threads first. The loop below then checks the gaps
+  // between the sections and takes over the results in map order, so that the same failure is
+  // reported as when checking the sections serially.
+  std::vector<SectionCheck> section_checks;
+  if (max_threads_ > 1u) {
+    section_checks = CheckIntraSectionItemsInParallel();
+  }
+
   // Check the items listed in the map.
   while (count--) {
     const size_t current_offset = offset;
@@ -1776,17 +1930,6 @@ bool DexFileVerifier::CheckIntraSection() {
         ptr_ = begin_ + header_->header_size_;
         offset = header_->header_size_;
         break;
-      case DexFile::kDexTypeStringIdItem:
-      case DexFile::kDexTypeTypeIdItem:
-      case DexFile::kDexTypeProtoIdItem:
-      case DexFile::kDexTypeFieldIdItem:
-      case DexFile::kDexTypeMethodIdItem:
-      case DexFile::kDexTypeClassDefItem:
-        if (!CheckIntraIdSection(section_offset, section_count, type)) {
-          return false;
-        }
-        offset = ptr_ - begin_;
-        break;
       case DexFile::kDexTypeMapList:
         if (UNLIKELY(section_count != 1)) {
           ErrorStringPrintf("Multiple map list items");
@@ -1800,11 +1943,14 @@ bool DexFileVerifier::CheckIntraSection() {
         ptr_ += sizeof(uint32_t) + (map->size_ * sizeof(DexFile::MapItem));
         offset = section_offset + sizeof(uint32_t) + (map->size_ * sizeof(DexFile::MapItem));
         break;
+      case DexFile::kDexTypeStringIdItem:
+      case DexFile::kDexTypeTypeIdItem:
+      case DexFile::kDexTypeProtoIdItem:
+      case DexFile::kDexTypeFieldIdItem:
+      case DexFile::kDexTypeMethodIdItem:
+      case DexFile::kDexTypeClassDefItem:
       case DexFile::kDexTypeMethodHandleItem:
       case DexFile::kDexTypeCallSiteIdItem:
-        CheckIntraSectionIterate(section_offset, section_count, type);
-        offset = ptr_ - begin_;
-        break;
       case DexFile::kDexTypeTypeList:
       case DexFile::kDexTypeAnnotationSetRefList:
       case DexFile::kDexTypeAnnotationSetItem:
@@ -1815,7 +1961,11 @@ bool DexFileVerifier::CheckIntraSection() {
       case DexFile::kDexTypeAnnotationItem:
       case DexFile::kDexTypeEncodedArrayItem:
       case DexFile::kDexTypeAnnotationsDirectoryItem:
-        if (!CheckIntraDataSection(section_offset, section_count, type)) {
+        if (section_checks.empty()) {
+          if (!CheckIntraSectionItems(section_offset, section_count, type)) {
+            return false;
+          }
+        } else if (!MergeIntraSectionCheck(&section_checks[item - map->list_])) {
           return false;
         }
         offset = ptr_ - begin_;
@@ -1835,8 +1985,10 @@ bool DexFileVerifier::CheckIntraSection() {
 
 bool DexFileVerifier::CheckOffsetToTypeMap(size_t offset, uint16_t type) {
   DCHECK_NE(offset, 0u);
-  auto it = offset_to_type_map_.Find(offset);
-  if (UNLIKELY(it == offset_to_type_map_.end())) {
+  const auto& offset_to_type_map =
+      (parent_ != nullptr) ? parent_->offset_to_type_map_ : offset_to_type_map_;
+  auto it = offset_to_type_map.Find(offset);
+  if (UNLIKELY(it == offset_to_type_map.end())) {
     ErrorStringPrintf("No data map entry found @ %zx; expected %x", offset, type);
     return false;
   }
@@ -2672,10 +2824,31 @@ bool DexFileVerifier::CheckInterSectionIterate(size_t offset,
   return true;
 }
 
+bool DexFileVerifier::CheckInterSectionsInParallel(
+    const std::vector<const DexFile::MapItem*>& items) {
+  std::vector<SectionCheck> checks(items.size());
+  RunInParallel(items.size(), max_threads_, [&](size_t index) {
+    const DexFile::MapItem* item = items[index];
+    std::unique_ptr<DexFileVerifier> verifier(new DexFileVerifier(this));
+    checks[index].success = verifier->CheckInterSectionIterate(
+        item->offset_, item->size_, static_cast<DexFile::MapItemType>(item->type_));
+    checks[index].verifier = std::move(verifier);
+  });
+  for (const SectionCheck& check : checks) {
+    if (!check.success) {
+      failure_reason_ = check.verifier->failure_reason_;
+      return false;
+    }
+  }
+  return true;
+}
+
 bool DexFileVerifier::CheckInterSection() {
   const DexFile::MapList* map = reinterpret_cast<const DexFile::MapList*>(begin_ + header_->map_off_);
   const DexFile::MapItem* item = map->list_;
   uint32_t count = map->size_;
+  // Sections checked in parallel after the loop, on large files.
+  std::vector<const DexFile::MapItem*> parallel_items;
 
   // Cross check the items listed in the map.
   while (count--) {
@@ -2700,6 +2873,13 @@ bool DexFileVerifier::CheckInterSection() {
       case DexFile::kDexTypeProtoIdItem:
       case DexFile::kDexTypeFieldIdItem:
       case DexFile::kDexTypeMethodIdItem:
+        // The checks of the other sections rely on these ids being valid, so these sections
+        // are never checked in parallel.
+        if (!CheckInterSectionIterate(section_offset, section_count, type)) {
+          return false;
+        }
+        found = true;
+        break;
       case DexFile::kDexTypeClassDefItem:
       case DexFile::kDexTypeCallSiteIdItem:
       case DexFile::kDexTypeMethodHandleItem:
@@ -2707,7 +2887,9 @@ bool DexFileVerifier::CheckInterSection() {
       case DexFile::kDexTypeAnnotationSetItem:
       case DexFile::kDexTypeClassDataItem:
       case DexFile::kDexTypeAnnotationsDirectoryItem: {
-        if (!CheckInterSectionIterate(section_offset, section_count, type)) {
+        if (max_threads_ > 1u) {
+          parallel_items.push_back(item);
+        } else if (!CheckInterSectionIterate(section_offset, section_count, type)) {
           return false;
         }
         found = true;
@@ -2723,6 +2905,10 @@ bool DexFileVerifier::CheckInterSection() {
     item++;
   }
 
+  if (!parallel_items.empty() && !CheckInterSectionsInParallel(parallel_items)) {
+    return false;
+  }
+
   return true;
 }
 
@@ -17,10 +17,13 @@
 #ifndef ART_RUNTIME_DEX_FILE_VERIFIER_H_
 #define ART_RUNTIME_DEX_FILE_VERIFIER_H_
 
+#include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include "dex_file.h"
 #include "dex_file_types.h"
+#include "globals.h"
 #include "safe_map.h"
 
 namespace art {
@@ -38,22 +41,47 @@ class DexFileVerifier {
     return failure_reason_;
   }
 
+  // Dex files of at least this size have their sections verified on multiple threads.
+  static constexpr size_t kParallelVerificationMinSize = 1 * MB;
+  // The maximum number of threads, including the calling one, used for verifying a dex file.
+  static constexpr size_t kMaxVerificationThreads = 4u;
+
  private:
   DexFileVerifier(const DexFile* dex_file,
                   const uint8_t* begin,
                   size_t size,
                   const char* location,
-                  bool verify_checksum)
+                  bool verify_checksum,
+                  size_t max_threads)
       : dex_file_(dex_file),
         begin_(begin),
         size_(size),
         location_(location),
         verify_checksum_(verify_checksum),
         header_(&dex_file->GetHeader()),
+        max_threads_(max_threads),
+        parent_(nullptr),
+        ptr_(nullptr),
+        previous_item_(nullptr)  {
+  }
+
+  // Creates a verifier for checking a single section of the file of `parent` on another thread.
+  explicit DexFileVerifier(const DexFileVerifier* parent)
+      : dex_file_(parent->dex_file_),
+        begin_(parent->begin_),
+        size_(parent->size_),
+        location_(parent->location_),
+        verify_checksum_(parent->verify_checksum_),
+        header_(parent->header_),
+        max_threads_(1u),
+        parent_(parent),
         ptr_(nullptr),
         previous_item_(nullptr)  {
   }
 
+  // Returns the number of threads to use for verifying a dex file of the given size.
+  static size_t GetVerificationThreadCount(size_t size);
+
   bool Verify();
 
   bool CheckShortyDescriptorMatch(char shorty_char, const char* descriptor, bool is_return_type);
@@ -125,8 +153,20 @@ class DexFileVerifier {
   bool CheckIntraSectionIterate(size_t offset, uint32_t count, DexFile::MapItemType type);
   bool CheckIntraIdSection(size_t offset, uint32_t count, DexFile::MapItemType type);
   bool CheckIntraDataSection(size_t offset, uint32_t count, DexFile::MapItemType type);
+  // Check the items of a section other than the header and the map list, starting at ptr_.
+  bool CheckIntraSectionItems(size_t offset, uint32_t count, DexFile::MapItemType type);
   bool CheckIntraSection();
 
+  // Result of checking the items of one section with its own verifier.
+  struct SectionCheck {
+    std::unique_ptr<DexFileVerifier> verifier;
+    bool success = false;
+  };
+  // Check the items of all sections in parallel, see CheckIntraSection().
+  std::vector<SectionCheck> CheckIntraSectionItemsInParallel();
+  // Take over the end of the section, the failure and the data items found by `check`.
+  bool MergeIntraSectionCheck(SectionCheck* check);
+
   bool CheckOffsetToTypeMap(size_t offset, uint16_t type);
 
   // Note: as sometimes kDexNoIndex16, being 0xFFFF, is a valid return value, we need an
@@ -149,6 +189,8 @@ class DexFileVerifier {
 
   bool CheckInterSectionIterate(size_t offset, uint32_t count, DexFile::MapItemType type);
   bool CheckInterSection();
+  // Check the given sections in parallel and report the first failure in map order.
+  bool CheckInterSectionsInParallel(const std::vector<const DexFile::MapItem*>& items);
 
   // Load a string by (type) index. Checks whether the index is in bounds, printing the error if
   // not. If there is an error, null is returned.
@@ -202,6 +244,11 @@ class DexFileVerifier {
   const char* const location_;
   const bool verify_checksum_;
   const DexFile::Header* const header_;
+  // The number of threads for verifying the sections, 1 for verifying them serially.
+  const size_t max_threads_;
+  // The verifier of the whole file if this one only checks a single section, null otherwise.
+  // The data section items are looked up in the map of the parent.
+  const DexFileVerifier* const parent_;
 
   struct OffsetTypeMapEmptyFn {
     // Make a hash map slot empty by making the offset 0. Offset 0 is a valid dex file offset that
@@ -239,6 +286,8 @@ class DexFileVerifier {
 
   // Set of type ids for which there are ClassDef elements in the dex file.
   std::unordered_set<decltype(DexFile::ClassDef::class_idx_)> defined_classes_;
+
+  friend class DexFileVerifierTest;
 };
 
 }  // namespace art
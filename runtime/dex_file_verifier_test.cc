@@ -22,8 +22,10 @@
 #include <memory>
 
 #include "base/unix_file/fd_file.h"
+#include "base/adler32.h"
 #include "base/bit_utils.h"
 #include "base/macros.h"
+#include "base/time_utils.h"
 #include "common_runtime_test.h"
 #include "dex_file-inl.h"
 #include "dex_file_types.h"
@@ -86,6 +88,33 @@ class DexFileVerifierTest : public CommonRuntimeTest {
       }
     }
   }
+
+  // Verifies the dex file with its sections checked on up to `max_threads` threads.
+  static bool VerifyWithThreads(const DexFile* dex_file,
+                                size_t max_threads,
+                                std::string* error_msg) {
+    DexFileVerifier verifier(dex_file,
+                             dex_file->Begin(),
+                             dex_file->Size(),
+                             dex_file->GetLocation().c_str(),
+                             /* verify_checksum */ true,
+                             max_threads);
+    if (!verifier.Verify()) {
+      *error_msg = verifier.FailureReason();
+      return false;
+    }
+    return true;
+  }
+
+  static void ExpectSameFailureSerialAndParallel(const DexFile* dex_file, const char* expected) {
+    std::string serial_error_msg;
+    EXPECT_FALSE(VerifyWithThreads(dex_file, 1u, &serial_error_msg));
+    EXPECT_NE(serial_error_msg.find(expected), std::string::npos) << serial_error_msg;
+    std::string parallel_error_msg;
+    EXPECT_FALSE(VerifyWithThreads(
+        dex_file, DexFileVerifier::kMaxVerificationThreads, &parallel_error_msg));
+    EXPECT_EQ(serial_error_msg, parallel_error_msg);
+  }
 };
 
 static std::unique_ptr<const DexFile> OpenDexFileBase64(const char* base64,
@@ -2090,4 +2119,90 @@ TEST_F(DexFileVerifierTest, InvokeCustomDexSamples) {
   }
 }
 
+// Microbenchmark for the checksum and the verification of a large dex file: the largest dex file
+// of the core libraries, which is about as large as the dex files of big apps.
+TEST_F(DexFileVerifierTest, LargeDexFileSerialAndParallel) {
+  std::vector<std::unique_ptr<const DexFile>> core_dex_files;
+  std::string error_msg;
+  for (const std::string& filename : GetLibCoreDexFileNames()) {
+    ASSERT_TRUE(DexFile::Open(filename.c_str(),
+                              filename,
+                              /* verify_checksum */ true,
+                              &error_msg,
+                              &core_dex_files)) << error_msg;
+  }
+  ASSERT_FALSE(core_dex_files.empty());
+  const DexFile* largest = core_dex_files[0].get();
+  for (const std::unique_ptr<const DexFile>& core_dex_file : core_dex_files) {
+    if (core_dex_file->Size() > largest->Size()) {
+      largest = core_dex_file.get();
+    }
+  }
+  ASSERT_GE(largest->Size(), DexFileVerifier::kParallelVerificationMinSize);
+
+  // Work on a copy that can be corrupted below.
+  std::vector<uint8_t> dex_bytes(largest->Begin(), largest->Begin() + largest->Size());
+  std::unique_ptr<DexFile> dex_file(GetDexFile(dex_bytes.data(), dex_bytes.size()));
+
+  static constexpr size_t kIterations = 5u;
+  uint64_t zlib_checksum_ns = 0u;
+  uint64_t checksum_ns = 0u;
+  uint64_t serial_ns = 0u;
+  uint64_t parallel_ns = 0u;
+  for (size_t i = 0; i != kIterations; ++i) {
+    uint64_t start_ns = NanoTime();
+    uint32_t zlib_checksum = adler32(adler32(0L, Z_NULL, 0), dex_bytes.data(), dex_bytes.size());
+    uint64_t zlib_checksum_end_ns = NanoTime();
+    uint32_t checksum = Adler32(kAdler32Init, dex_bytes.data(), dex_bytes.size());
+    uint64_t checksum_end_ns = NanoTime();
+    EXPECT_EQ(zlib_checksum, checksum);
+    EXPECT_TRUE(VerifyWithThreads(dex_file.get(), 1u, &error_msg)) << error_msg;
+    uint64_t serial_end_ns = NanoTime();
+    EXPECT_TRUE(VerifyWithThreads(
+        dex_file.get(), DexFileVerifier::kMaxVerificationThreads, &error_msg)) << error_msg;
+    uint64_t parallel_end_ns = NanoTime();
+    zlib_checksum_ns += zlib_checksum_end_ns - start_ns;
+    checksum_ns += checksum_end_ns - zlib_checksum_end_ns;
+    serial_ns += serial_end_ns - checksum_end_ns;
+    parallel_ns += parallel_end_ns - serial_end_ns;
+  }
+  LOG(INFO) << "Dex file of " << PrettySize(dex_bytes.size()) << ":"
+            << " checksum zlib " << PrettyDuration(zlib_checksum_ns / kIterations)
+            << ", simd " << PrettyDuration(checksum_ns / kIterations)
+            << "; verification serial " << PrettyDuration(serial_ns / kIterations)
+            << ", parallel " << PrettyDuration(parallel_ns / kIterations);
+
+  // Corrupt a code item, which is checked within its section.
+  uint8_t* begin = dex_bytes.data();
+  const DexFile::Header& header = dex_file->GetHeader();
+  const DexFile::MapList* map = reinterpret_cast<const DexFile::MapList*>(begin + header.map_off_);
+  uint32_t code_item_offset = 0u;
+  for (uint32_t i = 0; i < map->size_; ++i) {
+    if (map->list_[i].type_ == DexFile::kDexTypeCodeItem) {
+      code_item_offset = map->list_[i].offset_;
+      break;
+    }
+  }
+  ASSERT_NE(code_item_offset, 0u);
+  DexFile::CodeItem* code_item = reinterpret_cast<DexFile::CodeItem*>(begin + code_item_offset);
+  const uint16_t ins_size = code_item->ins_size_;
+  code_item->ins_size_ = code_item->registers_size_ + 1u;
+  FixUpChecksum(begin);
+  ExpectSameFailureSerialAndParallel(dex_file.get(), "ins_size");
+  code_item->ins_size_ = ins_size;
+
+  // Corrupt a class def, which is checked against the other sections.
+  DexFile::ClassDef* class_def = nullptr;
+  for (uint32_t i = 0; i < header.class_defs_size_; ++i) {
+    class_def = const_cast<DexFile::ClassDef*>(&dex_file->GetClassDef(i));
+    if (class_def->class_data_off_ != 0u) {
+      break;
+    }
+  }
+  ASSERT_TRUE(class_def != nullptr);
+  class_def->class_data_off_ = code_item_offset;
+  FixUpChecksum(begin);
+  ExpectSameFailureSerialAndParallel(dex_file.get(), "Unexpected data map entry");
+}
+
 }  // namespace art
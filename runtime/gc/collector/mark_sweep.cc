@@ -1372,11 +1372,13 @@ void MarkSweep::ProcessMarkStackParallel(size_t thread_count) {
                                      static_cast<size_t>(MarkStackTask<false>::kMaxSize));
   CHECK_GT(chunk_size, 0U);
   // Split the current mark stack up into work tasks.
+  std::vector<Task*> tasks;
   for (auto* it = mark_stack_->Begin(), *end = mark_stack_->End(); it < end; ) {
     const size_t delta = std::min(static_cast<size_t>(end - it), chunk_size);
-    thread_pool->AddTask(self, new MarkStackTask<false>(thread_pool, this, delta, it));
+    tasks.push_back(new MarkStackTask<false>(thread_pool, this, delta, it));
     it += delta;
   }
+  thread_pool->AddTasks(self, tasks);
   thread_pool->SetMaxActiveWorkers(thread_count - 1);
   thread_pool->StartWorkers(self);
   thread_pool->Wait(self, true, true);
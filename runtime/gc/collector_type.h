@@ -61,6 +61,8 @@ enum CollectorType {
   kCollectorTypeAddRemoveSystemWeakHolder,
   // Fake collector type for GetObjectsAllocated
   kCollectorTypeGetObjectsAllocated,
+  // Fake collector type for concurrent monitor deflation.
+  kCollectorTypeMonitorDeflation,
 };
 std::ostream& operator<<(std::ostream& os, const CollectorType& collector_type);
 
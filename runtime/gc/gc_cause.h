@@ -59,6 +59,8 @@ enum GcCause {
   kGcCauseHprof,
   // Not a real GC cause, used to prevent GetObjectsAllocated running in the middle of GC.
   kGcCauseGetObjectsAllocated,
+  // Not a real GC cause, used to deflate idle monitors while the mutators are running.
+  kGcCauseMonitorDeflation,
 };
 
 const char* PrettyCause(GcCause cause);
@@ -81,6 +81,7 @@
 #include "ScopedLocalRef.h"
 #include "scoped_thread_state_change-inl.h"
 #include "handle_scope-inl.h"
+#include "handshake.h"
 #include "thread_list.h"
 #include "verify_object-inl.h"
 #include "well_known_classes.h"
@@ -1358,14 +1359,11 @@ void Heap::DoPendingCollectorTransition() {
 void Heap::Trim(Thread* self) {
   Runtime* const runtime = Runtime::Current();
   if (!CareAboutPauseTimes()) {
-    // Deflate the monitors, this can cause a pause but shouldn't matter since we don't care
-    // about pauses.
+    // Deflate all the unowned monitors. This runs concurrently with the mutators, it only needs
+    // a handshake with every thread before the monitors can be freed.
     ScopedTrace trace("Deflating monitors");
-    // Avoid race conditions on the lock word for CC.
-    ScopedGCCriticalSection gcs(self, kGcCauseTrim, kCollectorTypeHeapTrim);
-    ScopedSuspendAll ssa(__FUNCTION__);
     uint64_t start_time = NanoTime();
-    size_t count = runtime->GetMonitorList()->DeflateMonitors();
+    size_t count = runtime->GetMonitorList()->DeflateIdleMonitors(self, 0 /* min_idle_ms */);
     VLOG(heap) << "Deflating " << count << " monitors took "
         << PrettyDuration(NanoTime() - start_time);
   }
@@ -1377,17 +1375,9 @@ void Heap::Trim(Thread* self) {
 
 class TrimIndirectReferenceTableClosure : public Closure {
  public:
-  explicit TrimIndirectReferenceTableClosure(Barrier* barrier) : barrier_(barrier) {
-  }
   virtual void Run(Thread* thread) OVERRIDE NO_THREAD_SAFETY_ANALYSIS {
     thread->GetJniEnv()->locals.Trim();
-    // If thread is a running mutator, then act on behalf of the trim thread.
-    // See the code in ThreadList::RunCheckpoint.
-    barrier_->Pass(Thread::Current());
   }
-
- private:
-  Barrier* const barrier_;
 };
 
 void Heap::TrimIndirectReferenceTables(Thread* self) {
@@ -1397,13 +1387,11 @@ void Heap::TrimIndirectReferenceTables(Thread* self) {
   // Trim globals indirect reference table.
   vm->TrimGlobals();
   // Trim locals indirect reference tables.
-  Barrier barrier(0);
-  TrimIndirectReferenceTableClosure closure(&barrier);
+  TrimIndirectReferenceTableClosure closure;
+  Handshake handshake(&closure);
   ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
-  size_t barrier_count = Runtime::Current()->GetThreadList()->RunCheckpoint(&closure);
-  if (barrier_count != 0) {
-    barrier.Increment(self, barrier_count);
-  }
+  handshake.StartWithAllThreads(self);
+  handshake.Wait(self);
 }
 
 void Heap::StartGC(Thread* self, GcCause cause, CollectorType collector_type) {
@@ -2751,6 +2739,7 @@ collector::GcType Heap::CollectGarbageInternal(collector::GcType gc_type,
   total_objects_freed_ever_ += GetCurrentGcIteration()->GetFreedObjects();
   total_bytes_freed_ever_ += GetCurrentGcIteration()->GetFreedBytes();
   RequestTrim(self);
+  RequestMonitorDeflation(self);
   // Enqueue cleared references.
   reference_processor_->EnqueueClearedReferences(self);
   // Grow the heap so that we know when to perform the next GC.
@@ -3845,6 +3834,36 @@ void Heap::RequestTrim(Thread* self) {
   task_processor_->AddTask(self, added_task);
 }
 
+class Heap::MonitorDeflationTask : public HeapTask {
+ public:
+  explicit MonitorDeflationTask(uint64_t target_time) : HeapTask(target_time) {}
+
+  virtual void Run(Thread* self) OVERRIDE {
+    Runtime* runtime = Runtime::Current();
+    MonitorList* monitor_list = runtime->GetMonitorList();
+    uint64_t start_time = NanoTime();
+    size_t count = monitor_list->DeflateIdleMonitors(self, MonitorList::kDeflationIdleMs);
+    VLOG(heap) << "Concurrently deflating " << count << " monitors took "
+        << PrettyDuration(NanoTime() - start_time);
+    gc::Heap* heap = runtime->GetHeap();
+    heap->monitor_deflation_pending_.StoreRelaxed(false);
+    // Look again while passes make progress, the monitors that were contended last may become
+    // idle soon. Otherwise the next inflation requests another pass.
+    if (count != 0u && monitor_list->Size() != 0u) {
+      heap->RequestMonitorDeflation(self);
+    }
+  }
+};
+
+void Heap::RequestMonitorDeflation(Thread* self) {
+  if (!monitor_deflation_pending_.LoadRelaxed() &&
+      Runtime::Current()->GetMonitorList()->Size() != 0u &&
+      CanAddHeapTask(self) &&
+      monitor_deflation_pending_.CompareExchangeStrongSequentiallyConsistent(false, true)) {
+    task_processor_->AddTask(self, new MonitorDeflationTask(NanoTime() + kMonitorDeflationWait));
+  }
+}
+
 void Heap::RevokeThreadLocalBuffers(Thread* thread) {
   if (rosalloc_space_ != nullptr) {
     size_t freed_bytes_revoke = rosalloc_space_->RevokeThreadLocalBuffers(thread);
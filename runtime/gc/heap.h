@@ -157,6 +157,8 @@ class Heap {
   static constexpr uint64_t kHeapTrimWait = MsToNs(5000);
   // How long we wait after a transition request to perform a collector transition (nanoseconds).
   static constexpr uint64_t kCollectorTransitionWait = MsToNs(5000);
+  // How often idle monitors are deflated while there are inflated monitors (nanoseconds).
+  static constexpr uint64_t kMonitorDeflationWait = MsToNs(2000);
 
   // Create a heap with the requested sizes. The possible empty
   // image_file_names names specify Spaces to load based on
@@ -747,6 +749,10 @@ class Heap {
   void RequestConcurrentGC(Thread* self, GcCause cause, bool force_full)
       REQUIRES(!*pending_task_lock_);
 
+  // Request an asynchronous deflation of idle monitors, unless one is already pending or there
+  // are no inflated monitors.
+  void RequestMonitorDeflation(Thread* self) REQUIRES(!Locks::runtime_shutdown_lock_);
+
   // Whether or not we may use a garbage collector, used so that we only create collectors we need.
   bool MayUseCollector(CollectorType type) const;
 
@@ -828,6 +834,7 @@ class Heap {
   class ConcurrentGCTask;
   class CollectorTransitionTask;
   class HeapTrimTask;
+  class MonitorDeflationTask;
 
   // Compact source space to target space. Returns the collector used.
   collector::GarbageCollector* Compact(space::ContinuousMemMapAllocSpace* target_space,
@@ -1383,6 +1390,9 @@ class Heap {
   // Whether or not a concurrent GC is pending.
   Atomic<bool> concurrent_gc_pending_;
 
+  // Whether or not a monitor deflation task is pending.
+  Atomic<bool> monitor_deflation_pending_;
+
   // Active tasks which we can modify (change target time, desired collector type, etc..).
   CollectorTransitionTask* pending_collector_transition_ GUARDED_BY(pending_task_lock_);
   HeapTrimTask* pending_heap_trim_ GUARDED_BY(pending_task_lock_);
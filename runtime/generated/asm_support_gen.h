@@ -108,6 +108,10 @@ DEFINE_CHECK_EQ(static_cast<int32_t>(LOCK_WORD_GC_STATE_SHIFT), (static_cast<int
 DEFINE_CHECK_EQ(static_cast<int32_t>(LOCK_WORD_MARK_BIT_SHIFT), (static_cast<int32_t>(art::LockWord::kMarkBitStateShift)))
 #define LOCK_WORD_MARK_BIT_MASK_SHIFTED 0x20000000
 DEFINE_CHECK_EQ(static_cast<uint32_t>(LOCK_WORD_MARK_BIT_MASK_SHIFTED), (static_cast<uint32_t>(art::LockWord::kMarkBitStateMaskShifted)))
+#define LOCK_WORD_STATE_BIASED_SHIFTED 0xe0000000
+DEFINE_CHECK_EQ(static_cast<uint32_t>(LOCK_WORD_STATE_BIASED_SHIFTED), (static_cast<uint32_t>(art::LockWord::kStateBiasedShifted)))
+#define LOCK_WORD_BIASED_OWNER_AND_STATE_MASK 0xe000ffff
+DEFINE_CHECK_EQ(static_cast<uint32_t>(LOCK_WORD_BIASED_OWNER_AND_STATE_MASK), (static_cast<uint32_t>(art::LockWord::kBiasedOwnerAndStateMaskShifted)))
 #define OBJECT_ALIGNMENT_MASK 0x7
 DEFINE_CHECK_EQ(static_cast<size_t>(OBJECT_ALIGNMENT_MASK), (static_cast<size_t>(art::kObjectAlignment - 1)))
 #define OBJECT_ALIGNMENT_MASK_TOGGLED 0xfffffff8
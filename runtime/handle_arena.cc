@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "handle_arena.h"
+
+namespace art {
+
+HandleArena::~HandleArena() {
+  Block* block = first_block_;
+  while (block != nullptr) {
+    Block* next = block->next;
+    delete block;
+    block = next;
+  }
+}
+
+void* HandleArena::AllocateInNextBlock(size_t bytes) {
+  // Reuse the blocks released by Reset() before allocating new ones.
+  Block* next = (current_block_ != nullptr) ? current_block_->next : first_block_;
+  if (next == nullptr) {
+    next = new Block();
+    next->next = nullptr;
+    if (current_block_ != nullptr) {
+      current_block_->next = next;
+    } else {
+      first_block_ = next;
+    }
+  }
+  current_block_ = next;
+  pos_ = next->data + bytes;
+  end_ = next->data + kBlockSize;
+  return next->data;
+}
+
+void HandleArena::Reset(const Mark& mark) {
+  current_block_ = mark.block;
+  pos_ = mark.pos;
+  end_ = (mark.block != nullptr) ? mark.block->data + kBlockSize : nullptr;
+}
+
+size_t HandleArena::GetCapacity() const {
+  size_t capacity = 0u;
+  for (Block* block = first_block_; block != nullptr; block = block->next) {
+    capacity += kBlockSize;
+  }
+  return capacity;
+}
+
+}  // namespace art
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_HANDLE_ARENA_H_
+#define ART_RUNTIME_HANDLE_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "base/bit_utils.h"
+#include "base/logging.h"
+#include "base/macros.h"
+#include "globals.h"
+
+namespace art {
+
+// Thread-local bump allocator for the storage of handle scopes that do not live on the native
+// stack, such as the chunks of a VariableSizedHandleScope.
+//
+// Handle scopes are created and destroyed in LIFO order on their thread, so a scope only needs to
+// remember the position of the arena when it is created and to reset the arena to it when it is
+// destroyed. Blocks are kept when the arena is reset and only freed with the thread, so a thread
+// only calls malloc when it needs more handles than it ever did before.
+//
+// The arena does not know which of its memory holds live references. The references are visited
+// by the GC through the handle scopes that own them, see Thread::HandleScopeVisitRoots.
+class HandleArena {
+ private:
+  struct Block;
+
+ public:
+  static constexpr size_t kBlockSize = 4 * KB;
+  static constexpr size_t kMaxAllocationSize = kBlockSize;
+  static constexpr size_t kAlignment = sizeof(void*);
+
+  // A position in the arena.
+  struct Mark {
+    Block* block;
+    uint8_t* pos;
+  };
+
+  HandleArena() : current_block_(nullptr), pos_(nullptr), end_(nullptr), first_block_(nullptr) {}
+  ~HandleArena();
+
+  // Returns kAlignment aligned memory for the given number of bytes, at most kMaxAllocationSize.
+  ALWAYS_INLINE void* Allocate(size_t bytes) {
+    DCHECK_LE(bytes, kMaxAllocationSize);
+    bytes = RoundUp(bytes, kAlignment);
+    if (UNLIKELY(static_cast<size_t>(end_ - pos_) < bytes)) {
+      return AllocateInNextBlock(bytes);
+    }
+    void* result = pos_;
+    pos_ += bytes;
+    return result;
+  }
+
+  Mark GetMark() const {
+    return Mark { current_block_, pos_ };
+  }
+
+  // Returns true if nothing was allocated since the mark was taken, or everything allocated since
+  // was released.
+  bool IsAt(const Mark& mark) const {
+    return pos_ == mark.pos;
+  }
+
+  // Releases everything allocated since the mark was taken.
+  void Reset(const Mark& mark);
+
+  // Number of bytes in blocks, used or not.
+  size_t GetCapacity() const;
+
+ private:
+  struct Block {
+    Block* next;
+    alignas(kAlignment) uint8_t data[kBlockSize];
+  };
+
+  void* AllocateInNextBlock(size_t bytes);
+
+  // The block pos_ is in, or null if nothing was allocated.
+  Block* current_block_;
+  uint8_t* pos_;
+  uint8_t* end_;
+  // All blocks of the arena, in the order they are used.
+  Block* first_block_;
+
+  DISALLOW_COPY_AND_ASSIGN(HandleArena);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_HANDLE_ARENA_H_
@@ -183,10 +183,24 @@ inline const HandleScope* BaseHandleScope::AsHandleScope() const {
   return down_cast<const HandleScope*>(this);
 }
 
+inline VariableSizedHandleScope::LocalScopeType* VariableSizedHandleScope::NewLocalScope(
+    LocalScopeType* link) {
+  HandleArena* const arena = self_->GetHandleArena();
+  if (LIKELY(arena->IsAt(arena_top_))) {
+    void* storage = arena->Allocate(sizeof(LocalScopeType));
+    arena_top_ = arena->GetMark();
+    return new (storage) LocalScopeType(link);
+  }
+  // A more recent scope allocated from the arena and is still alive.
+  LocalScopeType* scope = new LocalScopeType(link);
+  heap_scopes_.push_back(scope);
+  return scope;
+}
+
 template<class T>
 MutableHandle<T> VariableSizedHandleScope::NewHandle(T* object) {
   if (current_scope_->RemainingSlots() == 0) {
-    current_scope_ = new LocalScopeType(current_scope_);
+    current_scope_ = NewLocalScope(current_scope_);
   }
   return current_scope_->NewHandle(object);
 }
@@ -198,18 +212,22 @@ inline MutableHandle<MirrorType> VariableSizedHandleScope::NewHandle(ObjPtr<Mirr
 
 inline VariableSizedHandleScope::VariableSizedHandleScope(Thread* const self)
     : BaseHandleScope(self->GetTopHandleScope()),
-      self_(self) {
-  current_scope_ = new LocalScopeType(/*link*/ nullptr);
+      self_(self),
+      arena_mark_(self->GetHandleArena()->GetMark()),
+      arena_top_(arena_mark_) {
+  current_scope_ = NewLocalScope(/*link*/ nullptr);
   self_->PushHandleScope(this);
 }
 
 inline VariableSizedHandleScope::~VariableSizedHandleScope() {
   BaseHandleScope* top_handle_scope = self_->PopHandleScope();
   DCHECK_EQ(top_handle_scope, this);
-  while (current_scope_ != nullptr) {
-    LocalScopeType* next = reinterpret_cast<LocalScopeType*>(current_scope_->GetLink());
-    delete current_scope_;
-    current_scope_ = next;
+  // The more recent scopes have been destroyed and released their part of the arena.
+  HandleArena* const arena = self_->GetHandleArena();
+  DCHECK(arena->IsAt(arena_top_));
+  arena->Reset(arena_mark_);
+  for (LocalScopeType* scope : heap_scopes_) {
+    delete scope;
   }
 }
 
@@ -18,12 +18,14 @@
 #define ART_RUNTIME_HANDLE_SCOPE_H_
 
 #include <stack>
+#include <vector>
 
 #include "base/enums.h"
 #include "base/logging.h"
 #include "base/macros.h"
 #include "base/mutex.h"
 #include "handle.h"
+#include "handle_arena.h"
 #include "stack_reference.h"
 #include "verify_object.h"
 
@@ -278,6 +280,10 @@ class PACKED(4) StackHandleScope FINAL : public FixedSizeHandleScope<kNumReferen
 // Calls to NewHandle will create a new handle inside the current FixedSizeHandleScope.
 // When the current handle scope becomes full a new one is created and put at the front of the
 // list.
+// The fixed size handle scopes are allocated from the HandleArena of the thread, and released
+// all at once when the variable sized handle scope is destroyed. If a variable sized handle scope
+// grows while a more recent one is alive, the new fixed size handle scope is allocated with new
+// instead.
 class VariableSizedHandleScope : public BaseHandleScope {
  public:
   explicit VariableSizedHandleScope(Thread* const self);
@@ -308,13 +314,24 @@ class VariableSizedHandleScope : public BaseHandleScope {
   static constexpr size_t kNumReferencesPerScope =
       kSizeOfReferencesPerScope / sizeof(StackReference<mirror::Object>);
 
+  using LocalScopeType = FixedSizeHandleScope<kNumReferencesPerScope>;
+  static_assert(sizeof(LocalScopeType) == kLocalScopeSize, "Unexpected size of LocalScopeType");
+
+  ALWAYS_INLINE LocalScopeType* NewLocalScope(LocalScopeType* link);
+
   Thread* const self_;
 
+  // Position of the thread's handle arena when this scope was created.
+  const HandleArena::Mark arena_mark_;
+  // Position of the thread's handle arena after the last allocation of this scope.
+  HandleArena::Mark arena_top_;
+
   // Linked list of fixed size handle scopes.
-  using LocalScopeType = FixedSizeHandleScope<kNumReferencesPerScope>;
-  static_assert(sizeof(LocalScopeType) == kLocalScopeSize, "Unexpected size of LocalScopeType");
   LocalScopeType* current_scope_;
 
+  // The fixed size handle scopes that are not in the arena.
+  std::vector<LocalScopeType*> heap_scopes_;
+
   DISALLOW_COPY_AND_ASSIGN(VariableSizedHandleScope);
 };
 
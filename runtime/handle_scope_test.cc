@@ -17,6 +17,7 @@
 #include <type_traits>
 
 #include "base/enums.h"
+#include "base/time_utils.h"
 #include "class_linker-inl.h"
 #include "common_runtime_test.h"
 #include "gtest/gtest.h"
@@ -119,4 +120,95 @@ TEST_F(HandleScopeTest, VariableSized) {
   }
 }
 
+// Test that nested variable sized handle scopes share the arena of the thread, including when the
+// outer scope grows while the inner one is alive.
+TEST_F(HandleScopeTest, VariableSizedNested) {
+  ScopedObjectAccess soa(Thread::Current());
+  HandleArena* arena = soa.Self()->GetHandleArena();
+  const HandleArena::Mark mark = arena->GetMark();
+  ClassLinker* const class_linker = Runtime::Current()->GetClassLinker();
+  static const size_t kNumHandles = 100;
+  {
+    VariableSizedHandleScope outer(soa.Self());
+    Handle<mirror::Class> c =
+        outer.NewHandle(class_linker->FindSystemClass(soa.Self(), "Ljava/lang/Object;"));
+    EXPECT_FALSE(arena->IsAt(mark));
+    std::vector<Handle<mirror::Object>> outer_handles;
+    std::vector<Handle<mirror::Object>> inner_handles;
+    {
+      VariableSizedHandleScope inner(soa.Self());
+      for (size_t i = 0; i < kNumHandles; ++i) {
+        inner_handles.push_back(inner.NewHandle(c->AllocObject(soa.Self())));
+        outer_handles.push_back(outer.NewHandle(c->AllocObject(soa.Self())));
+      }
+      for (size_t i = 0; i < kNumHandles; ++i) {
+        EXPECT_TRUE(inner.Contains(inner_handles[i].GetReference()));
+        EXPECT_FALSE(inner.Contains(outer_handles[i].GetReference()));
+        EXPECT_TRUE(outer.Contains(outer_handles[i].GetReference()));
+        EXPECT_FALSE(outer.Contains(inner_handles[i].GetReference()));
+      }
+      EXPECT_GE(inner.NumberOfReferences(), kNumHandles);
+      EXPECT_GE(outer.NumberOfReferences(), kNumHandles + 1);
+    }
+    // The outer scope can use the arena again.
+    const HandleArena::Mark outer_top = arena->GetMark();
+    for (size_t i = 0; i < kNumHandles; ++i) {
+      outer_handles.push_back(outer.NewHandle(c->AllocObject(soa.Self())));
+    }
+    EXPECT_FALSE(arena->IsAt(outer_top));
+    CollectVisitor visitor;
+    outer.VisitRoots(visitor);
+    EXPECT_EQ(2 * kNumHandles + 1, visitor.visited.size());
+    for (Handle<mirror::Object> h : outer_handles) {
+      EXPECT_TRUE(outer.Contains(h.GetReference()));
+      EXPECT_TRUE(soa.Self()->HandleScopeContains(reinterpret_cast<jobject>(h.GetReference())));
+    }
+  }
+  EXPECT_TRUE(arena->IsAt(mark));
+}
+
+// Measures the cost of a variable sized handle scope with a few handles, which used to allocate
+// its storage with new, against a stack handle scope.
+TEST_F(HandleScopeTest, VariableSizedPerformance) {
+  static constexpr size_t kIterations = 100000;
+  static constexpr size_t kNumHandles = 20;
+  ScopedObjectAccess soa(Thread::Current());
+  HandleArena* arena = soa.Self()->GetHandleArena();
+  ObjPtr<mirror::Class> c =
+      Runtime::Current()->GetClassLinker()->FindSystemClass(soa.Self(), "Ljava/lang/Object;");
+
+  // Warm up the arena.
+  {
+    VariableSizedHandleScope hs(soa.Self());
+    for (size_t j = 0; j < kNumHandles; ++j) {
+      hs.NewHandle(c);
+    }
+  }
+  const size_t capacity = arena->GetCapacity();
+
+  uint64_t start_ns = NanoTime();
+  for (size_t i = 0; i < kIterations; ++i) {
+    VariableSizedHandleScope hs(soa.Self());
+    for (size_t j = 0; j < kNumHandles; ++j) {
+      hs.NewHandle(c);
+    }
+  }
+  const uint64_t variable_sized_ns = NanoTime() - start_ns;
+  // The arena does not grow once it is large enough.
+  EXPECT_EQ(capacity, arena->GetCapacity());
+
+  start_ns = NanoTime();
+  for (size_t i = 0; i < kIterations; ++i) {
+    StackHandleScope<kNumHandles> hs(soa.Self());
+    for (size_t j = 0; j < kNumHandles; ++j) {
+      hs.NewHandle(c);
+    }
+  }
+  const uint64_t stack_ns = NanoTime() - start_ns;
+
+  LOG(INFO) << "Handle scope with " << kNumHandles << " handles: variable sized "
+            << PrettyDuration(variable_sized_ns / kIterations) << ", on the stack "
+            << PrettyDuration(stack_ns / kIterations);
+}
+
 }  // namespace art
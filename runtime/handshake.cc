@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "handshake.h"
+
+#include "base/logging.h"
+#include "runtime.h"
+#include "scoped_thread_state_change-inl.h"
+#include "thread-inl.h"
+#include "thread_list.h"
+
+namespace art {
+
+Handshake::Handshake(Closure* closure)
+    : closure_(closure),
+      handshake_closure_(this),
+      lock_("handshake lock", kThreadSuspendCountLock),
+      complete_cond_("handshake complete condition", lock_),
+      pending_(0) {
+}
+
+Handshake::~Handshake() {
+  MutexLock mu(Thread::Current(), lock_);
+  CHECK_EQ(pending_, 0) << "Destroying a handshake with outstanding requests";
+}
+
+void Handshake::HandshakeClosure::Run(Thread* thread) {
+  handshake_->closure_->Run(thread);
+  // Note thread and self may not be equal if thread was already suspended at the point of the
+  // request.
+  handshake_->Complete(Thread::Current());
+}
+
+bool Handshake::StartWithThread(Thread* self, uint32_t thread_id) {
+  size_t count =
+      Runtime::Current()->GetThreadList()->RunCheckpointOnThread(&handshake_closure_, thread_id);
+  AddRequests(self, count);
+  return count != 0;
+}
+
+size_t Handshake::StartWithAllThreads(Thread* self) {
+  size_t count = Runtime::Current()->GetThreadList()->RunCheckpoint(&handshake_closure_);
+  AddRequests(self, count);
+  return count;
+}
+
+bool Handshake::IsComplete(Thread* self) {
+  MutexLock mu(self, lock_);
+  return pending_ == 0;
+}
+
+void Handshake::Wait(Thread* self) {
+  if (self->GetState() == kRunnable) {
+    ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
+    Wait(self);
+    return;
+  }
+  MutexLock mu(self, lock_);
+  while (pending_ != 0) {
+    complete_cond_.Wait(self);
+  }
+}
+
+void Handshake::AddRequests(Thread* self, size_t count) {
+  MutexLock mu(self, lock_);
+  pending_ += count;
+  if (pending_ == 0) {
+    complete_cond_.Broadcast(self);
+  }
+}
+
+void Handshake::Complete(Thread* self) {
+  MutexLock mu(self, lock_);
+  --pending_;
+  if (pending_ == 0) {
+    complete_cond_.Broadcast(self);
+  }
+}
+
+}  // namespace art
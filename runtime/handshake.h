@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_HANDSHAKE_H_
+#define ART_RUNTIME_HANDSHAKE_H_
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "thread_pool.h"
+
+namespace art {
+
+class Thread;
+
+// A handshake runs a closure on some threads without stopping the world. Runnable threads run it
+// at their next suspend point, suspended threads have it run on their behalf by the requester
+// while they are kept suspended. Unlike with SuspendAll, threads never wait for each other. Unlike
+// with a bare ThreadList::RunCheckpoint, the requester tracks completion itself and can keep
+// working until it needs the result.
+//
+// The closure may run on several threads at the same time. The handshake must outlive the
+// requests, Wait() for them before destroying it.
+class Handshake {
+ public:
+  explicit Handshake(Closure* closure);
+  ~Handshake();
+
+  // Requests the closure on the thread with the given id. Returns false if there is no such
+  // thread. Runs the closure right away if the thread is self or suspended.
+  bool StartWithThread(Thread* self, uint32_t thread_id)
+      REQUIRES(!Locks::thread_list_lock_, !Locks::thread_suspend_count_lock_, !lock_);
+
+  // Requests the closure on all threads, including self. Returns the number of threads.
+  size_t StartWithAllThreads(Thread* self)
+      REQUIRES(!Locks::thread_list_lock_, !Locks::thread_suspend_count_lock_, !lock_);
+
+  // Returns whether all the requested threads ran the closure.
+  bool IsComplete(Thread* self) REQUIRES(!lock_);
+
+  // Waits until all the requested threads ran the closure. Waits in the
+  // kWaitingForCheckPointsToRun state if self is runnable, so that a GC may run meanwhile.
+  void Wait(Thread* self) REQUIRES(!lock_);
+
+ private:
+  class HandshakeClosure FINAL : public Closure {
+   public:
+    explicit HandshakeClosure(Handshake* handshake) : handshake_(handshake) {}
+
+    void Run(Thread* thread) OVERRIDE;
+
+   private:
+    Handshake* const handshake_;
+  };
+
+  void AddRequests(Thread* self, size_t count) REQUIRES(!lock_);
+  void Complete(Thread* self) REQUIRES(!lock_);
+
+  Closure* const closure_;
+  HandshakeClosure handshake_closure_;
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  ConditionVariable complete_cond_ GUARDED_BY(lock_);
+  // Requests not completed yet. Closures may complete before the requester added them, so this
+  // may be negative while a Start method runs.
+  int64_t pending_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(Handshake);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_HANDSHAKE_H_
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "handshake.h"
+
+#include "atomic.h"
+#include "base/time_utils.h"
+#include "common_runtime_test.h"
+#include "scoped_thread_state_change-inl.h"
+#include "thread-inl.h"
+#include "thread_list.h"
+#include "thread_pool.h"
+
+namespace art {
+
+class CountingClosure : public Closure {
+ public:
+  CountingClosure() : count_(0) {}
+
+  void Run(Thread* thread ATTRIBUTE_UNUSED) OVERRIDE {
+    ++count_;
+  }
+
+  int32_t GetCount() const {
+    return count_.LoadSequentiallyConsistent();
+  }
+
+ private:
+  AtomicInteger count_;
+};
+
+// Keeps a pool thread runnable, spinning through suspend points, until told to stop.
+class SpinTask : public Task {
+ public:
+  explicit SpinTask(AtomicInteger* stop) : stop_(stop) {}
+
+  void Run(Thread* self) OVERRIDE {
+    ScopedObjectAccess soa(self);
+    while (stop_->LoadSequentiallyConsistent() == 0) {
+      self->AllowThreadSuspension();
+    }
+  }
+
+  void Finalize() OVERRIDE {
+    delete this;
+  }
+
+ private:
+  AtomicInteger* const stop_;
+};
+
+class HandshakeTest : public CommonRuntimeTest {
+ protected:
+  static constexpr size_t kNumThreads = 4;
+};
+
+TEST_F(HandshakeTest, SingleThread) {
+  Thread* self = Thread::Current();
+  ThreadPool thread_pool("Handshake test thread pool", kNumThreads);
+  AtomicInteger stop(0);
+  for (size_t i = 0; i < kNumThreads; ++i) {
+    thread_pool.AddTask(self, new SpinTask(&stop));
+  }
+  thread_pool.StartWorkers(self);
+
+  CountingClosure closure;
+  {
+    Handshake handshake(&closure);
+    uint32_t thread_id = thread_pool.GetWorkers()[0]->GetThread()->GetThreadId();
+    EXPECT_TRUE(handshake.StartWithThread(self, thread_id));
+    handshake.Wait(self);
+    EXPECT_TRUE(handshake.IsComplete(self));
+  }
+  EXPECT_EQ(1, closure.GetCount());
+
+  // A thread id nobody has gives no request.
+  {
+    Handshake handshake(&closure);
+    EXPECT_FALSE(handshake.StartWithThread(self, ThreadList::kMaxThreadId - 1));
+    EXPECT_TRUE(handshake.IsComplete(self));
+  }
+  EXPECT_EQ(1, closure.GetCount());
+
+  stop.StoreSequentiallyConsistent(1);
+  thread_pool.Wait(self, true, false);
+}
+
+TEST_F(HandshakeTest, AllThreads) {
+  Thread* self = Thread::Current();
+  ThreadPool thread_pool("Handshake test thread pool", kNumThreads);
+  AtomicInteger stop(0);
+  // Leave one worker idle in the pool so that both runnable and suspended threads are covered.
+  for (size_t i = 0; i < kNumThreads - 1; ++i) {
+    thread_pool.AddTask(self, new SpinTask(&stop));
+  }
+  thread_pool.StartWorkers(self);
+
+  CountingClosure closure;
+  Handshake handshake(&closure);
+  size_t count;
+  {
+    ScopedObjectAccess soa(self);
+    count = handshake.StartWithAllThreads(self);
+    // Self runs the closure right away.
+    EXPECT_GE(closure.GetCount(), 1);
+  }
+  EXPECT_GE(count, kNumThreads + 1);
+  handshake.Wait(self);
+  EXPECT_EQ(static_cast<int32_t>(count), closure.GetCount());
+
+  stop.StoreSequentiallyConsistent(1);
+  thread_pool.Wait(self, true, false);
+}
+
+// Compares the pause of a global suspension with a handshake on a single thread while many
+// threads are running.
+TEST_F(HandshakeTest, PauseWithManyThreads) {
+  static constexpr size_t kManyThreads = 32;
+  static constexpr size_t kIterations = 100;
+  Thread* self = Thread::Current();
+  ThreadPool thread_pool("Handshake test thread pool", kManyThreads);
+  AtomicInteger stop(0);
+  for (size_t i = 0; i < kManyThreads; ++i) {
+    thread_pool.AddTask(self, new SpinTask(&stop));
+  }
+  thread_pool.StartWorkers(self);
+
+  uint64_t start_ns = NanoTime();
+  for (size_t i = 0; i < kIterations; ++i) {
+    ScopedSuspendAll ssa(__FUNCTION__);
+  }
+  uint64_t suspend_all_ns = NanoTime() - start_ns;
+
+  CountingClosure closure;
+  uint32_t thread_id = thread_pool.GetWorkers()[0]->GetThread()->GetThreadId();
+  start_ns = NanoTime();
+  for (size_t i = 0; i < kIterations; ++i) {
+    Handshake handshake(&closure);
+    EXPECT_TRUE(handshake.StartWithThread(self, thread_id));
+    handshake.Wait(self);
+  }
+  uint64_t handshake_ns = NanoTime() - start_ns;
+  EXPECT_EQ(static_cast<int32_t>(kIterations), closure.GetCount());
+
+  LOG(INFO) << "With " << kManyThreads << " running threads: SuspendAll "
+            << PrettyDuration(suspend_all_ns / kIterations) << ", single thread handshake "
+            << PrettyDuration(handshake_ns / kIterations);
+
+  stop.StoreSequentiallyConsistent(1);
+  thread_pool.Wait(self, true, false);
+}
+
+}  // namespace art
@@ -27,6 +27,7 @@
 #include "thread.h"
 #include "utils.h"
 
+#include <algorithm>
 #include <cstdlib>
 
 namespace art {
@@ -34,6 +35,9 @@ namespace art {
 static constexpr bool kDumpStackOnNonLocalReference = false;
 static constexpr bool kDebugIRT = false;
 
+// Stale free list entries tolerated on top of twice the hole count before compacting the list.
+static constexpr size_t kFreeListSlack = 16;
+
 const char* GetIndirectRefKindString(const IndirectRefKind& kind) {
   switch (kind) {
     case kHandleScopeOrInvalid:
@@ -64,25 +68,19 @@ IndirectReferenceTable::IndirectReferenceTable(size_t max_count,
                                                ResizableCapacity resizable,
                                                std::string* error_msg)
     : segment_state_(kIRTFirstSegment),
+      chunks_(),
+      num_chunks_(0),
+      first_chunk_shift_(WhichPowerOf2(RoundUpToPowerOfTwo(std::max<size_t>(max_count, 1u)))),
+      allocated_entries_(0),
       kind_(desired_kind),
-      max_entries_(max_count),
+      max_entries_(resizable == ResizableCapacity::kYes ? kMaxTableEntries : max_count),
       current_num_holes_(0),
       resizable_(resizable) {
   CHECK(error_msg != nullptr);
   CHECK_NE(desired_kind, kHandleScopeOrInvalid);
+  CHECK_LE(max_count, kMaxTableEntries);
 
-  const size_t table_bytes = max_count * sizeof(IrtEntry);
-  table_mem_map_.reset(MemMap::MapAnonymous("indirect ref table", nullptr, table_bytes,
-                                            PROT_READ | PROT_WRITE, false, false, error_msg));
-  if (table_mem_map_.get() == nullptr && error_msg->empty()) {
-    *error_msg = "Unable to map memory for indirect ref table";
-  }
-
-  if (table_mem_map_.get() != nullptr) {
-    table_ = reinterpret_cast<IrtEntry*>(table_mem_map_->Begin());
-  } else {
-    table_ = nullptr;
-  }
+  AddChunk(error_msg);
   segment_state_ = kIRTFirstSegment;
   last_known_previous_state_ = kIRTFirstSegment;
 }
@@ -119,16 +117,17 @@ void IndirectReferenceTable::ConstexprChecks() {
 }
 
 bool IndirectReferenceTable::IsValid() const {
-  return table_mem_map_.get() != nullptr;
+  return num_chunks_ != 0;
 }
 
 // Holes:
 //
 // To keep the IRT compact, we want to fill "holes" created by non-stack-discipline Add & Remove
-// operation sequences. For simplicity and lower memory overhead, we do not use a free list or
-// similar. Instead, we scan for holes, with the expectation that we will find holes fast as they
-// are usually near the end of the table (see the header, TODO: verify this assumption). To avoid
-// scans when there are no holes, the number of known holes should be tracked.
+// operation sequences. Remove pushes the index of every hole it creates onto a free list, and Add
+// pops from it. The list is not updated when holes go away otherwise (eaten when the top entry is
+// removed, or dropped with a popped segment), so Add skips the entries that are not holes of the
+// current segment any more, and Remove compacts the list when it is mostly stale. To avoid looking
+// at the list when there are no holes, the number of known holes should be tracked.
 //
 // A previous implementation stored the top index and the number of holes as the segment state.
 // This constraints the maximum number of references to 16-bit. We want to relax this, as it
@@ -157,10 +156,14 @@ bool IndirectReferenceTable::IsValid() const {
 // equal to the current previous state, and smaller than the current state (top index). The
 // condition is conservative as it adds O(1) overhead to operations on an empty segment.
 
-static size_t CountNullEntries(const IrtEntry* table, size_t from, size_t to) {
+//
+// The free list belongs to the current segment as well, so it is rebuilt whenever the holes are
+// recovered.
+
+size_t IndirectReferenceTable::CountNullEntries(size_t from, size_t to) const {
   size_t count = 0;
   for (size_t index = from; index != to; ++index) {
-    if (table[index].GetReference()->IsNull()) {
+    if (GetEntry(index)->GetReference()->IsNull()) {
       count++;
     }
   }
@@ -171,7 +174,13 @@ void IndirectReferenceTable::RecoverHoles(IRTSegmentState prev_state) {
   if (last_known_previous_state_.top_index >= segment_state_.top_index ||
       last_known_previous_state_.top_index < prev_state.top_index) {
     const size_t top_index = segment_state_.top_index;
-    size_t count = CountNullEntries(table_, prev_state.top_index, top_index);
+    free_list_.clear();
+    for (size_t index = prev_state.top_index; index != top_index; ++index) {
+      if (GetEntry(index)->GetReference()->IsNull()) {
+        free_list_.push_back(index);
+      }
+    }
+    size_t count = free_list_.size();
 
     if (kDebugIRT) {
       LOG(INFO) << "+++ Recovered holes: "
@@ -189,37 +198,74 @@ void IndirectReferenceTable::RecoverHoles(IRTSegmentState prev_state) {
 }
 
 ALWAYS_INLINE
-static inline void CheckHoleCount(IrtEntry* table,
-                                  size_t exp_num_holes,
-                                  IRTSegmentState prev_state,
-                                  IRTSegmentState cur_state) {
+inline void IndirectReferenceTable::CheckHoleCount(IRTSegmentState prev_state) const {
   if (kIsDebugBuild) {
-    size_t count = CountNullEntries(table, prev_state.top_index, cur_state.top_index);
-    CHECK_EQ(exp_num_holes, count) << "prevState=" << prev_state.top_index
-                                   << " topIndex=" << cur_state.top_index;
+    const IRTSegmentState cur_state = segment_state_;
+    size_t count = CountNullEntries(prev_state.top_index, cur_state.top_index);
+    CHECK_EQ(current_num_holes_, count) << "prevState=" << prev_state.top_index
+                                        << " topIndex=" << cur_state.top_index;
   }
 }
 
-bool IndirectReferenceTable::Resize(size_t new_size, std::string* error_msg) {
-  CHECK_GT(new_size, max_entries_);
+void IndirectReferenceTable::CompactFreeList(IRTSegmentState prev_state) {
+  const uint32_t bottom_index = prev_state.top_index;
+  const uint32_t top_index = segment_state_.top_index;
+  std::sort(free_list_.begin(), free_list_.end());
+  auto last = std::unique(free_list_.begin(), free_list_.end());
+  last = std::remove_if(free_list_.begin(), last, [&](uint32_t index) {
+    return index < bottom_index ||
+           index >= top_index ||
+           !GetEntry(index)->GetReference()->IsNull();
+  });
+  free_list_.erase(last, free_list_.end());
+  DCHECK_EQ(free_list_.size(), current_num_holes_);
+}
+
+bool IndirectReferenceTable::AddChunk(std::string* error_msg) {
+  CHECK_LT(num_chunks_, kMaxChunks);
+  CHECK_LT(allocated_entries_, max_entries_);
 
-  const size_t table_bytes = new_size * sizeof(IrtEntry);
+  const size_t chunk_entries = static_cast<size_t>(1u) << (first_chunk_shift_ + num_chunks_);
+  const size_t chunk_bytes = chunk_entries * sizeof(IrtEntry);
   std::unique_ptr<MemMap> new_map(MemMap::MapAnonymous("indirect ref table",
                                                        nullptr,
-                                                       table_bytes,
+                                                       chunk_bytes,
                                                        PROT_READ | PROT_WRITE,
                                                        false,
                                                        false,
                                                        error_msg));
   if (new_map == nullptr) {
+    if (error_msg->empty()) {
+      *error_msg = "Unable to map memory for indirect ref table";
+    }
     return false;
   }
 
-  memcpy(new_map->Begin(), table_mem_map_->Begin(), table_mem_map_->Size());
-  table_mem_map_ = std::move(new_map);
-  table_ = reinterpret_cast<IrtEntry*>(table_mem_map_->Begin());
-  max_entries_ = new_size;
+  // The entries of the new chunk are only reachable through indexes above the current top, so
+  // lock-free readers of the table never see the chunk before it is published.
+  chunks_[num_chunks_] = reinterpret_cast<IrtEntry*>(new_map->Begin());
+  chunk_maps_[num_chunks_] = std::move(new_map);
+  ++num_chunks_;
+  allocated_entries_ += chunk_entries;
+  return true;
+}
 
+bool IndirectReferenceTable::EnsureFreeCapacity(size_t free_capacity, std::string* error_msg) {
+  const size_t top_index = segment_state_.top_index;
+  if (free_capacity > max_entries_ - top_index) {
+    *error_msg = android::base::StringPrintf("Requested size exceeds maximum: %zu > %zu",
+                                             free_capacity,
+                                             max_entries_ - top_index);
+    return false;
+  }
+  if (resizable_ == ResizableCapacity::kNo) {
+    return true;
+  }
+  while (top_index + free_capacity > allocated_entries_) {
+    if (!AddChunk(error_msg)) {
+      return false;
+    }
+  }
   return true;
 }
 
@@ -236,53 +282,49 @@ IndirectRef IndirectReferenceTable::Add(IRTSegmentState previous_state,
 
   CHECK(obj != nullptr);
   VerifyObject(obj);
-  DCHECK(table_ != nullptr);
+  DCHECK(IsValid());
 
   if (top_index == max_entries_) {
-    if (resizable_ == ResizableCapacity::kNo) {
-      LOG(FATAL) << "JNI ERROR (app bug): " << kind_ << " table overflow "
-                 << "(max=" << max_entries_ << ")\n"
-                 << MutatorLockedDumpable<IndirectReferenceTable>(*this);
-      UNREACHABLE();
-    }
-
-    // Try to double space.
-    std::string error_msg;
-    if (!Resize(max_entries_ * 2, &error_msg)) {
-      LOG(FATAL) << "JNI ERROR (app bug): " << kind_ << " table overflow "
-                 << "(max=" << max_entries_ << ")" << std::endl
-                 << MutatorLockedDumpable<IndirectReferenceTable>(*this)
-                 << " Resizing failed: " << error_msg;
-      UNREACHABLE();
-    }
+    LOG(FATAL) << "JNI ERROR (app bug): " << kind_ << " table overflow "
+               << "(max=" << max_entries_ << ")\n"
+               << MutatorLockedDumpable<IndirectReferenceTable>(*this);
+    UNREACHABLE();
   }
 
   RecoverHoles(previous_state);
-  CheckHoleCount(table_, current_num_holes_, previous_state, segment_state_);
+  CheckHoleCount(previous_state);
 
-  // We know there's enough room in the table.  Now we just need to find
-  // the right spot.  If there's a hole, find it and fill it; otherwise,
-  // add to the end of the list.
+  // If there's a hole, fill it; otherwise, add to the end of the list.
   IndirectRef result;
   size_t index;
   if (current_num_holes_ > 0) {
     DCHECK_GT(top_index, 1U);
-    // Find the first hole; likely to be near the end of the list.
-    IrtEntry* p_scan = &table_[top_index - 1];
-    DCHECK(!p_scan->GetReference()->IsNull());
-    --p_scan;
-    while (!p_scan->GetReference()->IsNull()) {
-      DCHECK_GE(p_scan, table_ + previous_state.top_index);
-      --p_scan;
-    }
-    index = p_scan - table_;
+    // Pop the first index that is still a hole of this segment.
+    do {
+      DCHECK(!free_list_.empty());
+      index = free_list_.back();
+      free_list_.pop_back();
+    } while (index < previous_state.top_index ||
+             index >= top_index ||
+             !GetEntry(index)->GetReference()->IsNull());
     current_num_holes_--;
   } else {
+    if (top_index == allocated_entries_) {
+      // Map the next chunk. The entries in use stay where they are.
+      std::string error_msg;
+      if (!AddChunk(&error_msg)) {
+        LOG(FATAL) << "JNI ERROR (app bug): " << kind_ << " table overflow "
+                   << "(max=" << max_entries_ << ")" << std::endl
+                   << MutatorLockedDumpable<IndirectReferenceTable>(*this)
+                   << " Resizing failed: " << error_msg;
+        UNREACHABLE();
+      }
+    }
     // Add to the end.
     index = top_index++;
     segment_state_.top_index = top_index;
   }
-  table_[index].Add(obj);
+  GetEntry(index)->Add(obj);
   result = ToIndirectRef(index);
   if (kDebugIRT) {
     LOG(INFO) << "+++ added at " << ExtractIndex(result) << " top=" << segment_state_.top_index
@@ -295,7 +337,7 @@ IndirectRef IndirectReferenceTable::Add(IRTSegmentState previous_state,
 
 void IndirectReferenceTable::AssertEmpty() {
   for (size_t i = 0; i < Capacity(); ++i) {
-    if (!table_[i].GetReference()->IsNull()) {
+    if (!GetEntry(i)->GetReference()->IsNull()) {
       LOG(FATAL) << "Internal Error: non-empty local reference table\n"
                  << MutatorLockedDumpable<IndirectReferenceTable>(*this);
       UNREACHABLE();
@@ -322,7 +364,7 @@ bool IndirectReferenceTable::Remove(IRTSegmentState previous_state, IndirectRef
   const uint32_t top_index = segment_state_.top_index;
   const uint32_t bottom_index = previous_state.top_index;
 
-  DCHECK(table_ != nullptr);
+  DCHECK(IsValid());
 
   if (GetIndirectRefKind(iref) == kHandleScopeOrInvalid) {
     auto* self = Thread::Current();
@@ -354,7 +396,7 @@ bool IndirectReferenceTable::Remove(IRTSegmentState previous_state, IndirectRef
   }
 
   RecoverHoles(previous_state);
-  CheckHoleCount(table_, current_num_holes_, previous_state, segment_state_);
+  CheckHoleCount(previous_state);
 
   if (idx == top_index - 1) {
     // Top-most entry.  Scan up and consume holes.
@@ -363,7 +405,7 @@ bool IndirectReferenceTable::Remove(IRTSegmentState previous_state, IndirectRef
       return false;
     }
 
-    *table_[idx].GetReference() = GcRoot<mirror::Object>(nullptr);
+    *GetEntry(idx)->GetReference() = GcRoot<mirror::Object>(nullptr);
     if (current_num_holes_ != 0) {
       uint32_t collapse_top_index = top_index;
       while (--collapse_top_index > bottom_index && current_num_holes_ != 0) {
@@ -371,9 +413,10 @@ bool IndirectReferenceTable::Remove(IRTSegmentState previous_state, IndirectRef
           ScopedObjectAccess soa(Thread::Current());
           LOG(INFO) << "+++ checking for hole at " << collapse_top_index - 1
                     << " (previous_state=" << bottom_index << ") val="
-                    << table_[collapse_top_index - 1].GetReference()->Read<kWithoutReadBarrier>();
+                    << GetEntry(collapse_top_index - 1)->GetReference()->Read<
+                           kWithoutReadBarrier>();
         }
-        if (!table_[collapse_top_index - 1].GetReference()->IsNull()) {
+        if (!GetEntry(collapse_top_index - 1)->GetReference()->IsNull()) {
           break;
         }
         if (kDebugIRT) {
@@ -382,8 +425,13 @@ bool IndirectReferenceTable::Remove(IRTSegmentState previous_state, IndirectRef
         current_num_holes_--;
       }
       segment_state_.top_index = collapse_top_index;
+      if (current_num_holes_ == 0) {
+        free_list_.clear();
+      } else if (free_list_.size() > 2 * current_num_holes_ + kFreeListSlack) {
+        CompactFreeList(previous_state);
+      }
 
-      CheckHoleCount(table_, current_num_holes_, previous_state, segment_state_);
+      CheckHoleCount(previous_state);
     } else {
       segment_state_.top_index = top_index - 1;
       if (kDebugIRT) {
@@ -393,7 +441,7 @@ bool IndirectReferenceTable::Remove(IRTSegmentState previous_state, IndirectRef
   } else {
     // Not the top-most entry.  This creates a hole.  We null out the entry to prevent somebody
     // from deleting it twice and screwing up the hole count.
-    if (table_[idx].GetReference()->IsNull()) {
+    if (GetEntry(idx)->GetReference()->IsNull()) {
       LOG(INFO) << "--- WEIRD: removing null entry " << idx;
       return false;
     }
@@ -401,9 +449,10 @@ bool IndirectReferenceTable::Remove(IRTSegmentState previous_state, IndirectRef
       return false;
     }
 
-    *table_[idx].GetReference() = GcRoot<mirror::Object>(nullptr);
+    *GetEntry(idx)->GetReference() = GcRoot<mirror::Object>(nullptr);
     current_num_holes_++;
-    CheckHoleCount(table_, current_num_holes_, previous_state, segment_state_);
+    free_list_.push_back(idx);
+    CheckHoleCount(previous_state);
     if (kDebugIRT) {
       LOG(INFO) << "+++ left hole at " << idx << ", holes=" << current_num_holes_;
     }
@@ -415,18 +464,38 @@ bool IndirectReferenceTable::Remove(IRTSegmentState previous_state, IndirectRef
 void IndirectReferenceTable::Trim() {
   ScopedTrace trace(__PRETTY_FUNCTION__);
   const size_t top_index = Capacity();
-  auto* release_start = AlignUp(reinterpret_cast<uint8_t*>(&table_[top_index]), kPageSize);
-  uint8_t* release_end = table_mem_map_->End();
-  madvise(release_start, release_end - release_start, MADV_DONTNEED);
+  size_t chunk_begin = 0;
+  for (size_t chunk = 0; chunk != num_chunks_; ++chunk) {
+    const size_t chunk_entries = static_cast<size_t>(1u) << (first_chunk_shift_ + chunk);
+    const size_t used_entries =
+        (top_index > chunk_begin) ? std::min(chunk_entries, top_index - chunk_begin) : 0u;
+    auto* release_start = AlignUp(reinterpret_cast<uint8_t*>(&chunks_[chunk][used_entries]),
+                                  kPageSize);
+    uint8_t* release_end = chunk_maps_[chunk]->End();
+    if (release_start < release_end) {
+      madvise(release_start, release_end - release_start, MADV_DONTNEED);
+    }
+    chunk_begin += chunk_entries;
+  }
 }
 
 void IndirectReferenceTable::VisitRoots(RootVisitor* visitor, const RootInfo& root_info) {
   BufferedRootVisitor<kDefaultBufferedRootCount> root_visitor(visitor, root_info);
-  for (auto ref : *this) {
-    if (!ref->IsNull()) {
-      root_visitor.VisitRoot(*ref);
-      DCHECK(!ref->IsNull());
+  // Walk the chunks directly rather than looking up every index.
+  const size_t top_index = Capacity();
+  size_t chunk_begin = 0;
+  for (size_t chunk = 0; chunk_begin < top_index; ++chunk) {
+    DCHECK_LT(chunk, num_chunks_);
+    const size_t chunk_entries = static_cast<size_t>(1u) << (first_chunk_shift_ + chunk);
+    const size_t used_entries = std::min(chunk_entries, top_index - chunk_begin);
+    for (size_t i = 0; i != used_entries; ++i) {
+      GcRoot<mirror::Object>* ref = chunks_[chunk][i].GetReference();
+      if (!ref->IsNull()) {
+        root_visitor.VisitRoot(*ref);
+        DCHECK(!ref->IsNull());
+      }
     }
+    chunk_begin += chunk_entries;
   }
 }
 
@@ -434,9 +503,9 @@ void IndirectReferenceTable::Dump(std::ostream& os) const {
   os << kind_ << " table dump:\n";
   ReferenceTable::Table entries;
   for (size_t i = 0; i < Capacity(); ++i) {
-    ObjPtr<mirror::Object> obj = table_[i].GetReference()->Read<kWithoutReadBarrier>();
+    ObjPtr<mirror::Object> obj = GetEntry(i)->GetReference()->Read<kWithoutReadBarrier>();
     if (obj != nullptr) {
-      obj = table_[i].GetReference()->Read();
+      obj = GetEntry(i)->GetReference()->Read();
       entries.push_back(GcRoot<mirror::Object>(obj));
     }
   }
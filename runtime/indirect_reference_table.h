@@ -21,7 +21,9 @@
 
 #include <iosfwd>
 #include <limits>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "base/bit_utils.h"
 #include "base/logging.h"
@@ -108,7 +110,8 @@ const char* GetIndirectRefKindString(const IndirectRefKind& kind);
 //
 // If we delete entries from the middle of the list, we will be left with "holes".  We track the
 // number of holes so that, when adding new elements, we can quickly decide to do a trivial append
-// or go slot-hunting.
+// or reuse a hole. The holes of the current segment are also kept in a free list, so reusing one
+// doesn't need a scan.
 //
 // When the top-most entry is removed, any holes immediately below it are also removed. Thus,
 // deletion of an entry may reduce "top_index" by more than one.
@@ -133,8 +136,10 @@ const char* GetIndirectRefKindString(const IndirectRefKind& kind);
 // detect stale references aren't possible (though we may be able to get similar benefits with other
 // approaches).
 //
-// TODO: consider a "lastDeleteIndex" for quick hole-filling when an add immediately follows a
-// delete; must invalidate after segment pop might be worth only using it for JNI globals.
+// The entries are stored in separately mapped chunks, chunk k holding twice as many entries as
+// chunk k - 1, so the chunk of an index is found with a bit scan. A growing table maps a new chunk
+// and never moves the existing entries, which lets global references be read without a lock while
+// another thread adds to the table.
 //
 // TODO: may want completely different add/remove algorithms for global and local refs to improve
 // performance.  A large circular buffer might reduce the amortized cost of adding global
@@ -182,9 +187,12 @@ static_assert(sizeof(IrtEntry) == (1 + kIRTPrevCount) * sizeof(uint32_t),
               "Unexpected sizeof(IrtEntry)");
 static_assert(IsPowerOfTwo(sizeof(IrtEntry)), "Unexpected sizeof(IrtEntry)");
 
+class IndirectReferenceTable;
+
 class IrtIterator {
  public:
-  IrtIterator(IrtEntry* table, size_t i, size_t capacity) REQUIRES_SHARED(Locks::mutator_lock_)
+  IrtIterator(const IndirectReferenceTable* table, size_t i, size_t capacity)
+      REQUIRES_SHARED(Locks::mutator_lock_)
       : table_(table), i_(i), capacity_(capacity) {
   }
 
@@ -193,17 +201,14 @@ class IrtIterator {
     return *this;
   }
 
-  GcRoot<mirror::Object>* operator*() REQUIRES_SHARED(Locks::mutator_lock_) {
-    // This does not have a read barrier as this is used to visit roots.
-    return table_[i_].GetReference();
-  }
+  GcRoot<mirror::Object>* operator*() REQUIRES_SHARED(Locks::mutator_lock_);
 
   bool equals(const IrtIterator& rhs) const {
     return (i_ == rhs.i_ && table_ == rhs.table_);
   }
 
  private:
-  IrtEntry* const table_;
+  const IndirectReferenceTable* const table_;
   size_t i_;
   const size_t capacity_;
 };
@@ -228,6 +233,9 @@ class IndirectReferenceTable {
   // construction has failed and the IndirectReferenceTable will be in an
   // invalid state. Use IsValid to check whether the object is in an invalid
   // state.
+  //
+  // A resizable table starts with room for max_count entries and grows up to
+  // kMaxTableEntries, otherwise max_count is a hard limit.
   IndirectReferenceTable(size_t max_count,
                          IndirectRefKind kind,
                          ResizableCapacity resizable,
@@ -249,6 +257,10 @@ class IndirectReferenceTable {
   IndirectRef Add(IRTSegmentState previous_state, ObjPtr<mirror::Object> obj)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Makes sure that free_capacity entries can be added without growing the table any more.
+  // Returns false if the table cannot hold them.
+  bool EnsureFreeCapacity(size_t free_capacity, std::string* error_msg);
+
   // Given an IndirectRef in the table, return the Object it refers to.
   //
   // This function may abort under error conditions.
@@ -287,11 +299,11 @@ class IndirectReferenceTable {
 
   // Note IrtIterator does not have a read barrier as it's used to visit roots.
   IrtIterator begin() {
-    return IrtIterator(table_, 0, Capacity());
+    return IrtIterator(this, 0, Capacity());
   }
 
   IrtIterator end() {
-    return IrtIterator(table_, Capacity(), Capacity());
+    return IrtIterator(this, Capacity(), Capacity());
   }
 
   void VisitRoots(RootVisitor* visitor, const RootInfo& root_info)
@@ -318,7 +330,15 @@ class IndirectReferenceTable {
     return DecodeIndirectRefKind(reinterpret_cast<uintptr_t>(iref));
   }
 
+  // Upper bound for resizable tables, also keeps the index encodable on 32-bit targets.
+  static constexpr size_t kMaxTableEntries = 1u << 24;
+
  private:
+  friend class IrtIterator;
+
+  // Enough chunks to reach kMaxTableEntries even if the first one holds a single entry.
+  static constexpr size_t kMaxChunks = 25;
+
   static constexpr size_t kSerialBits = MinimumBitsToStore(kIRTPrevCount);
   static constexpr uint32_t kShiftedSerialMask = (1u << kSerialBits) - 1;
 
@@ -364,14 +384,27 @@ class IndirectReferenceTable {
 
   IndirectRef ToIndirectRef(uint32_t table_index) const {
     DCHECK_LT(table_index, max_entries_);
-    uint32_t serial = table_[table_index].GetSerial();
+    uint32_t serial = GetEntry(table_index)->GetSerial();
     return reinterpret_cast<IndirectRef>(EncodeIndirectRef(table_index, serial));
   }
 
-  // Resize the backing table. Currently must be larger than the current size.
-  bool Resize(size_t new_size, std::string* error_msg);
+  // Chunk k starts at index ((1 << k) - 1) << first_chunk_shift_.
+  ALWAYS_INLINE IrtEntry* GetEntry(uint32_t table_index) const {
+    DCHECK_LT(table_index, allocated_entries_);
+    const uint32_t scaled_index = (table_index >> first_chunk_shift_) + 1u;
+    const size_t chunk = static_cast<size_t>(MostSignificantBit(scaled_index));
+    const uint32_t chunk_begin = ((1u << chunk) - 1u) << first_chunk_shift_;
+    return &chunks_[chunk][table_index - chunk_begin];
+  }
+
+  // Maps the next chunk of the table.
+  bool AddChunk(std::string* error_msg);
 
   void RecoverHoles(IRTSegmentState from);
+  size_t CountNullEntries(size_t from, size_t to) const;
+  void CheckHoleCount(IRTSegmentState prev_state) const;
+  // Drops the free list entries that are no longer holes of the current segment.
+  void CompactFreeList(IRTSegmentState prev_state);
 
   // Abort if check_jni is not enabled. Otherwise, just log as an error.
   static void AbortIfNoCheckJNI(const std::string& msg);
@@ -383,28 +416,39 @@ class IndirectReferenceTable {
   /// semi-public - read/write by jni down calls.
   IRTSegmentState segment_state_;
 
-  // Mem map where we store the indirect refs.
-  std::unique_ptr<MemMap> table_mem_map_;
-  // bottom of the stack. Do not directly access the object references
-  // in this as they are roots. Use Get() that has a read barrier.
-  IrtEntry* table_;
+  // Mem maps where we store the indirect refs, and their entries. Do not directly access the
+  // object references in these as they are roots. Use Get() that has a read barrier.
+  std::unique_ptr<MemMap> chunk_maps_[kMaxChunks];
+  IrtEntry* chunks_[kMaxChunks];
+  size_t num_chunks_;
+  // The first chunk holds 1 << first_chunk_shift_ entries.
+  const uint32_t first_chunk_shift_;
+  // #of entries in the mapped chunks.
+  size_t allocated_entries_;
   // bit mask, ORed into all irefs.
   const IndirectRefKind kind_;
 
-  // max #of entries allowed (modulo resizing).
-  size_t max_entries_;
+  // max #of entries allowed.
+  const size_t max_entries_;
 
   // Some values to retain old behavior with holes. Description of the algorithm is in the .cc
   // file.
-  // TODO: Consider other data structures for compact tables, e.g., free lists.
   size_t current_num_holes_;
   IRTSegmentState last_known_previous_state_;
+  // Indexes of the holes in the current segment. May also contain stale entries that were filled
+  // or dropped from the top since, these are skipped.
+  std::vector<uint32_t> free_list_;
 
   // Whether the table's capacity may be resized. As there are no locks used, it is the caller's
-  // responsibility to ensure thread-safety.
+  // responsibility to serialize adds and removes. Entries never move, so reads need no lock.
   ResizableCapacity resizable_;
 };
 
+inline GcRoot<mirror::Object>* IrtIterator::operator*() {
+  // This does not have a read barrier as this is used to visit roots.
+  return table_->GetEntry(i_)->GetReference();
+}
+
 }  // namespace art
 
 #endif  // ART_RUNTIME_INDIRECT_REFERENCE_TABLE_H_
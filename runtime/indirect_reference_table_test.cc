@@ -503,11 +503,80 @@ TEST_F(IndirectReferenceTableTest, Resize) {
   CheckDump(&irt, 0, 0);
   const IRTSegmentState cookie = kIRTFirstSegment;
 
-  for (size_t i = 0; i != kTableMax + 1; ++i) {
+  IndirectRef first = irt.Add(cookie, obj0.Get());
+  for (size_t i = 1; i != kTableMax + 1; ++i) {
     irt.Add(cookie, obj0.Get());
   }
 
   EXPECT_EQ(irt.Capacity(), kTableMax + 1);
+  // Growing must not move the entries that are already there.
+  EXPECT_OBJ_PTR_EQ(obj0.Get(), irt.Get(first));
+
+  // Several more chunks.
+  for (size_t i = kTableMax + 1; i != 16 * kTableMax; ++i) {
+    irt.Add(cookie, obj0.Get());
+  }
+  EXPECT_EQ(irt.Capacity(), 16 * kTableMax);
+  EXPECT_OBJ_PTR_EQ(obj0.Get(), irt.Get(first));
+  CheckDump(&irt, 16 * kTableMax, 1);
+
+  EXPECT_TRUE(irt.EnsureFreeCapacity(64 * kTableMax, &error_msg)) << error_msg;
+  EXPECT_FALSE(irt.EnsureFreeCapacity(IndirectReferenceTable::kMaxTableEntries, &error_msg));
+}
+
+TEST_F(IndirectReferenceTableTest, HoleReuse) {
+  ScopedObjectAccess soa(Thread::Current());
+  static const size_t kTableMax = 64;
+
+  mirror::Class* c = class_linker_->FindSystemClass(soa.Self(), "Ljava/lang/Object;");
+  StackHandleScope<2> hs(soa.Self());
+  ASSERT_TRUE(c != nullptr);
+  Handle<mirror::Object> obj0 = hs.NewHandle(c->AllocObject(soa.Self()));
+  ASSERT_TRUE(obj0 != nullptr);
+  Handle<mirror::Object> obj1 = hs.NewHandle(c->AllocObject(soa.Self()));
+  ASSERT_TRUE(obj1 != nullptr);
+
+  std::string error_msg;
+  IndirectReferenceTable irt(kTableMax,
+                             kGlobal,
+                             IndirectReferenceTable::ResizableCapacity::kNo,
+                             &error_msg);
+  ASSERT_TRUE(irt.IsValid()) << error_msg;
+
+  const IRTSegmentState cookie = kIRTFirstSegment;
+  IndirectRef refs[kTableMax];
+  for (size_t i = 0; i != kTableMax; ++i) {
+    refs[i] = irt.Add(cookie, obj0.Get());
+  }
+
+  // Punch holes everywhere but at the top, then fill them all again. A full table only takes
+  // new references through the holes.
+  for (size_t i = 0; i < kTableMax - 1; i += 2) {
+    EXPECT_TRUE(irt.Remove(cookie, refs[i]));
+  }
+  for (size_t i = 0; i < kTableMax - 1; i += 2) {
+    refs[i] = irt.Add(cookie, obj1.Get());
+  }
+  EXPECT_EQ(kTableMax, irt.Capacity());
+  for (size_t i = 0; i != kTableMax; ++i) {
+    EXPECT_OBJ_PTR_EQ((i % 2 == 0) ? obj1.Get() : obj0.Get(), irt.Get(refs[i]));
+  }
+
+  // Holes eaten by removing the top entries must not be handed out again.
+  EXPECT_TRUE(irt.Remove(cookie, refs[kTableMax - 4]));
+  EXPECT_TRUE(irt.Remove(cookie, refs[kTableMax - 3]));
+  EXPECT_TRUE(irt.Remove(cookie, refs[kTableMax - 2]));
+  EXPECT_TRUE(irt.Remove(cookie, refs[kTableMax - 1]));
+  EXPECT_EQ(kTableMax - 4, irt.Capacity());
+  IndirectRef iref = irt.Add(cookie, obj0.Get());
+  EXPECT_EQ(kTableMax - 3, irt.Capacity());
+  EXPECT_OBJ_PTR_EQ(obj0.Get(), irt.Get(iref));
+
+  for (size_t i = 0; i != kTableMax - 4; ++i) {
+    EXPECT_TRUE(irt.Remove(cookie, refs[i]));
+  }
+  EXPECT_TRUE(irt.Remove(cookie, iref));
+  EXPECT_EQ(0U, irt.Capacity());
 }
 
 }  // namespace art
@@ -28,6 +28,7 @@
 #include "entrypoints/quick/quick_alloc_entrypoints.h"
 #include "entrypoints/runtime_asm_entrypoints.h"
 #include "gc_root-inl.h"
+#include "handshake.h"
 #include "interpreter/interpreter.h"
 #include "jit/jit.h"
 #include "jit/jit_code_cache.h"
@@ -37,6 +38,7 @@
 #include "mirror/object-inl.h"
 #include "nth_caller_visitor.h"
 #include "oat_quick_method_header.h"
+#include "scoped_thread_state_change-inl.h"
 #include "thread.h"
 #include "thread_list.h"
 
@@ -638,16 +640,32 @@ static void ResetQuickAllocEntryPointsForThread(Thread* thread, void* arg ATTRIB
   thread->ResetQuickAllocEntryPointsForThread(kUseReadBarrier && thread->GetIsGcMarking());
 }
 
+class ResetQuickAllocEntryPointsClosure : public Closure {
+ public:
+  void Run(Thread* thread) OVERRIDE {
+    ResetQuickAllocEntryPointsForThread(thread, nullptr);
+  }
+};
+
 void Instrumentation::SetEntrypointsInstrumented(bool instrumented) {
   Thread* self = Thread::Current();
   Runtime* runtime = Runtime::Current();
   Locks::mutator_lock_->AssertNotHeld(self);
   Locks::instrument_entrypoints_lock_->AssertHeld(self);
   if (runtime->IsStarted()) {
-    ScopedSuspendAll ssa(__FUNCTION__);
-    MutexLock mu(self, *Locks::runtime_shutdown_lock_);
-    SetQuickAllocEntryPointsInstrumented(instrumented);
-    ResetQuickAllocEntryPoints();
+    // Each thread switches its entrypoints at its next suspend point, no need to stop all of them
+    // at once. Threads started from now on pick up the new entrypoints themselves.
+    ResetQuickAllocEntryPointsClosure closure;
+    Handshake handshake(&closure);
+    {
+      // Holding the mutator lock keeps a concurrent allocator change from resetting the
+      // entrypoints of suspended threads while we do.
+      ScopedObjectAccess soa(self);
+      MutexLock mu(self, *Locks::runtime_shutdown_lock_);
+      SetQuickAllocEntryPointsInstrumented(instrumented);
+      handshake.StartWithAllThreads(self);
+    }
+    handshake.Wait(self);
     alloc_entrypoints_instrumented_ = instrumented;
   } else {
     MutexLock mu(self, *Locks::runtime_shutdown_lock_);
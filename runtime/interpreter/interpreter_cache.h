@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_INTERPRETER_INTERPRETER_CACHE_H_
+#define ART_RUNTIME_INTERPRETER_INTERPRETER_CACHE_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "atomic.h"
+#include "base/bit_utils.h"
+#include "base/logging.h"
+#include "base/macros.h"
+
+namespace art {
+
+namespace interpreter {
+
+// Small direct-mapped cache of resolution results keyed by the address of a dex instruction.
+//
+// The cache is thread-local and only ever accessed by its owning thread, so no synchronization
+// is needed on the entries themselves. Since a key is the address of the instruction in the
+// mapped dex file, entries become meaningless once the dex file is unloaded. Class unloading
+// therefore bumps a global generation which makes every thread's cache flush itself on its next
+// lookup.
+class InterpreterCache {
+ public:
+  typedef std::pair<const void*, size_t> Entry;
+
+  static constexpr size_t kSize = 256;
+
+  InterpreterCache() : generation_(0u) {
+    Clear();
+  }
+
+  // Returns true and sets `*value` if `key` is in the cache.
+  ALWAYS_INLINE bool Get(const void* key, /* out */ size_t* value) {
+    if (UNLIKELY(generation_ != global_generation_.LoadRelaxed())) {
+      Clear();
+      generation_ = global_generation_.LoadRelaxed();
+      return false;
+    }
+    Entry& entry = data_[IndexOf(key)];
+    if (LIKELY(entry.first == key)) {
+      *value = entry.second;
+      return true;
+    }
+    return false;
+  }
+
+  ALWAYS_INLINE void Set(const void* key, size_t value) {
+    data_[IndexOf(key)] = Entry{key, value};
+  }
+
+  // Invalidate the caches of all threads. Must be called before any memory which may hold cached
+  // keys or values (dex files, ArtMethods, ArtFields) is released.
+  static void InvalidateAll() {
+    global_generation_.FetchAndAddSequentiallyConsistent(1u);
+  }
+
+ private:
+  void Clear() {
+    data_.fill(Entry{});
+  }
+
+  static ALWAYS_INLINE size_t IndexOf(const void* key) {
+    static_assert(IsPowerOfTwo(kSize), "Size must be power of two");
+    // Dex instructions are at least 2-byte aligned, so drop the low bit.
+    size_t index = (reinterpret_cast<uintptr_t>(key) >> 1) & (kSize - 1);
+    DCHECK_LT(index, kSize);
+    return index;
+  }
+
+  static Atomic<uint32_t> global_generation_;
+
+  std::array<Entry, kSize> data_;
+  uint32_t generation_;
+};
+
+}  // namespace interpreter
+}  // namespace art
+
+#endif  // ART_RUNTIME_INTERPRETER_INTERPRETER_CACHE_H_
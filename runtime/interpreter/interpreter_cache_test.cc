@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "interpreter_cache.h"
+
+#include <memory>
+
+#include "gtest/gtest.h"
+
+namespace art {
+namespace interpreter {
+
+TEST(InterpreterCache, GetSet) {
+  std::unique_ptr<InterpreterCache> cache(new InterpreterCache());
+  uint16_t insns[4];
+  size_t value = 0u;
+  EXPECT_FALSE(cache->Get(&insns[0], &value));
+  cache->Set(&insns[0], 42u);
+  cache->Set(&insns[1], 43u);
+  EXPECT_TRUE(cache->Get(&insns[0], &value));
+  EXPECT_EQ(42u, value);
+  EXPECT_TRUE(cache->Get(&insns[1], &value));
+  EXPECT_EQ(43u, value);
+  EXPECT_FALSE(cache->Get(&insns[2], &value));
+
+  // Keys mapping to the same slot evict each other.
+  const void* alias = reinterpret_cast<const void*>(
+      reinterpret_cast<uintptr_t>(&insns[0]) + 2u * InterpreterCache::kSize);
+  cache->Set(alias, 44u);
+  EXPECT_TRUE(cache->Get(alias, &value));
+  EXPECT_EQ(44u, value);
+  EXPECT_FALSE(cache->Get(&insns[0], &value));
+}
+
+TEST(InterpreterCache, InvalidateAll) {
+  std::unique_ptr<InterpreterCache> cache(new InterpreterCache());
+  uint16_t insn;
+  size_t value = 0u;
+  // Synchronize with the current global generation first.
+  EXPECT_FALSE(cache->Get(&insn, &value));
+  cache->Set(&insn, 1u);
+  EXPECT_TRUE(cache->Get(&insn, &value));
+  InterpreterCache::InvalidateAll();
+  EXPECT_FALSE(cache->Get(&insn, &value));
+  EXPECT_FALSE(cache->Get(&insn, &value));
+  cache->Set(&insn, 2u);
+  EXPECT_TRUE(cache->Get(&insn, &value));
+  EXPECT_EQ(2u, value);
+}
+
+}  // namespace interpreter
+}  // namespace art
@@ -18,6 +18,7 @@
 #define ART_RUNTIME_INTERPRETER_INTERPRETER_COMMON_H_
 
 #include "interpreter.h"
+#include "interpreter_cache.h"
 #include "interpreter_intrinsics.h"
 
 #include <math.h>
@@ -112,24 +113,44 @@ template<bool is_range, bool do_assignability_check>
 bool DoCall(ArtMethod* called_method, Thread* self, ShadowFrame& shadow_frame,
             const Instruction* inst, uint16_t inst_data, JValue* result);
 
-// Handles streamlined non-range invoke static, direct and virtual instructions originating in
-// mterp. Access checks and instrumentation other than jit profiling are not supported, but does
-// support interpreter intrinsics if applicable.
+// Handles streamlined invoke static, direct and virtual instructions (and their range variants)
+// originating in mterp. Access checks and instrumentation other than jit profiling are not
+// supported, but does support interpreter intrinsics for the non-range forms if applicable.
 // Returns true on success, otherwise throws an exception and returns false.
-template<InvokeType type>
+template<InvokeType type, bool is_range = false>
 static inline bool DoFastInvoke(Thread* self,
                                 ShadowFrame& shadow_frame,
                                 const Instruction* inst,
                                 uint16_t inst_data,
                                 JValue* result) {
-  const uint32_t method_idx = inst->VRegB_35c();
-  const uint32_t vregC = inst->VRegC_35c();
+  const uint32_t method_idx = (is_range) ? inst->VRegB_3rc() : inst->VRegB_35c();
+  const uint32_t vregC = (is_range) ? inst->VRegC_3rc() : inst->VRegC_35c();
   ObjPtr<mirror::Object> receiver = (type == kStatic)
       ? nullptr
       : shadow_frame.GetVRegReference(vregC);
   ArtMethod* sf_method = shadow_frame.GetMethod();
-  ArtMethod* const called_method = FindMethodFromCode<type, false>(
-      method_idx, &receiver, sf_method, self);
+  ArtMethod* called_method = nullptr;
+  // Reuse the method resolved by a previous execution of this instruction if we can. A null
+  // receiver always goes through FindMethodFromCode so that the right exception is thrown.
+  InterpreterCache* tls_cache = self->GetInterpreterCache();
+  size_t tls_value;
+  if (LIKELY((type == kStatic || receiver != nullptr) && tls_cache->Get(inst, &tls_value))) {
+    ArtMethod* resolved_method = reinterpret_cast<ArtMethod*>(tls_value);
+    called_method = (type == kVirtual)
+        ? receiver->GetClass()->GetVTableEntry(resolved_method->GetMethodIndex(),
+                                               kRuntimePointerSize)
+        : resolved_method;
+  } else {
+    called_method = FindMethodFromCode<type, false>(method_idx, &receiver, sf_method, self);
+    if (called_method != nullptr) {
+      ArtMethod* resolved_method = (type == kVirtual)
+          ? Runtime::Current()->GetClassLinker()->GetResolvedMethod(method_idx, sf_method)
+          : called_method;
+      if (resolved_method != nullptr) {
+        tls_cache->Set(inst, reinterpret_cast<size_t>(resolved_method));
+      }
+    }
+  }
   // The shadow frame should already be pushed, so we don't need to update it.
   if (UNLIKELY(called_method == nullptr)) {
     CHECK(self->IsExceptionPending());
@@ -140,7 +161,8 @@ static inline bool DoFastInvoke(Thread* self,
     result->SetJ(0);
     return false;
   } else {
-    if (called_method->IsIntrinsic()) {
+    // Interpreter intrinsics only decode the 35c argument layout.
+    if (!is_range && called_method->IsIntrinsic()) {
       if (MterpHandleIntrinsic(&shadow_frame, called_method, inst, inst_data,
                                shadow_frame.GetResultRegister())) {
         return !self->IsExceptionPending();
@@ -153,7 +175,7 @@ static inline bool DoFastInvoke(Thread* self,
       }
       jit->AddSamples(self, sf_method, 1, /*with_backedges*/false);
     }
-    return DoCall<false, false>(called_method, self, shadow_frame, inst, inst_data, result);
+    return DoCall<is_range, false>(called_method, self, shadow_frame, inst, inst_data, result);
   }
 }
 
@@ -562,16 +584,19 @@ EXPLICIT_DO_INVOKE_ALL_TEMPLATE_DECL(kInterface)   // invoke-interface/range.
 #undef EXPLICIT_DO_INVOKE_TEMPLATE_DECL
 
 // Explicitly instantiate all DoFastInvoke functions.
-#define EXPLICIT_DO_FAST_INVOKE_TEMPLATE_DECL(_type)                     \
-  template REQUIRES_SHARED(Locks::mutator_lock_)                         \
-  bool DoFastInvoke<_type>(Thread* self,                                 \
-                           ShadowFrame& shadow_frame,                    \
-                           const Instruction* inst, uint16_t inst_data,  \
-                           JValue* result)
-
-EXPLICIT_DO_FAST_INVOKE_TEMPLATE_DECL(kStatic);     // invoke-static
-EXPLICIT_DO_FAST_INVOKE_TEMPLATE_DECL(kDirect);     // invoke-direct
-EXPLICIT_DO_FAST_INVOKE_TEMPLATE_DECL(kVirtual);    // invoke-virtual
+#define EXPLICIT_DO_FAST_INVOKE_TEMPLATE_DECL(_type, _is_range)                     \
+  template REQUIRES_SHARED(Locks::mutator_lock_)                                   \
+  bool DoFastInvoke<_type, _is_range>(Thread* self,                                \
+                                      ShadowFrame& shadow_frame,                   \
+                                      const Instruction* inst, uint16_t inst_data, \
+                                      JValue* result)
+
+EXPLICIT_DO_FAST_INVOKE_TEMPLATE_DECL(kStatic, false);     // invoke-static
+EXPLICIT_DO_FAST_INVOKE_TEMPLATE_DECL(kDirect, false);     // invoke-direct
+EXPLICIT_DO_FAST_INVOKE_TEMPLATE_DECL(kVirtual, false);    // invoke-virtual
+EXPLICIT_DO_FAST_INVOKE_TEMPLATE_DECL(kStatic, true);      // invoke-static/range
+EXPLICIT_DO_FAST_INVOKE_TEMPLATE_DECL(kDirect, true);      // invoke-direct/range
+EXPLICIT_DO_FAST_INVOKE_TEMPLATE_DECL(kVirtual, true);     // invoke-virtual/range
 #undef EXPLICIT_DO_FAST_INVOKE_TEMPLATE_DECL
 
 // Explicitly instantiate all DoInvokeVirtualQuick functions.
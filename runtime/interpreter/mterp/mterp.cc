@@ -213,7 +213,7 @@ extern "C" size_t MterpInvokeVirtualRange(Thread* self,
     REQUIRES_SHARED(Locks::mutator_lock_) {
   JValue* result_register = shadow_frame->GetResultRegister();
   const Instruction* inst = Instruction::At(dex_pc_ptr);
-  return DoInvoke<kVirtual, true, false>(
+  return DoFastInvoke<kVirtual, /* is_range */ true>(
       self, *shadow_frame, inst, inst_data, result_register);
 }
 
@@ -246,7 +246,7 @@ extern "C" size_t MterpInvokeDirectRange(Thread* self,
     REQUIRES_SHARED(Locks::mutator_lock_) {
   JValue* result_register = shadow_frame->GetResultRegister();
   const Instruction* inst = Instruction::At(dex_pc_ptr);
-  return DoInvoke<kDirect, true, false>(
+  return DoFastInvoke<kDirect, /* is_range */ true>(
       self, *shadow_frame, inst, inst_data, result_register);
 }
 
@@ -257,7 +257,7 @@ extern "C" size_t MterpInvokeStaticRange(Thread* self,
     REQUIRES_SHARED(Locks::mutator_lock_) {
   JValue* result_register = shadow_frame->GetResultRegister();
   const Instruction* inst = Instruction::At(dex_pc_ptr);
-  return DoInvoke<kStatic, true, false>(
+  return DoFastInvoke<kStatic, /* is_range */ true>(
       self, *shadow_frame, inst, inst_data, result_register);
 }
 
@@ -688,11 +688,19 @@ ALWAYS_INLINE return_type MterpGetStatic(uint32_t field_idx,
                                          return_type (ArtField::*func)(ObjPtr<mirror::Object>))
     REQUIRES_SHARED(Locks::mutator_lock_) {
   return_type res = 0;  // On exception, the result will be ignored.
-  ArtField* f =
-      FindFieldFromCode<StaticPrimitiveRead, false>(field_idx,
-                                                    referrer,
-                                                    self,
-                                                    primitive_type);
+  // Try the dex cache first; this avoids the full resolution path once the field is resolved
+  // and its declaring class is initialized.
+  ArtField* f = FindFieldFast(field_idx,
+                              referrer,
+                              (primitive_type == Primitive::kPrimNot) ? StaticObjectRead
+                                                                      : StaticPrimitiveRead,
+                              Primitive::ComponentSize(primitive_type));
+  if (UNLIKELY(f == nullptr)) {
+    f = FindFieldFromCode<StaticPrimitiveRead, false>(field_idx,
+                                                      referrer,
+                                                      self,
+                                                      primitive_type);
+  }
   if (LIKELY(f != nullptr)) {
     ObjPtr<mirror::Object> obj = f->GetDeclaringClass();
     res = (f->*func)(obj);
@@ -777,8 +785,13 @@ int MterpSetStatic(uint32_t field_idx,
                    void (ArtField::*func)(ObjPtr<mirror::Object>, field_type val))
     REQUIRES_SHARED(Locks::mutator_lock_) {
   int res = 0;  // Assume success (following quick_field_entrypoints conventions)
-  ArtField* f =
-      FindFieldFromCode<StaticPrimitiveWrite, false>(field_idx, referrer, self, primitive_type);
+  ArtField* f = FindFieldFast(field_idx,
+                              referrer,
+                              StaticPrimitiveWrite,
+                              Primitive::ComponentSize(primitive_type));
+  if (UNLIKELY(f == nullptr)) {
+    f = FindFieldFromCode<StaticPrimitiveWrite, false>(field_idx, referrer, self, primitive_type);
+  }
   if (LIKELY(f != nullptr)) {
     ObjPtr<mirror::Object> obj = f->GetDeclaringClass();
     (f->*func)(obj, new_value);
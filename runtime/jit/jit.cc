@@ -17,9 +17,13 @@
 #include "jit.h"
 
 #include <dlfcn.h>
+#include <sstream>
+#include <vector>
 
 #include "art_method-inl.h"
 #include "base/enums.h"
+#include "base/time_utils.h"
+#include "base/unix_file/fd_file.h"
 #include "debugger.h"
 #include "entrypoints/runtime_asm_entrypoints.h"
 #include "interpreter/interpreter.h"
@@ -27,6 +31,7 @@
 #include "jit_code_cache.h"
 #include "oat_file_manager.h"
 #include "oat_quick_method_header.h"
+#include "os.h"
 #include "profile_compilation_info.h"
 #include "profile_saver.h"
 #include "runtime.h"
@@ -61,6 +66,8 @@ JitOptions* JitOptions::CreateFromRuntimeArguments(const RuntimeArgumentMap& opt
       options.GetOrDefault(RuntimeArgumentMap::JITCodeCacheMaxCapacity);
   jit_options->dump_info_on_shutdown_ =
       options.Exists(RuntimeArgumentMap::DumpJITInfoOnShutdown);
+  jit_options->stats_file_ = options.GetOrDefault(RuntimeArgumentMap::JITStatsFile);
+  jit_options->seed_from_profile_ = options.Exists(RuntimeArgumentMap::JITSeedFromProfile);
   jit_options->profile_saver_options_ =
       options.GetOrDefault(RuntimeArgumentMap::ProfileSaverOpts);
 
@@ -131,6 +138,14 @@ void Jit::DumpInfo(std::ostream& os) {
   cumulative_timings_.Dump(os);
   MutexLock mu(Thread::Current(), lock_);
   memory_use_.PrintMemoryUse(os);
+  code_size_.PrintMemoryUse(os);
+  for (const Histogram<uint64_t>* histogram : { &queue_delay_, &compile_time_ }) {
+    if (histogram->SampleSize() > 0) {
+      Histogram<uint64_t>::CumulativeData cumulative_data;
+      histogram->CreateHistogram(&cumulative_data);
+      histogram->PrintConfidenceIntervals(os, 0.99, cumulative_data);
+    }
+  }
 }
 
 void Jit::DumpForSigQuit(std::ostream& os) {
@@ -145,18 +160,25 @@ void Jit::AddTimingLogger(const TimingLogger& logger) {
 Jit::Jit() : dump_info_on_shutdown_(false),
              cumulative_timings_("JIT timings"),
              memory_use_("Memory used for compilation", 16),
-             lock_("JIT memory use lock"),
+             queue_delay_("JIT compilation queue delay", 1000, 32),
+             compile_time_("JIT compilation time", 500, 32),
+             code_size_("JIT code size", 64, 32),
+             lock_("JIT statistics lock"),
              use_jit_compilation_(true),
              hot_method_threshold_(0),
              warm_method_threshold_(0),
              osr_method_threshold_(0),
              priority_thread_weight_(0),
-             invoke_transition_weight_(0) {}
+             invoke_transition_weight_(0),
+             seed_from_profile_(false),
+             seed_profile_(nullptr) {}
 
 Jit* Jit::Create(JitOptions* options, std::string* error_msg) {
   DCHECK(options->UseJitCompilation() || options->GetProfileSaverOptions().IsEnabled());
   std::unique_ptr<Jit> jit(new Jit);
   jit->dump_info_on_shutdown_ = options->DumpJitInfoOnShutdown();
+  jit->stats_file_ = options->GetStatsFile();
+  jit->seed_from_profile_ = options->SeedFromProfile();
   if (jit_compiler_handle_ == nullptr && !LoadCompiler(error_msg)) {
     return nullptr;
   }
@@ -325,8 +347,52 @@ void Jit::DeleteThreadPool() {
   }
 }
 
+class SeedProfileTask FINAL : public Task {
+ public:
+  explicit SeedProfileTask(const std::string& filename) : filename_(filename) {}
+
+  void Run(Thread* self ATTRIBUTE_UNUSED) OVERRIDE {
+    Runtime::Current()->GetJit()->LoadSeedProfile(filename_);
+  }
+
+  void Finalize() OVERRIDE {
+    delete this;
+  }
+
+ private:
+  const std::string filename_;
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(SeedProfileTask);
+};
+
+void Jit::LoadSeedProfile(const std::string& filename) {
+  if (seed_profile_.LoadRelaxed() != nullptr) {
+    return;
+  }
+  std::unique_ptr<File> profile_file(OS::OpenFileForReading(filename.c_str()));
+  std::unique_ptr<ProfileCompilationInfo> info(new ProfileCompilationInfo());
+  if (profile_file != nullptr && info->Load(profile_file->Fd())) {
+    VLOG(jit) << "Seeding JIT with " << info->GetNumberOfMethods() << " methods from "
+              << filename;
+    // Publish the fully loaded profile; readers in AddSamples never block on it.
+    if (!seed_profile_.CompareExchangeStrongSequentiallyConsistent(nullptr, info.get())) {
+      // Another registration of app info won the race.
+      info.reset();
+    } else {
+      info.release();
+    }
+  }
+}
+
 void Jit::StartProfileSaver(const std::string& filename,
                             const std::vector<std::string>& code_paths) {
+  if (seed_from_profile_ &&
+      use_jit_compilation_ &&
+      thread_pool_ != nullptr &&
+      seed_profile_.LoadRelaxed() == nullptr) {
+    // Keep the file I/O off the thread that registers the app, which is usually starting up.
+    thread_pool_->AddTask(Thread::Current(), new SeedProfileTask(filename));
+  }
   if (profile_saver_options_.IsEnabled()) {
     ProfileSaver::Start(profile_saver_options_,
                         filename,
@@ -355,6 +421,10 @@ Jit::~Jit() {
     DumpInfo(LOG_STREAM(INFO));
   }
   DeleteThreadPool();
+  if (!stats_file_.empty()) {
+    WriteStatsFile();
+  }
+  delete seed_profile_.LoadSequentiallyConsistent();
   if (jit_compiler_handle_ != nullptr) {
     jit_unload_(jit_compiler_handle_);
     jit_compiler_handle_ = nullptr;
@@ -494,9 +564,11 @@ bool Jit::MaybeDoOnStackReplacement(Thread* thread,
       // If we don't have a dex register map, then there are no live dex registers at
       // this dex pc.
     } else {
+      // Decode all locations in one pass rather than looking up each vreg separately.
+      std::vector<DexRegisterLocation> vreg_locations(number_of_vregs);
+      vreg_map.GetDexRegisterLocations(number_of_vregs, code_info, encoding, vreg_locations.data());
       for (uint16_t vreg = 0; vreg < number_of_vregs; ++vreg) {
-        DexRegisterLocation::Kind location =
-            vreg_map.GetLocationKind(vreg, number_of_vregs, code_info, encoding);
+        DexRegisterLocation::Kind location = vreg_locations[vreg].GetKind();
         if (location == DexRegisterLocation::Kind::kNone) {
           // Dex register is dead or uninitialized.
           continue;
@@ -510,10 +582,8 @@ bool Jit::MaybeDoOnStackReplacement(Thread* thread,
         DCHECK_EQ(location, DexRegisterLocation::Kind::kInStack);
 
         int32_t vreg_value = shadow_frame->GetVReg(vreg);
-        int32_t slot_offset = vreg_map.GetStackOffsetInBytes(vreg,
-                                                             number_of_vregs,
-                                                             code_info,
-                                                             encoding);
+        // The location value of a stack slot is its offset in bytes.
+        int32_t slot_offset = vreg_locations[vreg].GetValue();
         DCHECK_LT(slot_offset, static_cast<int32_t>(frame_size));
         DCHECK_GT(slot_offset, 0);
         (reinterpret_cast<int32_t*>(memory))[slot_offset / sizeof(int32_t)] = vreg_value;
@@ -560,6 +630,90 @@ void Jit::AddMemoryUsage(ArtMethod* method, size_t bytes) {
   memory_use_.AddValue(bytes);
 }
 
+void Jit::AddCompilationStats(ArtMethod* method,
+                              bool osr,
+                              uint64_t queue_delay_ns,
+                              uint64_t compile_time_ns) {
+  method = method->GetInterfaceMethodIfProxy(kRuntimePointerSize);
+  const OatQuickMethodHeader* method_header = nullptr;
+  if (osr) {
+    method_header = code_cache_->LookupOsrMethodHeader(method);
+  } else {
+    const void* entry_point = method->GetEntryPointFromQuickCompiledCode();
+    if (code_cache_->ContainsPc(entry_point)) {
+      method_header = OatQuickMethodHeader::FromEntryPoint(entry_point);
+    }
+  }
+  size_t code_size = (method_header != nullptr) ? method_header->GetCodeSize() : 0u;
+  std::string method_name(stats_file_.empty() ? "" : method->PrettyMethod());
+
+  MutexLock mu(Thread::Current(), lock_);
+  queue_delay_.AdjustAndAddValue(queue_delay_ns);
+  compile_time_.AdjustAndAddValue(compile_time_ns);
+  if (code_size != 0u) {
+    code_size_.AddValue(code_size);
+  }
+  if (!stats_file_.empty() && compilation_records_.size() < kMaxCompilationRecords) {
+    compilation_records_.push_back(
+        CompilationRecord { method_name, osr, queue_delay_ns, compile_time_ns, code_size });
+  }
+}
+
+void Jit::WriteStatsFile() {
+  std::ostringstream os;
+  {
+    MutexLock mu(Thread::Current(), lock_);
+    auto dump_histogram = [&os](const Histogram<uint64_t>& histogram, uint64_t scale) {
+      os << "{\"samples\":" << histogram.SampleSize();
+      if (histogram.SampleSize() > 0) {
+        Histogram<uint64_t>::CumulativeData data;
+        histogram.CreateHistogram(&data);
+        os << ",\"sum\":" << histogram.Sum() * scale
+           << ",\"min\":" << histogram.Min() * scale
+           << ",\"max\":" << histogram.Max() * scale
+           << ",\"p50\":" << static_cast<uint64_t>(histogram.Percentile(0.5, data) * scale)
+           << ",\"p90\":" << static_cast<uint64_t>(histogram.Percentile(0.9, data) * scale)
+           << ",\"p99\":" << static_cast<uint64_t>(histogram.Percentile(0.99, data) * scale);
+      }
+      os << "}";
+    };
+    // The time histograms hold microseconds, see AdjustAndAddValue(); report nanoseconds.
+    os << "{\"queue_delay_ns\":";
+    dump_histogram(queue_delay_, 1000u);
+    os << ",\"compile_time_ns\":";
+    dump_histogram(compile_time_, 1000u);
+    os << ",\"code_size_bytes\":";
+    dump_histogram(code_size_, 1u);
+    os << ",\"compilations\":[";
+    bool first = true;
+    for (const CompilationRecord& record : compilation_records_) {
+      os << (first ? "" : ",") << "\n{\"method\":\"";
+      first = false;
+      // Method names never contain control characters, only escape quotes and backslashes.
+      for (char c : record.method) {
+        if (c == '"' || c == '\\') {
+          os << '\\';
+        }
+        os << c;
+      }
+      os << "\",\"osr\":" << std::boolalpha << record.osr << std::noboolalpha
+         << ",\"queue_delay_ns\":" << record.queue_delay_ns
+         << ",\"compile_time_ns\":" << record.compile_time_ns
+         << ",\"code_size\":" << record.code_size << "}";
+    }
+    os << "]}\n";
+  }
+  std::string data = os.str();
+  std::unique_ptr<File> file(OS::CreateEmptyFileWriteOnly(stats_file_.c_str()));
+  if (file == nullptr) {
+    PLOG(ERROR) << "Unable to open JIT stats file '" << stats_file_ << "'";
+    return;
+  }
+  if (!file->WriteFully(data.c_str(), data.length()) || file->FlushCloseOrErase() != 0) {
+    PLOG(ERROR) << "Failed to write JIT stats file '" << stats_file_ << "'";
+  }
+}
+
 class JitCompileTask FINAL : public Task {
  public:
   enum TaskKind {
@@ -568,7 +722,8 @@ class JitCompileTask FINAL : public Task {
     kCompileOsr
   };
 
-  JitCompileTask(ArtMethod* method, TaskKind kind) : method_(method), kind_(kind) {
+  JitCompileTask(ArtMethod* method, TaskKind kind)
+      : method_(method), kind_(kind), enqueue_time_ns_(NanoTime()) {
     ScopedObjectAccess soa(Thread::Current());
     // Add a global ref to the class to prevent class unloading until compilation is done.
     klass_ = soa.Vm()->AddGlobalRef(soa.Self(), method_->GetDeclaringClass());
@@ -582,10 +737,13 @@ class JitCompileTask FINAL : public Task {
 
   void Run(Thread* self) OVERRIDE {
     ScopedObjectAccess soa(self);
-    if (kind_ == kCompile) {
-      Runtime::Current()->GetJit()->CompileMethod(method_, self, /* osr */ false);
-    } else if (kind_ == kCompileOsr) {
-      Runtime::Current()->GetJit()->CompileMethod(method_, self, /* osr */ true);
+    if (kind_ == kCompile || kind_ == kCompileOsr) {
+      bool osr = (kind_ == kCompileOsr);
+      Jit* jit = Runtime::Current()->GetJit();
+      uint64_t start_ns = NanoTime();
+      if (jit->CompileMethod(method_, self, osr)) {
+        jit->AddCompilationStats(method_, osr, start_ns - enqueue_time_ns_, NanoTime() - start_ns);
+      }
     } else {
       DCHECK(kind_ == kAllocateProfile);
       if (ProfilingInfo::Create(self, method_, /* retry_allocation */ true)) {
@@ -602,11 +760,22 @@ class JitCompileTask FINAL : public Task {
  private:
   ArtMethod* const method_;
   const TaskKind kind_;
+  const uint64_t enqueue_time_ns_;
   jobject klass_;
 
   DISALLOW_IMPLICIT_CONSTRUCTORS(JitCompileTask);
 };
 
+bool Jit::IsSeededHotMethod(ArtMethod* method) {
+  const ProfileCompilationInfo* seed_profile = seed_profile_.LoadAcquire();
+  if (seed_profile == nullptr) {
+    return false;
+  }
+  method = method->GetInterfaceMethodIfProxy(kRuntimePointerSize);
+  return seed_profile->ContainsMethod(
+      MethodReference(method->GetDexFile(), method->GetDexMethodIndex()));
+}
+
 void Jit::AddSamples(Thread* self, ArtMethod* method, uint16_t count, bool with_backedges) {
   if (thread_pool_ == nullptr) {
     // Should only see this when shutting down.
@@ -649,6 +818,12 @@ void Jit::AddSamples(Thread* self, ArtMethod* method, uint16_t count, bool with_
         // We failed allocating. Instead of doing the collection on the Java thread, we push
         // an allocation to a compiler thread, that will do the collection.
         thread_pool_->AddTask(self, new JitCompileTask(method, JitCompileTask::kAllocateProfile));
+      } else if (use_jit_compilation_ && IsSeededHotMethod(method)) {
+        // A previous run found this method hot, so don't wait for the hot threshold.
+        VLOG(jit) << "Compiling seeded method " << method->PrettyMethod();
+        thread_pool_->AddTask(self, new JitCompileTask(method, JitCompileTask::kCompile));
+        method->SetCounter(hot_method_threshold_);
+        return;
       }
     }
     // Avoid jumping more than one state at a time.
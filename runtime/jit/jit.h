@@ -81,6 +81,14 @@ class Jit {
   void AddMemoryUsage(ArtMethod* method, size_t bytes)
       REQUIRES(!lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
+  // Record statistics of a successful compilation of `method`: how long it waited in the
+  // compilation queue and how long the compilation itself took.
+  void AddCompilationStats(ArtMethod* method,
+                           bool osr,
+                           uint64_t queue_delay_ns,
+                           uint64_t compile_time_ns)
+      REQUIRES(!lock_)
+      REQUIRES_SHARED(Locks::mutator_lock_);
 
   size_t OSRMethodThreshold() const {
     return osr_method_threshold_;
@@ -136,6 +144,9 @@ class Jit {
   // Starts the profile saver if the config options allow profile recording.
   // The profile will be stored in the specified `filename` and will contain
   // information collected from the given `code_paths` (a set of dex locations).
+  // If seeding from the profile is enabled, the methods already recorded as hot in
+  // `filename` by previous runs are compiled as soon as they become warm. The profile is
+  // read on a JIT thread, methods that become warm before it is loaded are not seeded.
   void StartProfileSaver(const std::string& filename,
                          const std::vector<std::string>& code_paths);
   void StopProfileSaver();
@@ -181,11 +192,32 @@ class Jit {
   // Start JIT threads.
   void Start();
 
+  // Reads the profile used to seed the JIT from `filename`. Runs on a JIT thread.
+  void LoadSeedProfile(const std::string& filename);
+
+  // Returns whether `method` is recorded as hot in the profile used to seed the JIT.
+  bool IsSeededHotMethod(ArtMethod* method) REQUIRES_SHARED(Locks::mutator_lock_);
+
  private:
   Jit();
 
   static bool LoadCompiler(std::string* error_msg);
 
+  // Write the recorded compilations and histograms as JSON to `stats_file_`.
+  void WriteStatsFile() REQUIRES(!lock_);
+
+  // Statistics of a single compilation, only recorded when a stats file was requested.
+  struct CompilationRecord {
+    std::string method;
+    bool osr;
+    uint64_t queue_delay_ns;
+    uint64_t compile_time_ns;
+    size_t code_size;
+  };
+
+  // Upper bound on the number of compilations recorded for the stats file.
+  static constexpr size_t kMaxCompilationRecords = 64 * 1024;
+
   // JIT compiler
   static void* jit_library_handle_;
   static void* jit_compiler_handle_;
@@ -198,6 +230,11 @@ class Jit {
   bool dump_info_on_shutdown_;
   CumulativeLogger cumulative_timings_;
   Histogram<uint64_t> memory_use_ GUARDED_BY(lock_);
+  Histogram<uint64_t> queue_delay_ GUARDED_BY(lock_);
+  Histogram<uint64_t> compile_time_ GUARDED_BY(lock_);
+  Histogram<uint64_t> code_size_ GUARDED_BY(lock_);
+  std::vector<CompilationRecord> compilation_records_ GUARDED_BY(lock_);
+  std::string stats_file_;
   Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
 
   std::unique_ptr<jit::JitCodeCache> code_cache_;
@@ -212,6 +249,11 @@ class Jit {
   uint16_t invoke_transition_weight_;
   std::unique_ptr<ThreadPool> thread_pool_;
 
+  // Profile of a previous run used to compile known hot methods early, see StartProfileSaver.
+  // Published once and never modified afterwards.
+  bool seed_from_profile_;
+  Atomic<const ProfileCompilationInfo*> seed_profile_;
+
   DISALLOW_COPY_AND_ASSIGN(Jit);
 };
 
@@ -242,6 +284,12 @@ class JitOptions {
   bool DumpJitInfoOnShutdown() const {
     return dump_info_on_shutdown_;
   }
+  const std::string& GetStatsFile() const {
+    return stats_file_;
+  }
+  bool SeedFromProfile() const {
+    return seed_from_profile_;
+  }
   const ProfileSaverOptions& GetProfileSaverOptions() const {
     return profile_saver_options_;
   }
@@ -272,6 +320,8 @@ class JitOptions {
   uint16_t priority_thread_weight_;
   size_t invoke_transition_weight_;
   bool dump_info_on_shutdown_;
+  std::string stats_file_;
+  bool seed_from_profile_;
   ProfileSaverOptions profile_saver_options_;
 
   JitOptions()
@@ -283,7 +333,8 @@ class JitOptions {
         osr_threshold_(0),
         priority_thread_weight_(0),
         invoke_transition_weight_(0),
-        dump_info_on_shutdown_(false) {}
+        dump_info_on_shutdown_(false),
+        seed_from_profile_(false) {}
 
   DISALLOW_COPY_AND_ASSIGN(JitOptions);
 };
@@ -37,6 +37,8 @@ using android::base::StringPrintf;
 
 static constexpr size_t kMonitorsInitial = 32;  // Arbitrary.
 static constexpr size_t kMonitorsMax = 4096;  // Arbitrary sanity check.
+// Local frames nest rarely deeper than this, so PushLocalFrame does not allocate for them.
+static constexpr size_t kLocalFramesInitial = 16;  // Arbitrary.
 
 const JNINativeInterface* JNIEnvExt::table_override_ = nullptr;
 
@@ -81,6 +83,7 @@ JNIEnvExt::JNIEnvExt(Thread* self_in, JavaVMExt* vm_in, std::string* error_msg)
       runtime_deleted(false),
       critical(0),
       monitors("monitors", kMonitorsInitial, kMonitorsMax) {
+  stacked_local_ref_cookies.reserve(kLocalFramesInitial);
   MutexLock mu(Thread::Current(), *Locks::jni_function_table_lock_);
   check_jni = vm->IsCheckJniEnabled();
   functions = GetFunctionTable(check_jni);
@@ -187,7 +190,8 @@ void JNIEnvExt::RecordMonitorEnter(jobject obj) {
 static std::string ComputeMonitorDescription(Thread* self,
                                              jobject obj) REQUIRES_SHARED(Locks::mutator_lock_) {
   ObjPtr<mirror::Object> o = self->DecodeJObject(obj);
-  if ((o->GetLockWord(false).GetState() == LockWord::kThinLocked) &&
+  const LockWord::LockState lock_state = o->GetLockWord(false).GetState();
+  if ((lock_state == LockWord::kThinLocked || lock_state == LockWord::kBiased) &&
       Locks::mutator_lock_->IsExclusiveHeld(self)) {
     // Getting the identity hashcode here would result in lock inflation and suspension of the
     // current thread, which isn't safe if this is the only runnable thread.
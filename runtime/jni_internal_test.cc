@@ -1903,14 +1903,19 @@ TEST_F(JniInternalTest, PushLocalFrame_10395422) {
   ASSERT_EQ(JNI_OK, env_->PushLocalFrame(0));
   env_->PopLocalFrame(nullptr);
 
+  // The local reference table grows, so capacities beyond its initial size are fine.
+  ASSERT_EQ(JNI_OK, env_->PushLocalFrame(8192));
+  env_->PopLocalFrame(nullptr);
+
   // The following two tests will print errors to the log.
   ScopedLogSeverity sls(LogSeverity::FATAL);
 
   // Negative capacities are not allowed.
   ASSERT_EQ(JNI_ERR, env_->PushLocalFrame(-1));
 
-  // And it's okay to have an upper limit. Ours is currently 512.
-  ASSERT_EQ(JNI_ERR, env_->PushLocalFrame(8192));
+  // And it's okay to have an upper limit. Ours is IndirectReferenceTable::kMaxTableEntries.
+  ASSERT_EQ(JNI_ERR, env_->PushLocalFrame(
+      static_cast<jint>(IndirectReferenceTable::kMaxTableEntries) + 1));
 }
 
 TEST_F(JniInternalTest, PushLocalFrame_PopLocalFrame) {
@@ -2261,6 +2266,8 @@ static bool IsLocked(JNIEnv* env, jobject jobj) {
       return false;
     case LockWord::kThinLocked:
       return true;
+    case LockWord::kBiased:
+      return lock_word.BiasedLockCount() != 0;
     case LockWord::kFatLocked:
       return lock_word.FatLockMonitor()->IsLocked();
     default: {
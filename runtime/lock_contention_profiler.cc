@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lock_contention_profiler.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <vector>
+
+#include "android-base/stringprintf.h"
+
+#include "art_method-inl.h"
+#include "atomic.h"
+#include "base/logging.h"
+#include "base/time_utils.h"
+#include "mirror/class-inl.h"
+#include "mirror/object-inl.h"
+#include "os.h"
+#include "utf.h"
+
+namespace art {
+
+using android::base::StringPrintf;
+
+// Number of slots looked at before a contention is dropped.
+static constexpr size_t kMaxProbes = 16;
+
+// Number of entries printed on SIGQUIT.
+static constexpr size_t kMaxSigQuitEntries = 20;
+
+struct LockContentionProfiler::Entry {
+  enum State : uint32_t {
+    kEmpty,
+    kInitializing,
+    kReady,
+  };
+
+  Atomic<uint32_t> state;
+  Kind kind;
+  const void* lock_key;
+  ArtMethod* waiter_method;
+  ArtMethod* owner_method;
+  // Copied when the entry is created, so that they outlive the locks and methods.
+  const char* lock_name;
+  const char* waiter_name;
+  const char* owner_name;
+  Atomic<uint64_t> count;
+  Atomic<uint64_t> wait_ns;
+};
+
+struct LockContentionProfiler::Table {
+  Entry entries[kTableSize];
+  Atomic<uint64_t> dropped;
+};
+
+bool LockContentionProfiler::enabled_ = false;
+LockContentionProfiler::Table* LockContentionProfiler::table_ = nullptr;
+const char* LockContentionProfiler::output_file_ = nullptr;
+
+void LockContentionProfiler::Init(bool enabled, const std::string& output_file) {
+  if (table_ == nullptr && (enabled || !output_file.empty())) {
+    table_ = new Table();
+  }
+  if (!output_file.empty()) {
+    output_file_ = strdup(output_file.c_str());
+  }
+  enabled_ = enabled || !output_file.empty();
+}
+
+static size_t HashKey(const void* lock_key,
+                      const char* lock_name,
+                      ArtMethod* waiter_method,
+                      ArtMethod* owner_method) {
+  size_t hash = (lock_key != nullptr)
+      ? reinterpret_cast<uintptr_t>(lock_key)
+      : ComputeModifiedUtf8Hash(lock_name);
+  hash = hash * 31u + reinterpret_cast<uintptr_t>(waiter_method);
+  hash = hash * 31u + reinterpret_cast<uintptr_t>(owner_method);
+  // Methods and names are aligned, mix the high bits into the low ones.
+  hash ^= hash >> 17;
+  hash *= 0x9e3779b1u;
+  return hash ^ (hash >> 13);
+}
+
+static const char* CopyMethodName(ArtMethod* method) REQUIRES_SHARED(Locks::mutator_lock_) {
+  if (method == nullptr) {
+    return strdup("<unknown>");
+  }
+  return strdup(ArtMethod::PrettyMethod(method, /* with_signature */ false).c_str());
+}
+
+LockContentionProfiler::Entry* LockContentionProfiler::FindOrInsert(Kind kind,
+                                                                    const void* lock_key,
+                                                                    const char* lock_name,
+                                                                    ArtMethod* waiter_method,
+                                                                    ArtMethod* owner_method) {
+  size_t index = HashKey(lock_key, lock_name, waiter_method, owner_method);
+  for (size_t probe = 0; probe != kMaxProbes; ++probe, ++index) {
+    Entry* entry = &table_->entries[index % kTableSize];
+    uint32_t state = entry->state.LoadAcquire();
+    if (state == Entry::kEmpty &&
+        entry->state.CompareExchangeStrongSequentiallyConsistent(Entry::kEmpty,
+                                                                 Entry::kInitializing)) {
+      entry->kind = kind;
+      entry->lock_key = lock_key;
+      entry->waiter_method = waiter_method;
+      entry->owner_method = owner_method;
+      entry->lock_name = strdup(lock_name);
+      entry->waiter_name = CopyMethodName(waiter_method);
+      entry->owner_name = CopyMethodName(owner_method);
+      entry->state.StoreRelease(Entry::kReady);
+      return entry;
+    }
+    // Another thread may be filling in the slot, its key is only known once it is ready.
+    while ((state = entry->state.LoadAcquire()) == Entry::kInitializing) {
+      sched_yield();
+    }
+    if (entry->kind == kind &&
+        entry->lock_key == lock_key &&
+        (lock_key != nullptr || strcmp(entry->lock_name, lock_name) == 0) &&
+        entry->waiter_method == waiter_method &&
+        entry->owner_method == owner_method) {
+      return entry;
+    }
+  }
+  return nullptr;
+}
+
+void LockContentionProfiler::Record(Entry* entry, uint64_t wait_ns) {
+  if (entry == nullptr) {
+    table_->dropped.FetchAndAddRelaxed(1u);
+    return;
+  }
+  entry->count.FetchAndAddRelaxed(1u);
+  entry->wait_ns.FetchAndAddRelaxed(wait_ns);
+}
+
+void LockContentionProfiler::RecordMonitorContention(mirror::Object* obj,
+                                                     ArtMethod* waiter_method,
+                                                     ArtMethod* owner_method,
+                                                     uint64_t wait_ns) {
+  DCHECK(table_ != nullptr);
+  std::string temp;
+  const char* descriptor = obj->GetClass()->GetDescriptor(&temp);
+  Record(FindOrInsert(Kind::kMonitor, nullptr, descriptor, waiter_method, owner_method), wait_ns);
+}
+
+void LockContentionProfiler::RecordMutexContention(const BaseMutex* mutex, uint64_t wait_ns) {
+  DCHECK(table_ != nullptr);
+  // Names are usually literals, their address identifies the lock.
+  const char* name = mutex->GetName();
+  Record(FindOrInsert(Kind::kMutex, name, name, nullptr, nullptr), wait_ns);
+}
+
+// Returns the entries that are ready, with the longest total wait time first.
+static std::vector<const LockContentionProfiler::Entry*> GetSortedEntries(
+    const LockContentionProfiler::Entry* entries, size_t size) {
+  std::vector<const LockContentionProfiler::Entry*> result;
+  for (size_t i = 0; i != size; ++i) {
+    if (entries[i].state.LoadAcquire() == LockContentionProfiler::Entry::kReady &&
+        entries[i].count.LoadRelaxed() != 0u) {
+      result.push_back(&entries[i]);
+    }
+  }
+  std::sort(result.begin(),
+            result.end(),
+            [](const LockContentionProfiler::Entry* lhs, const LockContentionProfiler::Entry* rhs) {
+              return lhs->wait_ns.LoadRelaxed() > rhs->wait_ns.LoadRelaxed();
+            });
+  return result;
+}
+
+uint64_t LockContentionProfiler::GetContentionCount() {
+  uint64_t count = 0u;
+  if (table_ != nullptr) {
+    for (const Entry& entry : table_->entries) {
+      count += entry.count.LoadRelaxed();
+    }
+    count += table_->dropped.LoadRelaxed();
+  }
+  return count;
+}
+
+uint64_t LockContentionProfiler::GetTotalWaitNs() {
+  uint64_t wait_ns = 0u;
+  if (table_ != nullptr) {
+    for (const Entry& entry : table_->entries) {
+      wait_ns += entry.wait_ns.LoadRelaxed();
+    }
+  }
+  return wait_ns;
+}
+
+void LockContentionProfiler::DumpForSigQuit(std::ostream& os) {
+  if (table_ == nullptr) {
+    return;
+  }
+  std::vector<const Entry*> entries = GetSortedEntries(table_->entries, kTableSize);
+  os << "Lock contention: " << GetContentionCount() << " contentions, "
+     << PrettyDuration(GetTotalWaitNs()) << " total wait time, "
+     << table_->dropped.LoadRelaxed() << " not attributed\n";
+  for (size_t i = 0; i != std::min(entries.size(), kMaxSigQuitEntries); ++i) {
+    const Entry* entry = entries[i];
+    uint64_t count = entry->count.LoadRelaxed();
+    uint64_t wait_ns = entry->wait_ns.LoadRelaxed();
+    os << "  " << PrettyDuration(wait_ns) << " in " << count << " waits (avg "
+       << PrettyDuration(wait_ns / count) << ") on ";
+    if (entry->kind == Kind::kMonitor) {
+      os << "monitor of " << entry->lock_name << " held by " << entry->owner_name;
+    } else {
+      os << "mutex \"" << entry->lock_name << "\"";
+    }
+    os << " from " << entry->waiter_name << "\n";
+  }
+  if (!entries.empty()) {
+    os << "\n";
+  }
+  WriteOutputFile();
+}
+
+void LockContentionProfiler::DumpPprof(std::ostream& os) {
+  // The samples are waiter first, then the owner of a monitor, lock last. Every distinct name
+  // gets an address, the names follow the samples.
+  std::vector<const Entry*> entries;
+  if (table_ != nullptr) {
+    entries = GetSortedEntries(table_->entries, kTableSize);
+  }
+  std::vector<std::string> names;
+  std::map<std::string, size_t> addresses;
+  auto get_address = [&](const std::string& name) {
+    auto it = addresses.find(name);
+    if (it == addresses.end()) {
+      names.push_back(name);
+      it = addresses.emplace(name, names.size()).first;
+    }
+    return it->second;
+  };
+  os << "--- contention\n"
+     << "format = java\n"
+     << "resolution = microseconds\n"
+     << "sampling period = 1\n";
+  for (const Entry* entry : entries) {
+    os << entry->wait_ns.LoadRelaxed() / 1000u << " " << entry->count.LoadRelaxed() << " @ "
+       << StringPrintf("0x%08zx ", get_address(entry->waiter_name));
+    if (entry->kind == Kind::kMonitor) {
+      os << StringPrintf("0x%08zx ", get_address(entry->owner_name))
+         << StringPrintf("0x%08zx", get_address(std::string("monitor:") + entry->lock_name));
+    } else {
+      os << StringPrintf("0x%08zx", get_address(std::string("mutex:") + entry->lock_name));
+    }
+    os << "\n";
+  }
+  for (size_t i = 0; i != names.size(); ++i) {
+    os << StringPrintf("0x%08zx ", i + 1u) << names[i] << "\n";
+  }
+}
+
+bool LockContentionProfiler::WritePprofFile(const std::string& filename, std::string* error_msg) {
+  std::ostringstream os;
+  DumpPprof(os);
+  std::string data = os.str();
+  std::unique_ptr<File> file(OS::CreateEmptyFileWriteOnly(filename.c_str()));
+  if (file == nullptr) {
+    *error_msg = StringPrintf("Unable to open '%s': %s", filename.c_str(), strerror(errno));
+    return false;
+  }
+  if (!file->WriteFully(data.c_str(), data.length()) || file->FlushCloseOrErase() != 0) {
+    *error_msg = StringPrintf("Failed to write '%s': %s", filename.c_str(), strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+void LockContentionProfiler::WriteOutputFile() {
+  if (output_file_ == nullptr) {
+    return;
+  }
+  std::string error_msg;
+  if (!WritePprofFile(output_file_, &error_msg)) {
+    LOG(ERROR) << "Unable to write lock contention profile: " << error_msg;
+  }
+}
+
+}  // namespace art
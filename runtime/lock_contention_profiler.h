@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_LOCK_CONTENTION_PROFILER_H_
+#define ART_RUNTIME_LOCK_CONTENTION_PROFILER_H_
+
+#include <stdint.h>
+
+#include <iosfwd>
+#include <string>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+
+namespace art {
+
+class ArtMethod;
+
+namespace mirror {
+class Object;
+}  // namespace mirror
+
+// Aggregates the time threads spend blocked on contended monitors and runtime mutexes.
+//
+// Every contention is added to a fixed-size table keyed by the lock and by the methods of the
+// waiter and of the owner, so the memory use is bounded and recording needs no lock: slots are
+// claimed with a CAS and the counters are updated atomically. Only contended paths, which are
+// about to block anyway, pay for the recording, which makes it cheap enough to leave enabled.
+//
+// Monitors are identified by the class of the locked object, since objects move and die. The
+// owner is the method that held the monitor (with -Xlockprofthreshold) or otherwise the method
+// that released it to the waiters. Runtime mutexes are identified by their name and have no
+// methods: a thread may wait for a mutex from an entrypoint that sets up no managed frame, so
+// its stack cannot be looked at safely.
+//
+// The table is printed on SIGQUIT and can be written in the text format that pprof reads for
+// Java contention profiles.
+class LockContentionProfiler {
+ public:
+  // Enables or disables recording. If output_file is not empty, the profile is written there on
+  // SIGQUIT and when the runtime shuts down. The table is kept when recording is disabled.
+  static void Init(bool enabled, const std::string& output_file);
+
+  static bool IsEnabled() {
+    return enabled_;
+  }
+
+  // Records a thread that waited wait_ns for the monitor of obj.
+  static void RecordMonitorContention(mirror::Object* obj,
+                                      ArtMethod* waiter_method,
+                                      ArtMethod* owner_method,
+                                      uint64_t wait_ns)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  // Records a thread that waited wait_ns for a runtime mutex.
+  static void RecordMutexContention(const BaseMutex* mutex, uint64_t wait_ns);
+
+  // Prints the entries with the longest total wait time.
+  static void DumpForSigQuit(std::ostream& os);
+
+  // Writes all entries as a pprof contention profile, in microseconds.
+  static void DumpPprof(std::ostream& os);
+  static bool WritePprofFile(const std::string& filename, std::string* error_msg);
+
+  // Writes the profile to the file given to Init(), if any.
+  static void WriteOutputFile();
+
+  static uint64_t GetContentionCount();
+  static uint64_t GetTotalWaitNs();
+
+  // Number of slots in the table. Contentions that do not find a slot are only counted.
+  static constexpr size_t kTableSize = 1024;
+
+  struct Entry;
+
+ private:
+  enum class Kind : uint32_t {
+    kMonitor,
+    kMutex,
+  };
+
+  struct Table;
+
+  // Returns null if the table has no room for the key. A null lock_key keys the entry by the
+  // contents of lock_name. A new entry copies the names, the methods must be null unless the
+  // mutator lock is held.
+  static Entry* FindOrInsert(Kind kind,
+                             const void* lock_key,
+                             const char* lock_name,
+                             ArtMethod* waiter_method,
+                             ArtMethod* owner_method)
+      NO_THREAD_SAFETY_ANALYSIS;
+  static void Record(Entry* entry, uint64_t wait_ns);
+
+  static bool enabled_;
+  // Allocated by the first Init() that enables recording, and never freed.
+  static Table* table_;
+  static const char* output_file_;
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(LockContentionProfiler);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_LOCK_CONTENTION_PROFILER_H_
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lock_contention_profiler.h"
+
+#include <sstream>
+
+#include "android-base/file.h"
+
+#include "atomic.h"
+#include "base/mutex.h"
+#include "base/time_utils.h"
+#include "common_runtime_test.h"
+#include "handle_scope-inl.h"
+#include "java_vm_ext.h"
+#include "mirror/class-inl.h"
+#include "monitor.h"
+#include "scoped_thread_state_change-inl.h"
+#include "thread_pool.h"
+
+namespace art {
+
+class LockContentionProfilerTest : public CommonRuntimeTest {
+ protected:
+  void SetUp() OVERRIDE {
+    CommonRuntimeTest::SetUp();
+    LockContentionProfiler::Init(/* enabled */ true, "");
+  }
+
+  void TearDown() OVERRIDE {
+    LockContentionProfiler::Init(/* enabled */ false, "");
+    CommonRuntimeTest::TearDown();
+  }
+};
+
+static constexpr const char* kTestMutexName = "lock contention profiler test mutex";
+
+struct ContendedMutex {
+  ContendedMutex() : mu(kTestMutexName), waiter_done(0) {}
+
+  Mutex mu;
+  AtomicInteger waiter_done;
+};
+
+static void* ContendedMutexWaiterCallback(void* arg) NO_THREAD_SAFETY_ANALYSIS {
+  ContendedMutex* state = reinterpret_cast<ContendedMutex*>(arg);
+  state->mu.ExclusiveLock(nullptr);
+  state->waiter_done.StoreSequentiallyConsistent(1);
+  state->mu.ExclusiveUnlock(nullptr);
+  return nullptr;
+}
+
+// GCC has trouble with our mutex tests, so we have to turn off thread safety analysis.
+static void ContendMutex(ContendedMutex* state) NO_THREAD_SAFETY_ANALYSIS {
+  state->mu.ExclusiveLock(Thread::Current());
+  pthread_t pthread;
+  ASSERT_EQ(0, pthread_create(&pthread, nullptr, ContendedMutexWaiterCallback, state));
+  NanoSleep(MsToNs(50));
+  EXPECT_EQ(0, state->waiter_done.LoadSequentiallyConsistent());
+  state->mu.ExclusiveUnlock(Thread::Current());
+  EXPECT_EQ(0, pthread_join(pthread, nullptr));
+  EXPECT_EQ(1, state->waiter_done.LoadSequentiallyConsistent());
+}
+
+TEST_F(LockContentionProfilerTest, MutexContention) {
+  uint64_t count_before = LockContentionProfiler::GetContentionCount();
+  uint64_t wait_ns_before = LockContentionProfiler::GetTotalWaitNs();
+
+  ContendedMutex state;
+  ContendMutex(&state);
+
+  EXPECT_GT(LockContentionProfiler::GetContentionCount(), count_before);
+  EXPECT_GT(LockContentionProfiler::GetTotalWaitNs(), wait_ns_before);
+
+  std::ostringstream sigquit;
+  LockContentionProfiler::DumpForSigQuit(sigquit);
+  EXPECT_NE(sigquit.str().find(std::string("mutex \"") + kTestMutexName + "\""),
+            std::string::npos) << sigquit.str();
+
+  std::ostringstream pprof;
+  LockContentionProfiler::DumpPprof(pprof);
+  EXPECT_EQ(0u, pprof.str().find("--- contention\n")) << pprof.str();
+  EXPECT_NE(pprof.str().find(std::string(" mutex:") + kTestMutexName + "\n"), std::string::npos)
+      << pprof.str();
+}
+
+class MonitorEnterTask : public Task {
+ public:
+  explicit MonitorEnterTask(jobject lock) : lock_(lock) {}
+
+  void Run(Thread* self) OVERRIDE {
+    ScopedObjectAccess soa(self);
+    ObjPtr<mirror::Object> obj = soa.Decode<mirror::Object>(lock_);
+    obj = Monitor::MonitorEnter(self, obj.Ptr(), /* trylock */ false);
+    Monitor::MonitorExit(self, obj.Ptr());
+  }
+
+  void Finalize() OVERRIDE {
+    delete this;
+  }
+
+ private:
+  const jobject lock_;
+};
+
+TEST_F(LockContentionProfilerTest, MonitorContention) {
+  Thread* self = Thread::Current();
+  ThreadPool thread_pool("Lock contention profiler test thread pool", 1);
+  {
+    ScopedObjectAccess soa(self);
+    StackHandleScope<1> hs(self);
+    Handle<mirror::Object> obj = hs.NewHandle(
+        class_linker_->FindSystemClass(self, "Ljava/lang/Object;")->AllocObject(self));
+    jobject lock = soa.Vm()->AddGlobalRef(self, obj.Get());
+    Monitor::MonitorEnter(self, obj.Get(), /* trylock */ false);
+    thread_pool.AddTask(self, new MonitorEnterTask(lock));
+    thread_pool.StartWorkers(self);
+    {
+      // Let the worker inflate the lock and block on it.
+      ScopedThreadSuspension sts(self, kNative);
+      NanoSleep(MsToNs(50));
+    }
+    Monitor::MonitorExit(self, obj.Get());
+    {
+      ScopedThreadSuspension sts(self, kNative);
+      thread_pool.Wait(self, /* do_work */ false, /* may_hold_locks */ false);
+    }
+    soa.Vm()->DeleteGlobalRef(self, lock);
+  }
+
+  std::ostringstream sigquit;
+  LockContentionProfiler::DumpForSigQuit(sigquit);
+  EXPECT_NE(sigquit.str().find("monitor of Ljava/lang/Object; held by"), std::string::npos)
+      << sigquit.str();
+
+  std::ostringstream pprof;
+  LockContentionProfiler::DumpPprof(pprof);
+  EXPECT_NE(pprof.str().find(" monitor:Ljava/lang/Object;\n"), std::string::npos) << pprof.str();
+}
+
+TEST_F(LockContentionProfilerTest, WritePprofFile) {
+  ContendedMutex state;
+  ContendMutex(&state);
+
+  ScratchFile file;
+  std::string error_msg;
+  ASSERT_TRUE(LockContentionProfiler::WritePprofFile(file.GetFilename(), &error_msg))
+      << error_msg;
+  std::string contents;
+  ASSERT_TRUE(android::base::ReadFileToString(file.GetFilename(), &contents));
+  EXPECT_EQ(0u, contents.find("--- contention\n")) << contents;
+  EXPECT_NE(contents.find(std::string(" mutex:") + kTestMutexName + "\n"), std::string::npos)
+      << contents;
+}
+
+}  // namespace art
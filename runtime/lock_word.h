@@ -57,8 +57,20 @@ class Monitor;
  *  |10|9|87654321098765432109876543210|
  *  |11|0| ForwardingAddress           |
  *
+ * When the lock word is in the "biased" state and its bits are formatted as follows:
+ *
+ *  |33|2|2|222222221111|1111110000000000|
+ *  |10|9|8|765432109876|5432109876543210|
+ *  |11|1|0| lock count |thread id owner |
+ *
  * The `r` bit stores the read barrier state.
  * The `m` bit stores the mark state.
+ *
+ * A biased lock word is reserved for its owner, which locks and unlocks it with plain stores. The
+ * lock count is the number of times the owner holds the lock, a count of zero means the object is
+ * reserved but unlocked. Forwarding addresses never set bit 29, so the biased state reuses the
+ * forwarding address state bits. As it takes the place of the mark bit, biased locking is not
+ * available with read barriers.
  */
 class LockWord {
  public:
@@ -113,6 +125,12 @@ class LockWord {
     kGCStateMaskShifted = kReadBarrierStateMaskShifted | kMarkBitStateMaskShifted,
     kGCStateMaskShiftedToggled = ~kGCStateMaskShifted,
 
+    // Biased state is the forwarding address state with the mark bit set. The count and owner use
+    // the thin lock layout.
+    kStateBiasedShifted = kStateForwardingAddressShifted | kMarkBitStateMaskShifted,
+    kBiasedStateMaskShifted = kStateMaskShifted | kMarkBitStateMaskShifted,
+    kBiasedOwnerAndStateMaskShifted = kBiasedStateMaskShifted | kThinLockOwnerMask,
+
     // When the state is kHashCode, the non-state bits hold the hashcode.
     // Note Object.hashCode() has the hash code layout hardcoded.
     kHashShift = 0,
@@ -141,6 +159,15 @@ class LockWord {
                     (kStateThinOrUnlocked << kStateShift));
   }
 
+  static LockWord FromBiasedThreadId(uint32_t thread_id, uint32_t count) {
+    DCHECK(!kUseReadBarrier);
+    CHECK_LE(thread_id, static_cast<uint32_t>(kThinLockMaxOwner));
+    CHECK_LE(count, static_cast<uint32_t>(kThinLockMaxCount));
+    return LockWord((thread_id << kThinLockOwnerShift) |
+                    (count << kThinLockCountShift) |
+                    kStateBiasedShifted);
+  }
+
   static LockWord FromForwardingAddress(size_t target) {
     DCHECK_ALIGNED(target, (1 << kStateSize));
     return LockWord((target >> kForwardingAddressShift) | kStateForwardingAddressShifted);
@@ -172,6 +199,7 @@ class LockWord {
     kFatLocked,   // See associated monitor.
     kHashCode,    // Lock word contains an identity hash.
     kForwardingAddress,  // Lock word contains the forwarding address of an object.
+    kBiased,      // Reserved for a single owner, locked if the count is not zero.
   };
 
   LockState GetState() const {
@@ -187,7 +215,7 @@ class LockWord {
         case kStateHash:
           return kHashCode;
         case kStateForwardingAddress:
-          return kForwardingAddress;
+          return ((value_ & kMarkBitStateMaskShifted) != 0) ? kBiased : kForwardingAddress;
         default:
           DCHECK_EQ(internal_state, static_cast<uint32_t>(kStateFat));
           return kFatLocked;
@@ -232,6 +260,12 @@ class LockWord {
   // Return the number of times a lock value has been locked.
   uint32_t ThinLockCount() const;
 
+  // Return the thread id the lock word is biased towards.
+  uint32_t BiasedLockOwner() const;
+
+  // Return the number of times the bias owner holds the lock, zero if it is only reserved.
+  uint32_t BiasedLockCount() const;
+
   // Return the Monitor encoded in a fat lock.
   Monitor* FatLockMonitor() const;
 
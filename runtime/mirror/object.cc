@@ -213,11 +213,26 @@ int32_t Object::IdentityHashCode() {
         // Already inflated, return the hash stored in the monitor.
         Monitor* monitor = lw.FatLockMonitor();
         DCHECK(monitor != nullptr);
-        return monitor->GetHashCode();
+        int32_t hash_code = monitor->GetHashCode();
+        if (hash_code != 0) {
+          return hash_code;
+        }
+        // The monitor was deflated concurrently, read the new lock word.
+        break;
       }
       case LockWord::kHashCode: {
         return lw.GetHashCode();
       }
+      case LockWord::kBiased: {
+        // Remove the bias, the lock word is then unlocked or thin locked.
+        Thread* self = Thread::Current();
+        StackHandleScope<1> hs(self);
+        Handle<mirror::Object> h_this(hs.NewHandle(current_this));
+        Monitor::RevokeBias(self, h_this);
+        // A GC may have occurred while we waited for the owner.
+        current_this = h_this.Get();
+        break;
+      }
       default: {
         LOG(FATAL) << "Invalid state during hashcode " << lw.GetState();
         break;
@@ -16,6 +16,7 @@
 
 #include "monitor.h"
 
+#include <algorithm>
 #include <vector>
 
 #include "android-base/stringprintf.h"
@@ -28,12 +29,16 @@
 #include "class_linker.h"
 #include "dex_file-inl.h"
 #include "dex_instruction-inl.h"
+#include "gc/scoped_gc_critical_section.h"
+#include "handshake.h"
+#include "lock_contention_profiler.h"
 #include "lock_word-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/object-inl.h"
 #include "scoped_thread_state_change-inl.h"
 #include "thread.h"
 #include "thread_list.h"
+#include "thread_pool.h"
 #include "verifier/method_verifier.h"
 #include "well_known_classes.h"
 
@@ -43,6 +48,29 @@ using android::base::StringPrintf;
 
 static constexpr uint64_t kLongWaitMs = 100;
 
+// Contended thin locks are first spun on with exponential backoff, since a running owner usually
+// releases them within a few hundred nanoseconds. Before spinning longer we check that the owner
+// is actually running; if it is blocked, suspended or in native code we inflate right away.
+static constexpr size_t kThinLockSpinRounds = 10;
+static constexpr size_t kThinLockOwnerCheckRound = 4;
+
+// Upper bound for the number of pause instructions between two looks at a contended lock.
+static constexpr uint32_t kMaxSpinBackoff = 64;
+
+// Bounds for the number of pause instructions a thread spends on a contended fat lock before
+// blocking. The actual duration is adapted per monitor from the observed hold times.
+static constexpr uint32_t kMinMonitorSpins = 16;
+static constexpr uint32_t kInitialMonitorSpins = 256;
+static constexpr uint32_t kMaxMonitorSpins = 4096;
+
+// Stored as the hash code of a monitor that was deflated without one. Identity hash codes are
+// masked with LockWord::kHashMask, so this never is a real hash code.
+static constexpr int32_t kDeflatedHashCode = -1;
+
+// Number of monitors looked at for each acquisition of monitor_list_lock_ during concurrent
+// deflation, which keeps inflating threads and the GC from waiting for a whole pass.
+static constexpr size_t kDeflationBatchSize = 256;
+
 /*
  * Every Object has a monitor associated with it, but not every Object is actually locked.  Even
  * the ones that are locked do not need a full-fledged monitor until a) there is actual contention
@@ -71,9 +99,14 @@ static constexpr uint64_t kLongWaitMs = 100;
  */
 
 uint32_t Monitor::lock_profiling_threshold_ = 0;
+Atomic<bool> Monitor::biased_locking_enabled_(false);
+Atomic<uint64_t> Monitor::num_bias_revocations_(0);
+Atomic<uint64_t> Monitor::bias_revocation_window_start_ms_(0);
+Atomic<uint32_t> Monitor::bias_revocations_in_window_(0);
 
-void Monitor::Init(uint32_t lock_profiling_threshold) {
+void Monitor::Init(uint32_t lock_profiling_threshold, bool use_biased_locking) {
   lock_profiling_threshold_ = lock_profiling_threshold;
+  biased_locking_enabled_.StoreRelaxed(use_biased_locking && !kUseReadBarrier);
 }
 
 Monitor::Monitor(Thread* self, Thread* owner, mirror::Object* obj, int32_t hash_code)
@@ -87,6 +120,11 @@ Monitor::Monitor(Thread* self, Thread* owner, mirror::Object* obj, int32_t hash_
       hash_code_(hash_code),
       locking_method_(nullptr),
       locking_dex_pc_(0),
+      releasing_method_(nullptr),
+      releasing_method_requested_(false),
+      spin_duration_(kInitialMonitorSpins),
+      last_contention_ms_(MilliTime()),
+      deflated_(false),
       monitor_id_(MonitorPool::ComputeMonitorId(this, self)) {
 #ifdef __LP64__
   DCHECK(false) << "Should not be reached in 64b";
@@ -110,6 +148,11 @@ Monitor::Monitor(Thread* self, Thread* owner, mirror::Object* obj, int32_t hash_
       hash_code_(hash_code),
       locking_method_(nullptr),
       locking_dex_pc_(0),
+      releasing_method_(nullptr),
+      releasing_method_requested_(false),
+      spin_duration_(kInitialMonitorSpins),
+      last_contention_ms_(MilliTime()),
+      deflated_(false),
       monitor_id_(id) {
 #ifdef __LP64__
   next_free_ = nullptr;
@@ -127,7 +170,9 @@ int32_t Monitor::GetHashCode() {
     }
   }
   DCHECK(HasHashCode());
-  return hash_code_.LoadRelaxed();
+  int32_t hash_code = hash_code_.LoadRelaxed();
+  // A monitor deflated concurrently has no hash code, the caller re-reads the lock word.
+  return (hash_code != kDeflatedHashCode) ? hash_code : 0;
 }
 
 bool Monitor::Install(Thread* self) {
@@ -319,6 +364,9 @@ std::string Monitor::PrettyContentionInfo(const std::string& owner_name,
 }
 
 bool Monitor::TryLockLocked(Thread* self) {
+  if (UNLIKELY(deflated_)) {
+    return false;
+  }
   if (owner_ == nullptr) {  // Unowned.
     owner_ = self;
     CHECK_EQ(lock_count_, 0);
@@ -341,17 +389,81 @@ bool Monitor::TryLock(Thread* self) {
   return TryLockLocked(self);
 }
 
-void Monitor::Lock(Thread* self) {
+bool Monitor::IsDeflated(Thread* self) {
+  MutexLock mu(self, monitor_lock_);
+  return deflated_;
+}
+
+bool Monitor::SpinWhileOwnerRunning(Thread* self) {
+  Thread* const owner = owner_;
+  DCHECK(owner != nullptr);
+  DCHECK_NE(owner, self);
+  const uint32_t spin_limit = spin_duration_;
+  uint32_t spins = 0u;
+  uint32_t backoff = 1u;
+  // The owner cannot exit while it owns the monitor and we hold monitor_lock_, so its state may
+  // be looked at here. Stop spinning once we are asked to suspend or run a checkpoint, the blocking
+  // path below lets the request proceed.
+  while (owner_ == owner &&
+         spins < spin_limit &&
+         owner->GetState() == kRunnable &&
+         !self->TestAllFlags()) {
+    monitor_lock_.Unlock(self);
+    // Racy reads of owner_, the monitor is re-checked under monitor_lock_.
+    for (uint32_t i = 0; i != backoff && GetOwner() == owner; ++i) {
+      CpuRelax();
+      ++spins;
+    }
+    backoff = std::min(2u * backoff, kMaxSpinBackoff);
+    monitor_lock_.Lock(self);
+  }
+  if (owner_ != owner) {
+    // The lock was released after `spins` pauses. Move towards spinning twice as long, so that
+    // slightly longer hold times are still covered.
+    uint32_t target = std::min(2u * spins, kMaxMonitorSpins);
+    spin_duration_ = std::max((spin_duration_ + target) / 2u, kMinMonitorSpins);
+    return true;
+  }
+  if (spins >= spin_limit) {
+    // The lock was held for longer than we were willing to spin. Blocking is cheaper.
+    spin_duration_ = std::max(spin_limit / 2u, kMinMonitorSpins);
+  }
+  return false;
+}
+
+bool Monitor::Lock(Thread* self) {
   MutexLock mu(self, monitor_lock_);
+  bool may_spin = true;
   while (true) {
     if (TryLockLocked(self)) {
-      return;
+      return true;
+    }
+    // Spinning threads are not counted as waiters, so the monitor may get deflated meanwhile.
+    if (UNLIKELY(deflated_)) {
+      return false;
+    }
+    // Contended. A running owner is likely to release the monitor soon, so spin for a while before
+    // blocking. Spin only once before each wait, other threads may keep taking the monitor first.
+    last_contention_ms_ = MilliTime();
+    if (may_spin && SpinWhileOwnerRunning(self)) {
+      may_spin = false;
+      continue;
     }
-    // Contended.
+    may_spin = true;
     const bool log_contention = (lock_profiling_threshold_ != 0);
     uint64_t wait_start_ms = log_contention ? MilliTime() : 0;
     ArtMethod* owners_method = locking_method_;
     uint32_t owners_dex_pc = locking_dex_pc_;
+    // For the contention profiler, ask the owner to tell which method releases the monitor.
+    const bool profile_contention = LockContentionProfiler::IsEnabled();
+    ArtMethod* waiters_method = nullptr;
+    uint64_t wait_start_ns = 0u;
+    uint64_t wait_ns = 0u;
+    if (profile_contention) {
+      waiters_method = self->GetCurrentMethod(nullptr);
+      releasing_method_requested_ = true;
+      wait_start_ns = NanoTime();
+    }
     // Do this before releasing the lock so that we don't get deflated.
     size_t num_waiters = num_waiters_;
     ++num_waiters_;
@@ -398,6 +510,9 @@ void Monitor::Lock(Thread* self) {
       }
       if (original_owner_thread_id != 0u) {
         // Woken from contention.
+        if (profile_contention) {
+          wait_ns = NanoTime() - wait_start_ns;
+        }
         if (log_contention) {
           uint32_t original_owner_tid = 0;
           std::string original_owner_name;
@@ -459,6 +574,13 @@ void Monitor::Lock(Thread* self) {
     self->SetMonitorEnterObject(nullptr);
     monitor_lock_.Lock(self);  // Reacquire locks in order.
     --num_waiters_;
+    if (wait_ns != 0u) {
+      LockContentionProfiler::RecordMonitorContention(
+          GetObject(),
+          waiters_method,
+          (owners_method != nullptr) ? owners_method : releasing_method_,
+          wait_ns);
+    }
   }
 }
 
@@ -558,6 +680,13 @@ void Monitor::FailedUnlock(mirror::Object* o,
   }
 }
 
+void Monitor::RecordReleasingMethodIfRequested(Thread* self) {
+  if (UNLIKELY(releasing_method_requested_)) {
+    releasing_method_ = self->GetCurrentMethod(nullptr);
+    releasing_method_requested_ = false;
+  }
+}
+
 bool Monitor::Unlock(Thread* self) {
   DCHECK(self != nullptr);
   uint32_t owner_thread_id = 0u;
@@ -571,6 +700,7 @@ bool Monitor::Unlock(Thread* self) {
       // We own the monitor, so nobody else can be in here.
       AtraceMonitorUnlock();
       if (lock_count_ == 0) {
+        RecordReleasingMethodIfRequested(self);
         owner_ = nullptr;
         locking_method_ = nullptr;
         locking_dex_pc_ = 0;
@@ -628,6 +758,8 @@ void Monitor::Wait(Thread* self, int64_t ms, int32_t ns,
    */
   AppendToWaitSet(self);
   ++num_waiters_;
+  last_contention_ms_ = MilliTime();
+  RecordReleasingMethodIfRequested(self);
   int prev_lock_count = lock_count_;
   lock_count_ = 0;
   owner_ = nullptr;
@@ -706,7 +838,8 @@ void Monitor::Wait(Thread* self, int64_t ms, int32_t ns,
 
   AtraceMonitorUnlock();  // End Wait().
 
-  // Re-acquire the monitor and lock.
+  // Re-acquire the monitor and lock. We are counted in num_waiters_, so the monitor cannot have
+  // been deflated.
   Lock(self);
   monitor_lock_.Lock(self);
   self->GetWaitMutex()->AssertNotHeld(self);
@@ -817,6 +950,41 @@ bool Monitor::Deflate(Thread* self, mirror::Object* obj) {
   return true;
 }
 
+bool Monitor::DeflateIfIdle(Thread* self, uint64_t now_ms, uint64_t min_idle_ms) {
+  MutexLock mu(self, monitor_lock_);
+  DCHECK(!deflated_);
+  if (owner_ != nullptr ||
+      num_waiters_ != 0 ||
+      wait_set_ != nullptr ||
+      now_ms - std::min(now_ms, last_contention_ms_) < min_idle_ms) {
+    return false;
+  }
+  mirror::Object* obj = GetObject();
+  if (obj == nullptr) {
+    return false;  // Deflated by Monitor::Deflate for the image writer, freed by the next GC.
+  }
+  // Keep other threads from storing a hash code in the monitor that the lock word would lose.
+  bool has_hash_code =
+      !hash_code_.CompareExchangeStrongSequentiallyConsistent(0, kDeflatedHashCode);
+  while (true) {
+    LockWord lw = obj->GetLockWord(true);
+    DCHECK_EQ(lw.GetState(), LockWord::kFatLocked);
+    DCHECK_EQ(lw.FatLockMonitor(), this);
+    LockWord new_lw = has_hash_code
+        ? LockWord::FromHashCode(hash_code_.LoadRelaxed(), lw.GCState())
+        : LockWord::FromDefault(lw.GCState());
+    // Mutators do not write the lock word of an inflated object, but the GC state may change.
+    if (obj->CasLockWordWeakRelease(lw, new_lw)) {
+      break;
+    }
+  }
+  VLOG(monitor) << "Concurrently deflated " << obj << " to "
+      << (has_hash_code ? "hash monitor" : "empty lock word");
+  deflated_ = true;
+  obj_ = GcRoot<mirror::Object>(nullptr);
+  return true;
+}
+
 void Monitor::Inflate(Thread* self, Thread* owner, mirror::Object* obj, int32_t hash_code) {
   DCHECK(self != nullptr);
   DCHECK(obj != nullptr);
@@ -881,6 +1049,106 @@ static mirror::Object* FakeUnlock(mirror::Object* obj)
   return obj;
 }
 
+// Returns whether the thread holding a thin lock is running and may release it soon. An owner that
+// is gone counts as running, the lock word will have changed when we look at it again.
+static bool IsThinLockOwnerRunnable(Thread* self, uint32_t owner_thread_id)
+    REQUIRES(!Locks::thread_list_lock_) {
+  MutexLock mu(self, *Locks::thread_list_lock_);
+  Thread* owner = Runtime::Current()->GetThreadList()->FindThreadByThreadId(owner_thread_id);
+  return owner == nullptr || owner->GetState() == kRunnable;
+}
+
+// Returns the lock word with the bias removed. The owner keeps holding the lock as a thin lock.
+static LockWord UnbiasedLockWord(LockWord lock_word) {
+  const uint32_t count = lock_word.BiasedLockCount();
+  if (count == 0) {
+    return LockWord::Default();
+  }
+  return LockWord::FromThinLockId(lock_word.BiasedLockOwner(), count - 1, 0 /* gc_state */);
+}
+
+// Removes the bias of `owner_thread_id` from the lock word. The owner must not run a lock fast
+// path concurrently, but other threads may be revoking the same bias.
+static void CasUnbiasedLockWord(mirror::Object* obj, uint32_t owner_thread_id)
+    REQUIRES_SHARED(Locks::mutator_lock_) {
+  LockWord lock_word = obj->GetLockWord(true);
+  while (lock_word.GetState() == LockWord::kBiased &&
+         lock_word.BiasedLockOwner() == owner_thread_id &&
+         !obj->CasLockWordWeakRelease(lock_word, UnbiasedLockWord(lock_word))) {
+    lock_word = obj->GetLockWord(true);
+  }
+}
+
+class BiasRevocationClosure FINAL : public Closure {
+ public:
+  explicit BiasRevocationClosure(Handle<mirror::Object> obj) : obj_(obj) {}
+
+  void Run(Thread* thread) OVERRIDE {
+    // The owner is at a suspend point or suspended, it is not in the middle of locking. Note
+    // thread and self may not be equal if thread was already suspended at the point of the
+    // request.
+    ScopedObjectAccess soa(Thread::Current());
+    CasUnbiasedLockWord(obj_.Get(), thread->GetThreadId());
+  }
+
+ private:
+  // The object to revoke the bias of, in the handle scope of the requestor.
+  Handle<mirror::Object> obj_;
+
+  DISALLOW_COPY_AND_ASSIGN(BiasRevocationClosure);
+};
+
+void Monitor::RevokeBias(Thread* self, Handle<mirror::Object> obj) {
+  LockWord lock_word = obj->GetLockWord(true);
+  if (lock_word.GetState() != LockWord::kBiased) {
+    return;
+  }
+  const uint32_t owner_thread_id = lock_word.BiasedLockOwner();
+  if (owner_thread_id == self->GetThreadId()) {
+    // Only the owner writes a biased lock word.
+    obj->SetLockWord(UnbiasedLockWord(lock_word), false /* volatile */);
+    return;
+  }
+  self->AssertThreadSuspensionIsAllowable();
+  RecordBiasRevocation();
+  ThreadList* thread_list = Runtime::Current()->GetThreadList();
+  BiasRevocationClosure closure(obj);
+  Handshake handshake(&closure);
+  while (true) {
+    {
+      MutexLock mu(self, *Locks::thread_list_lock_);
+      if (thread_list->FindThreadByThreadId(owner_thread_id) == nullptr) {
+        // The owner exited, a new thread with its id cannot lock before it is registered.
+        CasUnbiasedLockWord(obj.Get(), owner_thread_id);
+        return;
+      }
+    }
+    // Only the owner takes part, the other threads keep running.
+    if (handshake.StartWithThread(self, owner_thread_id)) {
+      handshake.Wait(self);
+      return;
+    }
+  }
+}
+
+void Monitor::RecordBiasRevocation() {
+  num_bias_revocations_.FetchAndAddRelaxed(1);
+  const uint64_t now_ms = MilliTime();
+  if (now_ms - bias_revocation_window_start_ms_.LoadRelaxed() >= 1000) {
+    // Racy, revocations at the start of a window may get lost.
+    bias_revocation_window_start_ms_.StoreRelaxed(now_ms);
+    bias_revocations_in_window_.StoreRelaxed(0);
+  }
+  if (bias_revocations_in_window_.FetchAndAddRelaxed(1) + 1 == kMaxBiasRevocationsPerSecond &&
+      biased_locking_enabled_.LoadRelaxed()) {
+    // Objects are shared between threads too often for the biases to pay for the checkpoints.
+    // Existing biases are revoked as they are hit.
+    biased_locking_enabled_.StoreRelaxed(false);
+    LOG(INFO) << "Disabling biased locking after " << kMaxBiasRevocationsPerSecond
+              << " revocations within a second";
+  }
+}
+
 mirror::Object* Monitor::MonitorEnter(Thread* self, mirror::Object* obj, bool trylock) {
   DCHECK(self != nullptr);
   DCHECK(obj != nullptr);
@@ -898,7 +1166,9 @@ mirror::Object* Monitor::MonitorEnter(Thread* self, mirror::Object* obj, bool tr
     switch (lock_word.GetState()) {
       case LockWord::kUnlocked: {
         // No ordering required for preceding lockword read, since we retest.
-        LockWord thin_locked(LockWord::FromThinLockId(thread_id, 0, lock_word.GCState()));
+        LockWord thin_locked = IsBiasedLockingEnabled()
+            ? LockWord::FromBiasedThreadId(thread_id, 1)
+            : LockWord::FromThinLockId(thread_id, 0, lock_word.GCState());
         if (h_obj->CasLockWordWeakAcquire(lock_word, thin_locked)) {
           AtraceMonitorLock(self, h_obj.Get(), false /* is_wait */);
           return h_obj.Get();  // Success!
@@ -940,15 +1210,23 @@ mirror::Object* Monitor::MonitorEnter(Thread* self, mirror::Object* obj, bool tr
           // Contention.
           contention_count++;
           Runtime* runtime = Runtime::Current();
-          if (contention_count <= runtime->GetMaxSpinsBeforeThinLockInflation()) {
+          if (contention_count == kThinLockOwnerCheckRound &&
+              !IsThinLockOwnerRunnable(self, owner_thread_id)) {
+            // The owner will not release the lock any time soon, stop spinning and wait for it
+            // on the inflated monitor.
+            contention_count = 0;
+            InflateThinLocked(self, h_obj, lock_word, 0);
+          } else if (contention_count <= kThinLockSpinRounds) {
+            // Spin with exponential backoff, re-reading the lock word after every round.
+            const uint32_t pauses = std::min(1u << (contention_count - 1u), kMaxSpinBackoff);
+            for (uint32_t i = 0; i != pauses; ++i) {
+              CpuRelax();
+            }
+          } else if (contention_count <= runtime->GetMaxSpinsBeforeThinLockInflation()) {
             // TODO: Consider switching the thread state to kBlocked when we are yielding.
             // Use sched_yield instead of NanoSleep since NanoSleep can wait much longer than the
             // parameter you pass in. This can cause thread suspension to take excessively long
             // and make long pauses. See b/16307460.
-            // TODO: We should literally spin first, without sched_yield. Sched_yield either does
-            // nothing (at significant expense), or guarantees that we wait at least microseconds.
-            // If the owner is running, I would expect the median lock hold time to be hundreds
-            // of nanoseconds or less.
             sched_yield();
           } else {
             contention_count = 0;
@@ -964,11 +1242,16 @@ mirror::Object* Monitor::MonitorEnter(Thread* self, mirror::Object* obj, bool tr
         QuasiAtomic::ThreadFenceAcquire();
         Monitor* mon = lock_word.FatLockMonitor();
         if (trylock) {
-          return mon->TryLock(self) ? h_obj.Get() : nullptr;
-        } else {
-          mon->Lock(self);
+          if (mon->TryLock(self)) {
+            return h_obj.Get();  // Success!
+          }
+          if (!mon->IsDeflated(self)) {
+            return nullptr;
+          }
+        } else if (mon->Lock(self)) {
           return h_obj.Get();  // Success!
         }
+        continue;  // The monitor was deflated, start from the beginning.
       }
       case LockWord::kHashCode:
         // Inflate with the existing hashcode.
@@ -976,6 +1259,24 @@ mirror::Object* Monitor::MonitorEnter(Thread* self, mirror::Object* obj, bool tr
         // on the visibility of any prior computation.
         Inflate(self, nullptr, h_obj.Get(), lock_word.GetHashCode());
         continue;  // Start from the beginning.
+      case LockWord::kBiased: {
+        if (lock_word.BiasedLockOwner() == thread_id &&
+            lock_word.BiasedLockCount() < LockWord::kThinLockMaxCount) {
+          // Only the owner writes a biased lock word, no atomic operation is needed.
+          LockWord biased(LockWord::FromBiasedThreadId(thread_id,
+                                                       lock_word.BiasedLockCount() + 1));
+          h_obj->SetLockWord(biased, false /* volatile */);
+          AtraceMonitorLock(self, h_obj.Get(), false /* is_wait */);
+          return h_obj.Get();  // Success!
+        }
+        if (trylock && lock_word.BiasedLockOwner() != thread_id &&
+            lock_word.BiasedLockCount() != 0) {
+          return nullptr;
+        }
+        // Either held by another thread or the count would overflow. Continue as a thin lock.
+        RevokeBias(self, h_obj);
+        continue;  // Start from the beginning.
+      }
       default: {
         LOG(FATAL) << "Invalid monitor state " << lock_word.GetState();
         UNREACHABLE();
@@ -1038,6 +1339,22 @@ bool Monitor::MonitorExit(Thread* self, mirror::Object* obj) {
         Monitor* mon = lock_word.FatLockMonitor();
         return mon->Unlock(self);
       }
+      case LockWord::kBiased: {
+        uint32_t thread_id = self->GetThreadId();
+        uint32_t owner_thread_id = lock_word.BiasedLockOwner();
+        if (owner_thread_id != thread_id || lock_word.BiasedLockCount() == 0) {
+          FailedUnlock(h_obj.Get(),
+                       thread_id,
+                       lock_word.BiasedLockCount() != 0 ? owner_thread_id : 0u,
+                       nullptr);
+          return false;  // Failure.
+        }
+        // Keep the bias, only the owner writes a biased lock word.
+        LockWord biased(LockWord::FromBiasedThreadId(thread_id, lock_word.BiasedLockCount() - 1));
+        h_obj->SetLockWord(biased, false /* volatile */);
+        AtraceMonitorUnlock();
+        return true;  // Success!
+      }
       default: {
         LOG(FATAL) << "Invalid monitor state " << lock_word.GetState();
         return false;
@@ -1072,6 +1389,17 @@ void Monitor::Wait(Thread* self, mirror::Object *obj, int64_t ms, int32_t ns,
         }
         break;
       }
+      case LockWord::kBiased: {
+        if (lock_word.BiasedLockOwner() != self->GetThreadId() ||
+            lock_word.BiasedLockCount() == 0) {
+          ThrowIllegalMonitorStateExceptionF("object not locked by thread before wait()");
+          return;  // Failure.
+        }
+        // We own the lock, drop the bias so that it can be inflated as a thin lock.
+        obj->SetLockWord(UnbiasedLockWord(lock_word), false /* volatile */);
+        lock_word = obj->GetLockWord(true);
+        break;
+      }
       case LockWord::kFatLocked:  // Unreachable given the loop condition above. Fall-through.
       default: {
         LOG(FATAL) << "Invalid monitor state " << lock_word.GetState();
@@ -1104,6 +1432,15 @@ void Monitor::DoNotify(Thread* self, mirror::Object* obj, bool notify_all) {
         return;  // Success.
       }
     }
+    case LockWord::kBiased: {
+      if (lock_word.BiasedLockOwner() != self->GetThreadId() ||
+          lock_word.BiasedLockCount() == 0) {
+        ThrowIllegalMonitorStateExceptionF("object not locked by thread before notify()");
+        return;  // Failure.
+      }
+      // Biased locks have no waiters either.
+      return;  // Success.
+    }
     case LockWord::kFatLocked: {
       Monitor* mon = lock_word.FatLockMonitor();
       if (notify_all) {
@@ -1130,6 +1467,11 @@ uint32_t Monitor::GetLockOwnerThreadId(mirror::Object* obj) {
       return ThreadList::kInvalidThreadId;
     case LockWord::kThinLocked:
       return lock_word.ThinLockOwner();
+    case LockWord::kBiased:
+      // A reserved but unlocked object has no owner.
+      return (lock_word.BiasedLockCount() != 0)
+          ? lock_word.BiasedLockOwner()
+          : ThreadList::kInvalidThreadId;
     case LockWord::kFatLocked: {
       Monitor* mon = lock_word.FatLockMonitor();
       return mon->GetOwnerThreadId();
@@ -1174,7 +1516,8 @@ void Monitor::DescribeWait(std::ostream& os, const Thread* thread) {
     if (pretty_object == nullptr) {
       os << wait_message << "an unknown object";
     } else {
-      if ((pretty_object->GetLockWord(true).GetState() == LockWord::kThinLocked) &&
+      const LockWord::LockState lock_state = pretty_object->GetLockWord(true).GetState();
+      if ((lock_state == LockWord::kThinLocked || lock_state == LockWord::kBiased) &&
           Locks::mutator_lock_->IsExclusiveHeld(Thread::Current())) {
         // Getting the identity hashcode here would result in lock inflation and suspension of the
         // current thread, which isn't safe if this is the only runnable thread.
@@ -1298,6 +1641,8 @@ bool Monitor::IsValidLockWord(LockWord lock_word) {
     }
     case LockWord::kHashCode:
       return true;
+    case LockWord::kBiased:
+      return lock_word.BiasedLockOwner() != ThreadList::kInvalidThreadId;
     default:
       LOG(FATAL) << "Unreachable";
       UNREACHABLE();
@@ -1338,7 +1683,8 @@ uint32_t Monitor::GetOwnerThreadId() {
 
 MonitorList::MonitorList()
     : allow_new_monitors_(true), monitor_list_lock_("MonitorList lock", kMonitorListLock),
-      monitor_add_condition_("MonitorList disallow condition", monitor_list_lock_) {
+      monitor_add_condition_("MonitorList disallow condition", monitor_list_lock_),
+      num_deflation_passes_(0u), num_deflated_monitors_(0u) {
 }
 
 MonitorList::~MonitorList() {
@@ -1412,30 +1758,75 @@ size_t MonitorList::Size() {
   return list_.size();
 }
 
-class MonitorDeflateVisitor : public IsMarkedVisitor {
+class MonitorDeflationClosure : public Closure {
  public:
-  MonitorDeflateVisitor() : self_(Thread::Current()), deflate_count_(0) {}
-
-  virtual mirror::Object* IsMarked(mirror::Object* object) OVERRIDE
-      REQUIRES_SHARED(Locks::mutator_lock_) {
-    if (Monitor::Deflate(self_, object)) {
-      DCHECK_NE(object->GetLockWord(true).GetState(), LockWord::kFatLocked);
-      ++deflate_count_;
-      // If we deflated, return null so that the monitor gets removed from the array.
-      return nullptr;
-    }
-    return object;  // Monitor was not deflated.
+  virtual void Run(Thread* thread ATTRIBUTE_UNUSED) OVERRIDE {
+    // Reaching the checkpoint means the thread is done with any monitor it read from a lock word
+    // before the deflation, nothing else to do.
   }
-
-  Thread* const self_;
-  size_t deflate_count_;
 };
 
-size_t MonitorList::DeflateMonitors() {
-  MonitorDeflateVisitor visitor;
-  Locks::mutator_lock_->AssertExclusiveHeld(visitor.self_);
-  SweepMonitorList(&visitor);
-  return visitor.deflate_count_;
+size_t MonitorList::DeflateIdleMonitors(Thread* self, uint64_t min_idle_ms) {
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  const uint64_t now_ms = MilliTime();
+  std::vector<Monitor*> deflated;
+  size_t remaining;
+  {
+    MutexLock mu(self, monitor_list_lock_);
+    remaining = list_.size();
+  }
+  while (remaining != 0u) {
+    ScopedObjectAccess soa(self);
+    // Keep the GC from sweeping or moving the objects of the monitors while we look at them.
+    gc::ScopedGCCriticalSection gcs(self,
+                                    gc::kGcCauseMonitorDeflation,
+                                    gc::kCollectorTypeMonitorDeflation);
+    MutexLock mu(self, monitor_list_lock_);
+    // New monitors are added at the front, take the old ones from the back and move the ones
+    // that stay inflated to the front.
+    size_t batch_size = std::min(std::min(remaining, list_.size()), kDeflationBatchSize);
+    remaining = (batch_size != 0u) ? remaining - batch_size : 0u;
+    for (size_t i = 0; i != batch_size; ++i) {
+      Monitor* m = list_.back();
+      list_.pop_back();
+      if (m->DeflateIfIdle(self, now_ms, min_idle_ms)) {
+        deflated.push_back(m);
+      } else {
+        list_.push_front(m);
+      }
+    }
+  }
+  if (!deflated.empty()) {
+    // Threads that read the lock word of a deflated object before the deflation may still be
+    // about to use the monitor. They do so without passing a suspend point, so the monitors can
+    // be reused once every thread ran a checkpoint.
+    MonitorDeflationClosure closure;
+    Handshake handshake(&closure);
+    ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
+    handshake.StartWithAllThreads(self);
+    handshake.Wait(self);
+    for (Monitor* m : deflated) {
+      MonitorPool::ReleaseMonitor(self, m);
+    }
+  }
+  MutexLock mu(self, monitor_list_lock_);
+  ++num_deflation_passes_;
+  num_deflated_monitors_ += deflated.size();
+  return deflated.size();
+}
+
+void MonitorList::DumpForSigQuit(std::ostream& os) {
+  {
+    MutexLock mu(Thread::Current(), monitor_list_lock_);
+    os << "Inflated monitors: " << list_.size() << " live, " << num_deflated_monitors_
+       << " deflated concurrently in " << num_deflation_passes_ << " passes\n";
+  }
+  const uint64_t num_bias_revocations = Monitor::GetBiasRevocationCount();
+  if (Monitor::IsBiasedLockingEnabled() || num_bias_revocations != 0) {
+    os << "Biased locking " << (Monitor::IsBiasedLockingEnabled() ? "enabled" : "disabled")
+       << ", " << num_bias_revocations << " revocations\n";
+  }
+  MonitorPool::DumpForSigQuit(os);
 }
 
 MonitorInfo::MonitorInfo(mirror::Object* obj) : owner_(nullptr), entry_count_(0) {
@@ -1453,6 +1844,13 @@ MonitorInfo::MonitorInfo(mirror::Object* obj) : owner_(nullptr), entry_count_(0)
       entry_count_ = 1 + lock_word.ThinLockCount();
       // Thin locks have no waiters.
       break;
+    case LockWord::kBiased:
+      if (lock_word.BiasedLockCount() != 0) {
+        owner_ = Runtime::Current()->GetThreadList()->FindThreadByThreadId(
+            lock_word.BiasedLockOwner());
+        entry_count_ = lock_word.BiasedLockCount();
+      }
+      break;
     case LockWord::kFatLocked: {
       Monitor* mon = lock_word.FatLockMonitor();
       owner_ = mon->owner_;
@@ -55,7 +55,28 @@ class Monitor {
 
   ~Monitor();
 
-  static void Init(uint32_t lock_profiling_threshold);
+  // Revocations of biased locks per second above which biased locking is turned off.
+  constexpr static uint32_t kMaxBiasRevocationsPerSecond = 100;
+
+  static void Init(uint32_t lock_profiling_threshold, bool use_biased_locking);
+
+  // Whether unlocked objects are biased towards the first thread that locks them. Not supported
+  // with read barriers, see LockWord.
+  static bool IsBiasedLockingEnabled() {
+    return biased_locking_enabled_.LoadRelaxed();
+  }
+
+  // Removes the bias of the object's lock word, if any. A lock word biased towards another thread
+  // is converted by that thread at a checkpoint, so this may suspend and move objects. The owner
+  // keeps holding the lock as a thin lock. The owner may bias the object again right away, callers
+  // have to re-read the lock word.
+  static void RevokeBias(Thread* self, Handle<mirror::Object> obj)
+      REQUIRES(!Locks::thread_list_lock_, !Locks::thread_suspend_count_lock_)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  static uint64_t GetBiasRevocationCount() {
+    return num_bias_revocations_.LoadRelaxed();
+  }
 
   // Return the thread id of the lock owner or 0 when there is no owner.
   static uint32_t GetLockOwnerThreadId(mirror::Object* obj)
@@ -117,6 +138,7 @@ class Monitor {
     return owner_;
   }
 
+  // Returns 0 if the monitor was deflated concurrently.
   int32_t GetHashCode();
 
   bool IsLocked() REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(!monitor_lock_);
@@ -125,6 +147,8 @@ class Monitor {
     return hash_code_.LoadRelaxed() != 0;
   }
 
+  bool IsDeflated(Thread* self) REQUIRES(!monitor_lock_);
+
   MonitorId GetMonitorId() const {
     return monitor_id_;
   }
@@ -193,7 +217,29 @@ class Monitor {
                !monitor_lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
-  // Try to lock without blocking, returns true if we acquired the lock.
+  // Called with a contended monitor, spins for up to spin_duration_ pauses while the owner is
+  // running. Returns true if the owner released the monitor in the meantime. The spin duration
+  // is adjusted to the observed hold time.
+  bool SpinWhileOwnerRunning(Thread* self)
+      REQUIRES(monitor_lock_)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  // Called by the owner when it gives up the monitor. Remembers the current method for the
+  // contention profiler if a contender asked for it.
+  void RecordReleasingMethodIfRequested(Thread* self)
+      REQUIRES(monitor_lock_)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  // Deflates the monitor if it is unowned, has no waiters and saw no contention for at least
+  // `min_idle_ms`. Mutators keep running, so the lock word is updated with a CAS and threads that
+  // still hold on to the monitor see it as deflated. The monitor must not be reused before all
+  // threads passed a suspend point.
+  bool DeflateIfIdle(Thread* self, uint64_t now_ms, uint64_t min_idle_ms)
+      REQUIRES(!monitor_lock_)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  // Try to lock without blocking, returns true if we acquired the lock. Also fails if the
+  // monitor was deflated concurrently, see IsDeflated().
   bool TryLock(Thread* self)
       REQUIRES(!monitor_lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
@@ -202,7 +248,9 @@ class Monitor {
       REQUIRES(monitor_lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
-  void Lock(Thread* self)
+  // Returns false if the monitor was deflated concurrently, the caller has to look at the lock
+  // word again.
+  bool Lock(Thread* self)
       REQUIRES(!monitor_lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
   bool Unlock(Thread* thread)
@@ -270,8 +318,18 @@ class Monitor {
       REQUIRES_SHARED(Locks::mutator_lock_);
   ALWAYS_INLINE static void AtraceMonitorUnlock();
 
+  // Counts a revocation of another thread's bias and turns biased locking off if they are too
+  // frequent.
+  static void RecordBiasRevocation();
+
   static uint32_t lock_profiling_threshold_;
 
+  // Read directly by the assembly lock fast path on x86-64.
+  static Atomic<bool> biased_locking_enabled_;
+  static Atomic<uint64_t> num_bias_revocations_;
+  static Atomic<uint64_t> bias_revocation_window_start_ms_;
+  static Atomic<uint32_t> bias_revocations_in_window_;
+
   Mutex monitor_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
 
   ConditionVariable monitor_contenders_ GUARDED_BY(monitor_lock_);
@@ -302,6 +360,24 @@ class Monitor {
   ArtMethod* locking_method_ GUARDED_BY(monitor_lock_);
   uint32_t locking_dex_pc_ GUARDED_BY(monitor_lock_);
 
+  // Method that last released the monitor after a contender set releasing_method_requested_,
+  // used by the lock contention profiler. Unlike locking_method_, this costs nothing unless the
+  // monitor is contended.
+  ArtMethod* releasing_method_ GUARDED_BY(monitor_lock_);
+  bool releasing_method_requested_ GUARDED_BY(monitor_lock_);
+
+  // Number of pause instructions to spin for when the monitor is contended and the owner is
+  // running. Adapted to how long the owners held the monitor when we spun on it before.
+  uint32_t spin_duration_ GUARDED_BY(monitor_lock_);
+
+  // Time of the last contention or wait, in milliseconds. Monitors that have been idle for long
+  // enough are deflated concurrently, see MonitorList::DeflateIdleMonitors.
+  uint64_t last_contention_ms_ GUARDED_BY(monitor_lock_);
+
+  // Set when the monitor was deflated while mutators were running. Threads that read the lock
+  // word before the deflation must not use the monitor any more.
+  bool deflated_ GUARDED_BY(monitor_lock_);
+
   // The denser encoded version of this monitor as stored in the lock word.
   MonitorId monitor_id_;
 
@@ -319,6 +395,9 @@ class Monitor {
 
 class MonitorList {
  public:
+  // Monitors that saw no contention for this long are deflated by the periodic heap task.
+  static constexpr uint64_t kDeflationIdleMs = 1000;
+
   MonitorList();
   ~MonitorList();
 
@@ -329,10 +408,16 @@ class MonitorList {
   void DisallowNewMonitors() REQUIRES(!monitor_list_lock_);
   void AllowNewMonitors() REQUIRES(!monitor_list_lock_);
   void BroadcastForNewMonitors() REQUIRES(!monitor_list_lock_);
-  // Returns how many monitors were deflated.
-  size_t DeflateMonitors() REQUIRES(!monitor_list_lock_) REQUIRES(Locks::mutator_lock_);
+  // Deflates the unowned monitors that saw no contention for at least `min_idle_ms`, without
+  // suspending the mutators. The list is processed in batches, and the deflated monitors are
+  // returned to the pool after a handshake with all threads. Returns how many monitors were
+  // deflated.
+  size_t DeflateIdleMonitors(Thread* self, uint64_t min_idle_ms)
+      REQUIRES(!monitor_list_lock_, !Locks::mutator_lock_);
   size_t Size() REQUIRES(!monitor_list_lock_);
 
+  void DumpForSigQuit(std::ostream& os) REQUIRES(!monitor_list_lock_);
+
   typedef std::list<Monitor*, TrackingAllocator<Monitor*, kAllocatorTagMonitorList>> Monitors;
 
  private:
@@ -345,6 +430,10 @@ class MonitorList {
   ConditionVariable monitor_add_condition_ GUARDED_BY(monitor_list_lock_);
   Monitors list_ GUARDED_BY(monitor_list_lock_);
 
+  // Statistics of DeflateIdleMonitors.
+  size_t num_deflation_passes_ GUARDED_BY(monitor_list_lock_);
+  size_t num_deflated_monitors_ GUARDED_BY(monitor_list_lock_);
+
   friend class Monitor;
   DISALLOW_COPY_AND_ASSIGN(MonitorList);
 };
@@ -20,6 +20,7 @@
 #include "base/mutex-inl.h"
 #include "thread-inl.h"
 #include "monitor.h"
+#include "utils.h"
 
 namespace art {
 
@@ -29,7 +30,7 @@ namespace mirror {
 
 MonitorPool::MonitorPool()
     : current_chunk_list_index_(0), num_chunks_(0), current_chunk_list_capacity_(0),
-    first_free_(nullptr) {
+    first_free_(nullptr), num_monitors_in_use_(0) {
   for (size_t i = 0; i < kMaxChunkLists; ++i) {
     monitor_chunks_[i] = nullptr;  // Not absolutely required, but ...
   }
@@ -125,6 +126,7 @@ Monitor* MonitorPool::CreateMonitorInPool(Thread* self, Thread* owner, mirror::O
 
   // Initialize it.
   Monitor* monitor = new(mon_uninitialized) Monitor(self, owner, obj, hash_code, id);
+  ++num_monitors_in_use_;
 
   return monitor;
 }
@@ -146,6 +148,20 @@ void MonitorPool::ReleaseMonitorToPool(Thread* self, Monitor* monitor) {
 
   // Rewrite monitor id.
   monitor->monitor_id_ = id;
+
+  DCHECK_NE(num_monitors_in_use_, 0u);
+  --num_monitors_in_use_;
+}
+
+void MonitorPool::DumpForSigQuitInPool(std::ostream& os) {
+  MutexLock mu(Thread::Current(), *Locks::allocated_monitor_ids_lock_);
+  size_t num_chunks = num_chunks_;
+  for (size_t i = 0; i < current_chunk_list_index_; ++i) {
+    num_chunks += ChunkListCapacity(i);
+  }
+  os << "Monitor pool: " << num_monitors_in_use_ << " of " << num_chunks * kChunkCapacity
+     << " monitors in use, " << num_chunks << " chunks (" << PrettySize(num_chunks * kChunkSize)
+     << ")\n";
 }
 
 void MonitorPool::ReleaseMonitorsToPool(Thread* self, MonitorList::Monitors* monitors) {
@@ -96,6 +96,14 @@ class MonitorPool {
 #endif
   }
 
+  static void DumpForSigQuit(std::ostream& os) {
+#ifndef __LP64__
+    UNUSED(os);
+#else
+    GetMonitorPool()->DumpForSigQuitInPool(os);
+#endif
+  }
+
   static MonitorPool* GetMonitorPool() {
 #ifndef __LP64__
     return nullptr;
@@ -128,6 +136,8 @@ class MonitorPool {
   void ReleaseMonitorToPool(Thread* self, Monitor* monitor);
   void ReleaseMonitorsToPool(Thread* self, MonitorList::Monitors* monitors);
 
+  void DumpForSigQuitInPool(std::ostream& os) REQUIRES(!Locks::allocated_monitor_ids_lock_);
+
   // Note: This is safe as we do not ever move chunks.  All needed entries in the monitor_chunks_
   // data structure are read-only once we get here.  Updates happen-before this call because
   // the lock word was stored with release semantics and we read it with acquire semantics to
@@ -236,6 +246,9 @@ class MonitorPool {
   // Start of free list of monitors.
   // Note: these point to the right memory regions, but do *not* denote initialized objects.
   Monitor* first_free_ GUARDED_BY(Locks::allocated_monitor_ids_lock_);
+
+  // Number of monitors taken from the free list and not yet released.
+  size_t num_monitors_in_use_ GUARDED_BY(Locks::allocated_monitor_ids_lock_);
 #endif
 };
 
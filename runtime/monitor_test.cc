@@ -343,6 +343,55 @@ static void CommonWaitSetup(MonitorTest* test, ClassLinker* class_linker, uint64
   thread_pool.StopWorkers(self);
 }
 
+TEST_F(MonitorTest, DeflateIdleMonitors) {
+  Thread* const self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  StackHandleScope<3> hs(self);
+  Handle<mirror::Object> unlocked(
+      hs.NewHandle<mirror::Object>(mirror::String::AllocFromModifiedUtf8(self, "unlocked")));
+  Handle<mirror::Object> hashed(
+      hs.NewHandle<mirror::Object>(mirror::String::AllocFromModifiedUtf8(self, "hashed")));
+  Handle<mirror::Object> owned(
+      hs.NewHandle<mirror::Object>(mirror::String::AllocFromModifiedUtf8(self, "owned")));
+
+  // Inflate all three monitors and keep the last one locked.
+  {
+    ObjectLock<mirror::Object> lock(self, unlocked);
+    Monitor::InflateThinLocked(self, unlocked, unlocked->GetLockWord(true), 0);
+  }
+  int32_t hash_code;
+  {
+    ObjectLock<mirror::Object> lock(self, hashed);
+    hash_code = hashed->IdentityHashCode();
+  }
+  ObjectLock<mirror::Object> owned_lock(self, owned);
+  owned->IdentityHashCode();
+  ASSERT_EQ(LockWord::kFatLocked, unlocked->GetLockWord(true).GetState());
+  ASSERT_EQ(LockWord::kFatLocked, hashed->GetLockWord(true).GetState());
+  ASSERT_EQ(LockWord::kFatLocked, owned->GetLockWord(true).GetState());
+
+  MonitorList* monitor_list = Runtime::Current()->GetMonitorList();
+  size_t num_monitors = monitor_list->Size();
+  size_t num_deflated;
+  {
+    ScopedThreadSuspension sts(self, kNative);
+    // The monitors were just contended, nothing is idle for that long.
+    EXPECT_EQ(0u, monitor_list->DeflateIdleMonitors(self, 60 * 1000));
+    num_deflated = monitor_list->DeflateIdleMonitors(self, 0);
+  }
+  EXPECT_GE(num_deflated, 2u);
+  EXPECT_EQ(num_monitors - num_deflated, monitor_list->Size());
+
+  EXPECT_EQ(LockWord::kUnlocked, unlocked->GetLockWord(true).GetState());
+  EXPECT_EQ(LockWord::kHashCode, hashed->GetLockWord(true).GetState());
+  EXPECT_EQ(hash_code, hashed->IdentityHashCode());
+  EXPECT_EQ(LockWord::kFatLocked, owned->GetLockWord(true).GetState());
+
+  // A deflated object goes back to using a thin lock.
+  ObjectLock<mirror::Object> lock(self, unlocked);
+  EXPECT_EQ(LockWord::kThinLocked, unlocked->GetLockWord(true).GetState());
+}
+
 
 // First test: throwing an exception when trying to wait in Monitor with another thread.
 TEST_F(MonitorTest, CheckExceptionsWait1) {
@@ -427,5 +476,103 @@ TEST_F(MonitorTest, TestTryLock) {
   thread_pool.StopWorkers(self);
 }
 
+class BiasedLockingTest : public MonitorTest {
+ protected:
+  void SetUpRuntimeOptions(RuntimeOptions *options) OVERRIDE {
+    MonitorTest::SetUpRuntimeOptions(options);
+    options->push_back(std::make_pair("-XX:UseBiasedLocking", nullptr));
+  }
+};
+
+class RevokeBiasTask : public Task {
+ public:
+  explicit RevokeBiasTask(Handle<mirror::Object> obj) : obj_(obj) {}
+
+  void Run(Thread* self) {
+    ScopedObjectAccess soa(self);
+    // The object is reserved for the main thread, locking it revokes the bias.
+    ObjectLock<mirror::Object> lock(self, obj_);
+    LockWord lock_word = obj_->GetLockWord(true);
+    ASSERT_EQ(LockWord::kBiased, lock_word.GetState());
+    EXPECT_EQ(self->GetThreadId(), lock_word.BiasedLockOwner());
+  }
+
+  void Finalize() {
+    delete this;
+  }
+
+ private:
+  Handle<mirror::Object> obj_;
+};
+
+TEST_F(BiasedLockingTest, BiasAndRevoke) {
+  if (kUseReadBarrier) {
+    // The biased state needs the mark bit of the lock word.
+    EXPECT_FALSE(Monitor::IsBiasedLockingEnabled());
+    return;
+  }
+  ASSERT_TRUE(Monitor::IsBiasedLockingEnabled());
+  Thread* const self = Thread::Current();
+  ThreadPool thread_pool("the pool", 1);
+  ScopedObjectAccess soa(self);
+  StackHandleScope<2> hs(self);
+  Handle<mirror::Object> obj(
+      hs.NewHandle<mirror::Object>(mirror::String::AllocFromModifiedUtf8(self, "biased")));
+  Handle<mirror::Object> hashed(
+      hs.NewHandle<mirror::Object>(mirror::String::AllocFromModifiedUtf8(self, "hashed")));
+
+  // The first lock reserves the object, recursive locks only update the count.
+  {
+    ObjectLock<mirror::Object> lock(self, obj);
+    {
+      ObjectLock<mirror::Object> recursive_lock(self, obj);
+      LockWord lock_word = obj->GetLockWord(true);
+      ASSERT_EQ(LockWord::kBiased, lock_word.GetState());
+      EXPECT_EQ(self->GetThreadId(), lock_word.BiasedLockOwner());
+      EXPECT_EQ(2u, lock_word.BiasedLockCount());
+    }
+    EXPECT_EQ(self->GetThreadId(), obj->GetLockOwnerThreadId());
+    obj->NotifyAll(self);
+    self->AssertNoPendingException();
+  }
+  ASSERT_EQ(LockWord::kBiased, obj->GetLockWord(true).GetState());
+  EXPECT_EQ(0u, obj->GetLockWord(true).BiasedLockCount());
+  EXPECT_EQ(ThreadList::kInvalidThreadId, obj->GetLockOwnerThreadId());
+
+  // Unlocking a reserved object that is not held fails.
+  EXPECT_FALSE(Monitor::MonitorExit(self, obj.Get()));
+  EXPECT_TRUE(self->IsExceptionPending());
+  self->ClearException();
+
+  // Another thread cannot try-lock the object while we hold it.
+  thread_pool.StartWorkers(self);
+  {
+    ObjectLock<mirror::Object> lock(self, obj);
+    thread_pool.AddTask(self, new TryLockTask(obj));
+    ScopedThreadSuspension sts(self, kSuspended);
+    thread_pool.Wait(Thread::Current(), /*do_work*/false, /*may_hold_locks*/false);
+  }
+
+  // Locking from another thread revokes the bias and reserves the object for that thread.
+  uint64_t revocations = Monitor::GetBiasRevocationCount();
+  thread_pool.AddTask(self, new RevokeBiasTask(obj));
+  {
+    ScopedThreadSuspension sts(self, kSuspended);
+    thread_pool.Wait(Thread::Current(), /*do_work*/false, /*may_hold_locks*/false);
+  }
+  EXPECT_EQ(revocations + 1, Monitor::GetBiasRevocationCount());
+  EXPECT_EQ(ThreadList::kInvalidThreadId, obj->GetLockOwnerThreadId());
+  thread_pool.StopWorkers(self);
+
+  // The owner drops its own bias to install a hash code.
+  {
+    ObjectLock<mirror::Object> lock(self, hashed);
+    ASSERT_EQ(LockWord::kBiased, hashed->GetLockWord(true).GetState());
+    int32_t hash_code = hashed->IdentityHashCode();
+    EXPECT_EQ(LockWord::kFatLocked, hashed->GetLockWord(true).GetState());
+    EXPECT_EQ(hash_code, hashed->IdentityHashCode());
+    EXPECT_EQ(self->GetThreadId(), hashed->GetLockOwnerThreadId());
+  }
+}
 
 }  // namespace art
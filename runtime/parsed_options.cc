@@ -134,6 +134,9 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
       .Define("-XX:MaxSpinsBeforeThinLockInflation=_")
           .WithType<unsigned int>()
           .IntoKey(M::MaxSpinsBeforeThinLockInflation)
+      .Define("-XX:UseBiasedLocking")
+          .WithValue(true)
+          .IntoKey(M::UseBiasedLocking)
       .Define("-XX:LongPauseLogThreshold=_")  // in ms
           .WithType<MillisecondsToNanoseconds>()  // store as ns
           .IntoKey(M::LongPauseLogThreshold)
@@ -183,6 +186,11 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
       .Define("-Xjittransitionweight:_")
           .WithType<unsigned int>()
           .IntoKey(M::JITInvokeTransitionWeight)
+      .Define("-Xjitstatsfile:_")
+          .WithType<std::string>()
+          .IntoKey(M::JITStatsFile)
+      .Define("-Xjitseedfromprofile")
+          .IntoKey(M::JITSeedFromProfile)
       .Define("-Xjitsaveprofilinginfo")
           .WithType<ProfileSaverOptions>()
           .AppendValues()
@@ -238,6 +246,12 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
       .Define("-Xlockprofthreshold:_")
           .WithType<unsigned int>()
           .IntoKey(M::LockProfThreshold)
+      .Define("-XX:LockContentionProfiling")
+          .WithValue(true)
+          .IntoKey(M::LockContentionProfiling)
+      .Define("-Xlockcontentionprofile:_")
+          .WithType<std::string>()
+          .IntoKey(M::LockContentionProfileFile)
       .Define("-Xstacktracedir:_")
           .WithType<std::string>()
           .IntoKey(M::StackTraceDir)
@@ -693,6 +707,9 @@ void ParsedOptions::Usage(const char* fmt, ...) {
   UsageMessage(stream, "  -XX:ParallelGCThreads=integervalue\n");
   UsageMessage(stream, "  -XX:ConcGCThreads=integervalue\n");
   UsageMessage(stream, "  -XX:MaxSpinsBeforeThinLockInflation=integervalue\n");
+  UsageMessage(stream, "  -XX:UseBiasedLocking\n");
+  UsageMessage(stream, "  -XX:LockContentionProfiling\n");
+  UsageMessage(stream, "  -Xlockcontentionprofile:filename\n");
   UsageMessage(stream, "  -XX:LongPauseLogThreshold=integervalue\n");
   UsageMessage(stream, "  -XX:LongGCLogThreshold=integervalue\n");
   UsageMessage(stream, "  -XX:ThreadSuspendTimeout=integervalue\n");
@@ -725,6 +742,8 @@ void ParsedOptions::Usage(const char* fmt, ...) {
   UsageMessage(stream, "  -Xjitwarmupthreshold:integervalue\n");
   UsageMessage(stream, "  -Xjitosrthreshold:integervalue\n");
   UsageMessage(stream, "  -Xjitprithreadweight:integervalue\n");
+  UsageMessage(stream, "  -Xjitstatsfile:filename\n");
+  UsageMessage(stream, "  -Xjitseedfromprofile\n");
   UsageMessage(stream, "  -X[no]relocate\n");
   UsageMessage(stream, "  -X[no]dex2oat (Whether to invoke dex2oat on the application)\n");
   UsageMessage(stream, "  -X[no]image-dex2oat (Whether to create and use a boot image)\n");
@@ -88,6 +88,7 @@
 #include "jit/jit_code_cache.h"
 #include "jni_internal.h"
 #include "linear_alloc.h"
+#include "lock_contention_profiler.h"
 #include "mirror/array.h"
 #include "mirror/class-inl.h"
 #include "mirror/class_ext.h"
@@ -286,6 +287,8 @@ Runtime::~Runtime() {
     heap_->DumpGcPerformanceInfo(LOG_STREAM(INFO));
   }
 
+  LockContentionProfiler::WriteOutputFile();
+
   if (jit_ != nullptr) {
     // Stop the profile saver thread before marking the runtime as shutting down.
     // The saver will try to dump the profiles before being sopped and that
@@ -1016,7 +1019,10 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
   oat_file_manager_ = new OatFileManager;
 
   Thread::SetSensitiveThreadHook(runtime_options.GetOrDefault(Opt::HookIsSensitiveThread));
-  Monitor::Init(runtime_options.GetOrDefault(Opt::LockProfThreshold));
+  Monitor::Init(runtime_options.GetOrDefault(Opt::LockProfThreshold),
+                runtime_options.GetOrDefault(Opt::UseBiasedLocking));
+  LockContentionProfiler::Init(runtime_options.GetOrDefault(Opt::LockContentionProfiling),
+                               runtime_options.GetOrDefault(Opt::LockContentionProfileFile));
 
   boot_class_path_string_ = runtime_options.ReleaseOrDefault(Opt::BootClassPath);
   class_path_string_ = runtime_options.ReleaseOrDefault(Opt::ClassPath);
@@ -1575,6 +1581,7 @@ void Runtime::DumpForSigQuit(std::ostream& os) {
   GetInternTable()->DumpForSigQuit(os);
   GetJavaVM()->DumpForSigQuit(os);
   GetHeap()->DumpForSigQuit(os);
+  GetMonitorList()->DumpForSigQuit(os);
   oat_file_manager_->DumpForSigQuit(os);
   if (GetJit() != nullptr) {
     GetJit()->DumpForSigQuit(os);
@@ -1586,6 +1593,7 @@ void Runtime::DumpForSigQuit(std::ostream& os) {
 
   thread_list_->DumpForSigQuit(os);
   BaseMutex::DumpAll(os);
+  LockContentionProfiler::DumpForSigQuit(os);
 
   // Inform anyone else who is interested in SigQuit.
   {
@@ -80,6 +80,41 @@ DexRegisterLocation DexRegisterMap::GetDexRegisterLocation(uint16_t dex_register
   return dex_register_location_catalog.GetDexRegisterLocation(location_catalog_entry_index);
 }
 
+void DexRegisterMap::GetDexRegisterLocations(uint16_t number_of_dex_registers,
+                                             const CodeInfo& code_info,
+                                             const CodeInfoEncoding& enc,
+                                             /* out */ DexRegisterLocation* locations) const {
+  DexRegisterLocationCatalog dex_register_location_catalog =
+      code_info.GetDexRegisterLocationCatalog(enc);
+  size_t number_of_location_catalog_entries = code_info.GetNumberOfLocationCatalogEntries(enc);
+  size_t map_locations_offset_in_bits =
+      GetLocationMappingDataOffset(number_of_dex_registers) * kBitsPerByte;
+  size_t map_entry_size_in_bits = SingleEntrySizeInBits(number_of_location_catalog_entries);
+  size_t index_in_dex_register_map = 0u;
+  for (uint16_t dex_register_number = 0;
+       dex_register_number < number_of_dex_registers;
+       ++dex_register_number) {
+    if (!IsDexRegisterLive(dex_register_number)) {
+      locations[dex_register_number] = DexRegisterLocation::None();
+      continue;
+    }
+    // See GetLocationCatalogEntryIndex(); a single-entry catalog has no location map.
+    size_t location_catalog_entry_index = 0u;
+    if (number_of_location_catalog_entries != 1) {
+      size_t entry_offset_in_bits =
+          map_locations_offset_in_bits + index_in_dex_register_map * map_entry_size_in_bits;
+      location_catalog_entry_index = region_.LoadBits(entry_offset_in_bits, map_entry_size_in_bits);
+    }
+    DCHECK_EQ(location_catalog_entry_index,
+              GetLocationCatalogEntryIndex(dex_register_number,
+                                           number_of_dex_registers,
+                                           number_of_location_catalog_entries));
+    ++index_in_dex_register_map;
+    locations[dex_register_number] =
+        dex_register_location_catalog.GetDexRegisterLocation(location_catalog_entry_index);
+  }
+}
+
 static void DumpRegisterMapping(std::ostream& os,
                                 size_t dex_register_num,
                                 DexRegisterLocation location,
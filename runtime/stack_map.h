@@ -473,6 +473,14 @@ class DexRegisterMap {
                                              const CodeInfo& code_info,
                                              const CodeInfoEncoding& enc) const;
 
+  // Get the locations of all `number_of_dex_registers` Dex registers in a single linear pass
+  // over the map, storing them in `locations`. Calling GetDexRegisterLocation() for every
+  // register is quadratic, as locating one entry counts the live registers before it.
+  void GetDexRegisterLocations(uint16_t number_of_dex_registers,
+                               const CodeInfo& code_info,
+                               const CodeInfoEncoding& enc,
+                               /* out */ DexRegisterLocation* locations) const;
+
   int32_t GetStackOffsetInBytes(uint16_t dex_register_number,
                                 uint16_t number_of_dex_registers,
                                 const CodeInfo& code_info,
@@ -1755,7 +1755,8 @@ struct StackDumpVisitor : public StackVisitor {
         // IdentityHashCode call below will crash. So explicitly mark/forward it here.
         o = ReadBarrier::Mark(o);
       }
-      if ((o->GetLockWord(false).GetState() == LockWord::kThinLocked) &&
+      const LockWord::LockState lock_state = o->GetLockWord(false).GetState();
+      if ((lock_state == LockWord::kThinLocked || lock_state == LockWord::kBiased) &&
           Locks::mutator_lock_->IsExclusiveHeld(Thread::Current())) {
         // Getting the identity hashcode here would result in lock inflation and suspension of the
         // current thread, which isn't safe if this is the only runnable thread.
@@ -2209,6 +2210,8 @@ bool Thread::HandleScopeContains(jobject obj) const {
 void Thread::HandleScopeVisitRoots(RootVisitor* visitor, uint32_t thread_id) {
   BufferedRootVisitor<kDefaultBufferedRootCount> buffered_visitor(
       visitor, RootInfo(kRootNativeStack, thread_id));
+  // The handles in handle_arena_ are visited through the variable sized handle scopes that own
+  // them. The rest of the arena holds stale references of destroyed scopes.
   for (BaseHandleScope* cur = tlsPtr_.top_handle_scope; cur; cur = cur->GetLink()) {
     cur->VisitRoots(buffered_visitor);
   }
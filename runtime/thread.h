@@ -35,8 +35,10 @@
 #include "entrypoints/quick/quick_entrypoints.h"
 #include "gc_root.h"
 #include "globals.h"
+#include "handle_arena.h"
 #include "handle_scope.h"
 #include "instrumentation.h"
+#include "interpreter/interpreter_cache.h"
 #include "jvalue.h"
 #include "object_callbacks.h"
 #include "offsets.h"
@@ -1167,6 +1169,14 @@ class Thread {
     custom_tls_ = data;
   }
 
+  interpreter::InterpreterCache* GetInterpreterCache() {
+    return &interpreter_cache_;
+  }
+
+  HandleArena* GetHandleArena() {
+    return &handle_arena_;
+  }
+
   // Returns true if the current thread is the jit sensitive thread.
   bool IsJitSensitiveThread() const {
     return this == jit_sensitive_thread_;
@@ -1656,6 +1666,12 @@ class Thread {
   // By default this is true.
   bool can_call_into_java_;
 
+  // Per-thread cache of interpreter resolution results, keyed by dex instruction address.
+  interpreter::InterpreterCache interpreter_cache_;
+
+  // Storage for the handle scopes of this thread that are not on the native stack.
+  HandleArena handle_arena_;
+
   friend class Dbg;  // For SetStateUnsafe.
   friend class gc::collector::SemiSpace;  // For getting stack traces.
   friend class Runtime;  // For CreatePeer.
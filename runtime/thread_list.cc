@@ -297,6 +297,17 @@ static void ThreadSuspendSleep(useconds_t delay_us) {
 }
 
 size_t ThreadList::RunCheckpoint(Closure* checkpoint_function, Closure* callback) {
+  return RunCheckpointOnThreads(checkpoint_function, callback, kInvalidThreadId);
+}
+
+size_t ThreadList::RunCheckpointOnThread(Closure* checkpoint_function, uint32_t thread_id) {
+  DCHECK_NE(thread_id, kInvalidThreadId);
+  return RunCheckpointOnThreads(checkpoint_function, nullptr, thread_id);
+}
+
+size_t ThreadList::RunCheckpointOnThreads(Closure* checkpoint_function,
+                                          Closure* callback,
+                                          uint32_t thread_id) {
   Thread* self = Thread::Current();
   Locks::mutator_lock_->AssertNotExclusiveHeld(self);
   Locks::thread_list_lock_->AssertNotHeld(self);
@@ -304,14 +315,20 @@ size_t ThreadList::RunCheckpoint(Closure* checkpoint_function, Closure* callback
 
   std::vector<Thread*> suspended_count_modified_threads;
   size_t count = 0;
+  bool run_on_self = false;
   {
     // Call a checkpoint function for each thread, threads which are suspend get their checkpoint
     // manually called.
     MutexLock mu(self, *Locks::thread_list_lock_);
     MutexLock mu2(self, *Locks::thread_suspend_count_lock_);
-    count = list_.size();
     for (const auto& thread : list_) {
-      if (thread != self) {
+      if (thread_id != kInvalidThreadId && thread->GetThreadId() != thread_id) {
+        continue;
+      }
+      ++count;
+      if (thread == self) {
+        run_on_self = true;
+      } else {
         while (true) {
           if (thread->RequestCheckpoint(checkpoint_function)) {
             // This thread will run its checkpoint some time in the near future.
@@ -338,7 +355,9 @@ size_t ThreadList::RunCheckpoint(Closure* checkpoint_function, Closure* callback
   }
 
   // Run the checkpoint on ourself while we wait for threads to suspend.
-  checkpoint_function->Run(self);
+  if (run_on_self) {
+    checkpoint_function->Run(self);
+  }
 
   // Run the checkpoint on the suspended threads.
   for (const auto& thread : suspended_count_modified_threads) {
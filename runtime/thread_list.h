@@ -104,6 +104,11 @@ class ThreadList {
   size_t RunCheckpoint(Closure* checkpoint_function, Closure* callback = nullptr)
       REQUIRES(!Locks::thread_list_lock_, !Locks::thread_suspend_count_lock_);
 
+  // Run a checkpoint on the thread with the given id only, see RunCheckpoint and Handshake.
+  // Returns 1 if the checkpoint was run or requested, 0 if there is no such thread.
+  size_t RunCheckpointOnThread(Closure* checkpoint_function, uint32_t thread_id)
+      REQUIRES(!Locks::thread_list_lock_, !Locks::thread_suspend_count_lock_);
+
   // Run an empty checkpoint on threads. Wait until threads pass the next suspend point or are
   // suspended. This is used to ensure that the threads finish or aren't in the middle of an
   // in-flight mutator heap access (eg. a read barrier.) Runnable threads will respond by
@@ -183,6 +188,13 @@ class ThreadList {
   size_t RunCheckpoint(Closure* checkpoint_function, bool includeSuspended)
       REQUIRES(!Locks::thread_list_lock_, !Locks::thread_suspend_count_lock_);
 
+  // Runs the checkpoint on all threads, or only on the thread with the given id unless it is
+  // kInvalidThreadId.
+  size_t RunCheckpointOnThreads(Closure* checkpoint_function,
+                                Closure* callback,
+                                uint32_t thread_id)
+      REQUIRES(!Locks::thread_list_lock_, !Locks::thread_suspend_count_lock_);
+
   void DumpUnattachedThreads(std::ostream& os, bool dump_native_stack)
       REQUIRES(!Locks::thread_list_lock_);
 
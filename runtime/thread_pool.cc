@@ -37,10 +37,75 @@ using android::base::StringPrintf;
 
 static constexpr bool kMeasureWaitTime = false;
 
+// Number of times an idle worker looks for a task without the lock before it waits on
+// task_queue_condition_. Waking a waiting worker takes a syscall on both sides, which costs more
+// than many short tasks, so a worker that just finished a task spins a little first.
+static constexpr size_t kIdleSpinIterations = 512;
+
+bool TaskDeque::Push(Task* task) {
+  const int64_t bottom = bottom_.LoadRelaxed();
+  const int64_t top = top_.LoadAcquire();
+  if (bottom - top >= static_cast<int64_t>(kCapacity)) {
+    return false;
+  }
+  tasks_[bottom % kCapacity].StoreRelaxed(task);
+  // Publish the task before the new bottom, thieves read bottom_ with acquire.
+  QuasiAtomic::ThreadFenceRelease();
+  bottom_.StoreRelaxed(bottom + 1);
+  return true;
+}
+
+Task* TaskDeque::Pop() {
+  const int64_t bottom = bottom_.LoadRelaxed() - 1;
+  bottom_.StoreRelaxed(bottom);
+  // Thieves must see the reserved bottom before we read top_, or a thief and the owner could
+  // both take the last task.
+  QuasiAtomic::ThreadFenceSequentiallyConsistent();
+  int64_t top = top_.LoadRelaxed();
+  if (top > bottom) {
+    // Empty.
+    bottom_.StoreRelaxed(bottom + 1);
+    return nullptr;
+  }
+  Task* task = tasks_[bottom % kCapacity].LoadRelaxed();
+  if (top == bottom) {
+    // Last task, race with the thieves for it.
+    if (!top_.CompareExchangeStrongSequentiallyConsistent(top, top + 1)) {
+      task = nullptr;
+    }
+    bottom_.StoreRelaxed(bottom + 1);
+  }
+  return task;
+}
+
+Task* TaskDeque::Steal() {
+  const int64_t top = top_.LoadAcquire();
+  QuasiAtomic::ThreadFenceSequentiallyConsistent();
+  const int64_t bottom = bottom_.LoadAcquire();
+  if (top >= bottom) {
+    return nullptr;
+  }
+  // The owner does not overwrite this slot while top_ is unchanged, since the deque would be full.
+  Task* task = tasks_[top % kCapacity].LoadRelaxed();
+  if (!top_.CompareExchangeStrongSequentiallyConsistent(top, top + 1)) {
+    return nullptr;
+  }
+  return task;
+}
+
+size_t TaskDeque::Size() const {
+  const int64_t top = top_.LoadSequentiallyConsistent();
+  const int64_t bottom = bottom_.LoadSequentiallyConsistent();
+  // The owner may have reserved a slot in Pop() on an empty deque.
+  return bottom > top ? static_cast<size_t>(bottom - top) : 0u;
+}
+
 ThreadPoolWorker::ThreadPoolWorker(ThreadPool* thread_pool, const std::string& name,
                                    size_t stack_size)
     : thread_pool_(thread_pool),
-      name_(name) {
+      name_(name),
+      joined_(false),
+      next_victim_(0) {
   // Add an inaccessible page to catch stack overflow.
   stack_size += kPageSize;
   std::string error_msg;
@@ -59,7 +124,14 @@ ThreadPoolWorker::ThreadPoolWorker(ThreadPool* thread_pool, const std::string& n
 }
 
 ThreadPoolWorker::~ThreadPoolWorker() {
-  CHECK_PTHREAD_CALL(pthread_join, (pthread_, nullptr), "thread pool worker shutdown");
+  Join();
+}
+
+void ThreadPoolWorker::Join() {
+  if (!joined_) {
+    CHECK_PTHREAD_CALL(pthread_join, (pthread_, nullptr), "thread pool worker shutdown");
+    joined_ = true;
+  }
 }
 
 void ThreadPoolWorker::SetPthreadPriority(int priority) {
@@ -79,7 +151,7 @@ void ThreadPoolWorker::Run() {
   Thread* self = Thread::Current();
   Task* task = nullptr;
   thread_pool_->creation_barier_.Wait(self);
-  while ((task = thread_pool_->GetTask(self)) != nullptr) {
+  while ((task = thread_pool_->GetTask(self, this)) != nullptr) {
     task->Run(self);
     task->Finalize();
   }
@@ -101,18 +173,83 @@ void* ThreadPoolWorker::Callback(void* arg) {
   return nullptr;
 }
 
+ThreadPoolWorker* ThreadPool::FindWorker(Thread* self) const {
+  for (ThreadPoolWorker* worker : threads_) {
+    if (worker->thread_ == self) {
+      return worker;
+    }
+  }
+  return nullptr;
+}
+
 void ThreadPool::AddTask(Thread* self, Task* task) {
+  ThreadPoolWorker* worker = FindWorker(self);
+  if (worker != nullptr && worker->deque_.Push(task)) {
+    SignalWaitingWorkers(self, 1u);
+    return;
+  }
   MutexLock mu(self, task_queue_lock_);
   tasks_.push_back(task);
+  num_queued_tasks_.StoreRelaxed(tasks_.size());
   // If we have any waiters, signal one.
-  if (started_ && waiting_count_ != 0) {
+  if (started_.LoadRelaxed() && waiting_count_.LoadRelaxed() != 0) {
     task_queue_condition_.Signal(self);
   }
 }
 
+void ThreadPool::AddTasks(Thread* self, const std::vector<Task*>& tasks) {
+  size_t num_pushed = 0;
+  ThreadPoolWorker* worker = FindWorker(self);
+  if (worker != nullptr) {
+    while (num_pushed != tasks.size() && worker->deque_.Push(tasks[num_pushed])) {
+      ++num_pushed;
+    }
+    if (num_pushed != 0) {
+      SignalWaitingWorkers(self, num_pushed);
+    }
+  }
+  if (num_pushed == tasks.size()) {
+    return;
+  }
+  MutexLock mu(self, task_queue_lock_);
+  tasks_.insert(tasks_.end(), tasks.begin() + num_pushed, tasks.end());
+  num_queued_tasks_.StoreRelaxed(tasks_.size());
+  if (started_.LoadRelaxed() && waiting_count_.LoadRelaxed() != 0) {
+    if (tasks.size() - num_pushed == 1u) {
+      task_queue_condition_.Signal(self);
+    } else {
+      task_queue_condition_.Broadcast(self);
+    }
+  }
+}
+
+void ThreadPool::SignalWaitingWorkers(Thread* self, size_t count) {
+  // Pairs with the increment of waiting_count_ in GetTask(): either the waiting worker sees the
+  // pushed tasks before it waits, or we see it waiting and signal it.
+  QuasiAtomic::ThreadFenceSequentiallyConsistent();
+  if (waiting_count_.LoadSequentiallyConsistent() == 0) {
+    return;
+  }
+  MutexLock mu(self, task_queue_lock_);
+  if (started_.LoadRelaxed()) {
+    if (count == 1u) {
+      task_queue_condition_.Signal(self);
+    } else {
+      task_queue_condition_.Broadcast(self);
+    }
+  }
+}
+
 void ThreadPool::RemoveAllTasks(Thread* self) {
   MutexLock mu(self, task_queue_lock_);
   tasks_.clear();
+  num_queued_tasks_.StoreRelaxed(0u);
+  // The owners may be popping concurrently, so drain the deques from the top.
+  for (ThreadPoolWorker* worker : threads_) {
+    while (!worker->deque_.IsEmpty()) {
+      worker->deque_.Steal();
+    }
+  }
 }
 
 ThreadPool::ThreadPool(const char* name, size_t num_threads, bool create_peers)
@@ -123,6 +260,7 @@ ThreadPool::ThreadPool(const char* name, size_t num_threads, bool create_peers)
     started_(false),
     shutting_down_(false),
     waiting_count_(0),
+    num_queued_tasks_(0),
     start_time_(0),
     total_wait_time_(0),
     // Add one since the caller of constructor waits on the barrier too.
@@ -156,13 +294,17 @@ ThreadPool::~ThreadPool() {
     task_queue_condition_.Broadcast(self);
     completion_condition_.Broadcast(self);
   }
-  // Wait for the threads to finish.
+  // Wait for the threads to finish. Workers look at the deques of the other workers, so join them
+  // all before deleting any.
+  for (ThreadPoolWorker* worker : threads_) {
+    worker->Join();
+  }
   STLDeleteElements(&threads_);
 }
 
 void ThreadPool::StartWorkers(Thread* self) {
   MutexLock mu(self, task_queue_lock_);
-  started_ = true;
+  started_.StoreRelaxed(true);
   task_queue_condition_.Broadcast(self);
   start_time_ = NanoTime();
   total_wait_time_ = 0;
@@ -170,25 +312,42 @@ void ThreadPool::StartWorkers(Thread* self) {
 
 void ThreadPool::StopWorkers(Thread* self) {
   MutexLock mu(self, task_queue_lock_);
-  started_ = false;
+  started_.StoreRelaxed(false);
 }
 
-Task* ThreadPool::GetTask(Thread* self) {
+Task* ThreadPool::GetTask(Thread* self, ThreadPoolWorker* worker) {
+  DCHECK_EQ(worker->thread_, self);
+  // Look for a task without the lock for a while, starting with the worker's own deque.
+  for (size_t i = 0; i != kIdleSpinIterations; ++i) {
+    Task* task = TryGetTaskUnlocked(self, worker);
+    if (task != nullptr) {
+      return task;
+    }
+    CpuRelax();
+  }
+
   MutexLock mu(self, task_queue_lock_);
   while (!IsShuttingDown()) {
     const size_t thread_count = GetThreadCount();
     // Ensure that we don't use more threads than the maximum active workers.
-    const size_t active_threads = thread_count - waiting_count_;
+    const size_t active_threads = thread_count - waiting_count_.LoadRelaxed();
     // <= since self is considered an active worker.
-    if (active_threads <= max_active_workers_) {
-      Task* task = TryGetTaskLocked();
+    const bool may_run = active_threads <= max_active_workers_;
+    if (may_run) {
+      Task* task = TryGetTaskLocked(worker);
       if (task != nullptr) {
         return task;
       }
     }
 
-    ++waiting_count_;
-    if (waiting_count_ == GetThreadCount() && !HasOutstandingTasks()) {
+    waiting_count_.FetchAndAddSequentiallyConsistent(1);
+    // Workers push to their deques without the lock. Look at the deques again now that they see
+    // us waiting and signal us, see SignalWaitingWorkers().
+    if (may_run && started_.LoadRelaxed() && HasTasksInDeques()) {
+      waiting_count_.FetchAndSubSequentiallyConsistent(1);
+      continue;
+    }
+    if (waiting_count_.LoadRelaxed() == thread_count && !HasOutstandingTasks()) {
       // We may be done, lets broadcast to the completion condition.
       completion_condition_.Broadcast(self);
     }
@@ -198,7 +357,7 @@ Task* ThreadPool::GetTask(Thread* self) {
       const uint64_t wait_end = NanoTime();
       total_wait_time_ += wait_end - std::max(wait_start, start_time_);
     }
-    --waiting_count_;
+    waiting_count_.FetchAndSubSequentiallyConsistent(1);
   }
 
   // We are shutting down, return null to tell the worker thread to stop looping.
@@ -206,19 +365,86 @@ Task* ThreadPool::GetTask(Thread* self) {
 }
 
 Task* ThreadPool::TryGetTask(Thread* self) {
+  ThreadPoolWorker* worker = FindWorker(self);
   MutexLock mu(self, task_queue_lock_);
-  return TryGetTaskLocked();
+  return TryGetTaskLocked(worker);
+}
+
+Task* ThreadPool::TryGetTaskLocked(ThreadPoolWorker* worker) {
+  if (!started_.LoadRelaxed()) {
+    return nullptr;
+  }
+  if (worker != nullptr) {
+    Task* task = worker->deque_.Pop();
+    if (task != nullptr) {
+      return task;
+    }
+  }
+  Task* task = PopQueuedTaskLocked();
+  if (task != nullptr) {
+    return task;
+  }
+  return StealTask(worker);
 }
 
-Task* ThreadPool::TryGetTaskLocked() {
-  if (HasOutstandingTasks()) {
-    Task* task = tasks_.front();
-    tasks_.pop_front();
+Task* ThreadPool::TryGetTaskUnlocked(Thread* self, ThreadPoolWorker* worker) {
+  if (!started_.LoadRelaxed()) {
+    return nullptr;
+  }
+  Task* task = worker->deque_.Pop();
+  if (task != nullptr) {
     return task;
   }
+  if (num_queued_tasks_.LoadRelaxed() != 0) {
+    MutexLock mu(self, task_queue_lock_);
+    task = PopQueuedTaskLocked();
+    if (task != nullptr) {
+      return task;
+    }
+  }
+  return StealTask(worker);
+}
+
+Task* ThreadPool::PopQueuedTaskLocked() {
+  if (tasks_.empty()) {
+    return nullptr;
+  }
+  Task* task = tasks_.front();
+  tasks_.pop_front();
+  num_queued_tasks_.StoreRelaxed(tasks_.size());
+  return task;
+}
+
+Task* ThreadPool::StealTask(ThreadPoolWorker* thief) {
+  const size_t thread_count = GetThreadCount();
+  const size_t first_victim = (thief != nullptr) ? thief->next_victim_ : 0u;
+  for (size_t i = 0; i != thread_count; ++i) {
+    const size_t victim_index = (first_victim + i) % thread_count;
+    ThreadPoolWorker* victim = threads_[victim_index];
+    if (victim == thief) {
+      continue;
+    }
+    Task* task = victim->deque_.Steal();
+    if (task != nullptr) {
+      if (thief != nullptr) {
+        // A worker that had tasks to steal likely has more.
+        thief->next_victim_ = victim_index;
+      }
+      return task;
+    }
+  }
   return nullptr;
 }
 
+bool ThreadPool::HasTasksInDeques() const {
+  for (ThreadPoolWorker* worker : threads_) {
+    if (!worker->deque_.IsEmpty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void ThreadPool::Wait(Thread* self, bool do_work, bool may_hold_locks) {
   if (do_work) {
     CHECK(!create_peers_);
@@ -230,7 +456,8 @@ void ThreadPool::Wait(Thread* self, bool do_work, bool may_hold_locks) {
   }
   // Wait until each thread is waiting and the task list is empty.
   MutexLock mu(self, task_queue_lock_);
-  while (!shutting_down_ && (waiting_count_ != GetThreadCount() || HasOutstandingTasks())) {
+  while (!shutting_down_ &&
+         (waiting_count_.LoadRelaxed() != GetThreadCount() || HasOutstandingTasks())) {
     if (!may_hold_locks) {
       completion_condition_.Wait(self);
     } else {
@@ -241,7 +468,11 @@ void ThreadPool::Wait(Thread* self, bool do_work, bool may_hold_locks) {
 
 size_t ThreadPool::GetTaskCount(Thread* self) {
   MutexLock mu(self, task_queue_lock_);
-  return tasks_.size();
+  size_t count = tasks_.size();
+  for (ThreadPoolWorker* worker : threads_) {
+    count += worker->deque_.Size();
+  }
+  return count;
 }
 
 void ThreadPool::SetPthreadPriority(int priority) {
@@ -20,6 +20,7 @@
 #include <deque>
 #include <vector>
 
+#include "atomic.h"
 #include "barrier.h"
 #include "base/mutex.h"
 #include "mem_map.h"
@@ -48,6 +49,42 @@ class SelfDeletingTask : public Task {
   }
 };
 
+// A bounded deque of tasks owned by one worker (Chase and Lev, "Dynamic Circular Work-Stealing
+// Deque"). Only the owner pushes and pops, at the bottom, so it runs the tasks it created most
+// recently first. Any thread may steal the oldest task from the top. None of the operations
+// take a lock: the owner only needs a CAS to race with thieves for the last task.
+class TaskDeque {
+ public:
+  static constexpr size_t kCapacity = 1024;
+
+  TaskDeque() : top_(0), bottom_(0) {}
+
+  // Returns false if the deque is full. Only called by the owner.
+  bool Push(Task* task);
+
+  // Returns the most recently pushed task, or null if the deque is empty. Only called by the
+  // owner.
+  Task* Pop();
+
+  // Returns the oldest task, or null if the deque is empty or another thread got the task first.
+  Task* Steal();
+
+  // The size is only a snapshot when other threads use the deque.
+  size_t Size() const;
+  bool IsEmpty() const {
+    return Size() == 0u;
+  }
+
+ private:
+  // The indices only grow, the task of index i is in tasks_[i % kCapacity]. They are 64-bit so
+  // that they do not wrap around during the lifetime of a pool.
+  Atomic<int64_t> top_;
+  Atomic<int64_t> bottom_;
+  Atomic<Task*> tasks_[kCapacity];
+
+  DISALLOW_COPY_AND_ASSIGN(TaskDeque);
+};
+
 class ThreadPoolWorker {
  public:
   static const size_t kDefaultStackSize = 1 * MB;
@@ -76,6 +113,15 @@ class ThreadPoolWorker {
   Thread* thread_;
 
  private:
+  // Waits for the worker thread to exit.
+  void Join();
+
+  bool joined_;
+  // Tasks added by this worker.
+  TaskDeque deque_;
+  // Index of the worker that this worker tries to steal from first. Only used by this worker.
+  size_t next_victim_;
+
   friend class ThreadPool;
   DISALLOW_COPY_AND_ASSIGN(ThreadPoolWorker);
 };
@@ -99,9 +145,14 @@ class ThreadPool {
   void StopWorkers(Thread* self) REQUIRES(!task_queue_lock_);
 
   // Add a new task, the first available started worker will process it. Does not delete the task
-  // after running it, it is the caller's responsibility.
+  // after running it, it is the caller's responsibility. A task added by a worker of this pool
+  // goes to the worker's own deque without taking task_queue_lock_, and is run by the worker
+  // itself unless another worker steals it.
   void AddTask(Thread* self, Task* task) REQUIRES(!task_queue_lock_);
 
+  // Add several tasks at once, taking task_queue_lock_ at most once.
+  void AddTasks(Thread* self, const std::vector<Task*>& tasks) REQUIRES(!task_queue_lock_);
+
   // Remove all tasks in the queue.
   void RemoveAllTasks(Thread* self) REQUIRES(!task_queue_lock_);
 
@@ -133,31 +184,49 @@ class ThreadPool {
   void SetPthreadPriority(int priority);
 
  protected:
-  // get a task to run, blocks if there are no tasks left
-  virtual Task* GetTask(Thread* self) REQUIRES(!task_queue_lock_);
+  // get a task for the given worker to run, blocks if there are no tasks left
+  virtual Task* GetTask(Thread* self, ThreadPoolWorker* worker) REQUIRES(!task_queue_lock_);
 
-  // Try to get a task, returning null if there is none available.
+  // Try to get a task, returning null if there is none available. The worker is null if the
+  // caller is not a worker of this pool.
   Task* TryGetTask(Thread* self) REQUIRES(!task_queue_lock_);
-  Task* TryGetTaskLocked() REQUIRES(task_queue_lock_);
+  Task* TryGetTaskLocked(ThreadPoolWorker* worker) REQUIRES(task_queue_lock_);
+  // Only takes task_queue_lock_ if tasks_ looks non-empty.
+  Task* TryGetTaskUnlocked(Thread* self, ThreadPoolWorker* worker) REQUIRES(!task_queue_lock_);
+  Task* PopQueuedTaskLocked() REQUIRES(task_queue_lock_);
+  Task* StealTask(ThreadPoolWorker* thief);
+
+  // Returns the worker running on self, or null if self is not a worker of this pool.
+  ThreadPoolWorker* FindWorker(Thread* self) const;
+
+  // Wakes workers waiting for tasks after self pushed count tasks to its deque.
+  void SignalWaitingWorkers(Thread* self, size_t count) REQUIRES(!task_queue_lock_);
 
   // Are we shutting down?
   bool IsShuttingDown() const REQUIRES(task_queue_lock_) {
     return shutting_down_;
   }
 
+  bool HasTasksInDeques() const;
+
   bool HasOutstandingTasks() const REQUIRES(task_queue_lock_) {
-    return started_ && !tasks_.empty();
+    return started_.LoadRelaxed() && (!tasks_.empty() || HasTasksInDeques());
   }
 
   const std::string name_;
   Mutex task_queue_lock_;
   ConditionVariable task_queue_condition_ GUARDED_BY(task_queue_lock_);
   ConditionVariable completion_condition_ GUARDED_BY(task_queue_lock_);
-  volatile bool started_ GUARDED_BY(task_queue_lock_);
+  // Only written with task_queue_lock_ held, workers read it without the lock.
+  Atomic<bool> started_;
   volatile bool shutting_down_ GUARDED_BY(task_queue_lock_);
-  // How many worker threads are waiting on the condition.
-  volatile size_t waiting_count_ GUARDED_BY(task_queue_lock_);
+  // How many worker threads are waiting on the condition. Only written with task_queue_lock_
+  // held, workers that push to their deque read it without the lock to know whether to signal.
+  Atomic<size_t> waiting_count_;
+  // Tasks added by threads that are not workers, or that did not fit in a worker's deque.
   std::deque<Task*> tasks_ GUARDED_BY(task_queue_lock_);
+  // The size of tasks_, which spinning workers look at without the lock.
+  Atomic<size_t> num_queued_tasks_;
   // TODO: make this immutable/const?
   std::vector<ThreadPoolWorker*> threads_;
   // Work balance detection.
@@ -19,6 +19,7 @@
 #include <string>
 
 #include "atomic.h"
+#include "base/time_utils.h"
 #include "common_runtime_test.h"
 #include "scoped_thread_state_change-inl.h"
 #include "thread-inl.h"
@@ -160,6 +161,160 @@ TEST_F(ThreadPoolTest, RecursiveTest) {
   EXPECT_EQ((1 << depth) - 1, count.LoadSequentiallyConsistent());
 }
 
+// Counts the tasks that did not run on the thread that added them.
+class StolenTask : public Task {
+ public:
+  StolenTask(Thread* owner, AtomicInteger* count, AtomicInteger* stolen_count)
+      : owner_(owner), count_(count), stolen_count_(stolen_count) {}
+
+  void Run(Thread* self) {
+    usleep(100);
+    if (self != owner_) {
+      ++*stolen_count_;
+    }
+    ++*count_;
+  }
+
+  void Finalize() {
+    delete this;
+  }
+
+ private:
+  Thread* const owner_;
+  AtomicInteger* const count_;
+  AtomicInteger* const stolen_count_;
+};
+
+class SpawnTask : public Task {
+ public:
+  SpawnTask(ThreadPool* const thread_pool,
+            AtomicInteger* count,
+            AtomicInteger* stolen_count,
+            size_t num_tasks)
+      : thread_pool_(thread_pool),
+        count_(count),
+        stolen_count_(stolen_count),
+        num_tasks_(num_tasks) {}
+
+  void Run(Thread* self) {
+    std::vector<Task*> tasks;
+    for (size_t i = 0; i < num_tasks_; ++i) {
+      tasks.push_back(new StolenTask(self, count_, stolen_count_));
+    }
+    thread_pool_->AddTasks(self, tasks);
+  }
+
+  void Finalize() {
+    delete this;
+  }
+
+ private:
+  ThreadPool* const thread_pool_;
+  AtomicInteger* const count_;
+  AtomicInteger* const stolen_count_;
+  const size_t num_tasks_;
+};
+
+// Test that the tasks a worker adds to its own deque are taken by the other workers, including
+// when they do not fit in the deque.
+TEST_F(ThreadPoolTest, WorkStealing) {
+  Thread* self = Thread::Current();
+  ThreadPool thread_pool("Thread pool test thread pool", num_threads);
+  for (size_t num_tasks : { static_cast<size_t>(num_threads * 16), TaskDeque::kCapacity + 10 }) {
+    AtomicInteger count(0);
+    AtomicInteger stolen_count(0);
+    thread_pool.AddTask(self, new SpawnTask(&thread_pool, &count, &stolen_count, num_tasks));
+    thread_pool.StartWorkers(self);
+    thread_pool.Wait(self, false, false);
+    thread_pool.StopWorkers(self);
+    EXPECT_EQ(static_cast<int32_t>(num_tasks), count.LoadSequentiallyConsistent());
+    EXPECT_GT(stolen_count.LoadSequentiallyConsistent(), 0);
+    EXPECT_EQ(0u, thread_pool.GetTaskCount(self));
+  }
+}
+
+TEST_F(ThreadPoolTest, AddTasks) {
+  Thread* self = Thread::Current();
+  ThreadPool thread_pool("Thread pool test thread pool", num_threads);
+  AtomicInteger count(0);
+  std::vector<Task*> tasks;
+  for (int32_t i = 0; i < num_threads * 4; ++i) {
+    tasks.push_back(new CountTask(&count));
+  }
+  thread_pool.AddTasks(self, tasks);
+  EXPECT_EQ(tasks.size(), thread_pool.GetTaskCount(self));
+  thread_pool.StartWorkers(self);
+  thread_pool.Wait(self, true, false);
+  EXPECT_EQ(static_cast<int32_t>(tasks.size()), count.LoadSequentiallyConsistent());
+}
+
+// Does a given amount of busy work, and adds its subtasks from the worker like the GC does.
+class SpinningTreeTask : public Task {
+ public:
+  SpinningTreeTask(ThreadPool* const thread_pool, AtomicInteger* count, int depth, size_t work)
+      : thread_pool_(thread_pool), count_(count), depth_(depth), work_(work) {}
+
+  void Run(Thread* self) {
+    if (depth_ > 1) {
+      thread_pool_->AddTask(self, new SpinningTreeTask(thread_pool_, count_, depth_ - 1, work_));
+      thread_pool_->AddTask(self, new SpinningTreeTask(thread_pool_, count_, depth_ - 1, work_));
+    }
+    volatile size_t sum = 0;
+    for (size_t i = 0; i < work_; ++i) {
+      sum += i;
+    }
+    ++*count_;
+  }
+
+  void Finalize() {
+    delete this;
+  }
+
+ private:
+  ThreadPool* const thread_pool_;
+  AtomicInteger* const count_;
+  const int depth_;
+  const size_t work_;
+};
+
+// Measures the number of tasks per second the pool runs for different task sizes, both for tasks
+// added from outside the pool and for tasks added by the workers.
+TEST_F(ThreadPoolTest, Throughput) {
+  static constexpr int kDepth = 14;
+  static constexpr int32_t kNumTasks = (1 << kDepth) - 1;
+  Thread* self = Thread::Current();
+  ThreadPool thread_pool("Thread pool test thread pool", num_threads);
+  for (size_t work : { 0u, 100u, 1000u, 10000u }) {
+    AtomicInteger count(0);
+    std::vector<Task*> tasks;
+    for (int32_t i = 0; i < kNumTasks; ++i) {
+      tasks.push_back(new SpinningTreeTask(&thread_pool, &count, /* depth */ 1, work));
+    }
+    uint64_t start_ns = NanoTime();
+    thread_pool.AddTasks(self, tasks);
+    thread_pool.StartWorkers(self);
+    thread_pool.Wait(self, false, false);
+    uint64_t external_ns = NanoTime() - start_ns;
+    thread_pool.StopWorkers(self);
+    EXPECT_EQ(kNumTasks, count.LoadSequentiallyConsistent());
+
+    count.StoreSequentiallyConsistent(0);
+    start_ns = NanoTime();
+    thread_pool.AddTask(self, new SpinningTreeTask(&thread_pool, &count, kDepth, work));
+    thread_pool.StartWorkers(self);
+    thread_pool.Wait(self, false, false);
+    uint64_t internal_ns = NanoTime() - start_ns;
+    thread_pool.StopWorkers(self);
+    EXPECT_EQ(kNumTasks, count.LoadSequentiallyConsistent());
+
+    LOG(INFO) << "Tasks of " << work << " iterations on " << num_threads << " threads: "
+              << kNumTasks * UINT64_C(1000000000) / std::max<uint64_t>(external_ns, 1u)
+              << " tasks/s added from outside the pool, "
+              << kNumTasks * UINT64_C(1000000000) / std::max<uint64_t>(internal_ns, 1u)
+              << " tasks/s added by the workers";
+  }
+}
+
 class PeerTask : public Task {
  public:
   PeerTask() {}
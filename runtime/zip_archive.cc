@@ -130,7 +130,7 @@ MemMap* ZipEntry::MapDirectlyFromFile(const char* zip_filename, std::string* err
   std::unique_ptr<MemMap> map(
       MemMap::MapFileAtAddress(nullptr,  // Expected pointer address
                                GetUncompressedLength(),  // Byte count
-                               PROT_READ | PROT_WRITE,
+                               PROT_READ,
                                MAP_PRIVATE,
                                zip_fd,
                                offset,
@@ -185,6 +185,39 @@ MemMap* ZipEntry::MapDirectlyFromFile(const char* zip_filename, std::string* err
   return map.release();
 }
 
+MemMap* ZipEntry::MapDirectlyOrExtract(const char* zip_filename,
+                                       const char* entry_filename,
+                                       size_t alignment,
+                                       bool* mapped_directly,
+                                       std::string* error_msg) {
+  std::unique_ptr<MemMap> map;
+  if (IsUncompressed()) {
+    if (!IsAlignedTo(alignment)) {
+      LOG(WARNING) << "Can't mmap " << zip_filename << "!" << entry_filename << " directly; "
+                   << "please zipalign to " << alignment << " bytes. "
+                   << "Falling back to extracting file.";
+    } else {
+      // Map uncompressed files within zip as file-backed to avoid a dirty copy.
+      map.reset(MapDirectlyFromFile(zip_filename, /*out*/error_msg));
+      if (map == nullptr) {
+        LOG(WARNING) << "Can't mmap " << zip_filename << "!" << entry_filename << " directly: "
+                     << *error_msg << "; is your ZIP file corrupted? Falling back to extraction.";
+        // Try again with extraction which still has a chance of recovery.
+        error_msg->clear();
+      }
+    }
+  }
+  if (mapped_directly != nullptr) {
+    *mapped_directly = (map != nullptr);
+  }
+  if (map == nullptr) {
+    // Default path for compressed ZIP entries,
+    // and fallback for stored ZIP entries.
+    map.reset(ExtractToMemMap(zip_filename, entry_filename, error_msg));
+  }
+  return map.release();
+}
+
 static void SetCloseOnExec(int fd) {
   // This dance is more portable than Linux's O_CLOEXEC open(2) flag.
   int flags = fcntl(fd, F_GETFD);
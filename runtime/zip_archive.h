@@ -41,7 +41,7 @@ class ZipEntry {
   // Returns null on failure and sets error_msg.
   MemMap* ExtractToMemMap(const char* zip_filename, const char* entry_filename,
                           std::string* error_msg);
-  // Create a file-backed private (clean, R/W) memory mapping to this entry.
+  // Create a file-backed private (clean, R/O) memory mapping to this entry.
   // 'zip_filename' is used for diagnostics only,
   //   the original file that the ZipArchive was open with is used
   //   for the mapping.
@@ -49,6 +49,16 @@ class ZipEntry {
   // Will only succeed if the entry is stored uncompressed.
   // Returns null on failure and sets error_msg.
   MemMap* MapDirectlyFromFile(const char* zip_filename, /*out*/std::string* error_msg);
+  // Map this entry directly from the file if it is stored uncompressed at an offset aligned to
+  // 'alignment', so that its pages stay clean and can be dropped by the kernel. Otherwise, or if
+  // the mapping fails, extract it to anonymous memory.
+  // If 'mapped_directly' is not null, it is set to whether the entry was mapped from the file.
+  // Returns null on failure and sets error_msg.
+  MemMap* MapDirectlyOrExtract(const char* zip_filename,
+                               const char* entry_filename,
+                               size_t alignment,
+                               /*out*/bool* mapped_directly,
+                               /*out*/std::string* error_msg);
   virtual ~ZipEntry();
 
   uint32_t GetUncompressedLength();
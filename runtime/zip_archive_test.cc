@@ -21,6 +21,9 @@
 #include <sys/types.h>
 #include <zlib.h>
 #include <memory>
+#include <vector>
+
+#include <ziparchive/zip_writer.h>
 
 #include "base/unix_file/fd_file.h"
 #include "common_runtime_test.h"
@@ -63,4 +66,57 @@ TEST_F(ZipArchiveTest, FindAndExtract) {
   EXPECT_EQ(zip_entry->GetCrc32(), computed_crc);
 }
 
+// Writes a zip file with a stored entry "stored.bin" aligned to a page, and a compressed entry
+// "compressed.bin", both with the given contents.
+static void WriteTestZip(const std::string& filename, const std::vector<uint8_t>& contents) {
+  FILE* file = fopen(filename.c_str(), "wb");
+  ASSERT_TRUE(file != nullptr);
+  ZipWriter writer(file);
+  ASSERT_EQ(0, writer.StartAlignedEntry("stored.bin", /* flags */ 0, kPageSize));
+  ASSERT_EQ(0, writer.WriteBytes(contents.data(), contents.size()));
+  ASSERT_EQ(0, writer.FinishEntry());
+  ASSERT_EQ(0, writer.StartEntry("compressed.bin", ZipWriter::kCompress));
+  ASSERT_EQ(0, writer.WriteBytes(contents.data(), contents.size()));
+  ASSERT_EQ(0, writer.FinishEntry());
+  ASSERT_EQ(0, writer.Finish());
+  ASSERT_EQ(0, fclose(file));
+}
+
+TEST_F(ZipArchiveTest, MapDirectlyOrExtract) {
+  std::vector<uint8_t> contents(3 * kPageSize + 5);
+  for (size_t i = 0; i != contents.size(); ++i) {
+    contents[i] = static_cast<uint8_t>(i % 251);
+  }
+  ScratchFile tmp;
+  WriteTestZip(tmp.GetFilename(), contents);
+
+  std::string error_msg;
+  std::unique_ptr<ZipArchive> zip_archive(ZipArchive::Open(tmp.GetFilename().c_str(), &error_msg));
+  ASSERT_TRUE(zip_archive != nullptr) << error_msg;
+
+  // The stored entry is mapped read-only from the zip file.
+  std::unique_ptr<ZipEntry> stored(zip_archive->Find("stored.bin", &error_msg));
+  ASSERT_TRUE(stored != nullptr) << error_msg;
+  ASSERT_TRUE(stored->IsUncompressed());
+  bool mapped_directly = false;
+  std::unique_ptr<MemMap> map(stored->MapDirectlyOrExtract(
+      tmp.GetFilename().c_str(), "stored.bin", kPageSize, &mapped_directly, &error_msg));
+  ASSERT_TRUE(map != nullptr) << error_msg;
+  EXPECT_TRUE(mapped_directly);
+  EXPECT_EQ(PROT_READ, map->GetProtect());
+  ASSERT_EQ(contents.size(), map->Size());
+  EXPECT_EQ(0, memcmp(contents.data(), map->Begin(), contents.size()));
+
+  // The compressed entry has to be extracted.
+  std::unique_ptr<ZipEntry> compressed(zip_archive->Find("compressed.bin", &error_msg));
+  ASSERT_TRUE(compressed != nullptr) << error_msg;
+  ASSERT_FALSE(compressed->IsUncompressed());
+  map.reset(compressed->MapDirectlyOrExtract(
+      tmp.GetFilename().c_str(), "compressed.bin", kPageSize, &mapped_directly, &error_msg));
+  ASSERT_TRUE(map != nullptr) << error_msg;
+  EXPECT_FALSE(mapped_directly);
+  ASSERT_EQ(contents.size(), map->Size());
+  EXPECT_EQ(0, memcmp(contents.data(), map->Begin(), contents.size()));
+}
+
 }  // namespace art
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include "art_method-inl.h"
+#include "dex_file.h"
+#include "jit/jit.h"
+#include "jit/profile_compilation_info.h"
+#include "jni.h"
+#include "mirror/class-inl.h"
+#include "os.h"
+#include "runtime.h"
+#include "scoped_thread_state_change-inl.h"
+#include "ScopedUtfChars.h"
+#include "thread.h"
+
+namespace art {
+namespace {
+
+ArtMethod* FindStaticMethod(const ScopedObjectAccess& soa, jclass cls, jstring method_name)
+    REQUIRES_SHARED(Locks::mutator_lock_) {
+  ScopedUtfChars chars(soa.Env(), method_name);
+  CHECK(chars.c_str() != nullptr);
+  ArtMethod* method = soa.Decode<mirror::Class>(cls)->FindDeclaredDirectMethodByName(
+      chars.c_str(), kRuntimePointerSize);
+  CHECK(method != nullptr) << "Unable to find method called " << chars.c_str();
+  return method;
+}
+
+extern "C" JNIEXPORT void JNICALL Java_Main_writeSeedProfile(JNIEnv* env,
+                                                            jclass,
+                                                            jstring filename,
+                                                            jclass cls,
+                                                            jstring method_name) {
+  ProfileCompilationInfo info;
+  {
+    ScopedObjectAccess soa(env);
+    ArtMethod* method = FindStaticMethod(soa, cls, method_name);
+    const DexFile* dex_file = method->GetDexFile();
+    CHECK(info.AddMethodIndex(dex_file->GetLocation(),
+                              dex_file->GetLocationChecksum(),
+                              method->GetDexMethodIndex()));
+  }
+  ScopedUtfChars filename_chars(env, filename);
+  CHECK(filename_chars.c_str() != nullptr);
+  std::unique_ptr<File> file(OS::CreateEmptyFile(filename_chars.c_str()));
+  CHECK(file != nullptr) << filename_chars.c_str();
+  CHECK(info.Save(file->Fd()));
+  CHECK_EQ(file->FlushClose(), 0);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL Java_Main_isSeededMethod(JNIEnv* env,
+                                                               jclass,
+                                                               jclass cls,
+                                                               jstring method_name) {
+  ScopedObjectAccess soa(env);
+  return Runtime::Current()->GetJit()->IsSeededHotMethod(FindStaticMethod(soa, cls, method_name));
+}
+
+extern "C" JNIEXPORT void JNICALL Java_Main_waitForSeededMethod(JNIEnv* env,
+                                                                jclass,
+                                                                jclass cls,
+                                                                jstring method_name) {
+  // The profile is loaded on the JIT thread.
+  while (true) {
+    {
+      ScopedObjectAccess soa(env);
+      if (Runtime::Current()->GetJit()->IsSeededHotMethod(
+              FindStaticMethod(soa, cls, method_name))) {
+        return;
+      }
+    }
+    usleep(1000);
+  }
+}
+
+extern "C" JNIEXPORT jint JNICALL Java_Main_getHotMethodThreshold(JNIEnv*, jclass) {
+  return Runtime::Current()->GetJit()->HotMethodThreshold();
+}
+
+}  // namespace
+}  // namespace art
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.io.File;
+import java.io.IOException;
+import java.lang.reflect.Method;
+
+public class Main {
+
+  public static void main(String[] args) throws Exception {
+    System.loadLibrary(args[0]);
+    if (!hasJit()) {
+      // Seeding only applies to JIT compilation.
+      return;
+    }
+
+    File file = null;
+    try {
+      // The profile of a "previous run" that found $noinline$seeded hot.
+      file = createTempFile();
+      writeSeedProfile(file.getPath(), Main.class, "$noinline$seeded");
+      String codePath = System.getenv("DEX_LOCATION") + "/988-jit-seed-from-profile.jar";
+      VMRuntime.registerAppInfo(file.getPath(), new String[] {codePath});
+
+      waitForSeededMethod(Main.class, "$noinline$seeded");
+      if (isSeededMethod(Main.class, "$noinline$notSeeded")) {
+        throw new Error("Unexpected seeded method");
+      }
+
+      // Make both methods warm, far from the hot threshold.
+      for (int i = 0; i < 1000; ++i) {
+        $noinline$seeded();
+        $noinline$notSeeded();
+      }
+
+      // The seeded method was queued for compilation when it became warm, which moves its
+      // counter to the hot threshold.
+      int hotThreshold = getHotMethodThreshold();
+      if (getHotnessCounter(Main.class, "$noinline$seeded") < hotThreshold) {
+        throw new Error("Seeded method was not queued as hot");
+      }
+      if (getHotnessCounter(Main.class, "$noinline$notSeeded") >= hotThreshold) {
+        throw new Error("Method not in the profile was queued as hot");
+      }
+    } finally {
+      if (file != null) {
+        file.delete();
+      }
+    }
+  }
+
+  public static int $noinline$seeded() {
+    if (doThrow) throw new Error();
+    return 1;
+  }
+
+  public static int $noinline$notSeeded() {
+    if (doThrow) throw new Error();
+    return 2;
+  }
+
+  public static native boolean hasJit();
+  public static native int getHotnessCounter(Class<?> cls, String methodName);
+  // Writes a profile with the given method as the only hot method.
+  public static native void writeSeedProfile(String profile, Class<?> cls, String methodName);
+  // Checks if the JIT seed profile lists the method.
+  public static native boolean isSeededMethod(Class<?> cls, String methodName);
+  // Waits until the JIT has loaded a seed profile listing the method.
+  public static native void waitForSeededMethod(Class<?> cls, String methodName);
+  public static native int getHotMethodThreshold();
+
+  public static boolean doThrow = false;
+  private static final String TEMP_FILE_NAME_PREFIX = "dummy";
+  private static final String TEMP_FILE_NAME_SUFFIX = "-file";
+
+  private static File createTempFile() throws Exception {
+    try {
+      return File.createTempFile(TEMP_FILE_NAME_PREFIX, TEMP_FILE_NAME_SUFFIX);
+    } catch (IOException e) {
+      System.setProperty("java.io.tmpdir", "/data/local/tmp");
+      try {
+        return File.createTempFile(TEMP_FILE_NAME_PREFIX, TEMP_FILE_NAME_SUFFIX);
+      } catch (IOException e2) {
+        System.setProperty("java.io.tmpdir", "/sdcard");
+        return File.createTempFile(TEMP_FILE_NAME_PREFIX, TEMP_FILE_NAME_SUFFIX);
+      }
+    }
+  }
+
+  private static class VMRuntime {
+    private static final Method registerAppInfoMethod;
+    static {
+      try {
+        Class<? extends Object> c = Class.forName("dalvik.system.VMRuntime");
+        registerAppInfoMethod = c.getDeclaredMethod("registerAppInfo",
+            String.class, String[].class);
+      } catch (Exception e) {
+        throw new RuntimeException(e);
+      }
+    }
+
+    public static void registerAppInfo(String profile, String[] codePaths)
+        throws Exception {
+      registerAppInfoMethod.invoke(null, profile, codePaths);
+    }
+  }
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// CompiledMethodCacheA and CompiledMethodCacheB only differ in Base.constant().
+
+class Base {
+    static int constant() {
+        return 2;
+    }
+
+    int value() {
+        return constant();
+    }
+}
+
+class Derived extends Base {
+    int twice() {
+        return constant() * 2;
+    }
+}
+
+class Caller {
+    static int call() {
+        return Base.constant() + 1;
+    }
+}
+
+class Unrelated {
+    static int compute(int x) {
+        return x * 3 + 1;
+    }
+}